@@ -0,0 +1,240 @@
+/**
+ * @file bench.c
+ *
+ * @brief Замеры производительности: измерение, статистика и отчет JSON
+ */
+
+#include "bench.h"
+
+#include "matrix/simd.h"
+#include "matrix/thread_pool.h"
+#include "matrix/trace.h"
+#include "matrix/tune.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// Наибольшее число вызовов в выборке
+#define BENCH_MAX_ITERATIONS 10000000
+
+/// Наименьшее число выборок замера
+#define BENCH_MIN_SAMPLES 5
+
+/// Длина строки отчета при сравнении
+#define BENCH_LINE 512
+
+/**
+ * @brief Форма замера в виде "m x n x k"
+ */
+const char* bench_shape (const BenchCase* bench, char* buffer, size_t size) {
+    if (bench->k > 0)
+        snprintf (buffer, size, "%dx%dx%d", bench->m, bench->n, bench->k);
+    else
+        snprintf (buffer, size, "%dx%d", bench->m, bench->n);
+
+    return buffer;
+}
+
+/**
+ * @brief Сравнение времен для qsort
+ */
+static int compare_times (const void* a, const void* b) {
+    const double x = *(const double*) a;
+    const double y = *(const double*) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Выполняет замер
+ *
+ * Первый вызов разогревает кэши и оценивает длительность вызова, по ней
+ * выбирается число вызовов в выборке. Выборки собираются, пока не набрано
+ * samples или не истрачен budget_ns (но не меньше BENCH_MIN_SAMPLES).
+ */
+int bench_measure (const BenchCase* bench, void* ctx, const BenchOptions* options,
+                   BenchResult* result) {
+    double* times = malloc ((size_t) options->samples * sizeof (double));
+    int     res   = -1;
+
+    if (times) {
+        const double start  = (double) trace_now ();
+        double       single = 0;
+        double       spent  = 0;
+        int          count  = 0;
+        int          iterations;
+
+        bench->run (ctx);
+        single     = fmax ((double) trace_now () - start, 1);
+        iterations = single >= options->sample_ns
+                       ? 1
+                       : (int) fmin (ceil (options->sample_ns / single),
+                                     BENCH_MAX_ITERATIONS);
+
+        while (count < options->samples &&
+               (count < BENCH_MIN_SAMPLES || spent < options->budget_ns)) {
+            const double begin = (double) trace_now ();
+            for (int i = 0; i < iterations; i++) bench->run (ctx);
+            const double elapsed = (double) trace_now () - begin;
+            times[count++]       = elapsed / iterations;
+            spent += elapsed;
+        }
+
+        qsort (times, (size_t) count, sizeof (double), compare_times);
+        result->iterations = iterations;
+        result->samples    = count;
+        result->median_ns  = count % 2
+                               ? times[count / 2]
+                               : (times[count / 2 - 1] + times[count / 2]) / 2;
+        result->p99_ns     = times[(int) ceil (0.99 * count) - 1];
+        result->min_ns     = times[0];
+        result->gflops     = bench->flops / result->median_ns;
+        result->gbps       = bench->bytes / result->median_ns;
+        free (times);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Начинает отчет JSON
+ */
+void bench_json_begin (FILE* out, const char* commit) {
+    char      cpu[256];
+    char      stamp[32];
+    time_t    now = time (NULL);
+    struct tm utc;
+
+    gmtime_r (&now, &utc);
+    strftime (stamp, sizeof stamp, "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    fprintf (out, "{\n  \"schema\": 1,\n  \"commit\": ");
+    trace_json_string (out, commit && *commit ? commit : "unknown");
+    fprintf (out, ",\n  \"timestamp\": \"%s\",\n  \"cpu\": ", stamp);
+    trace_json_string (out, tune_cpu_model (cpu, sizeof cpu));
+    fprintf (out, ",\n  \"simd\": \"%s\",\n  \"threads\": %d,\n  \"compiler\": ",
+             simd_kernels ()->name, thread_pool_threads ());
+    trace_json_string (out, __VERSION__);
+    fprintf (out, ",\n  \"results\": [\n");
+}
+
+/**
+ * @brief Записывает результат замера строкой отчета
+ */
+void bench_json_result (FILE* out, const BenchCase* bench, const BenchResult* result,
+                        int first) {
+    char shape[64];
+
+    fprintf (out,
+             "%s    {\"name\": \"%s\", \"shape\": \"%s\", \"m\": %d, \"n\": %d, "
+             "\"k\": %d, \"iterations\": %d, \"samples\": %d, \"median_ns\": %.1f, "
+             "\"p99_ns\": %.1f, \"min_ns\": %.1f, \"gflops\": %.3f, \"gbps\": %.3f}",
+             first ? "" : ",\n", bench->name,
+             bench_shape (bench, shape, sizeof shape), bench->m, bench->n, bench->k,
+             result->iterations, result->samples, result->median_ns, result->p99_ns,
+             result->min_ns, result->gflops, result->gbps);
+}
+
+/**
+ * @brief Завершает отчет JSON
+ */
+void bench_json_end (FILE* out) {
+    fprintf (out, "\n  ]\n}\n");
+}
+
+/**
+ * @brief Значение строкового поля "key": "value" строки отчета
+ */
+static int read_string (const char* line, const char* key, char* value,
+                        size_t size) {
+    const char* p   = strstr (line, key);
+    int         res = -1;
+
+    if (p) {
+        const char* begin = p + strlen (key);
+        const char* end   = strchr (begin, '"');
+        if (end && (size_t) (end - begin) < size) {
+            memcpy (value, begin, (size_t) (end - begin));
+            value[end - begin] = '\0';
+            res                = 0;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief Читает результаты отчета
+ */
+int bench_report_read (const char* filename, BenchReport* report) {
+    FILE* f    = fopen (filename, "r");
+    int   size = 0;
+    char  line[BENCH_LINE * 2];
+
+    report->entries = NULL;
+    report->count   = 0;
+    while (f && fgets (line, sizeof line, f)) {
+        BenchEntry  entry;
+        const char* median = strstr (line, "\"median_ns\": ");
+        if (median &&
+            read_string (line, "\"name\": \"", entry.name, sizeof entry.name) == 0 &&
+            read_string (line, "\"shape\": \"", entry.shape, sizeof entry.shape) ==
+                0) {
+            entry.median = strtod (median + strlen ("\"median_ns\": "), NULL);
+            if (report->count == size) {
+                const int   grown_size = size ? size * 2 : 64;
+                BenchEntry* grown =
+                    realloc (report->entries, (size_t) grown_size * sizeof *grown);
+                if (!grown) break;
+                report->entries = grown;
+                size            = grown_size;
+            }
+            report->entries[report->count++] = entry;
+        }
+    }
+    if (f) fclose (f);
+
+    return report->entries ? 0 : -1;
+}
+
+/**
+ * @brief Освобождает результаты отчета
+ */
+void bench_report_free (BenchReport* report) {
+    free (report->entries);
+    report->entries = NULL;
+    report->count   = 0;
+}
+
+/**
+ * @brief Печатает ускорение относительно прежнего отчета
+ */
+int bench_compare (const BenchReport* baseline, const char* current) {
+    BenchReport now;
+    int         res = -1;
+
+    if (bench_report_read (current, &now) == 0) {
+        printf ("\n%-16s %-16s %14s %14s %9s\n", "operation", "shape", "base, ns",
+                "current, ns", "speedup");
+        for (int i = 0; i < now.count; i++) {
+            const BenchEntry* entry = &now.entries[i];
+            for (int j = 0; j < baseline->count; j++) {
+                const BenchEntry* base = &baseline->entries[j];
+                if (strcmp (entry->name, base->name) == 0 &&
+                    strcmp (entry->shape, base->shape) == 0) {
+                    printf ("%-16s %-16s %14.1f %14.1f %8.2fx\n", entry->name,
+                            entry->shape, base->median, entry->median,
+                            base->median / entry->median);
+                    break;
+                }
+            }
+        }
+        res = 0;
+    }
+    bench_report_free (&now);
+
+    return res;
+}
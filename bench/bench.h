@@ -0,0 +1,156 @@
+/**
+ * @file bench.h
+ *
+ * @brief Замеры производительности: измерение, статистика и отчет JSON
+ *
+ * @details
+ * Замер состоит из выборок; выборка - iterations вызовов подряд, число
+ * вызовов подбирается так, чтобы выборка длилась не меньше sample_ns
+ * (таймер не вносит заметной погрешности в быстрые операции). По
+ * выборкам считаются медиана, 99-й процентиль и минимум времени одного
+ * вызова, а из медианы - GFLOP/s и GB/s.
+ *
+ * Отчет JSON пишет каждый результат отдельной строкой с постоянным
+ * порядком полей, поэтому отчеты разных коммитов сравниваются построчно
+ * (bench_compare ()).
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+
+/**
+ * @struct BenchCase
+ * @brief Один замер: операция над операндами заданной формы
+ */
+typedef struct {
+    const char* name;                ///< Операция ("multiply", "add", ...)
+    int         m;                   ///< Строк результата
+    int         n;                   ///< Столбцов результата
+    int         k;                   ///< Общая размерность (0 - нет)
+    int         quick;               ///< Входит в быстрый набор
+    double      flops;               ///< Операций с плавающей точкой на вызов
+    double      bytes;               ///< Байт, прочитанных и записанных за вызов
+    int (*setup) (void* ctx);        ///< Подготовка операндов (0 - успех)
+    void (*run) (void* ctx);         ///< Один вызов операции
+    void (*teardown) (void* ctx);    ///< Освобождение операндов
+} BenchCase;
+
+/**
+ * @struct BenchResult
+ * @brief Статистика замера
+ */
+typedef struct {
+    int    iterations;   ///< Вызовов в выборке
+    int    samples;      ///< Число выборок
+    double median_ns;    ///< Медиана времени вызова
+    double p99_ns;       ///< 99-й процентиль времени вызова
+    double min_ns;       ///< Минимальное время вызова
+    double gflops;       ///< Производительность по медиане
+    double gbps;         ///< Пропускная способность по медиане
+} BenchResult;
+
+/**
+ * @struct BenchOptions
+ * @brief Параметры прогона
+ */
+typedef struct {
+    int         samples;     ///< Наибольшее число выборок
+    double      sample_ns;   ///< Наименьшая длительность выборки
+    double      budget_ns;   ///< Время на один замер (не меньше 5 выборок)
+    int         quick;       ///< Только быстрый набор
+    const char* filter;      ///< Подстрока имени замера или NULL
+} BenchOptions;
+
+/**
+ * @brief Форма замера в виде "m x n x k" ("512x512x512", "1024x1024")
+ * @param bench Замер
+ * @param buffer Буфер
+ * @param size Размер буфера
+ * @return buffer
+ */
+const char* bench_shape (const BenchCase* bench, char* buffer, size_t size);
+
+/**
+ * @brief Выполняет замер
+ * @param bench Замер (setup уже выполнен)
+ * @param ctx Контекст операции
+ * @param options Параметры прогона
+ * @param result Статистика
+ * @return 0 при успехе, -1 при ошибке выделения памяти
+ */
+int bench_measure (const BenchCase* bench, void* ctx, const BenchOptions* options,
+                   BenchResult* result);
+
+/**
+ * @brief Начинает отчет JSON: сведения о коммите, процессоре и сборке
+ * @param out Поток отчета
+ * @param commit Идентификатор коммита или NULL
+ */
+void bench_json_begin (FILE* out, const char* commit);
+
+/**
+ * @brief Записывает результат замера строкой отчета
+ * @param out Поток отчета
+ * @param bench Замер
+ * @param result Статистика
+ * @param first Первый результат отчета (без запятой перед ним)
+ */
+void bench_json_result (FILE* out, const BenchCase* bench, const BenchResult* result,
+                        int first);
+
+/**
+ * @brief Завершает отчет JSON
+ * @param out Поток отчета
+ */
+void bench_json_end (FILE* out);
+
+/**
+ * @struct BenchEntry
+ * @brief Результат, прочитанный из отчета
+ */
+typedef struct {
+    char   name[64];    ///< Операция
+    char   shape[64];   ///< Форма
+    double median;      ///< Медиана времени вызова
+} BenchEntry;
+
+/**
+ * @struct BenchReport
+ * @brief Результаты отчета
+ */
+typedef struct {
+    BenchEntry* entries;   ///< Результаты
+    int         count;     ///< Число результатов
+} BenchReport;
+
+/**
+ * @brief Читает результаты отчета
+ * @param filename Файл отчета
+ * @param report Результаты (освобождаются bench_report_free ())
+ * @note Прежний отчет читается до замеров: новый отчет может заменить
+ * тот же файл
+ * @return 0 при успехе, -1 если отчет не читается или пуст
+ */
+int bench_report_read (const char* filename, BenchReport* report);
+
+/**
+ * @brief Освобождает результаты отчета
+ * @param report Результаты
+ */
+void bench_report_free (BenchReport* report);
+
+/**
+ * @brief Печатает ускорение относительно прежнего отчета
+ *
+ * Замеры сопоставляются по имени и форме, ускорение - отношение медиан
+ * (больше 1 - быстрее).
+ *
+ * @param baseline Результаты прежнего отчета
+ * @param current Файл нового отчета
+ * @return 0 при успехе, -1 если новый отчет не читается
+ */
+int bench_compare (const BenchReport* baseline, const char* current);
+
+#endif   // BENCH_H
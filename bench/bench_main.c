@@ -0,0 +1,428 @@
+/**
+ * @file bench_main.c
+ *
+ * @brief Набор замеров операций библиотеки и точка входа make bench
+ *
+ * @details
+ * Замеры проходят размеры и формы операндов для multiply_matrices (),
+ * add_matrices (), subtract_matrices (), transpose_matrix (), determinant ()
+ * и путей загрузки и сохранения. Итоги печатаются таблицей, отчет JSON
+ * пишется в файл --json; --compare сравнивает его с прежним отчетом,
+ * который читается до замеров и может совпадать с файлом --json.
+ *
+ * --tune вместо замеров подбирает параметры умножения под процессор
+ * (tune.h) и сохраняет их в файл настроек --tune-file (по умолчанию -
+ * файл, который библиотека загружает при запуске).
+ *
+ * @code
+ * matrix_bench [--quick] [--filter multiply] [--json out.json]
+ *              [--compare base.json] [--samples N] [--budget SEC]
+ * matrix_bench --tune [--quick] [--tune-file matrix_tune.txt]
+ * @endcode
+ */
+
+#include "bench.h"
+
+#include "matrix/matrix.h"
+#include "matrix/tune.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/// Размер элемента
+#define ELEM ((double) sizeof (MATRIX_TYPE))
+
+/**
+ * @struct BenchData
+ * @brief Операнды замера
+ */
+typedef struct {
+    const BenchCase* bench;      ///< Замер
+    Matrix           A;          ///< Первый операнд
+    Matrix           B;          ///< Второй операнд
+    Matrix           C;          ///< Результат
+    double           checksum;   ///< Накопитель, не дающий выбросить вызовы
+} BenchData;
+
+/// Временный файл замеров загрузки и сохранения (create_bench_file ())
+static char bench_file[1024];
+
+/**
+ * @brief Создает временный файл замеров в $TMPDIR (по умолчанию /tmp)
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int create_bench_file (void) {
+    const char* dir = getenv ("TMPDIR");
+    int         fd  = -1;
+
+    if (!dir || !*dir) dir = "/tmp";
+    if (snprintf (bench_file, sizeof bench_file, "%s/matrix_bench.XXXXXX", dir) <
+        (int) sizeof bench_file)
+        fd = mkstemp (bench_file);
+    if (fd >= 0) close (fd);
+
+    return fd >= 0 ? 0 : -1;
+}
+
+/**
+ * @brief Заполняет матрицу значениями без вырождения
+ */
+static void fill (Matrix* m, int seed) {
+    for (int i = 0; i < m->rows; i++)
+        for (int j = 0; j < m->cols; j++)
+            MATRIX_AT (m, i, j) =
+                (double) ((i * 31 + j * 17 + seed) % 97) / 97 + (i == j) * m->cols;
+}
+
+/**
+ * @brief Подготовка C = op (A, B) с A m x k, B k x n (или m x n без k)
+ */
+static int setup_binary (void* ctx) {
+    BenchData*       d     = ctx;
+    const BenchCase* b     = d->bench;
+    const int        inner = b->k > 0 ? b->k : b->n;
+
+    d->A = create_matrix (b->m, inner);
+    d->B = create_matrix (b->k > 0 ? b->k : b->m, b->n);
+    d->C = create_matrix (b->m, b->n);
+    fill (&d->A, 1);
+    fill (&d->B, 2);
+
+    return d->A.data && d->B.data && d->C.data ? 0 : -1;
+}
+
+/**
+ * @brief Подготовка операций над одной матрицей m x n
+ */
+static int setup_unary (void* ctx) {
+    BenchData* d = ctx;
+
+    d->A = create_matrix (d->bench->m, d->bench->n);
+    fill (&d->A, 3);
+
+    return d->A.data ? 0 : -1;
+}
+
+/**
+ * @brief Подготовка загрузки: файл записывается заранее
+ */
+static int setup_load_text (void* ctx) {
+    BenchData* d = ctx;
+
+    return setup_unary (ctx) == 0 && save_matrix_to_file (&d->A, bench_file) == 0
+             ? 0
+             : -1;
+}
+
+/**
+ * @brief Подготовка отображения двоичного файла
+ */
+static int setup_load_binary (void* ctx) {
+    BenchData* d = ctx;
+
+    return setup_unary (ctx) == 0 && save_matrix_binary (&d->A, bench_file) == 0
+             ? 0
+             : -1;
+}
+
+/**
+ * @brief Освобождает операнды
+ */
+static void teardown (void* ctx) {
+    BenchData* d = ctx;
+
+    free_matrix (&d->A);
+    free_matrix (&d->B);
+    free_matrix (&d->C);
+}
+
+static void run_multiply (void* ctx) {
+    BenchData* d = ctx;
+    multiply_matrices (&d->A, &d->B, &d->C);
+}
+
+static void run_add (void* ctx) {
+    BenchData* d = ctx;
+    add_matrices (&d->A, &d->B, &d->C);
+}
+
+static void run_subtract (void* ctx) {
+    BenchData* d = ctx;
+    subtract_matrices (&d->A, &d->B, &d->C);
+}
+
+static void run_transpose (void* ctx) {
+    BenchData* d = ctx;
+    Matrix     t = transpose_matrix (&d->A);
+    free_matrix (&t);
+}
+
+static void run_determinant (void* ctx) {
+    BenchData* d = ctx;
+    d->checksum += determinant (&d->A);
+}
+
+static void run_save_text (void* ctx) {
+    BenchData* d = ctx;
+    save_matrix_to_file (&d->A, bench_file);
+}
+
+static void run_load_text (void* ctx) {
+    Matrix m = load_matrix_from_file (bench_file);
+    (void) ctx;
+    free_matrix (&m);
+}
+
+static void run_save_binary (void* ctx) {
+    BenchData* d = ctx;
+    save_matrix_binary (&d->A, bench_file);
+}
+
+/**
+ * @brief Отображение файла и чтение всех элементов
+ */
+static void run_load_binary (void* ctx) {
+    BenchData* d = ctx;
+    Matrix     m = load_matrix_binary (bench_file, 0);
+    for (int i = 0; i < m.rows; i++)
+        for (int j = 0; j < m.cols; j++) d->checksum += MATRIX_AT (&m, i, j);
+    free_matrix (&m);
+}
+
+/// Замер C = A x B (m x k на k x n)
+#define MULTIPLY(m, n, k, quick)                                                   \
+    {"multiply",                                                                   \
+     m,                                                                            \
+     n,                                                                            \
+     k,                                                                            \
+     quick,                                                                        \
+     2.0 * (m) * (n) * (k),                                                        \
+     ELEM * ((double) (m) * (k) + (double) (k) * (n) + (double) (m) * (n)),        \
+     setup_binary,                                                                 \
+     run_multiply,                                                                 \
+     teardown}
+
+/// Поэлементный замер: name - операция, run - функция вызова
+#define ELEMENTWISE(name, run, m, n, quick)                                        \
+    {name, m, n, 0, quick, (double) (m) * (n), 3 * ELEM * (m) * (n),               \
+     setup_binary, run, teardown}
+
+/// Замер над одной матрицей m x n
+#define UNARY(name, setup, run, m, n, quick, flops, bytes)                         \
+    {name, m, n, 0, quick, flops, bytes, setup, run, teardown}
+
+/// Детерминант n x n: 2n^3 / 3 операций LU, копия читается и пишется
+#define DETERMINANT(size, quick)                                                   \
+    UNARY ("determinant", setup_unary, run_determinant, size, size, quick,         \
+           2.0 * (size) * (size) * (size) / 3, 2 * ELEM * (size) * (size))
+
+/// Транспонирование m x n: каждый элемент читается и пишется
+#define TRANSPOSE(m, n, quick)                                                     \
+    UNARY ("transpose", setup_unary, run_transpose, m, n, quick, 0,               \
+           2 * ELEM * (m) * (n))
+
+/// Загрузка и сохранение: bytes - объем данных матрицы
+#define IO(name, setup, run, m, n, quick)                                          \
+    UNARY (name, setup, run, m, n, quick, 0, ELEM * (m) * (n))
+
+static const BenchCase bench_cases[] = {
+    MULTIPLY (4, 4, 4, 1),
+    MULTIPLY (8, 8, 8, 1),
+    MULTIPLY (16, 16, 16, 1),
+    MULTIPLY (32, 32, 32, 1),
+    MULTIPLY (64, 64, 64, 1),
+    MULTIPLY (128, 128, 128, 1),
+    MULTIPLY (256, 256, 256, 1),
+    MULTIPLY (512, 512, 512, 0),
+    MULTIPLY (1024, 1024, 1024, 0),
+    MULTIPLY (2048, 2048, 64, 0),
+    MULTIPLY (64, 64, 4096, 0),
+    MULTIPLY (4096, 16, 256, 0),
+    MULTIPLY (1, 1024, 1024, 1),
+
+    ELEMENTWISE ("add", run_add, 16, 16, 1),
+    ELEMENTWISE ("add", run_add, 256, 256, 1),
+    ELEMENTWISE ("add", run_add, 1024, 1024, 0),
+    ELEMENTWISE ("add", run_add, 2048, 2048, 0),
+    ELEMENTWISE ("add", run_add, 100000, 3, 0),
+    ELEMENTWISE ("subtract", run_subtract, 16, 16, 1),
+    ELEMENTWISE ("subtract", run_subtract, 256, 256, 1),
+    ELEMENTWISE ("subtract", run_subtract, 1024, 1024, 0),
+    ELEMENTWISE ("subtract", run_subtract, 2048, 2048, 0),
+
+    TRANSPOSE (8, 8, 1),
+    TRANSPOSE (64, 64, 1),
+    TRANSPOSE (256, 256, 1),
+    TRANSPOSE (1024, 1024, 0),
+    TRANSPOSE (2048, 2048, 0),
+    TRANSPOSE (4096, 256, 0),
+
+    DETERMINANT (3, 1),
+    DETERMINANT (4, 1),
+    DETERMINANT (8, 1),
+    DETERMINANT (16, 1),
+    DETERMINANT (64, 1),
+    DETERMINANT (256, 0),
+    DETERMINANT (512, 0),
+
+    IO ("save_text", setup_unary, run_save_text, 64, 64, 1),
+    IO ("save_text", setup_unary, run_save_text, 512, 512, 0),
+    IO ("load_text", setup_load_text, run_load_text, 64, 64, 1),
+    IO ("load_text", setup_load_text, run_load_text, 512, 512, 0),
+    IO ("save_binary", setup_unary, run_save_binary, 512, 512, 1),
+    IO ("save_binary", setup_unary, run_save_binary, 2048, 2048, 0),
+    IO ("load_binary", setup_load_binary, run_load_binary, 512, 512, 1),
+    IO ("load_binary", setup_load_binary, run_load_binary, 2048, 2048, 0),
+};
+
+/**
+ * @brief Печатает подсказку по параметрам
+ */
+static void usage (const char* program) {
+    fprintf (stderr,
+             "Использование: %s [--quick] [--filter подстрока] [--json файл]\n"
+             "       [--compare прежний.json] [--samples N] [--budget секунды]\n"
+             "       %s --tune [--quick] [--tune-file файл]\n",
+             program, program);
+}
+
+/**
+ * @brief Подбирает параметры умножения и сохраняет их в файл настроек
+ *
+ * @return EXIT_SUCCESS или EXIT_FAILURE
+ */
+static int run_tune (int quick, const char* filename) {
+    TuneParams params;
+    char       path[1024];
+    int        status = EXIT_FAILURE;
+
+    printf ("Подбор параметров (%s)...\n", quick ? "quick" : "full");
+    fflush (stdout);
+    if (!filename) filename = tune_default_file (path, sizeof path);
+
+    if (tune_run (quick ? TUNE_QUICK : TUNE_FULL, &params) != 0) {
+        fprintf (stderr, "Не удалось выделить память для замеров\n");
+    } else {
+        printf ("gemm: mc %d, kc %d, nc %d, порог %d\n", params.gemm.mc,
+                params.gemm.kc, params.gemm.nc, params.gemm.threshold);
+        printf ("strassen: порог %d, переход %d\n", params.strassen.threshold,
+                params.strassen.crossover);
+        if (filename && tune_save (filename, &params) == 0) {
+            printf ("Параметры сохранены в %s\n", filename);
+            status = EXIT_SUCCESS;
+        } else {
+            fprintf (stderr, "Не удалось сохранить параметры%s%s\n",
+                     filename ? " в " : "", filename ? filename : "");
+        }
+    }
+
+    return status;
+}
+
+int main (int argc, char** argv) {
+    BenchOptions options  = {51, 1e6, 2e9, 0, NULL};
+    BenchReport  base     = {NULL, 0};
+    const char*  json     = NULL;
+    const char*  baseline = NULL;
+    const char*  tune     = NULL;
+    int          tuning   = 0;
+    FILE*        out      = NULL;
+    int          first    = 1;
+    int          status   = EXIT_SUCCESS;
+
+    for (int i = 1; i < argc && status == EXIT_SUCCESS; i++) {
+        const int has_value = i + 1 < argc;
+        if (strcmp (argv[i], "--quick") == 0) {
+            options.quick     = 1;
+            options.budget_ns = 3e8;
+        } else if (strcmp (argv[i], "--filter") == 0 && has_value)
+            options.filter = argv[++i];
+        else if (strcmp (argv[i], "--json") == 0 && has_value) json = argv[++i];
+        else if (strcmp (argv[i], "--compare") == 0 && has_value)
+            baseline = argv[++i];
+        else if (strcmp (argv[i], "--samples") == 0 && has_value)
+            options.samples = atoi (argv[++i]);
+        else if (strcmp (argv[i], "--budget") == 0 && has_value)
+            options.budget_ns = atof (argv[++i]) * 1e9;
+        else if (strcmp (argv[i], "--tune") == 0) tuning = 1;
+        else if (strcmp (argv[i], "--tune-file") == 0 && has_value)
+            tune = argv[++i];
+        else status = EXIT_FAILURE;
+    }
+    if (options.samples < 1) status = EXIT_FAILURE;
+
+    if (status == EXIT_SUCCESS && baseline && !tuning) {
+        // Прежний отчет читается до того, как --json заменит тот же файл
+        if (!json) {
+            fprintf (stderr, "--compare требует --json\n");
+            status = EXIT_FAILURE;
+        } else if (bench_report_read (baseline, &base) != 0) {
+            fprintf (stderr, "Не удалось прочитать отчет %s\n", baseline);
+            status = EXIT_FAILURE;
+        }
+    }
+    if (status == EXIT_SUCCESS && !tuning && create_bench_file () != 0) {
+        fprintf (stderr, "Не удалось создать временный файл замеров\n");
+        status = EXIT_FAILURE;
+    }
+    if (status == EXIT_SUCCESS && json && !tuning) {
+        out = fopen (json, "w");
+        if (!out) {
+            fprintf (stderr, "Не удалось открыть %s\n", json);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    if (status == EXIT_SUCCESS && tuning) {
+        status = run_tune (options.quick, tune);
+    } else if (status == EXIT_SUCCESS) {
+        if (out) bench_json_begin (out, getenv ("BENCH_COMMIT"));
+        printf ("%-12s %-16s %12s %12s %10s %10s\n", "operation", "shape",
+                "median, ns", "p99, ns", "GFLOP/s", "GB/s");
+
+        for (size_t i = 0; i < sizeof bench_cases / sizeof bench_cases[0]; i++) {
+            const BenchCase* bench = &bench_cases[i];
+            BenchData        data  = {bench, {0}, {0}, {0}, 0};
+            BenchResult      result;
+            char             shape[64];
+
+            if ((options.quick && !bench->quick) ||
+                (options.filter && !strstr (bench->name, options.filter)))
+                continue;
+
+            bench_shape (bench, shape, sizeof shape);
+            if (bench->setup (&data) == 0 &&
+                bench_measure (bench, &data, &options, &result) == 0) {
+                printf ("%-12s %-16s %12.1f %12.1f %10.3f %10.3f\n", bench->name,
+                        shape, result.median_ns, result.p99_ns, result.gflops,
+                        result.gbps);
+                fflush (stdout);
+                if (out) bench_json_result (out, bench, &result, first);
+                first = 0;
+            } else {
+                fprintf (stderr, "%s %s: ошибка подготовки замера\n", bench->name,
+                         shape);
+                status = EXIT_FAILURE;
+            }
+            bench->teardown (&data);
+        }
+
+        if (out) {
+            bench_json_end (out);
+            fclose (out);
+        }
+        if (base.entries && bench_compare (&base, json) != 0) {
+            fprintf (stderr, "Не удалось сравнить %s и %s\n", baseline, json);
+            status = EXIT_FAILURE;
+        }
+    } else {
+        usage (argv[0]);
+    }
+    if (bench_file[0]) remove (bench_file);
+    bench_report_free (&base);
+
+    return status;
+}
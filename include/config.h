@@ -12,4 +12,36 @@
  */
 typedef double MATRIX_TYPE;
 
+/**
+ * @brief Выравнивание буфера данных матрицы в байтах
+ *
+ * Совпадает с размером строки кэша, каждая строка матрицы начинается
+ * с выровненного адреса
+ */
+#define MATRIX_ALIGNMENT 64
+
+/**
+ * @brief Количество элементов MATRIX_TYPE в одном блоке выравнивания
+ */
+#define MATRIX_ALIGN_ELEMS ((int) (MATRIX_ALIGNMENT / sizeof (MATRIX_TYPE)))
+
+/**
+ * @brief Шаг строки (leading dimension) для заданного числа столбцов
+ *
+ * Число столбцов округляется вверх до кратного MATRIX_ALIGN_ELEMS
+ */
+#define MATRIX_STRIDE(cols)                                                        \
+    ((((cols) + MATRIX_ALIGN_ELEMS - 1) / MATRIX_ALIGN_ELEMS) * MATRIX_ALIGN_ELEMS)
+
+/**
+ * @brief Шаг строки для элементов размера size байт
+ *
+ * size должен делить MATRIX_ALIGNMENT;
+ * MATRIX_STRIDE_FOR (cols, sizeof (MATRIX_TYPE)) == MATRIX_STRIDE (cols)
+ */
+#define MATRIX_STRIDE_FOR(cols, size)                                              \
+    ((((cols) + (int) (MATRIX_ALIGNMENT / (size)) - 1) /                           \
+      (int) (MATRIX_ALIGNMENT / (size))) *                                         \
+     (int) (MATRIX_ALIGNMENT / (size)))
+
 #endif   // CONFIG_H
@@ -12,11 +12,12 @@
  *
  * Алгоритм работы:
  * 1. Загрузка матриц A, B, C, D из файлов
- * 2. Транспонирование матрицы B
- * 3. Умножение A на B^T
- * 4. Вычитание матрицы C
- * 5. Сложение с матрицей D
- * 6. Сохранение результата
+ * 2. Вычисление A × B^T − C + D за один проход без промежуточных матриц
+ *    (fused_multiply_bt_sub_add)
+ * 3. Сохранение результата
+ *
+ * С переменной окружения MATRIX_TRACE=trace.json этапы, операции, потоки
+ * пула и тайлы умножения записываются на временную шкалу (trace.h).
  *
  * @return 1 при успешном выполнении, 0 при ошибке
  *
@@ -26,6 +27,7 @@
  */
 
 #include "matrix/matrix.h"
+#include "matrix/trace.h"
 #include "output/output.h"
 
 #include <stdio.h>
@@ -35,64 +37,22 @@ int main () {
     int res = 1;   // Общий флаг успеха операций
 
     // 1. Загрузка матриц
+    TRACE_BEGIN ("load", "stage");
     Matrix A = load_matrix_from_file ("data/data_main/matrix_a.txt");
     Matrix B = load_matrix_from_file ("data/data_main/matrix_b.txt");
     Matrix C = load_matrix_from_file ("data/data_main/matrix_c.txt");
     Matrix D = load_matrix_from_file ("data/data_main/matrix_d.txt");
+    TRACE_END ("load", "stage");
 
     if (!A.data || !B.data || !C.data || !D.data) {
         res = 0;
         fprintf (stderr, "Ошибка загрузки матриц.\n");
     }
 
-    // 2. Транспонирование B
-    Matrix B_transpose = {0};
-    if (res) {
-        B_transpose = transpose_matrix (&B);
-        if (!B_transpose.data) {
-            res = 0;
-            fprintf (stderr, "Ошибка транспонирования B.\n");
-        }
-    }
-
-    // 3. Умножение A × B^T
-    Matrix AB = {0};
-    if (res) {
-        AB = create_matrix (A.rows, B_transpose.cols);
-        if (!AB.data) {
-            res = 0;
-            fprintf (stderr, "Ошибка создания матрицы AB.\n");
-        }
-    }
-
-    if (res) {
-        if (multiply_matrices (&A, &B_transpose, &AB) != 0) {
-            res = 0;
-            fprintf (stderr, "Ошибка умножения матриц.\n");
-        }
-    }
-
-    // 4. Вычитание C (AB - C)
-    Matrix AB_minus_C = {0};
-    if (res) {
-        AB_minus_C = create_matrix (AB.rows, AB.cols);
-        if (!AB_minus_C.data) {
-            res = 0;
-            fprintf (stderr, "Ошибка создания матрицы AB_minus_C.\n");
-        }
-    }
-
-    if (res) {
-        if (subtract_matrices (&AB, &C, &AB_minus_C) != 0) {
-            res = 0;
-            fprintf (stderr, "Ошибка вычитания матриц.\n");
-        }
-    }
-
-    // 5. Сложение с D (AB_minus_C + D)
+    // 2. Вычисление A × B^T − C + D
     Matrix result = {0};
     if (res) {
-        result = create_matrix (AB_minus_C.rows, AB_minus_C.cols);
+        result = create_matrix (A.rows, B.rows);
         if (!result.data) {
             res = 0;
             fprintf (stderr, "Ошибка создания результирующей матрицы.\n");
@@ -100,14 +60,17 @@ int main () {
     }
 
     if (res) {
-        if (add_matrices (&AB_minus_C, &D, &result) != 0) {
+        TRACE_BEGIN ("compute", "stage");
+        if (fused_multiply_bt_sub_add (&A, &B, &C, &D, &result) != 0) {
             res = 0;
-            fprintf (stderr, "Ошибка сложения матриц.\n");
+            fprintf (stderr, "Ошибка вычисления выражения.\n");
         }
+        TRACE_END ("compute", "stage");
     }
 
-    // 6. Вывод и сохранение результата
+    // 3. Вывод и сохранение результата
     if (res) {
+        TRACE_BEGIN ("save", "stage");
         printf ("Результат выражения A×B^T−C+D:\n");
         print_matrix (&result);
 
@@ -117,6 +80,7 @@ int main () {
         } else {
             printf ("Результат сохранен в data/output/result.txt\n");
         }
+        TRACE_END ("save", "stage");
     }
 
     // Освобождение памяти
@@ -124,9 +88,6 @@ int main () {
     free_matrix (&B);
     free_matrix (&C);
     free_matrix (&D);
-    free_matrix (&B_transpose);
-    free_matrix (&AB);
-    free_matrix (&AB_minus_C);
     free_matrix (&result);
 
     return res ? 0 : 1;
@@ -0,0 +1,368 @@
+/**
+ * @file alloc.c
+ * @brief Реализация арены и пула размерных классов
+ *
+ * @details
+ * Арена хранит список блоков. Выделение сдвигает указатель в текущем
+ * блоке; если места нет, арена переходит к следующему блоку списка
+ * (оставшемуся от прошлой задачи) или добавляет новый. Освобождение
+ * ничего не делает: откат указателя при освобождении последнего
+ * выделения нельзя отличить от освобождения матрицы, выделенной до сброса
+ * по тому же адресу. Сброс возвращает указатель в начало первого блока.
+ *
+ * Пул округляет размер вверх до класса: до 8 * MATRIX_ALIGNMENT - шаг
+ * MATRIX_ALIGNMENT, дальше четыре класса на каждую степень двойки, то есть
+ * потери на округление не больше 25%. Свободные блоки класса связаны в
+ * список через первое слово блока.
+ *
+ * @see alloc.h
+ */
+
+#include "alloc.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/// Число размерных классов пула; большие запросы идут мимо пула
+#define POOL_CLASSES 192
+
+/**
+ * @struct ArenaBlock
+ * @brief Блок арены
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;   ///< Следующий блок
+    size_t             size;   ///< Размер данных блока
+    char*              data;   ///< Выровненные данные
+} ArenaBlock;
+
+/**
+ * @struct MatrixArena
+ * @brief Состояние арены
+ */
+struct MatrixArena {
+    MatrixAllocator allocator;    ///< Интерфейс распределителя
+    ArenaBlock*     head;         ///< Первый блок
+    ArenaBlock*     current;      ///< Блок, из которого идет выделение
+    size_t          used;         ///< Занято в текущем блоке
+    size_t          before;       ///< Занято в блоках до текущего
+    size_t          block_size;   ///< Размер нового блока
+};
+
+/**
+ * @struct MatrixPool
+ * @brief Состояние пула
+ */
+struct MatrixPool {
+    MatrixAllocator allocator;             ///< Интерфейс распределителя
+    pthread_mutex_t lock;                  ///< Защищает списки
+    void*           free[POOL_CLASSES];    ///< Свободные блоки по классам
+    size_t          cached;                ///< Байт в свободных блоках
+};
+
+/**
+ * @brief Округляет размер вверх до кратного MATRIX_ALIGNMENT
+ */
+static size_t align_size (size_t bytes) {
+    return (bytes + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
+}
+
+/**
+ * @brief Добавляет блок после текущего
+ *
+ * @return Новый блок или NULL при ошибке выделения памяти
+ */
+static ArenaBlock* arena_grow (MatrixArena* arena, size_t bytes) {
+    const size_t size  = bytes > arena->block_size ? bytes : arena->block_size;
+    ArenaBlock*  block = malloc (sizeof (ArenaBlock));
+
+    if (block) {
+        block->size = size;
+        block->data = aligned_alloc (MATRIX_ALIGNMENT, size);
+        if (block->data) {
+            ArenaBlock** link = arena->current ? &arena->current->next
+                                               : &arena->head;
+            block->next       = *link;
+            *link             = block;
+        } else {
+            free (block);
+            block = NULL;
+        }
+    }
+
+    return block;
+}
+
+/**
+ * @brief Выделение из арены сдвигом указателя
+ */
+static void* arena_allocate (void* state, size_t bytes) {
+    MatrixArena* arena = state;
+    const size_t size  = align_size (bytes ? bytes : 1);
+    void*        res   = NULL;
+
+    // Переход к следующему блоку, если в текущем не хватает места
+    while (arena->current && arena->current->size - arena->used < size &&
+           arena->current->next) {
+        arena->before += arena->used;
+        arena->current = arena->current->next;
+        arena->used    = 0;
+    }
+
+    if (!arena->current || arena->current->size - arena->used < size) {
+        ArenaBlock* block = arena_grow (arena, size);
+        if (block) {
+            if (arena->current) arena->before += arena->used;
+            arena->current = block;
+            arena->used    = 0;
+        }
+    }
+
+    if (arena->current && arena->current->size - arena->used >= size) {
+        res = arena->current->data + arena->used;
+        arena->used += size;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Освобождение в арене: память вернется при matrix_arena_reset ()
+ */
+static void arena_release (void* state, void* data, size_t bytes) {
+    (void) state;
+    (void) data;
+    (void) bytes;
+}
+
+/**
+ * @brief Создает арену
+ *
+ * @param block_size Размер блока, 0 - MATRIX_ARENA_BLOCK_DEFAULT
+ *
+ * @return Указатель на арену или NULL
+ */
+MatrixArena* matrix_arena_create (size_t block_size) {
+    MatrixArena* arena = calloc (1, sizeof (MatrixArena));
+
+    if (arena) {
+        arena->allocator.allocate = arena_allocate;
+        arena->allocator.release  = arena_release;
+        arena->allocator.state    = arena;
+        arena->block_size = align_size (block_size ? block_size
+                                                   : MATRIX_ARENA_BLOCK_DEFAULT);
+    }
+
+    return arena;
+}
+
+/**
+ * @brief Возвращает интерфейс распределителя арены
+ *
+ * @param arena Указатель на арену
+ *
+ * @return Распределитель или NULL
+ */
+const MatrixAllocator* matrix_arena_allocator (MatrixArena* arena) {
+    return arena ? &arena->allocator : NULL;
+}
+
+/**
+ * @brief Освобождает все выделения арены, сохраняя блоки
+ *
+ * @param arena Указатель на арену
+ */
+void matrix_arena_reset (MatrixArena* arena) {
+    if (arena) {
+        arena->current = arena->head;
+        arena->used    = 0;
+        arena->before  = 0;
+    }
+}
+
+/**
+ * @brief Возвращает объем, занятый в арене с последнего сброса
+ *
+ * @param arena Указатель на арену
+ *
+ * @return Число байт
+ */
+size_t matrix_arena_used (const MatrixArena* arena) {
+    return arena ? arena->before + arena->used : 0;
+}
+
+/**
+ * @brief Освобождает арену со всеми блоками
+ *
+ * @param arena Указатель на арену
+ */
+void matrix_arena_destroy (MatrixArena* arena) {
+    if (arena) {
+        ArenaBlock* block = arena->head;
+        while (block) {
+            ArenaBlock* next = block->next;
+            free (block->data);
+            free (block);
+            block = next;
+        }
+        free (arena);
+    }
+}
+
+/**
+ * @brief Размерный класс запроса
+ *
+ * @param bytes Запрошенный размер
+ * @param index Номер класса, POOL_CLASSES и больше - запрос мимо пула
+ *
+ * @return Размер блока класса
+ */
+static size_t pool_class (size_t bytes, int* index) {
+    size_t step  = MATRIX_ALIGNMENT;
+    size_t limit = 8 * MATRIX_ALIGNMENT;
+    int    first = 0;   // Номер первого класса текущей степени двойки
+    size_t size  = 0;
+
+    if (bytes == 0) bytes = 1;
+    while (bytes > limit && limit <= SIZE_MAX / 2) {
+        first += first == 0 ? 8 : 4;
+        step <<= 1;
+        limit <<= 1;
+    }
+
+    if (bytes > limit) {
+        size   = align_size (bytes);
+        *index = POOL_CLASSES;
+    } else {
+        size   = (bytes + step - 1) / step * step;
+        *index = first == 0 ? (int) (size / step) - 1
+                            : first + (int) (size / step) - 5;
+    }
+
+    return size;
+}
+
+/**
+ * @brief Выделение из пула: свободный блок класса или новый
+ */
+static void* pool_allocate (void* state, size_t bytes) {
+    MatrixPool*  pool  = state;
+    int          index = 0;
+    const size_t size  = pool_class (bytes, &index);
+    void*        res   = NULL;
+
+    if (index < POOL_CLASSES) {
+        pthread_mutex_lock (&pool->lock);
+        res = pool->free[index];
+        if (res) {
+            pool->free[index] = *(void**) res;
+            pool->cached -= size;
+        }
+        pthread_mutex_unlock (&pool->lock);
+    }
+
+    if (!res) res = aligned_alloc (MATRIX_ALIGNMENT, size);
+
+    return res;
+}
+
+/**
+ * @brief Возврат блока в список его класса
+ */
+static void pool_release (void* state, void* data, size_t bytes) {
+    MatrixPool*  pool  = state;
+    int          index = 0;
+    const size_t size  = pool_class (bytes, &index);
+
+    if (index < POOL_CLASSES) {
+        pthread_mutex_lock (&pool->lock);
+        *(void**) data    = pool->free[index];
+        pool->free[index] = data;
+        pool->cached += size;
+        pthread_mutex_unlock (&pool->lock);
+    } else {
+        free (data);
+    }
+}
+
+/**
+ * @brief Создает пустой пул
+ *
+ * @return Указатель на пул или NULL
+ */
+MatrixPool* matrix_pool_create (void) {
+    MatrixPool* pool = calloc (1, sizeof (MatrixPool));
+
+    if (pool) {
+        pool->allocator.allocate = pool_allocate;
+        pool->allocator.release  = pool_release;
+        pool->allocator.state    = pool;
+        pthread_mutex_init (&pool->lock, NULL);
+    }
+
+    return pool;
+}
+
+/**
+ * @brief Возвращает интерфейс распределителя пула
+ *
+ * @param pool Указатель на пул
+ *
+ * @return Распределитель или NULL
+ */
+const MatrixAllocator* matrix_pool_allocator (MatrixPool* pool) {
+    return pool ? &pool->allocator : NULL;
+}
+
+/**
+ * @brief Отдает системе все свободные блоки пула
+ *
+ * @param pool Указатель на пул
+ */
+void matrix_pool_trim (MatrixPool* pool) {
+    if (pool) {
+        pthread_mutex_lock (&pool->lock);
+        for (int i = 0; i < POOL_CLASSES; i++) {
+            while (pool->free[i]) {
+                void* next = *(void**) pool->free[i];
+                free (pool->free[i]);
+                pool->free[i] = next;
+            }
+        }
+        pool->cached = 0;
+        pthread_mutex_unlock (&pool->lock);
+    }
+}
+
+/**
+ * @brief Возвращает объем свободных блоков пула
+ *
+ * @param pool Указатель на пул
+ *
+ * @return Число байт
+ */
+size_t matrix_pool_cached (MatrixPool* pool) {
+    size_t res = 0;
+
+    if (pool) {
+        pthread_mutex_lock (&pool->lock);
+        res = pool->cached;
+        pthread_mutex_unlock (&pool->lock);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Освобождает пул и его свободные блоки
+ *
+ * @param pool Указатель на пул
+ */
+void matrix_pool_destroy (MatrixPool* pool) {
+    if (pool) {
+        matrix_pool_trim (pool);
+        pthread_mutex_destroy (&pool->lock);
+        free (pool);
+    }
+}
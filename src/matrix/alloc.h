@@ -0,0 +1,121 @@
+/**
+ * @file alloc.h
+ * @brief Распределители памяти для временных матриц
+ *
+ * @details
+ * Две реализации интерфейса MatrixAllocator (matrix.h):
+ * - арена - выделение сдвигом указателя в крупных блоках; отдельные
+ *   матрицы не освобождаются, matrix_arena_reset () разом освобождает всё
+ *   выделенное за задачу, а блоки остаются для следующей задачи
+ * - пул - списки свободных блоков по размерным классам (четыре класса на
+ *   каждую степень двойки), освобожденный буфер сразу достается следующей
+ *   матрице того же размера
+ *
+ * Распределитель подключается явно через create_matrix_with () или для
+ * всех операций потока через matrix_set_allocator ():
+ *
+ * @code
+ * MatrixArena* arena = matrix_arena_create (0);
+ * matrix_set_allocator (matrix_arena_allocator (arena));
+ * for (...) {
+ *     ...                        // Матрицы задачи берутся из арены
+ *     matrix_arena_reset (arena);
+ * }
+ * matrix_set_allocator (NULL);
+ * matrix_arena_destroy (arena);
+ * @endcode
+ *
+ * @note Арена не потокобезопасна и рассчитана на один поток; пул защищен
+ * мьютексом и может быть общим
+ *
+ * @see matrix.h
+ */
+
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include "matrix.h"
+
+/// Размер блока арены по умолчанию, байт
+#define MATRIX_ARENA_BLOCK_DEFAULT ((size_t) 1 << 20)
+
+/**
+ * @brief Арена (непрозрачный тип)
+ */
+typedef struct MatrixArena MatrixArena;
+
+/**
+ * @brief Пул размерных классов (непрозрачный тип)
+ */
+typedef struct MatrixPool MatrixPool;
+
+/**
+ * @brief Создает арену
+ * @param block_size Размер блока в байтах, 0 - MATRIX_ARENA_BLOCK_DEFAULT;
+ * запрос больше блока получает отдельный блок
+ * @return Указатель на арену или NULL при ошибке выделения памяти
+ */
+MatrixArena* matrix_arena_create (size_t block_size);
+
+/**
+ * @brief Возвращает интерфейс распределителя арены
+ * @param arena Указатель на арену
+ * @return Распределитель, действительный до matrix_arena_destroy ()
+ */
+const MatrixAllocator* matrix_arena_allocator (MatrixArena* arena);
+
+/**
+ * @brief Освобождает все выделения арены, сохраняя блоки
+ * @param arena Указатель на арену
+ * @note Матрицы из арены после сброса недействительны; free_matrix () для
+ * них допустим и ничего не делает
+ */
+void matrix_arena_reset (MatrixArena* arena);
+
+/**
+ * @brief Возвращает объем, занятый в арене с последнего сброса
+ * @param arena Указатель на арену
+ * @return Число байт с учетом выравнивания
+ */
+size_t matrix_arena_used (const MatrixArena* arena);
+
+/**
+ * @brief Освобождает арену со всеми блоками
+ * @param arena Указатель на арену (может быть NULL)
+ */
+void matrix_arena_destroy (MatrixArena* arena);
+
+/**
+ * @brief Создает пустой пул
+ * @return Указатель на пул или NULL при ошибке выделения памяти
+ */
+MatrixPool* matrix_pool_create (void);
+
+/**
+ * @brief Возвращает интерфейс распределителя пула
+ * @param pool Указатель на пул
+ * @return Распределитель, действительный до matrix_pool_destroy ()
+ */
+const MatrixAllocator* matrix_pool_allocator (MatrixPool* pool);
+
+/**
+ * @brief Отдает системе все свободные блоки пула
+ * @param pool Указатель на пул
+ */
+void matrix_pool_trim (MatrixPool* pool);
+
+/**
+ * @brief Возвращает объем свободных блоков, удерживаемых пулом
+ * @param pool Указатель на пул
+ * @return Число байт
+ */
+size_t matrix_pool_cached (MatrixPool* pool);
+
+/**
+ * @brief Освобождает пул и его свободные блоки
+ * @param pool Указатель на пул (может быть NULL)
+ * @note Все матрицы из пула должны быть освобождены раньше
+ */
+void matrix_pool_destroy (MatrixPool* pool);
+
+#endif   // ALLOC_H
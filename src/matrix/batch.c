@@ -0,0 +1,509 @@
+/**
+ * @file batch.c
+ * @brief Операции над пакетами малых матриц в раскладке SoA
+ *
+ * @details
+ * Все ядра устроены одинаково: внешние циклы идут по элементам матрицы
+ * (плоскостям), внутренний - по матрицам пакета подряд в памяти, поэтому
+ * векторизуется внутренний цикл при любом размере матриц. Пакет делится
+ * на куски по BATCH_LANES матриц: плоскости куска результата остаются в
+ * L1, пока к ним прибавляются слагаемые.
+ *
+ * Детерминант матриц больше 3 x 3 считается LU-разложением куска в буфере
+ * потока. Ведущий элемент выбирается для каждой матрицы отдельно, а
+ * исключение идет общими для куска векторными проходами.
+ *
+ * Ядра собираются переносимо и с target ("avx2,fma"), вариант выбирается
+ * по уровню simd_kernels ().
+ *
+ * @see batch.h
+ */
+
+#include "batch.h"
+
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Матриц в куске ядра: плоскость куска - 2 КБ
+#define BATCH_LANES 256
+
+/// Меньше этого числа операций пакет обрабатывает один поток
+#define BATCH_PARALLEL_MIN (256 * 1024)
+
+/**
+ * @brief Операция над пакетом
+ */
+typedef enum {
+    BATCH_COMBINE = 0,    ///< A + sign * B
+    BATCH_MULTIPLY,       ///< A x B
+    BATCH_DETERMINANT     ///< det A
+} BatchOp;
+
+/**
+ * @struct BatchKernels
+ * @brief Ядра одного уровня инструкций для куска first..last-1
+ */
+typedef struct {
+    void (*combine) (const MatrixBatch* A, const MatrixBatch* B, MatrixBatch* C,
+                     MATRIX_TYPE sign, int first, int last);
+    void (*multiply) (const MatrixBatch* A, const MatrixBatch* B, MatrixBatch* C,
+                      int first, int last);
+    void (*determinant) (const MatrixBatch* A, MATRIX_TYPE* det, int first,
+                         int last, MATRIX_TYPE* work, int* pivot);
+} BatchKernels;
+
+/**
+ * @struct BatchJob
+ * @brief Общие данные параллельной операции
+ */
+typedef struct {
+    BatchOp             op;        ///< Операция
+    const BatchKernels* kernels;   ///< Ядра
+    const MatrixBatch*  A;         ///< Первый операнд
+    const MatrixBatch*  B;         ///< Второй операнд
+    MatrixBatch*        C;         ///< Результат
+    MATRIX_TYPE*        det;       ///< Детерминанты
+    MATRIX_TYPE         sign;      ///< Знак B для BATCH_COMBINE
+    int                 chunk;     ///< Матриц в подзадаче
+    MATRIX_TYPE*        work;      ///< Буферы LU потоков
+    int*                pivot;     ///< Ведущие строки потоков
+    size_t              size;      ///< Элементов в буфере LU одного потока
+} BatchJob;
+
+/**
+ * @brief Ядра пакетов с атрибутами attr
+ *
+ * determinant: w(r, c) - плоскость куска в буфере work, inv - обратные
+ * ведущие элементы (последняя плоскость буфера), вырожденная матрица
+ * получает inv = 0 и дальше не портит соседей делением на ноль.
+ */
+#define BATCH_KERNELS(name, attr)                                                  \
+    attr static void combine_##name (const MatrixBatch* A, const MatrixBatch* B,   \
+                                     MatrixBatch* C, MATRIX_TYPE sign, int first,  \
+                                     int last) {                                   \
+        for (int p = 0; p < A->rows * A->cols; p++) {                              \
+            const MATRIX_TYPE* a = A->data + (size_t) p * A->stride;               \
+            const MATRIX_TYPE* b = B->data + (size_t) p * B->stride;               \
+            MATRIX_TYPE*       c = C->data + (size_t) p * C->stride;               \
+            for (int l = first; l < last; l++) c[l] = a[l] + sign * b[l];          \
+        }                                                                          \
+    }                                                                              \
+                                                                                   \
+    attr static void multiply_##name (const MatrixBatch* A, const MatrixBatch* B,  \
+                                      MatrixBatch* C, int first, int last) {       \
+        for (int i = 0; i < C->rows; i++) {                                        \
+            for (int j = 0; j < C->cols; j++) {                                    \
+                MATRIX_TYPE*       c  = MATRIX_BATCH_PLANE (C, i, j);              \
+                const MATRIX_TYPE* a0 = MATRIX_BATCH_PLANE (A, i, 0);              \
+                const MATRIX_TYPE* b0 = MATRIX_BATCH_PLANE (B, 0, j);              \
+                for (int l = first; l < last; l++) c[l] = a0[l] * b0[l];           \
+                for (int p = 1; p < A->cols; p++) {                                \
+                    const MATRIX_TYPE* a = MATRIX_BATCH_PLANE (A, i, p);           \
+                    const MATRIX_TYPE* b = MATRIX_BATCH_PLANE (B, p, j);           \
+                    for (int l = first; l < last; l++) c[l] += a[l] * b[l];        \
+                }                                                                  \
+            }                                                                      \
+        }                                                                          \
+    }                                                                              \
+                                                                                   \
+    attr static void determinant_##name (const MatrixBatch* A, MATRIX_TYPE* det,   \
+                                         int first, int last, MATRIX_TYPE* work,   \
+                                         int* pivot) {                             \
+        const int    n   = A->rows;                                                \
+        const int    len = last - first;                                           \
+        MATRIX_TYPE* d   = det + first;                                            \
+        MATRIX_TYPE* inv = work + (size_t) n * n * BATCH_LANES;                    \
+                                                                                   \
+        for (int p = 0; p < n * n; p++)                                            \
+            memcpy (work + (size_t) p * BATCH_LANES,                               \
+                    A->data + (size_t) p * A->stride + first,                      \
+                    (size_t) len * sizeof (MATRIX_TYPE));                          \
+        for (int l = 0; l < len; l++) d[l] = 1;                                    \
+                                                                                   \
+        for (int col = 0; col < n; col++) {                                        \
+            MATRIX_TYPE* diag = BATCH_W (col, col);                                \
+                                                                                   \
+            for (int l = 0; l < len; l++) {                                        \
+                MATRIX_TYPE best = fabs (diag[l]);                                 \
+                pivot[l]         = col;                                            \
+                for (int r = col + 1; r < n; r++) {                                \
+                    if (fabs (BATCH_W (r, col)[l]) > best) {                       \
+                        best     = fabs (BATCH_W (r, col)[l]);                     \
+                        pivot[l] = r;                                              \
+                    }                                                              \
+                }                                                                  \
+                if (pivot[l] != col) {                                             \
+                    for (int j = col; j < n; j++) {                                \
+                        MATRIX_TYPE tmp          = BATCH_W (col, j)[l];            \
+                        BATCH_W (col, j)[l]      = BATCH_W (pivot[l], j)[l];       \
+                        BATCH_W (pivot[l], j)[l] = tmp;                            \
+                    }                                                              \
+                    d[l] = -d[l];                                                  \
+                }                                                                  \
+            }                                                                      \
+                                                                                   \
+            for (int l = 0; l < len; l++) {                                        \
+                d[l] *= diag[l];                                                   \
+                inv[l] = diag[l] != 0 ? 1 / diag[l] : 0;                           \
+            }                                                                      \
+                                                                                   \
+            for (int r = col + 1; r < n; r++) {                                    \
+                MATRIX_TYPE* f = BATCH_W (r, col);                                 \
+                for (int l = 0; l < len; l++) f[l] *= inv[l];                      \
+                for (int j = col + 1; j < n; j++) {                                \
+                    MATRIX_TYPE*       w = BATCH_W (r, j);                         \
+                    const MATRIX_TYPE* u = BATCH_W (col, j);                       \
+                    for (int l = 0; l < len; l++) w[l] -= f[l] * u[l];             \
+                }                                                                  \
+            }                                                                      \
+        }                                                                          \
+    }
+
+/// Плоскость (r, c) куска в буфере LU
+#define BATCH_W(r, c) (work + ((size_t) (r) * n + (size_t) (c)) * BATCH_LANES)
+
+BATCH_KERNELS (generic, SIMD_VECTORIZE)
+
+static const BatchKernels batch_generic = {combine_generic, multiply_generic,
+                                           determinant_generic};
+
+#if SIMD_X86
+BATCH_KERNELS (avx2, SIMD_VECTORIZE __attribute__ ((target ("avx2,fma"))))
+
+static const BatchKernels batch_avx2 = {combine_avx2, multiply_avx2,
+                                        determinant_avx2};
+#endif
+
+/**
+ * @brief Ядра для текущего уровня simd_kernels ()
+ */
+static const BatchKernels* batch_kernels (void) {
+    const BatchKernels* res = &batch_generic;
+
+#if SIMD_X86
+    if (simd_kernels ()->level >= SIMD_AVX2) res = &batch_avx2;
+#endif
+
+    return res;
+}
+
+/**
+ * @brief Детерминанты куска по явным формулам (матрицы до 3 x 3)
+ */
+static void determinant_small (const MatrixBatch* A, MATRIX_TYPE* det, int first,
+                               int last) {
+    const MatrixBatch* m = A;
+
+    if (A->rows == 1) {
+        memcpy (det + first, A->data + first,
+                (size_t) (last - first) * sizeof (MATRIX_TYPE));
+    } else if (A->rows == 2) {
+        for (int l = first; l < last; l++)
+            det[l] = MATRIX_BATCH_AT (m, l, 0, 0) * MATRIX_BATCH_AT (m, l, 1, 1) -
+                     MATRIX_BATCH_AT (m, l, 0, 1) * MATRIX_BATCH_AT (m, l, 1, 0);
+    } else {
+        for (int l = first; l < last; l++) {
+            const MATRIX_TYPE a = MATRIX_BATCH_AT (m, l, 0, 0);
+            const MATRIX_TYPE b = MATRIX_BATCH_AT (m, l, 0, 1);
+            const MATRIX_TYPE c = MATRIX_BATCH_AT (m, l, 0, 2);
+            const MATRIX_TYPE d = MATRIX_BATCH_AT (m, l, 1, 0);
+            const MATRIX_TYPE e = MATRIX_BATCH_AT (m, l, 1, 1);
+            const MATRIX_TYPE f = MATRIX_BATCH_AT (m, l, 1, 2);
+            const MATRIX_TYPE g = MATRIX_BATCH_AT (m, l, 2, 0);
+            const MATRIX_TYPE h = MATRIX_BATCH_AT (m, l, 2, 1);
+            const MATRIX_TYPE i = MATRIX_BATCH_AT (m, l, 2, 2);
+            det[l] = a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+        }
+    }
+}
+
+/**
+ * @brief Подзадача: матрицы полосы task кусками по BATCH_LANES
+ */
+static void batch_task (void* ctx, int task, int worker) {
+    BatchJob*    job   = ctx;
+    const int    count = job->A->count;
+    const int    first = task * job->chunk;
+    const int    last  = first + job->chunk < count ? first + job->chunk : count;
+    MATRIX_TYPE* work  = job->work ? job->work + (size_t) worker * job->size : NULL;
+    int*         pivot = job->pivot ? job->pivot + (size_t) worker * BATCH_LANES
+                                    : NULL;
+
+    for (int lo = first; lo < last; lo += BATCH_LANES) {
+        const int hi = last - lo < BATCH_LANES ? last : lo + BATCH_LANES;
+
+        switch (job->op) {
+        case BATCH_COMBINE:
+            job->kernels->combine (job->A, job->B, job->C, job->sign, lo, hi);
+            break;
+        case BATCH_MULTIPLY:
+            job->kernels->multiply (job->A, job->B, job->C, lo, hi);
+            break;
+        case BATCH_DETERMINANT:
+            if (job->A->rows <= 3)
+                determinant_small (job->A, job->det, lo, hi);
+            else
+                job->kernels->determinant (job->A, job->det, lo, hi, work, pivot);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Делит пакет на полосы и выполняет операцию потоками пула
+ *
+ * @param job Операция
+ * @param cost Число операций на одну матрицу
+ * @param workers Число буферов потоков в job, INT_MAX - буферов нет
+ */
+static void batch_run (BatchJob* job, double cost, int workers) {
+    const int count = job->A->count;
+    int       tasks = thread_pool_threads () * 4;
+
+    if ((double) count * cost < BATCH_PARALLEL_MIN) tasks = 1;
+
+    // Границы полос кратны MATRIX_ALIGN_ELEMS: потоки не делят строку кэша
+    job->kernels = batch_kernels ();
+    job->chunk   = MATRIX_STRIDE ((count + tasks - 1) / tasks);
+    thread_pool_run_workers ((count + job->chunk - 1) / job->chunk, workers,
+                             batch_task, job);
+}
+
+/**
+ * @brief Создает пакет из count матриц rows x cols
+ *
+ * @param rows Строк в каждой матрице
+ * @param cols Столбцов в каждой матрице
+ * @param count Число матриц
+ *
+ * @return Пакет или нулевой пакет при ошибке
+ */
+MatrixBatch batch_create (int rows, int cols, int count) {
+    MatrixBatch batch = {0};
+
+    if (rows > 0 && cols > 0 && count > 0 &&
+        count <= INT_MAX - MATRIX_ALIGN_ELEMS) {
+        const size_t planes = (size_t) rows * (size_t) cols;
+
+        batch.rows   = rows;
+        batch.cols   = cols;
+        batch.count  = count;
+        batch.stride = MATRIX_STRIDE (count);
+        batch.data   = aligned_alloc (MATRIX_ALIGNMENT,
+                                      planes * batch.stride * sizeof (MATRIX_TYPE));
+        if (!batch.data) batch = (MatrixBatch) {0};
+    }
+
+    return batch;
+}
+
+/**
+ * @brief Освобождает пакет и обнуляет структуру
+ *
+ * @param batch Указатель на пакет
+ */
+void batch_free (MatrixBatch* batch) {
+    if (batch) {
+        free (batch->data);
+        *batch = (MatrixBatch) {0};
+    }
+}
+
+/**
+ * @brief Записывает матрицу в пакет
+ *
+ * @param batch Пакет
+ * @param index Номер матрицы в пакете
+ * @param matrix Матрица того же размера
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_set (MatrixBatch* batch, int index, const Matrix* matrix) {
+    int res = -1;
+
+    if (batch && batch->data && matrix && matrix->data && index >= 0 &&
+        index < batch->count && matrix->rows == batch->rows &&
+        matrix->cols == batch->cols && matrix->dtype == MATRIX_FLOAT64) {
+        for (int i = 0; i < batch->rows; i++)
+            for (int j = 0; j < batch->cols; j++)
+                MATRIX_BATCH_AT (batch, index, i, j) = MATRIX_AT (matrix, i, j);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Копирует матрицу из пакета
+ *
+ * @param batch Пакет
+ * @param index Номер матрицы в пакете
+ * @param matrix Матрица того же размера
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_get (const MatrixBatch* batch, int index, Matrix* matrix) {
+    int res = -1;
+
+    if (batch && batch->data && matrix && matrix->data && index >= 0 &&
+        index < batch->count && matrix->rows == batch->rows &&
+        matrix->cols == batch->cols && matrix->dtype == MATRIX_FLOAT64) {
+        for (int i = 0; i < batch->rows; i++)
+            for (int j = 0; j < batch->cols; j++)
+                MATRIX_AT (matrix, i, j) = MATRIX_BATCH_AT (batch, index, i, j);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Проверяет, что пакеты заданы, одного размера и одной длины
+ */
+static int same_shape (const MatrixBatch* a, const MatrixBatch* b) {
+    return a && b && a->data && b->data && a->rows == b->rows &&
+           a->cols == b->cols && a->count == b->count;
+}
+
+/**
+ * @brief result = A + sign * B
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int batch_combine (const MatrixBatch* A, const MatrixBatch* B,
+                          MatrixBatch* result, MATRIX_TYPE sign) {
+    int res = -1;
+
+    if (same_shape (A, B) && same_shape (A, result)) {
+        BatchJob job = {BATCH_COMBINE, NULL, A, B, result, NULL, sign,
+                        0,             NULL, NULL, 0};
+
+        batch_run (&job, (double) A->rows * A->cols, INT_MAX);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Складывает пакеты поматрично: result[t] = A[t] + B[t]
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_add (const MatrixBatch* A, const MatrixBatch* B, MatrixBatch* result) {
+    return batch_combine (A, B, result, 1);
+}
+
+/**
+ * @brief Вычитает пакеты поматрично: result[t] = A[t] - B[t]
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_subtract (const MatrixBatch* A, const MatrixBatch* B,
+                    MatrixBatch* result) {
+    return batch_combine (A, B, result, -1);
+}
+
+/**
+ * @brief Умножает пакеты поматрично: result[t] = A[t] x B[t]
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_multiply (const MatrixBatch* A, const MatrixBatch* B,
+                    MatrixBatch* result) {
+    int res = -1;
+
+    if (A && B && result && A->data && B->data && result->data &&
+        A->cols == B->rows && result->rows == A->rows &&
+        result->cols == B->cols && A->count == B->count &&
+        result->count == A->count && result->data != A->data &&
+        result->data != B->data) {
+        BatchJob job = {BATCH_MULTIPLY, NULL, A, B, result, NULL, 0,
+                        0,              NULL, NULL, 0};
+
+        batch_run (&job, (double) A->rows * A->cols * B->cols, INT_MAX);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Транспонирует матрицы пакета: result[t] = A[t]^T
+ *
+ * Плоскость (i, j) источника становится плоскостью (j, i) результата;
+ * на месте квадратные матрицы обменивают плоскости над и под диагональю.
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_transpose (const MatrixBatch* A, MatrixBatch* result) {
+    int res = -1;
+
+    if (A && result && A->data && result->data && result->rows == A->cols &&
+        result->cols == A->rows && result->count == A->count) {
+        const size_t bytes = (size_t) A->count * sizeof (MATRIX_TYPE);
+
+        if (result->data != A->data) {
+            for (int i = 0; i < A->rows; i++)
+                for (int j = 0; j < A->cols; j++)
+                    memcpy (MATRIX_BATCH_PLANE (result, j, i),
+                            MATRIX_BATCH_PLANE (A, i, j), bytes);
+            res = 0;
+        } else if (A->rows == A->cols && result->stride == A->stride) {
+            for (int i = 0; i < A->rows; i++) {
+                for (int j = i + 1; j < A->cols; j++) {
+                    MATRIX_TYPE* upper = MATRIX_BATCH_PLANE (result, i, j);
+                    MATRIX_TYPE* lower = MATRIX_BATCH_PLANE (result, j, i);
+                    for (int l = 0; l < A->count; l++) {
+                        const MATRIX_TYPE tmp = upper[l];
+                        upper[l]              = lower[l];
+                        lower[l]              = tmp;
+                    }
+                }
+            }
+            res = 0;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief Вычисляет детерминанты всех матриц пакета
+ *
+ * @param A Пакет квадратных матриц
+ * @param det Массив из A->count значений
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_determinant (const MatrixBatch* A, MATRIX_TYPE* det) {
+    const int threads = thread_pool_threads ();
+    BatchJob  job     = {BATCH_DETERMINANT, NULL, A, NULL, NULL, det, 0,
+                         0,                 NULL, NULL, 0};
+    int       res     = -1;
+
+    if (A && A->data && det && A->rows == A->cols) {
+        res = 0;
+
+        // Буфер LU потока: n * n плоскостей куска и плоскость inv
+        if (A->rows > 3) {
+            job.size  = ((size_t) A->rows * A->rows + 1) * BATCH_LANES;
+            job.work  = malloc ((size_t) threads * job.size * sizeof (MATRIX_TYPE));
+            job.pivot = malloc ((size_t) threads * BATCH_LANES * sizeof (int));
+            if (!job.work || !job.pivot) res = -1;
+        }
+    }
+
+    if (res == 0)
+        batch_run (&job, (double) A->rows * A->rows * A->rows / 3, threads);
+
+    free (job.work);
+    free (job.pivot);
+
+    return res;
+}
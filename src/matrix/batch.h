@@ -0,0 +1,141 @@
+/**
+ * @file batch.h
+ * @brief Пакеты малых матриц одного размера в раскладке SoA
+ *
+ * @details
+ * Пакет хранит count матриц rows x cols как rows * cols плоскостей: в
+ * плоскости (i, j) подряд лежат элементы (i, j) всех матриц пакета. Одна
+ * операция над пакетом заменяет count вызовов create_matrix () -
+ * multiply_matrices () - free_matrix (), а каждое скалярное действие над
+ * элементами становится проходом по непрерывной плоскости, который
+ * векторизуется поперек матриц независимо от их размера (2 x 2 ... 8 x 8).
+ *
+ * Плоскости начинаются с адресов, выровненных по MATRIX_ALIGNMENT: шаг
+ * stride - count, округленный вверх до MATRIX_ALIGN_ELEMS. Пакет делится
+ * на полосы матриц, полосы обрабатываются потоками пула.
+ *
+ * @code
+ * MatrixBatch A = batch_create (4, 4, 100000);
+ * MatrixBatch B = batch_create (4, 4, 100000);
+ * MatrixBatch C = batch_create (4, 4, 100000);
+ * MATRIX_BATCH_AT (&A, index, i, j) = ...;
+ * batch_multiply (&A, &B, &C);
+ * @endcode
+ *
+ * @see matrix.h
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "matrix.h"
+
+/**
+ * @struct MatrixBatch
+ * @brief Пакет матриц одного размера
+ */
+typedef struct {
+    int          rows;     ///< Строк в каждой матрице
+    int          cols;     ///< Столбцов в каждой матрице
+    int          count;    ///< Число матриц
+    int          stride;   ///< Шаг между плоскостями в элементах (>= count)
+    MATRIX_TYPE* data;     ///< rows * cols плоскостей по stride элементов
+} MatrixBatch;
+
+/**
+ * @brief Плоскость (row, col): элементы (row, col) всех матриц пакета
+ *
+ * @param b Указатель на пакет
+ */
+#define MATRIX_BATCH_PLANE(b, row, col)                                            \
+    ((b)->data + ((size_t) (row) * (size_t) (b)->cols + (size_t) (col)) *          \
+                     (size_t) (b)->stride)
+
+/**
+ * @brief Элемент (row, col) матрицы index пакета
+ *
+ * @param b Указатель на пакет
+ */
+#define MATRIX_BATCH_AT(b, index, row, col)                                        \
+    (MATRIX_BATCH_PLANE (b, row, col)[(size_t) (index)])
+
+/**
+ * @brief Создает пакет из count матриц rows x cols
+ * @param rows Строк в каждой матрице
+ * @param cols Столбцов в каждой матрице
+ * @param count Число матриц
+ * @note Элементы не инициализированы
+ * @return Пакет или нулевой пакет при ошибке
+ */
+MatrixBatch batch_create (int rows, int cols, int count);
+
+/**
+ * @brief Освобождает пакет и обнуляет структуру
+ * @param batch Указатель на пакет (может быть NULL)
+ */
+void batch_free (MatrixBatch* batch);
+
+/**
+ * @brief Записывает матрицу в пакет
+ * @param batch Пакет
+ * @param index Номер матрицы в пакете
+ * @param matrix Матрица того же размера
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_set (MatrixBatch* batch, int index, const Matrix* matrix);
+
+/**
+ * @brief Копирует матрицу из пакета
+ * @param batch Пакет
+ * @param index Номер матрицы в пакете
+ * @param matrix Матрица того же размера
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_get (const MatrixBatch* batch, int index, Matrix* matrix);
+
+/**
+ * @brief Складывает пакеты поматрично: result[t] = A[t] + B[t]
+ * @note result может совпадать с A или B
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_add (const MatrixBatch* A, const MatrixBatch* B, MatrixBatch* result);
+
+/**
+ * @brief Вычитает пакеты поматрично: result[t] = A[t] - B[t]
+ * @note result может совпадать с A или B
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_subtract (const MatrixBatch* A, const MatrixBatch* B,
+                    MatrixBatch* result);
+
+/**
+ * @brief Умножает пакеты поматрично: result[t] = A[t] x B[t]
+ * @param A Пакет матриц m x k
+ * @param B Пакет матриц k x n с тем же числом матриц
+ * @param result Пакет матриц m x n, не совпадает с A и B
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_multiply (const MatrixBatch* A, const MatrixBatch* B,
+                    MatrixBatch* result);
+
+/**
+ * @brief Транспонирует матрицы пакета: result[t] = A[t]^T
+ * @param A Пакет матриц rows x cols
+ * @param result Пакет матриц cols x rows; для квадратных матриц может
+ * совпадать с A
+ * @note Транспонирование в SoA - перестановка плоскостей целиком
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_transpose (const MatrixBatch* A, MatrixBatch* result);
+
+/**
+ * @brief Вычисляет детерминанты всех матриц пакета
+ * @param A Пакет квадратных матриц
+ * @param det Массив из A->count значений
+ * @note До 3 x 3 - явные формулы, дальше - LU-разложение с выбором
+ * ведущего элемента отдельно для каждой матрицы
+ * @return 0 при успехе, -1 при ошибке
+ */
+int batch_determinant (const MatrixBatch* A, MATRIX_TYPE* det);
+
+#endif   // BATCH_H
@@ -0,0 +1,521 @@
+/**
+ * @file dtype.c
+ * @brief Ядра для матриц с элементами float, double, int32, int64 и complex
+ *
+ * @details
+ * Ядра каждого типа порождаются макросами DTYPE_ARITH, DTYPE_COMPLEX и
+ * DTYPE_COPY. Арифметика целых типов ведется в беззнаковом типе той же
+ * ширины: переполнение определено (по модулю 2^N), а обращение к знаковым
+ * данным через беззнаковый тип допустимо правилами псевдонимов C. complex
+ * хранится парами double, его сложение и axpby - те же ядра double над
+ * строкой двойной длины, умножение раскрыто вручную, без __muldc3.
+ *
+ * Арифметические ядра собираются дважды: переносимо и с target
+ * ("avx2,fma"), вариант выбирается по уровню simd_kernels ().
+ *
+ * @see dtype.h
+ */
+
+#include "dtype.h"
+
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Глубина блока B в умножении
+#define DTYPE_GEMM_KB 128
+
+/// Ширина блока B в умножении (столбцов)
+#define DTYPE_GEMM_NB 256
+
+/// Сторона блока транспонирования
+#define DTYPE_TRANSPOSE_BLOCK 32
+
+/// Меньше этого числа умножений-сложений произведение считает один поток
+#define DTYPE_PARALLEL_MIN (256 * 1024)
+
+/**
+ * @struct MultiplyJob
+ * @brief Общие данные параллельного умножения
+ */
+typedef struct {
+    const DtypeKernels* kernels;   ///< Ядра типа
+    const Matrix*       A;         ///< Левый множитель
+    const Matrix*       B;         ///< Правый множитель
+    Matrix*             C;         ///< Результат
+    int                 chunk;     ///< Строк в подзадаче
+} MultiplyJob;
+
+// ==============================================================================
+//  Скаляры и преобразования
+// ==============================================================================
+
+/**
+ * @brief Коэффициент действительного типа
+ */
+static double real_scalar (double value) {
+    return value;
+}
+
+/**
+ * @brief Коэффициент целого типа: округление, вне диапазона int64 - ноль
+ */
+static uint64_t integer_scalar (double value) {
+    const double rounded = nearbyint (value);
+
+    return rounded >= -9223372036854775808.0 && rounded < 9223372036854775808.0
+               ? (uint64_t) (int64_t) rounded
+               : 0;
+}
+
+/**
+ * @brief double в int32 с насыщением, NaN - ноль
+ */
+static int32_t clamp_int32 (double value) {
+    return value != value                ? 0
+           : value <= (double) INT32_MIN ? INT32_MIN
+           : value >= (double) INT32_MAX ? INT32_MAX
+                                         : (int32_t) value;
+}
+
+/**
+ * @brief double в int64 с насыщением, NaN - ноль
+ */
+static int64_t clamp_int64 (double value) {
+    return value != value                ? 0
+           : value <= (double) INT64_MIN ? INT64_MIN
+           : value >= (double) INT64_MAX ? INT64_MAX
+                                         : (int64_t) value;
+}
+
+// ==============================================================================
+//  Порождающие макросы
+// ==============================================================================
+
+/**
+ * @brief Сложение, вычитание, axpby и полоса GEMM для типа utype
+ *
+ * Умножение проходит B блоками DTYPE_GEMM_KB x DTYPE_GEMM_NB: блок
+ * остается в кэше, пока через него проходят все строки полосы, а
+ * внутренний цикл по строке B векторизуется компилятором.
+ */
+#define DTYPE_ARITH(name, attr, utype, scalar)                                     \
+    attr static void add_##name (int n, const void* a, const void* b, void* r) {   \
+        const utype* x = a;                                                        \
+        const utype* y = b;                                                        \
+        utype*       z = r;                                                        \
+        for (int i = 0; i < n; i++) z[i] = x[i] + y[i];                            \
+    }                                                                              \
+                                                                                   \
+    attr static void sub_##name (int n, const void* a, const void* b, void* r) {   \
+        const utype* x = a;                                                        \
+        const utype* y = b;                                                        \
+        utype*       z = r;                                                        \
+        for (int i = 0; i < n; i++) z[i] = x[i] - y[i];                            \
+    }                                                                              \
+                                                                                   \
+    attr static void axpby_##name (int n, double alpha, const void* x,             \
+                                   double beta, void* y) {                         \
+        const utype  a  = (utype) scalar (alpha);                                  \
+        const utype  b  = (utype) scalar (beta);                                   \
+        const utype* xs = x;                                                       \
+        utype*       ys = y;                                                       \
+        if (beta == 0)                                                             \
+            for (int i = 0; i < n; i++) ys[i] = a * xs[i];                         \
+        else                                                                       \
+            for (int i = 0; i < n; i++) ys[i] = a * xs[i] + b * ys[i];             \
+    }                                                                              \
+                                                                                   \
+    attr static void gemm_##name (int first, int last, int n, int k,               \
+                                  const void* A, int lda, const void* B, int ldb,  \
+                                  void* C, int ldc) {                              \
+        const utype* a = A;                                                        \
+        const utype* b = B;                                                        \
+        utype*       c = C;                                                        \
+        for (int i = first; i < last; i++)                                         \
+            memset (c + (size_t) i * ldc, 0, (size_t) n * sizeof (utype));         \
+        for (int j0 = 0; j0 < n; j0 += DTYPE_GEMM_NB) {                            \
+            const int nb = n - j0 < DTYPE_GEMM_NB ? n - j0 : DTYPE_GEMM_NB;        \
+            for (int p0 = 0; p0 < k; p0 += DTYPE_GEMM_KB) {                        \
+                const int p1 = k - p0 < DTYPE_GEMM_KB ? k : p0 + DTYPE_GEMM_KB;    \
+                for (int i = first; i < last; i++) {                               \
+                    const utype* ai = a + (size_t) i * lda;                        \
+                    utype*       ci = c + (size_t) i * ldc + j0;                   \
+                    for (int p = p0; p < p1; p++) {                                \
+                        const utype  av = ai[p];                                   \
+                        const utype* bp = b + (size_t) p * ldb + j0;               \
+                        for (int j = 0; j < nb; j++) ci[j] += av * bp[j];          \
+                    }                                                              \
+                }                                                                  \
+            }                                                                      \
+        }                                                                          \
+    }
+
+/**
+ * @brief Ядра complex поверх ядер double real
+ *
+ * Элемент - пара (re, im); шаги и n считаются в комплексных элементах.
+ */
+#define DTYPE_COMPLEX(name, attr, real)                                            \
+    attr static void add_##name (int n, const void* a, const void* b, void* r) {   \
+        add_##real (2 * n, a, b, r);                                               \
+    }                                                                              \
+                                                                                   \
+    attr static void sub_##name (int n, const void* a, const void* b, void* r) {   \
+        sub_##real (2 * n, a, b, r);                                               \
+    }                                                                              \
+                                                                                   \
+    attr static void axpby_##name (int n, double alpha, const void* x,             \
+                                   double beta, void* y) {                         \
+        axpby_##real (2 * n, alpha, x, beta, y);                                   \
+    }                                                                              \
+                                                                                   \
+    attr static void gemm_##name (int first, int last, int n, int k,               \
+                                  const void* A, int lda, const void* B, int ldb,  \
+                                  void* C, int ldc) {                              \
+        const double* a = A;                                                       \
+        const double* b = B;                                                       \
+        double*       c = C;                                                       \
+        for (int i = first; i < last; i++)                                         \
+            memset (c + 2 * (size_t) i * ldc, 0, (size_t) n * 2 * sizeof (double));\
+        for (int j0 = 0; j0 < n; j0 += DTYPE_GEMM_NB) {                            \
+            const int nb = n - j0 < DTYPE_GEMM_NB ? n - j0 : DTYPE_GEMM_NB;        \
+            for (int p0 = 0; p0 < k; p0 += DTYPE_GEMM_KB) {                        \
+                const int p1 = k - p0 < DTYPE_GEMM_KB ? k : p0 + DTYPE_GEMM_KB;    \
+                for (int i = first; i < last; i++) {                               \
+                    const double* ai = a + 2 * (size_t) i * lda;                   \
+                    double*       ci = c + 2 * ((size_t) i * ldc + j0);            \
+                    for (int p = p0; p < p1; p++) {                                \
+                        const double  re = ai[2 * p];                              \
+                        const double  im = ai[2 * p + 1];                          \
+                        const double* bp = b + 2 * ((size_t) p * ldb + j0);        \
+                        for (int j = 0; j < nb; j++) {                             \
+                            ci[2 * j] += re * bp[2 * j] - im * bp[2 * j + 1];      \
+                            ci[2 * j + 1] += re * bp[2 * j + 1] + im * bp[2 * j];  \
+                        }                                                          \
+                    }                                                              \
+                }                                                                  \
+            }                                                                      \
+        }                                                                          \
+    }
+
+/**
+ * @brief Транспонирование и преобразования строк для типа type
+ *
+ * from приводит double к типу; преобразование complex в действительный
+ * тип по правилам C отбрасывает мнимую часть.
+ */
+#define DTYPE_COPY(name, type, from)                                               \
+    static void transpose_##name (int rows, int cols, const void* src, int lds,    \
+                                  void* dst, int ldd) {                            \
+        const type* s = src;                                                       \
+        type*       d = dst;                                                       \
+        for (int i0 = 0; i0 < rows; i0 += DTYPE_TRANSPOSE_BLOCK) {                 \
+            const int i1 = rows - i0 < DTYPE_TRANSPOSE_BLOCK                       \
+                               ? rows                                              \
+                               : i0 + DTYPE_TRANSPOSE_BLOCK;                       \
+            for (int j0 = 0; j0 < cols; j0 += DTYPE_TRANSPOSE_BLOCK) {             \
+                const int j1 = cols - j0 < DTYPE_TRANSPOSE_BLOCK                   \
+                                   ? cols                                          \
+                                   : j0 + DTYPE_TRANSPOSE_BLOCK;                   \
+                for (int i = i0; i < i1; i++)                                      \
+                    for (int j = j0; j < j1; j++)                                  \
+                        d[(size_t) j * ldd + i] = s[(size_t) i * lds + j];         \
+            }                                                                      \
+        }                                                                          \
+    }                                                                              \
+                                                                                   \
+    static void to_double_##name (int n, const void* src, double* dst) {           \
+        const type* s = src;                                                       \
+        for (int i = 0; i < n; i++) dst[i] = (double) s[i];                        \
+    }                                                                              \
+                                                                                   \
+    static void from_double_##name (int n, const double* src, void* dst) {         \
+        type* d = dst;                                                             \
+        for (int i = 0; i < n; i++) d[i] = (type) from (src[i]);                   \
+    }
+
+// ==============================================================================
+//  Ядра
+// ==============================================================================
+
+DTYPE_ARITH (f64_generic, SIMD_VECTORIZE, double, real_scalar)
+DTYPE_ARITH (f32_generic, SIMD_VECTORIZE, float, real_scalar)
+DTYPE_ARITH (i32_generic, SIMD_VECTORIZE, uint32_t, integer_scalar)
+DTYPE_ARITH (i64_generic, SIMD_VECTORIZE, uint64_t, integer_scalar)
+DTYPE_COMPLEX (c128_generic, SIMD_VECTORIZE, f64_generic)
+
+#if SIMD_X86
+#define DTYPE_AVX2 SIMD_VECTORIZE __attribute__ ((target ("avx2,fma")))
+DTYPE_ARITH (f64_avx2, DTYPE_AVX2, double, real_scalar)
+DTYPE_ARITH (f32_avx2, DTYPE_AVX2, float, real_scalar)
+DTYPE_ARITH (i32_avx2, DTYPE_AVX2, uint32_t, integer_scalar)
+DTYPE_ARITH (i64_avx2, DTYPE_AVX2, uint64_t, integer_scalar)
+DTYPE_COMPLEX (c128_avx2, DTYPE_AVX2, f64_avx2)
+#endif
+
+DTYPE_COPY (f64, double, real_scalar)
+DTYPE_COPY (f32, float, real_scalar)
+DTYPE_COPY (i32, int32_t, clamp_int32)
+DTYPE_COPY (i64, int64_t, clamp_int64)
+DTYPE_COPY (c128, double _Complex, real_scalar)
+
+// ==============================================================================
+//  Таблицы
+// ==============================================================================
+
+/// Строка таблицы: арифметика arith, копирование copy
+#define DTYPE_ENTRY(dtype, name, type, arith, copy)                                \
+    {dtype,         name,          sizeof (type),    add_##arith,                  \
+     sub_##arith,   axpby_##arith, gemm_##arith,     transpose_##copy,             \
+     to_double_##copy,             from_double_##copy}
+
+static const DtypeKernels dtype_generic[MATRIX_DTYPE_COUNT] = {
+    DTYPE_ENTRY (MATRIX_FLOAT64, "float64", double, f64_generic, f64),
+    DTYPE_ENTRY (MATRIX_FLOAT32, "float32", float, f32_generic, f32),
+    DTYPE_ENTRY (MATRIX_INT32, "int32", int32_t, i32_generic, i32),
+    DTYPE_ENTRY (MATRIX_INT64, "int64", int64_t, i64_generic, i64),
+    DTYPE_ENTRY (MATRIX_COMPLEX128, "complex128", double _Complex, c128_generic,
+                 c128),
+};
+
+#if SIMD_X86
+static const DtypeKernels dtype_avx2[MATRIX_DTYPE_COUNT] = {
+    DTYPE_ENTRY (MATRIX_FLOAT64, "float64", double, f64_avx2, f64),
+    DTYPE_ENTRY (MATRIX_FLOAT32, "float32", float, f32_avx2, f32),
+    DTYPE_ENTRY (MATRIX_INT32, "int32", int32_t, i32_avx2, i32),
+    DTYPE_ENTRY (MATRIX_INT64, "int64", int64_t, i64_avx2, i64),
+    DTYPE_ENTRY (MATRIX_COMPLEX128, "complex128", double _Complex, c128_avx2,
+                 c128),
+};
+#endif
+
+/**
+ * @brief Возвращает ядра типа для текущего процессора
+ *
+ * @param dtype Тип элементов
+ *
+ * @return Указатель на таблицу или NULL для неизвестного типа
+ */
+const DtypeKernels* dtype_kernels (MatrixDtype dtype) {
+    const DtypeKernels* res = NULL;
+
+    if (dtype >= MATRIX_FLOAT64 && dtype < MATRIX_DTYPE_COUNT) {
+        res = &dtype_generic[dtype];
+#if SIMD_X86
+        if (simd_kernels ()->level >= SIMD_AVX2) res = &dtype_avx2[dtype];
+#endif
+    }
+
+    return res;
+}
+
+/**
+ * @brief Размер элемента типа в байтах
+ *
+ * @param dtype Тип элементов
+ *
+ * @return Размер или 0 для неизвестного типа
+ */
+size_t matrix_dtype_size (MatrixDtype dtype) {
+    return dtype >= MATRIX_FLOAT64 && dtype < MATRIX_DTYPE_COUNT
+               ? dtype_generic[dtype].size
+               : 0;
+}
+
+/**
+ * @brief Имя типа
+ *
+ * @param dtype Тип элементов
+ *
+ * @return Имя или NULL для неизвестного типа
+ */
+const char* matrix_dtype_name (MatrixDtype dtype) {
+    return dtype >= MATRIX_FLOAT64 && dtype < MATRIX_DTYPE_COUNT
+               ? dtype_generic[dtype].name
+               : NULL;
+}
+
+// ==============================================================================
+//  Операции над матрицами
+// ==============================================================================
+
+/**
+ * @brief Начало строки row матрицы с элементами размера size
+ */
+static void* typed_row (const Matrix* m, int row, size_t size) {
+    return (char*) m->data + (size_t) row * (size_t) m->stride * size;
+}
+
+/**
+ * @brief Проверяет, что матрицы заданы, одного размера и одного типа
+ */
+static int same_shape (const Matrix* a, const Matrix* b) {
+    return a != NULL && b != NULL && a->data != NULL && b->data != NULL &&
+           a->rows == b->rows && a->cols == b->cols && a->dtype == b->dtype;
+}
+
+/**
+ * @brief result = A op B построчно
+ */
+static int elementwise (const Matrix* A, const Matrix* B, Matrix* result,
+                        int subtract) {
+    const DtypeKernels* kernels = A ? dtype_kernels (A->dtype) : NULL;
+    int                 res     = -1;
+
+    if (kernels && same_shape (A, B) && same_shape (A, result)) {
+        DtypeRowOp op = subtract ? kernels->sub : kernels->add;
+
+        for (int row = 0; row < A->rows; row++)
+            op (A->cols, typed_row (A, row, kernels->size),
+                typed_row (B, row, kernels->size),
+                typed_row (result, row, kernels->size));
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Поэлементно складывает матрицы одного типа: result = A + B
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int dtype_add (const Matrix* A, const Matrix* B, Matrix* result) {
+    return elementwise (A, B, result, 0);
+}
+
+/**
+ * @brief Поэлементно вычитает матрицы одного типа: result = A - B
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int dtype_subtract (const Matrix* A, const Matrix* B, Matrix* result) {
+    return elementwise (A, B, result, 1);
+}
+
+/**
+ * @brief Y = alpha * X + beta * Y для матриц одного типа
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int dtype_axpby (double alpha, const Matrix* X, double beta, Matrix* Y) {
+    const DtypeKernels* kernels = X ? dtype_kernels (X->dtype) : NULL;
+    int                 res     = -1;
+
+    if (kernels && same_shape (X, Y)) {
+        for (int row = 0; row < X->rows; row++)
+            kernels->axpby (X->cols, alpha, typed_row (X, row, kernels->size), beta,
+                            typed_row (Y, row, kernels->size));
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Подзадача умножения: полоса строк task
+ */
+static void multiply_rows (void* ctx, int task, int worker) {
+    MultiplyJob* job   = ctx;
+    const int    first = task * job->chunk;
+    const int    last  = first + job->chunk < job->C->rows ? first + job->chunk
+                                                           : job->C->rows;
+
+    (void) worker;
+    job->kernels->gemm_rows (first, last, job->C->cols, job->A->cols, job->A->data,
+                             job->A->stride, job->B->data, job->B->stride,
+                             job->C->data, job->C->stride);
+}
+
+/**
+ * @brief Умножает матрицы одного типа: result = A x B
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int dtype_multiply (const Matrix* A, const Matrix* B, Matrix* result) {
+    const DtypeKernels* kernels = A ? dtype_kernels (A->dtype) : NULL;
+    int                 res     = -1;
+
+    if (kernels && B && result && A->data && B->data && result->data &&
+        A->dtype == B->dtype && A->dtype == result->dtype && A->cols == B->rows &&
+        result->rows == A->rows && result->cols == B->cols &&
+        result->data != A->data && result->data != B->data) {
+        const double work  = (double) A->rows * B->cols * A->cols;
+        MultiplyJob  job   = {kernels, A, B, result, 0};
+        int          tasks = thread_pool_threads () * 2;
+
+        if (work < DTYPE_PARALLEL_MIN) tasks = 1;
+        if (tasks > result->rows) tasks = result->rows;
+        job.chunk = (result->rows + tasks - 1) / tasks;
+        thread_pool_run ((result->rows + job.chunk - 1) / job.chunk, multiply_rows,
+                         &job);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Транспонирует матрицу в result того же типа
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int dtype_transpose (const Matrix* matrix, Matrix* result) {
+    const DtypeKernels* kernels = matrix ? dtype_kernels (matrix->dtype) : NULL;
+    int                 res     = -1;
+
+    if (kernels && result && matrix->data && result->data &&
+        matrix->dtype == result->dtype && matrix->data != result->data &&
+        result->rows == matrix->cols && result->cols == matrix->rows) {
+        kernels->transpose (matrix->rows, matrix->cols, matrix->data,
+                            matrix->stride, result->data, result->stride);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Копирует матрицу с преобразованием типа элементов
+ *
+ * Строка переводится в double во временный буфер и затем в тип dst.
+ *
+ * @param src Исходная матрица
+ * @param dst Матрица того же размера с нужным dtype
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int convert_matrix (const Matrix* src, Matrix* dst) {
+    const DtypeKernels* from = src ? dtype_kernels (src->dtype) : NULL;
+    const DtypeKernels* to   = dst ? dtype_kernels (dst->dtype) : NULL;
+    double*             row  = NULL;
+    int                 res  = -1;
+
+    if (from && to && src->data && dst->data && src->data != dst->data &&
+        src->rows == dst->rows && src->cols == dst->cols) {
+        res = 0;
+        if (from != to) {
+            row = malloc ((size_t) src->cols * sizeof (double));
+            if (!row) res = -1;
+        }
+    }
+
+    for (int r = 0; r < (res == 0 ? src->rows : 0); r++) {
+        if (from == to) {
+            memcpy (typed_row (dst, r, to->size), typed_row (src, r, from->size),
+                    (size_t) src->cols * from->size);
+        } else {
+            from->to_double (src->cols, typed_row (src, r, from->size), row);
+            to->from_double (src->cols, row, typed_row (dst, r, to->size));
+        }
+    }
+
+    free (row);
+
+    return res;
+}
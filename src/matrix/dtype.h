@@ -0,0 +1,163 @@
+/**
+ * @file dtype.h
+ * @brief Матрицы с элементами float, double, int32, int64 и complex
+ *
+ * @details
+ * Тип элементов хранится в поле dtype матрицы (matrix.h). Для каждого типа
+ * ядра собираются из одних макросов и сводятся в таблицу DtypeKernels,
+ * операции matrix.h выбирают таблицу по dtype операндов во время
+ * выполнения. Все типы работают в одной сборке; MATRIX_TYPE (double)
+ * по-прежнему использует векторные ядра simd.h и блочный GEMM gemm.h.
+ *
+ * Семантика типов:
+ * - float и double - арифметика IEEE в своем типе
+ * - int32 и int64 - целочисленная арифметика по модулю 2^32 (2^64), без
+ *   неопределенного поведения при переполнении; коэффициенты axpby
+ *   округляются до целого
+ * - complex - пара (re, im) double, как double _Complex; коэффициенты
+ *   axpby вещественные
+ *
+ * Умножение работает блоками строк B, удерживаемыми в кэше, параллельно по
+ * полосам строк результата; на процессорах с AVX2 используется вариант
+ * тех же ядер, собранный с target ("avx2,fma").
+ *
+ * @code
+ * Matrix A = create_matrix_dtype (n, n, MATRIX_INT32);
+ * Matrix B = create_matrix_dtype (n, n, MATRIX_INT32);
+ * Matrix C = create_matrix_dtype (n, n, MATRIX_INT32);
+ * multiply_matrices (&A, &B, &C);
+ * @endcode
+ *
+ * @see matrix.h simd.h
+ */
+
+#ifndef DTYPE_H
+#define DTYPE_H
+
+#include "matrix.h"
+
+/**
+ * @brief Поэлементная операция над строкой: r[i] = a[i] op b[i]
+ */
+typedef void (*DtypeRowOp) (int n, const void* a, const void* b, void* r);
+
+/**
+ * @brief Линейная комбинация строк: y[i] = alpha * x[i] + beta * y[i]
+ *
+ * При beta == 0 строка y не читается. x и y могут совпадать.
+ */
+typedef void (*DtypeRowAxpby) (int n, double alpha, const void* x, double beta,
+                               void* y);
+
+/**
+ * @brief Строки first..last-1 произведения C = A x B
+ * @param n Число столбцов B и C
+ * @param k Общая размерность
+ */
+typedef void (*DtypeGemmRows) (int first, int last, int n, int k, const void* A,
+                               int lda, const void* B, int ldb, void* C, int ldc);
+
+/**
+ * @brief Транспонирование блока rows x cols: dst[j][i] = src[i][j]
+ */
+typedef void (*DtypeTranspose) (int rows, int cols, const void* src, int lds,
+                                void* dst, int ldd);
+
+/**
+ * @brief Перевод строки из типа в double (complex - действительная часть)
+ */
+typedef void (*DtypeToDouble) (int n, const void* src, double* dst);
+
+/**
+ * @brief Перевод строки из double в тип
+ *
+ * Целые типы получают значение с отбрасыванием дробной части и
+ * насыщением на границах диапазона, NaN становится нулем.
+ */
+typedef void (*DtypeFromDouble) (int n, const double* src, void* dst);
+
+/**
+ * @struct DtypeKernels
+ * @brief Таблица ядер одного типа элементов
+ */
+typedef struct {
+    MatrixDtype     dtype;         ///< Тип элементов
+    const char*     name;          ///< Имя типа
+    size_t          size;          ///< Размер элемента в байтах
+    DtypeRowOp      add;           ///< Сложение строк
+    DtypeRowOp      sub;           ///< Вычитание строк
+    DtypeRowAxpby   axpby;         ///< Линейная комбинация строк
+    DtypeGemmRows   gemm_rows;     ///< Полоса строк произведения
+    DtypeTranspose  transpose;     ///< Транспонирование блока
+    DtypeToDouble   to_double;     ///< Перевод строки в double
+    DtypeFromDouble from_double;   ///< Перевод строки из double
+} DtypeKernels;
+
+/**
+ * @brief Возвращает ядра типа для текущего процессора
+ * @param dtype Тип элементов
+ * @return Указатель на таблицу или NULL для неизвестного типа
+ */
+const DtypeKernels* dtype_kernels (MatrixDtype dtype);
+
+/**
+ * @brief Размер элемента типа в байтах
+ * @param dtype Тип элементов
+ * @return Размер или 0 для неизвестного типа
+ */
+size_t matrix_dtype_size (MatrixDtype dtype);
+
+/**
+ * @brief Имя типа ("float64", "float32", "int32", "int64", "complex128")
+ * @param dtype Тип элементов
+ * @return Имя или NULL для неизвестного типа
+ */
+const char* matrix_dtype_name (MatrixDtype dtype);
+
+/**
+ * @brief Поэлементно складывает матрицы одного типа: result = A + B
+ * @note result может совпадать с A или B
+ * @return 0 при успехе, -1 при ошибке или разных типах операндов
+ */
+int dtype_add (const Matrix* A, const Matrix* B, Matrix* result);
+
+/**
+ * @brief Поэлементно вычитает матрицы одного типа: result = A - B
+ * @note result может совпадать с A или B
+ * @return 0 при успехе, -1 при ошибке или разных типах операндов
+ */
+int dtype_subtract (const Matrix* A, const Matrix* B, Matrix* result);
+
+/**
+ * @brief Y = alpha * X + beta * Y для матриц одного типа
+ * @note X может совпадать с Y; при beta == 0 прежнее Y не читается
+ * @return 0 при успехе, -1 при ошибке или разных типах операндов
+ */
+int dtype_axpby (double alpha, const Matrix* X, double beta, Matrix* Y);
+
+/**
+ * @brief Умножает матрицы одного типа: result = A x B
+ * @note result не пересекается с A и B
+ * @return 0 при успехе, -1 при ошибке или разных типах операндов
+ */
+int dtype_multiply (const Matrix* A, const Matrix* B, Matrix* result);
+
+/**
+ * @brief Транспонирует матрицу в result того же типа
+ * @note result размера cols x rows, не совпадает с matrix
+ * @return 0 при успехе, -1 при ошибке или разных типах операндов
+ */
+int dtype_transpose (const Matrix* matrix, Matrix* result);
+
+/**
+ * @brief Копирует матрицу с преобразованием типа элементов
+ * @param src Исходная матрица
+ * @param dst Матрица того же размера с нужным dtype, не пересекается с src
+ * @note Преобразование идет через double: int64 по модулю больше 2^53
+ * теряет младшие разряды, complex переходит в действительные типы
+ * действительной частью. При одинаковых типах строки копируются точно
+ * @return 0 при успехе, -1 при ошибке
+ */
+int convert_matrix (const Matrix* src, Matrix* dst);
+
+#endif   // DTYPE_H
@@ -0,0 +1,822 @@
+/**
+ * @file expr.c
+ * @brief Планирование и вычисление ленивых матричных выражений
+ *
+ * @details
+ * Вычисление проходит в два этапа.
+ *
+ * Планирование обходит граф от корня и строит список шагов:
+ * - сложения, вычитания и умножения на число, чьи узлы не используются
+ *   повторно, сворачиваются в линейную комбинацию листьев; одинаковые
+ *   листья объединяются, комбинация считается одним шагом EXPR_STEP_LINEAR
+ * - транспонирование переносится на листья комбинации ((X + Y)^T =
+ *   X^T + Y^T) и на операнды умножения, где становится флагом GEMM;
+ *   (X x Y)^T считается как Y^T x X^T
+ * - произведение с коэффициентом 1 внутри комбинации считается GEMM с
+ *   эпилогом из остальных слагаемых, если их не больше GEMM_MAX_ADDENDS
+ * - значение узла, используемого несколько раз, считается один раз
+ *
+ * Исполнение выполняет шаги по порядку. Для каждого промежуточного
+ * значения известен последний читающий его шаг; после этого шага буфер
+ * возвращается в пул и достается следующему шагу, которому хватает его
+ * размера. Последний шаг пишет сразу в матрицу результата.
+ *
+ * @see expr.h gemm.h
+ */
+
+#include "expr.h"
+
+#include "gemm.h"
+#include "simd.h"
+
+#include <stdlib.h>
+
+/**
+ * @brief Операция узла
+ */
+typedef enum {
+    EXPR_INPUT,      ///< Входная матрица
+    EXPR_ADD,        ///< a + b
+    EXPR_SUB,        ///< a - b
+    EXPR_SCALE,      ///< alpha * a
+    EXPR_MULTIPLY,   ///< a x b
+    EXPR_TRANSPOSE   ///< a^T
+} ExprOp;
+
+/**
+ * @struct ExprNode
+ * @brief Узел графа
+ */
+typedef struct {
+    ExprOp        op;           ///< Операция
+    int           a, b;         ///< Номера операндов
+    MATRIX_TYPE   alpha;        ///< Коэффициент EXPR_SCALE
+    int           rows, cols;   ///< Размеры результата
+    const Matrix* input;        ///< Матрица EXPR_INPUT
+} ExprNode;
+
+struct MatrixExpr {
+    ExprNode* nodes;      ///< Узлы в порядке добавления
+    int       count;      ///< Число узлов
+    int       capacity;   ///< Емкость массива nodes
+};
+
+/**
+ * @brief Вид шага плана
+ */
+typedef enum {
+    EXPR_STEP_LINEAR,     ///< out = sum (alpha_i * value_i)
+    EXPR_STEP_GEMM,       ///< out = op(a) x op(b) + sum (alpha_i * value_i)
+    EXPR_STEP_TRANSPOSE   ///< out = a^T
+} ExprStepKind;
+
+/**
+ * @struct ExprTerm
+ * @brief Слагаемое линейной комбинации или эпилога
+ */
+typedef struct {
+    int         value;   ///< Номер значения
+    MATRIX_TYPE alpha;   ///< Коэффициент
+} ExprTerm;
+
+/**
+ * @struct ExprStep
+ * @brief Шаг плана
+ */
+typedef struct {
+    ExprStepKind kind;               ///< Вид шага
+    int          out;                ///< Значение-результат
+    int          a, b;               ///< Операнды GEMM, источник транспонирования
+    int          trans_a, trans_b;   ///< Флаги транспонирования GEMM
+    int          first, terms;       ///< Слагаемые: plan.terms[first..first+terms)
+} ExprStep;
+
+/**
+ * @struct ExprValue
+ * @brief Значение: входная матрица или результат шага
+ */
+typedef struct {
+    const Matrix* input;        ///< Входная матрица или NULL
+    int           rows, cols;   ///< Размеры
+    int           last_use;     ///< Последний шаг, читающий значение
+    int           buffer;       ///< Буфер пула во время исполнения
+} ExprValue;
+
+/**
+ * @struct ExprLeaf
+ * @brief Лист линейной комбинации при планировании
+ */
+typedef struct {
+    int         node;    ///< Номер узла
+    int         trans;   ///< Узел берется транспонированным
+    MATRIX_TYPE alpha;   ///< Коэффициент
+} ExprLeaf;
+
+/**
+ * @struct ExprPlan
+ * @brief План вычисления
+ */
+typedef struct {
+    const MatrixExpr* expr;                     ///< Выражение
+    int*              uses;                     ///< Число использований узлов
+    int*              memo;                     ///< Значение (узел, trans) или -1
+    ExprValue*        values;                   ///< Значения
+    int               value_count, value_cap;   ///< Размер и емкость values
+    ExprStep*         steps;                    ///< Шаги по порядку исполнения
+    int               step_count, step_cap;     ///< Размер и емкость steps
+    ExprTerm*         terms;                    ///< Слагаемые всех шагов
+    int               term_count, term_cap;     ///< Размер и емкость terms
+    int               failed;                   ///< Признак ошибки
+} ExprPlan;
+
+/**
+ * @struct ExprBuffer
+ * @brief Буфер пула промежуточных значений
+ */
+typedef struct {
+    Matrix matrix;     ///< Матрица с текущими размерами
+    size_t capacity;   ///< Емкость буфера в элементах
+    int    busy;       ///< Буфер занят живым значением
+} ExprBuffer;
+
+/**
+ * @brief Обеспечивает место для еще одного элемента массива
+ *
+ * @param data Указатель на массив
+ * @param capacity Текущая емкость, обновляется при росте
+ * @param count Число занятых элементов
+ * @param size Размер элемента
+ *
+ * @return Массив (возможно перемещенный) или NULL при ошибке
+ */
+static void* reserve (void* data, int* capacity, int count, size_t size) {
+    void* res = data;
+
+    if (count >= *capacity) {
+        int grown = *capacity > 0 ? *capacity * 2 : 16;
+        res       = realloc (data, (size_t) grown * size);
+        if (res) *capacity = grown;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Проверяет номер узла
+ */
+static int valid_node (const MatrixExpr* expr, int node) {
+    return expr != NULL && node >= 0 && node < expr->count;
+}
+
+/**
+ * @brief Добавляет узел в граф
+ *
+ * @return Номер узла или -1 при ошибке выделения памяти
+ */
+static int add_node (MatrixExpr* expr, ExprNode node) {
+    int       res   = -1;
+    ExprNode* nodes = reserve (expr->nodes, &expr->capacity, expr->count,
+                               sizeof (ExprNode));
+
+    if (nodes) {
+        expr->nodes              = nodes;
+        expr->nodes[expr->count] = node;
+        res                      = expr->count++;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Создает пустое выражение
+ *
+ * @return Указатель на выражение или NULL при ошибке выделения памяти
+ */
+MatrixExpr* expr_create (void) {
+    return calloc (1, sizeof (MatrixExpr));
+}
+
+/**
+ * @brief Освобождает выражение
+ *
+ * @param expr Указатель на выражение (может быть NULL)
+ */
+void expr_free (MatrixExpr* expr) {
+    if (expr) {
+        free (expr->nodes);
+        free (expr);
+    }
+}
+
+/**
+ * @brief Добавляет входную матрицу
+ *
+ * @param expr Указатель на выражение
+ * @param matrix Матрица; не копируется и должна жить до вычисления
+ *
+ * @return Номер узла или -1 при ошибке
+ */
+int expr_input (MatrixExpr* expr, const Matrix* matrix) {
+    int res = -1;
+
+    if (expr != NULL && matrix != NULL && matrix->data != NULL &&
+        matrix->rows > 0 && matrix->cols > 0 && matrix->dtype == MATRIX_FLOAT64) {
+        ExprNode node = {EXPR_INPUT, -1, -1, 0, matrix->rows, matrix->cols, matrix};
+        res           = add_node (expr, node);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Добавляет поэлементный узел a op b
+ */
+static int add_elementwise (MatrixExpr* expr, ExprOp op, int a, int b) {
+    int res = -1;
+
+    if (valid_node (expr, a) && valid_node (expr, b) &&
+        expr->nodes[a].rows == expr->nodes[b].rows &&
+        expr->nodes[a].cols == expr->nodes[b].cols) {
+        ExprNode node = {op, a, b, 0, expr->nodes[a].rows, expr->nodes[a].cols,
+                         NULL};
+        res           = add_node (expr, node);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Добавляет узел a + b
+ *
+ * @param expr Указатель на выражение
+ * @param a Номер первого операнда
+ * @param b Номер второго операнда
+ *
+ * @return Номер узла или -1 при ошибке или несовпадении размеров
+ */
+int expr_add (MatrixExpr* expr, int a, int b) {
+    return add_elementwise (expr, EXPR_ADD, a, b);
+}
+
+/**
+ * @brief Добавляет узел a - b
+ *
+ * @param expr Указатель на выражение
+ * @param a Номер уменьшаемого
+ * @param b Номер вычитаемого
+ *
+ * @return Номер узла или -1 при ошибке или несовпадении размеров
+ */
+int expr_sub (MatrixExpr* expr, int a, int b) {
+    return add_elementwise (expr, EXPR_SUB, a, b);
+}
+
+/**
+ * @brief Добавляет узел alpha * a
+ *
+ * @param expr Указатель на выражение
+ * @param a Номер операнда
+ * @param alpha Коэффициент
+ *
+ * @return Номер узла или -1 при ошибке
+ */
+int expr_scale (MatrixExpr* expr, int a, MATRIX_TYPE alpha) {
+    int res = -1;
+
+    if (valid_node (expr, a)) {
+        ExprNode node = {EXPR_SCALE, a, -1, alpha, expr->nodes[a].rows,
+                         expr->nodes[a].cols, NULL};
+        res           = add_node (expr, node);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Добавляет узел a x b
+ *
+ * @param expr Указатель на выражение
+ * @param a Номер левого множителя
+ * @param b Номер правого множителя
+ *
+ * @return Номер узла или -1 при ошибке или несовместимых размерах
+ */
+int expr_multiply (MatrixExpr* expr, int a, int b) {
+    int res = -1;
+
+    if (valid_node (expr, a) && valid_node (expr, b) &&
+        expr->nodes[a].cols == expr->nodes[b].rows) {
+        ExprNode node = {EXPR_MULTIPLY, a, b, 0, expr->nodes[a].rows,
+                         expr->nodes[b].cols, NULL};
+        res           = add_node (expr, node);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Добавляет узел a^T
+ *
+ * @param expr Указатель на выражение
+ * @param a Номер операнда
+ *
+ * @return Номер узла или -1 при ошибке
+ */
+int expr_transpose (MatrixExpr* expr, int a) {
+    int res = -1;
+
+    if (valid_node (expr, a)) {
+        ExprNode node = {EXPR_TRANSPOSE, a, -1, 0, expr->nodes[a].cols,
+                         expr->nodes[a].rows, NULL};
+        res           = add_node (expr, node);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Возвращает размеры результата узла
+ *
+ * @param expr Указатель на выражение
+ * @param node Номер узла
+ * @param rows Число строк
+ * @param cols Число столбцов
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int expr_shape (const MatrixExpr* expr, int node, int* rows, int* cols) {
+    int res = -1;
+
+    if (valid_node (expr, node) && rows != NULL && cols != NULL) {
+        *rows = expr->nodes[node].rows;
+        *cols = expr->nodes[node].cols;
+        res   = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Считает использования узлов, достижимых из node
+ */
+static void count_uses (ExprPlan* plan, int node) {
+    const ExprNode* n = &plan->expr->nodes[node];
+
+    if (plan->uses[node]++ == 0 && n->op != EXPR_INPUT) {
+        count_uses (plan, n->a);
+        if (n->op == EXPR_ADD || n->op == EXPR_SUB || n->op == EXPR_MULTIPLY)
+            count_uses (plan, n->b);
+    }
+}
+
+/**
+ * @brief Добавляет значение в план
+ *
+ * @return Номер значения или -1 при ошибке
+ */
+static int add_value (ExprPlan* plan, const Matrix* input, int rows, int cols) {
+    int        res    = -1;
+    ExprValue* values = reserve (plan->values, &plan->value_cap, plan->value_count,
+                                 sizeof (ExprValue));
+
+    if (values) {
+        ExprValue value                  = {input, rows, cols, -1, -1};
+        plan->values                     = values;
+        plan->values[plan->value_count] = value;
+        res                              = plan->value_count++;
+    } else {
+        plan->failed = 1;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Добавляет слагаемое к последнему шагу плана
+ */
+static void add_term (ExprPlan* plan, int value, MATRIX_TYPE alpha) {
+    ExprTerm* terms = reserve (plan->terms, &plan->term_cap, plan->term_count,
+                               sizeof (ExprTerm));
+
+    if (terms) {
+        ExprTerm term                   = {value, alpha};
+        plan->terms                     = terms;
+        plan->terms[plan->term_count++] = term;
+    } else {
+        plan->failed = 1;
+    }
+}
+
+/**
+ * @brief Добавляет шаг и отмечает чтение его операндов
+ *
+ * Слагаемые шага должны быть добавлены последними в plan.terms.
+ *
+ * @return Номер значения-результата или -1 при ошибке
+ */
+static int add_step (ExprPlan* plan, ExprStep step, int rows, int cols) {
+    ExprStep* steps = reserve (plan->steps, &plan->step_cap, plan->step_count,
+                               sizeof (ExprStep));
+
+    step.out = add_value (plan, NULL, rows, cols);
+    if (steps && step.out >= 0) {
+        const int index = plan->step_count++;
+
+        plan->steps        = steps;
+        plan->steps[index] = step;
+
+        if (step.a >= 0) plan->values[step.a].last_use = index;
+        if (step.b >= 0) plan->values[step.b].last_use = index;
+        for (int t = step.first; t < step.first + step.terms; t++)
+            plan->values[plan->terms[t].value].last_use = index;
+    } else {
+        if (steps) plan->steps = steps;
+        plan->failed = 1;
+        step.out     = -1;
+    }
+
+    return step.out;
+}
+
+static int plan_value (ExprPlan* plan, int node, int trans);
+
+/**
+ * @brief Снимает с узла цепочку транспонирований
+ */
+static void strip_transposes (const ExprPlan* plan, int* node, int* trans) {
+    while (plan->expr->nodes[*node].op == EXPR_TRANSPOSE) {
+        *node  = plan->expr->nodes[*node].a;
+        *trans = !*trans;
+    }
+}
+
+/**
+ * @brief Раскладывает узел в линейную комбинацию листьев
+ *
+ * Спуск идет через сложения, вычитания, умножения на число и
+ * транспонирования, если узел - корень группы или используется один раз.
+ *
+ * @param leaves Массив листьев, растет по мере надобности
+ * @param count Число листьев
+ * @param capacity Емкость массива листьев
+ */
+static void collect (ExprPlan* plan, int node, int trans, MATRIX_TYPE alpha,
+                     int root, ExprLeaf** leaves, int* count, int* capacity) {
+    const ExprNode* n     = &plan->expr->nodes[node];
+    const int       inner = root || plan->uses[node] == 1;
+
+    if (inner && (n->op == EXPR_ADD || n->op == EXPR_SUB)) {
+        collect (plan, n->a, trans, alpha, 0, leaves, count, capacity);
+        collect (plan, n->b, trans, n->op == EXPR_SUB ? -alpha : alpha, 0, leaves,
+                 count, capacity);
+    } else if (inner && n->op == EXPR_SCALE) {
+        collect (plan, n->a, trans, alpha * n->alpha, 0, leaves, count, capacity);
+    } else if (inner && n->op == EXPR_TRANSPOSE) {
+        collect (plan, n->a, !trans, alpha, 0, leaves, count, capacity);
+    } else {
+        int found = 0;
+
+        strip_transposes (plan, &node, &trans);
+        for (int i = 0; i < *count && !found; i++) {
+            if ((*leaves)[i].node == node && (*leaves)[i].trans == trans) {
+                (*leaves)[i].alpha += alpha;
+                found = 1;
+            }
+        }
+
+        if (!found) {
+            ExprLeaf* grown = reserve (*leaves, capacity, *count, sizeof (ExprLeaf));
+            if (grown) {
+                ExprLeaf leaf     = {node, trans, alpha};
+                *leaves           = grown;
+                (*leaves)[*count] = leaf;
+                (*count)++;
+            } else {
+                plan->failed = 1;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Планирует op(X) x op(Y) (или транспонированное произведение)
+ *        с эпилогом из листьев
+ *
+ * @param node Узел EXPR_MULTIPLY
+ * @param trans 1 - нужен результат (X x Y)^T = Y^T x X^T
+ * @param leaves Слагаемые эпилога
+ * @param count Число слагаемых (не больше GEMM_MAX_ADDENDS)
+ *
+ * @return Номер значения или -1 при ошибке
+ */
+static int plan_gemm (ExprPlan* plan, int node, int trans, const ExprLeaf* leaves,
+                      int count) {
+    const ExprNode* n       = &plan->expr->nodes[node];
+    int             left    = trans ? n->b : n->a;
+    int             right   = trans ? n->a : n->b;
+    int             trans_a = trans;
+    int             trans_b = trans;
+    int             rows    = trans ? n->cols : n->rows;
+    int             cols    = trans ? n->rows : n->cols;
+
+    strip_transposes (plan, &left, &trans_a);
+    strip_transposes (plan, &right, &trans_b);
+
+    ExprStep step = {EXPR_STEP_GEMM, -1, -1, -1, trans_a, trans_b, 0, count};
+    int      addends[GEMM_MAX_ADDENDS];
+
+    step.a = plan_value (plan, left, 0);
+    step.b = plan_value (plan, right, 0);
+    for (int i = 0; i < count; i++)
+        addends[i] = plan_value (plan, leaves[i].node, leaves[i].trans);
+
+    step.first = plan->term_count;
+    for (int i = 0; i < count && !plan->failed; i++)
+        add_term (plan, addends[i], leaves[i].alpha);
+
+    return plan->failed ? -1 : add_step (plan, step, rows, cols);
+}
+
+/**
+ * @brief Планирует линейную комбинацию с корнем node
+ *
+ * @return Номер значения или -1 при ошибке
+ */
+static int plan_linear (ExprPlan* plan, int node, int trans) {
+    const ExprNode* n        = &plan->expr->nodes[node];
+    ExprLeaf*       leaves   = NULL;
+    int             count    = 0;
+    int             capacity = 0;
+    int             fused    = -1;
+    int             res      = -1;
+
+    collect (plan, node, trans, 1, 1, &leaves, &count, &capacity);
+
+    // Произведение с коэффициентом 1, считающееся только здесь, - в GEMM
+    for (int i = 0; i < count && fused < 0 && count - 1 <= GEMM_MAX_ADDENDS; i++) {
+        const int leaf = leaves[i].node;
+        if (plan->expr->nodes[leaf].op == EXPR_MULTIPLY && plan->uses[leaf] == 1 &&
+            leaves[i].alpha == 1)
+            fused = i;
+    }
+
+    if (plan->failed) {
+        res = -1;
+    } else if (fused >= 0) {
+        ExprLeaf product = leaves[fused];
+        leaves[fused]    = leaves[count - 1];
+        res = plan_gemm (plan, product.node, product.trans, leaves, count - 1);
+    } else {
+        int*     values = malloc ((size_t) count * sizeof (int));
+        ExprStep step   = {EXPR_STEP_LINEAR, -1, -1, -1, 0, 0, 0, count};
+
+        if (values) {
+            for (int i = 0; i < count; i++)
+                values[i] = plan_value (plan, leaves[i].node, leaves[i].trans);
+
+            step.first = plan->term_count;
+            for (int i = 0; i < count && !plan->failed; i++)
+                add_term (plan, values[i], leaves[i].alpha);
+
+            if (!plan->failed)
+                res = add_step (plan, step, trans ? n->cols : n->rows,
+                                trans ? n->rows : n->cols);
+            free (values);
+        } else {
+            plan->failed = 1;
+        }
+    }
+
+    free (leaves);
+
+    return res;
+}
+
+/**
+ * @brief Планирует вычисление узла (транспонированного при trans = 1)
+ *
+ * @return Номер значения или -1 при ошибке
+ */
+static int plan_value (ExprPlan* plan, int node, int trans) {
+    int res = -1;
+
+    strip_transposes (plan, &node, &trans);
+    if (plan->failed) {
+        res = -1;
+    } else if (plan->memo[2 * node + trans] >= 0) {
+        res = plan->memo[2 * node + trans];
+    } else {
+        const ExprNode* n = &plan->expr->nodes[node];
+
+        if (n->op == EXPR_INPUT && !trans) {
+            res = add_value (plan, n->input, n->rows, n->cols);
+        } else if (n->op == EXPR_INPUT) {
+            ExprStep step = {EXPR_STEP_TRANSPOSE, -1, -1, -1, 0, 0, 0, 0};
+
+            step.a = plan_value (plan, node, 0);
+            if (!plan->failed) res = add_step (plan, step, n->cols, n->rows);
+        } else if (n->op == EXPR_MULTIPLY) {
+            res = plan_gemm (plan, node, trans, NULL, 0);
+        } else {
+            res = plan_linear (plan, node, trans);
+        }
+
+        plan->memo[2 * node + trans] = res;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Выдает буфер пула размером не меньше rows x cols
+ *
+ * Из свободных буферов выбирается наименьший подходящий.
+ *
+ * @return Номер буфера или -1 при ошибке выделения памяти
+ */
+static int acquire_buffer (ExprBuffer** pool, int* count, int* capacity, int rows,
+                           int cols) {
+    const int    stride = MATRIX_STRIDE (cols);
+    const size_t need   = (size_t) rows * stride;
+    int          res    = -1;
+
+    for (int i = 0; i < *count; i++) {
+        if (!(*pool)[i].busy && (*pool)[i].capacity >= need &&
+            (res < 0 || (*pool)[i].capacity < (*pool)[res].capacity))
+            res = i;
+    }
+
+    if (res < 0) {
+        ExprBuffer* grown = reserve (*pool, capacity, *count, sizeof (ExprBuffer));
+        if (grown) {
+            *pool                    = grown;
+            (*pool)[*count].matrix   = create_matrix (rows, cols);
+            (*pool)[*count].capacity = need;
+            if ((*pool)[*count].matrix.data) res = (*count)++;
+        }
+    }
+
+    if (res >= 0) {
+        Matrix* m = &(*pool)[res].matrix;
+
+        (*pool)[res].busy = 1;
+        m->rows           = rows;
+        m->cols           = cols;
+        m->stride         = stride;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Считает out = sum (alpha_i * value_i) построчно
+ *
+ * Строка результата остается в L1, пока к ней прибавляются строки всех
+ * слагаемых, поэтому каждая матрица читается и пишется один раз.
+ */
+static void run_linear (const Matrix* const* inputs, const ExprTerm* terms,
+                        int count, Matrix* out) {
+    SimdRowAxpby axpby = simd_kernels ()->axpby;
+
+    for (int row = 0; row < out->rows; row++) {
+        MATRIX_TYPE* r = MATRIX_ROW (out, row);
+
+        for (int t = 0; t < count; t++)
+            axpby (out->cols, terms[t].alpha, MATRIX_ROW (inputs[t], row),
+                   t == 0 ? 0.0 : 1.0, r);
+    }
+}
+
+/**
+ * @brief Матрица значения во время исполнения
+ */
+static const Matrix* value_matrix (const ExprPlan* plan, const ExprBuffer* pool,
+                                   int value) {
+    const ExprValue* v = &plan->values[value];
+    return v->input ? v->input : &pool[v->buffer].matrix;
+}
+
+/**
+ * @brief Выполняет шаги плана, последний - в result
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int execute (ExprPlan* plan, Matrix* result) {
+    ExprBuffer*    pool     = NULL;
+    int            count    = 0;
+    int            capacity = 0;
+    const Matrix** inputs   = malloc ((size_t) (plan->term_count + 1) *
+                                      sizeof (const Matrix*));
+    int            res      = inputs ? 0 : -1;
+
+    for (int s = 0; s < plan->step_count && res == 0; s++) {
+        const ExprStep* step = &plan->steps[s];
+        ExprValue*      out  = &plan->values[step->out];
+        Matrix*         target;
+
+        if (s == plan->step_count - 1) {
+            target = result;
+        } else {
+            out->buffer = acquire_buffer (&pool, &count, &capacity, out->rows,
+                                          out->cols);
+            if (out->buffer < 0) {
+                res = -1;
+                break;
+            }
+            target = &pool[out->buffer].matrix;
+        }
+
+        for (int t = 0; t < step->terms; t++) {
+            const int value = plan->terms[step->first + t].value;
+            inputs[t]       = value_matrix (plan, pool, value);
+        }
+
+        if (step->kind == EXPR_STEP_LINEAR) {
+            run_linear (inputs, plan->terms + step->first, step->terms, target);
+        } else if (step->kind == EXPR_STEP_TRANSPOSE) {
+            res = transpose_matrix_into (value_matrix (plan, pool, step->a), target);
+        } else {
+            const Matrix* A        = value_matrix (plan, pool, step->a);
+            const Matrix* B        = value_matrix (plan, pool, step->b);
+            GemmEpilogue  epilogue = {step->terms, {{0}}};
+
+            for (int t = 0; t < step->terms; t++) {
+                epilogue.terms[t].data  = inputs[t]->data;
+                epilogue.terms[t].ld    = inputs[t]->stride;
+                epilogue.terms[t].alpha = plan->terms[step->first + t].alpha;
+            }
+            res = gemm_compute (step->trans_a, step->trans_b, target->rows,
+                                target->cols, step->trans_a ? A->rows : A->cols,
+                                A->data, A->stride, B->data, B->stride,
+                                target->data, target->stride, &epilogue);
+        }
+
+        // Значения, которые больше никто не читает, освобождают буферы
+        for (int v = 0; v < plan->value_count; v++) {
+            if (plan->values[v].last_use == s && plan->values[v].buffer >= 0)
+                pool[plan->values[v].buffer].busy = 0;
+        }
+    }
+
+    for (int i = 0; i < count; i++) free_matrix (&pool[i].matrix);
+    free (pool);
+    free (inputs);
+
+    return res;
+}
+
+/**
+ * @brief Оптимизирует и вычисляет выражение с корнем node
+ *
+ * @param expr Указатель на выражение
+ * @param node Номер корня
+ * @param result Матрица размера expr_shape (); не совпадает со входами
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int expr_evaluate (const MatrixExpr* expr, int node, Matrix* result) {
+    int      res  = -1;
+    ExprPlan plan = {0};
+
+    if (valid_node (expr, node) && result != NULL && result->data != NULL &&
+        result->dtype == MATRIX_FLOAT64 && result->rows == expr->nodes[node].rows &&
+        result->cols == expr->nodes[node].cols) {
+        plan.expr = expr;
+        plan.uses = calloc ((size_t) expr->count, sizeof (int));
+        plan.memo = malloc ((size_t) expr->count * 2 * sizeof (int));
+        res       = plan.uses && plan.memo ? 0 : -1;
+    }
+
+    if (res == 0) {
+        for (int i = 0; i < 2 * expr->count; i++) plan.memo[i] = -1;
+        count_uses (&plan, node);
+
+        // Результат пишется до того, как прочитаны все входы
+        for (int i = 0; i < expr->count; i++) {
+            if (plan.uses[i] > 0 && expr->nodes[i].op == EXPR_INPUT &&
+                expr->nodes[i].input->data == result->data)
+                res = -1;
+        }
+    }
+
+    if (res == 0) {
+        int root = plan_value (&plan, node, 0);
+
+        // Корень - сама входная матрица: копия одним линейным шагом
+        if (root >= 0 && plan.values[root].input != NULL) {
+            ExprStep step = {EXPR_STEP_LINEAR, -1, -1, -1, 0, 0, plan.term_count, 1};
+            add_term (&plan, root, 1);
+            if (!plan.failed) add_step (&plan, step, result->rows, result->cols);
+        }
+
+        res = plan.failed || root < 0 ? -1 : execute (&plan, result);
+    }
+
+    free (plan.uses);
+    free (plan.memo);
+    free (plan.values);
+    free (plan.steps);
+    free (plan.terms);
+
+    return res;
+}
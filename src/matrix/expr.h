@@ -0,0 +1,128 @@
+/**
+ * @file expr.h
+ * @brief Ленивые матричные выражения
+ *
+ * @details
+ * Выражение строится как граф операций над матрицами и вычисляется одним
+ * вызовом expr_evaluate (). До вычисления граф оптимизируется:
+ * - цепочки сложений, вычитаний и умножений на число считаются за один
+ *   проход без промежуточных матриц
+ * - транспонирование не копирует данные, если операнд идет в умножение,
+ *   а переходит во флаги GEMM
+ * - произведение, к которому прибавляются другие матрицы, вычисляется
+ *   вместе со слагаемыми при записи результата (эпилог GEMM)
+ * - буферы промежуточных результатов переиспользуются, как только
+ *   значение больше не нужно
+ *
+ * Узлы обозначаются целыми номерами. Функции построения возвращают -1 при
+ * ошибке и принимают -1 как операнд, поэтому проверять результат можно
+ * один раз, у корня выражения.
+ *
+ * @code
+ * MatrixExpr* e = expr_create ();
+ * int ab  = expr_multiply (e, expr_input (e, &A),
+ *                          expr_transpose (e, expr_input (e, &B)));
+ * int res = expr_add (e, expr_sub (e, ab, expr_input (e, &C)),
+ *                     expr_input (e, &D));
+ * expr_evaluate (e, res, &result);
+ * expr_free (e);
+ * @endcode
+ *
+ * @see matrix.h gemm.h
+ */
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include "matrix.h"
+
+/**
+ * @brief Граф выражения (непрозрачный тип)
+ */
+typedef struct MatrixExpr MatrixExpr;
+
+/**
+ * @brief Создает пустое выражение
+ * @return Указатель на выражение или NULL при ошибке выделения памяти
+ */
+MatrixExpr* expr_create (void);
+
+/**
+ * @brief Освобождает выражение
+ * @param expr Указатель на выражение (может быть NULL)
+ * @note Входные матрицы не освобождаются
+ */
+void expr_free (MatrixExpr* expr);
+
+/**
+ * @brief Добавляет входную матрицу
+ * @param expr Указатель на выражение
+ * @param matrix Матрица; не копируется и должна жить до вычисления
+ * @return Номер узла или -1 при ошибке
+ */
+int expr_input (MatrixExpr* expr, const Matrix* matrix);
+
+/**
+ * @brief Добавляет узел a + b
+ * @param expr Указатель на выражение
+ * @param a Номер первого операнда
+ * @param b Номер второго операнда
+ * @return Номер узла или -1 при ошибке или несовпадении размеров
+ */
+int expr_add (MatrixExpr* expr, int a, int b);
+
+/**
+ * @brief Добавляет узел a - b
+ * @param expr Указатель на выражение
+ * @param a Номер уменьшаемого
+ * @param b Номер вычитаемого
+ * @return Номер узла или -1 при ошибке или несовпадении размеров
+ */
+int expr_sub (MatrixExpr* expr, int a, int b);
+
+/**
+ * @brief Добавляет узел alpha * a
+ * @param expr Указатель на выражение
+ * @param a Номер операнда
+ * @param alpha Коэффициент
+ * @return Номер узла или -1 при ошибке
+ */
+int expr_scale (MatrixExpr* expr, int a, MATRIX_TYPE alpha);
+
+/**
+ * @brief Добавляет узел a x b
+ * @param expr Указатель на выражение
+ * @param a Номер левого множителя
+ * @param b Номер правого множителя
+ * @return Номер узла или -1 при ошибке или несовместимых размерах
+ */
+int expr_multiply (MatrixExpr* expr, int a, int b);
+
+/**
+ * @brief Добавляет узел a^T
+ * @param expr Указатель на выражение
+ * @param a Номер операнда
+ * @return Номер узла или -1 при ошибке
+ */
+int expr_transpose (MatrixExpr* expr, int a);
+
+/**
+ * @brief Возвращает размеры результата узла
+ * @param expr Указатель на выражение
+ * @param node Номер узла
+ * @param rows Число строк
+ * @param cols Число столбцов
+ * @return 0 при успехе, -1 при ошибке
+ */
+int expr_shape (const MatrixExpr* expr, int node, int* rows, int* cols);
+
+/**
+ * @brief Оптимизирует и вычисляет выражение с корнем node
+ * @param expr Указатель на выражение
+ * @param node Номер корня
+ * @param result Матрица размера expr_shape (); не совпадает со входами
+ * @return 0 при успехе, -1 при ошибке
+ */
+int expr_evaluate (const MatrixExpr* expr, int node, Matrix* result);
+
+#endif   // EXPR_H
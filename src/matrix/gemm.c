@@ -0,0 +1,430 @@
+/**
+ * @file gemm.c
+ * @brief Реализация блочного умножения матриц с упаковкой панелей
+ *
+ * @details
+ * Порядок циклов (от внешнего к внутреннему):
+ * - jc: панели B шириной nc
+ * - pc: глубина kc, упаковка панели B
+ * - ic: панели A высотой mc, упаковка панели A
+ * - jr, ir: тайлы mr x nr, вызов микроядра
+ *
+ * Краевые тайлы дополняются нулями при упаковке. Микроядро всегда считает
+ * полный тайл, для неполного тайла результат пишется во временный буфер
+ * и в C переносится только валидная часть. Тем же путем идут тайлы с
+ * эпилогом: слагаемые прибавляются при переносе, и C записывается один раз
+ * за последний проход по k.
+ *
+ * В режиме трассировки (trace.h) каждый тайл C - интервал с координатами.
+ *
+ * @see gemm.h
+ */
+
+#include "gemm.h"
+
+#include "simd.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "tune.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Текущие параметры блочного умножения
+static GemmConfig gemm_config = {GEMM_MC_DEFAULT, GEMM_KC_DEFAULT, GEMM_NC_DEFAULT,
+                                 GEMM_THRESHOLD_DEFAULT};
+
+/**
+ * @brief Округляет value вверх до кратного step
+ */
+static int round_up (int value, int step) {
+    return ((value + step - 1) / step) * step;
+}
+
+/**
+ * @brief Размер буфера в байтах, округленный до кратного MATRIX_ALIGNMENT
+ */
+static size_t aligned_bytes (size_t count) {
+    size_t bytes = count * sizeof (MATRIX_TYPE);
+    return ((bytes + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT) * MATRIX_ALIGNMENT;
+}
+
+/**
+ * @brief Возвращает текущие параметры блочного умножения
+ *
+ * @param config Указатель на структуру для заполнения
+ */
+void gemm_get_config (GemmConfig* config) {
+    tune_init ();
+    if (config) *config = gemm_config;
+}
+
+/**
+ * @brief Устанавливает параметры блочного умножения
+ *
+ * @param config Новые параметры
+ *
+ * @return 0 при успехе, -1 при некорректных параметрах
+ */
+int gemm_set_config (const GemmConfig* config) {
+    int res = -1;
+
+    // Файл настроек загружается раньше, чтобы не заменить явные параметры
+    tune_init ();
+    if (config && config->mc > 0 && config->kc > 0 && config->nc > 0 &&
+        config->threshold > 0) {
+        gemm_config.mc        = config->mc;
+        gemm_config.kc        = config->kc;
+        gemm_config.nc        = config->nc;
+        gemm_config.threshold = config->threshold;
+        res                   = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Проверяет, стоит ли использовать блочную схему
+ *
+ * @param m Число строк A
+ * @param n Число столбцов B
+ * @param k Общая размерность
+ *
+ * @return 1, если m * n * k >= threshold^3, иначе 0
+ */
+int gemm_use_blocked (int m, int n, int k) {
+    tune_init ();
+    double work  = (double) m * n * k;
+    double limit = (double) gemm_config.threshold * gemm_config.threshold *
+                   gemm_config.threshold;
+
+    return work >= limit;
+}
+
+/**
+ * @brief Упаковывает панель A (mc x kc) полосками по mr строк
+ *
+ * Внутри полоски элементы идут по столбцам: для каждого p подряд лежат
+ * mr значений. Недостающие строки последней полоски заполняются нулями.
+ */
+static void pack_a (int mc, int kc, const MATRIX_TYPE* A, int lda, int mr,
+                    MATRIX_TYPE* packed) {
+    for (int ir = 0; ir < mc; ir += mr) {
+        int rows = mc - ir < mr ? mc - ir : mr;
+        for (int p = 0; p < kc; p++) {
+            for (int i = 0; i < rows; i++) {
+                packed[i] = A[(size_t) (ir + i) * lda + p];
+            }
+            for (int i = rows; i < mr; i++) packed[i] = 0;
+            packed += mr;
+        }
+    }
+}
+
+/**
+ * @brief Упаковывает панель A^T: A хранится как kc x mc
+ *
+ * Формат буфера совпадает с pack_a, но значения для одного p читаются
+ * подряд из строки p исходной матрицы.
+ */
+static void pack_a_trans (int mc, int kc, const MATRIX_TYPE* A, int lda, int mr,
+                          MATRIX_TYPE* packed) {
+    for (int ir = 0; ir < mc; ir += mr) {
+        int rows = mc - ir < mr ? mc - ir : mr;
+        for (int p = 0; p < kc; p++) {
+            const MATRIX_TYPE* row = A + (size_t) p * lda + ir;
+            for (int i = 0; i < rows; i++) packed[i] = row[i];
+            for (int i = rows; i < mr; i++) packed[i] = 0;
+            packed += mr;
+        }
+    }
+}
+
+/**
+ * @brief Упаковывает панель B (kc x nc) полосками по nr столбцов
+ *
+ * Внутри полоски для каждого p подряд лежат nr значений строки p.
+ * Недостающие столбцы последней полоски заполняются нулями.
+ */
+static void pack_b (int kc, int nc, const MATRIX_TYPE* B, int ldb, int nr,
+                    MATRIX_TYPE* packed) {
+    for (int jr = 0; jr < nc; jr += nr) {
+        int cols = nc - jr < nr ? nc - jr : nr;
+        for (int p = 0; p < kc; p++) {
+            const MATRIX_TYPE* row = B + (size_t) p * ldb + jr;
+            for (int j = 0; j < cols; j++) packed[j] = row[j];
+            for (int j = cols; j < nr; j++) packed[j] = 0;
+            packed += nr;
+        }
+    }
+}
+
+/**
+ * @brief Упаковывает панель B^T: B хранится как nc x kc
+ *
+ * Формат буфера совпадает с pack_b. Каждая строка B дает один столбец
+ * полоски и читается подряд по памяти.
+ */
+static void pack_b_trans (int kc, int nc, const MATRIX_TYPE* B, int ldb, int nr,
+                          MATRIX_TYPE* packed) {
+    for (int jr = 0; jr < nc; jr += nr) {
+        int cols = nc - jr < nr ? nc - jr : nr;
+        for (int j = 0; j < cols; j++) {
+            const MATRIX_TYPE* row = B + (size_t) (jr + j) * ldb;
+            for (int p = 0; p < kc; p++) packed[(size_t) p * nr + j] = row[p];
+        }
+        for (int j = cols; j < nr; j++) {
+            for (int p = 0; p < kc; p++) packed[(size_t) p * nr + j] = 0;
+        }
+        packed += (size_t) kc * nr;
+    }
+}
+
+/**
+ * @brief Считает один тайл C, при необходимости через временный буфер
+ *
+ * @param kernels Выбранные ядра
+ * @param kc Глубина
+ * @param a Упакованная полоска A
+ * @param b Упакованная полоска B
+ * @param C Левый верхний угол тайла в C
+ * @param ldc Шаг строки C
+ * @param rows Число валидных строк тайла
+ * @param cols Число валидных столбцов тайла
+ * @param first 1 - записать результат, 0 - прибавить к C
+ * @param epilogue Эпилог для последнего прохода по k или NULL
+ * @param offset Смещение тайла в слагаемых эпилога (row * ld + col)
+ */
+static void gemm_tile (const SimdKernels* kernels, int kc, const MATRIX_TYPE* a,
+                       const MATRIX_TYPE* b, MATRIX_TYPE* C, int ldc, int rows,
+                       int cols, int first, const GemmEpilogue* epilogue,
+                       const size_t* offset) {
+    if (!epilogue && rows == kernels->gemm_mr && cols == kernels->gemm_nr) {
+        kernels->gemm_kernel (kc, a, b, C, ldc, first);
+    } else {
+        MATRIX_TYPE tile[SIMD_GEMM_MR_MAX * SIMD_GEMM_NR_MAX]
+            __attribute__ ((aligned (MATRIX_ALIGNMENT)));
+        const int ldt   = kernels->gemm_nr;
+        const int terms = epilogue ? epilogue->count : 0;
+
+        kernels->gemm_kernel (kc, a, b, tile, ldt, 1);
+        for (int i = 0; i < rows; i++) {
+            MATRIX_TYPE* c = C + (size_t) i * ldc;
+            MATRIX_TYPE* t = tile + (size_t) i * ldt;
+            for (int e = 0; e < terms; e++) {
+                const GemmAddend*  term = &epilogue->terms[e];
+                const MATRIX_TYPE* x =
+                    term->data + offset[e] + (size_t) i * term->ld;
+                for (int j = 0; j < cols; j++) t[j] += term->alpha * x[j];
+            }
+            if (first) {
+                for (int j = 0; j < cols; j++) c[j] = t[j];
+            } else {
+                for (int j = 0; j < cols; j++) c[j] += t[j];
+            }
+        }
+    }
+}
+
+/**
+ * @struct GemmJob
+ * @brief Общие данные параллельного умножения
+ *
+ * C разбивается на тайлы mc x nc, каждый тайл - отдельная подзадача пула.
+ * Поток упаковывает панели своего тайла в собственные буферы, поэтому
+ * подзадачи не требуют синхронизации между собой.
+ */
+typedef struct {
+    const SimdKernels*  kernels;    ///< Выбранные ядра
+    int                 m, n, k;    ///< Размеры произведения
+    const MATRIX_TYPE*  A;          ///< Матрица A
+    int                 lda;        ///< Шаг строки A
+    const MATRIX_TYPE*  B;          ///< Матрица B
+    int                 ldb;        ///< Шаг строки B
+    MATRIX_TYPE*        C;          ///< Матрица C
+    int                 ldc;        ///< Шаг строки C
+    int                 mc, nc;     ///< Размер тайла C
+    int                 kc;         ///< Глубина панелей
+    int                 tiles_m;    ///< Число тайлов по строкам
+    int                 trans_a;    ///< Транспонировать A при упаковке
+    int                 trans_b;    ///< Транспонировать B при упаковке
+    const GemmEpilogue* epilogue;   ///< Эпилог или NULL
+    MATRIX_TYPE**       packed;     ///< Буферы упаковки по потокам
+    atomic_int          failed;     ///< Признак ошибки выделения памяти
+} GemmJob;
+
+/**
+ * @brief Подзадача пула: тайл C с номером task
+ *
+ * @param ctx Указатель на GemmJob
+ * @param task Номер тайла, тайлы одного столбца идут подряд
+ * @param worker Номер потока
+ */
+static void gemm_task (void* ctx, int task, int worker) {
+    GemmJob*       job     = ctx;
+    const int      mr      = job->kernels->gemm_mr;
+    const int      nr      = job->kernels->gemm_nr;
+    const int      ic      = (task % job->tiles_m) * job->mc;
+    const int      jc      = (task / job->tiles_m) * job->nc;
+    const int      mb      = job->m - ic < job->mc ? job->m - ic : job->mc;
+    const int      nb      = job->n - jc < job->nc ? job->n - jc : job->nc;
+    const size_t   a_count = (size_t) job->mc * job->kc;
+    const uint64_t traced  = TRACE_ACTIVE () ? trace_now () : 0;   // Начало тайла
+
+    // Буфер потока выделяется при его первой подзадаче
+    if (!job->packed[worker]) {
+        job->packed[worker] = aligned_alloc (
+            MATRIX_ALIGNMENT,
+            aligned_bytes (a_count) +
+                aligned_bytes ((size_t) job->kc * job->nc));
+    }
+
+    MATRIX_TYPE* packed_a = job->packed[worker];
+    if (!packed_a) {
+        atomic_store (&job->failed, 1);
+    } else {
+        MATRIX_TYPE* packed_b =
+            packed_a + aligned_bytes (a_count) / sizeof (MATRIX_TYPE);
+
+        const GemmEpilogue* epilogue = job->epilogue;
+        size_t              offset[GEMM_MAX_ADDENDS];
+
+        for (int pc = 0; pc < job->k; pc += job->kc) {
+            int  kb   = job->k - pc < job->kc ? job->k - pc : job->kc;
+            int  last = pc + kb >= job->k;
+
+            if (job->trans_b) {
+                pack_b_trans (kb, nb, job->B + (size_t) jc * job->ldb + pc, job->ldb,
+                              nr, packed_b);
+            } else {
+                pack_b (kb, nb, job->B + (size_t) pc * job->ldb + jc, job->ldb, nr,
+                        packed_b);
+            }
+            if (job->trans_a) {
+                pack_a_trans (mb, kb, job->A + (size_t) pc * job->lda + ic, job->lda,
+                              mr, packed_a);
+            } else {
+                pack_a (mb, kb, job->A + (size_t) ic * job->lda + pc, job->lda, mr,
+                        packed_a);
+            }
+
+            for (int jr = 0; jr < nb; jr += nr) {
+                int cols = nb - jr < nr ? nb - jr : nr;
+                for (int ir = 0; ir < mb; ir += mr) {
+                    int rows = mb - ir < mr ? mb - ir : mr;
+                    for (int e = 0; epilogue && e < epilogue->count; e++) {
+                        offset[e] = (size_t) (ic + ir) * epilogue->terms[e].ld +
+                                    jc + jr;
+                    }
+                    gemm_tile (job->kernels, kb, packed_a + (size_t) ir * kb,
+                               packed_b + (size_t) jr * kb,
+                               job->C + (size_t) (ic + ir) * job->ldc + jc + jr,
+                               job->ldc, rows, cols, pc == 0,
+                               last ? epilogue : NULL, offset);
+                }
+            }
+        }
+    }
+
+    if (traced) {
+        char args[96];
+        snprintf (args, sizeof args,
+                  "{\"ic\": %d, \"jc\": %d, \"mb\": %d, \"nb\": %d}", ic, jc,
+                  mb, nb);
+        trace_complete ("gemm_tile", "gemm", traced, args);
+    }
+}
+
+/**
+ * @brief Вычисляет C = op(A) x op(B) + эпилог блочным алгоритмом
+ *
+ * Тайлы C распределяются по потокам пула (thread_pool.h). При нескольких
+ * потоках ширина панели B делится между ними, чтобы панели всех потоков
+ * вместе помещались в общий L3.
+ *
+ * @param trans_a 1 - op(A) = A^T
+ * @param trans_b 1 - op(B) = B^T
+ * @param m Число строк op(A) и C
+ * @param n Число столбцов op(B) и C
+ * @param k Общая размерность
+ * @param A Данные A с шагом строки lda
+ * @param lda Шаг строки A
+ * @param B Данные B с шагом строки ldb
+ * @param ldb Шаг строки B
+ * @param C Данные C с шагом строки ldc
+ * @param ldc Шаг строки C
+ * @param epilogue Слагаемые эпилога или NULL
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int gemm_compute (int trans_a, int trans_b, int m, int n, int k,
+                  const MATRIX_TYPE* A, int lda, const MATRIX_TYPE* B, int ldb,
+                  MATRIX_TYPE* C, int ldc, const GemmEpilogue* epilogue) {
+    tune_init ();
+    const GemmConfig   cfg     = gemm_config;
+    const SimdKernels* kernels = simd_kernels ();
+    const int          mr      = kernels->gemm_mr;
+    const int          nr      = kernels->gemm_nr;
+    const int          threads = thread_pool_threads ();
+    int                res     = -1;
+
+    if (m <= 0 || n <= 0 || k <= 0 ||
+        (epilogue && (epilogue->count < 0 || epilogue->count > GEMM_MAX_ADDENDS)))
+        return res;
+
+    // Доля L3 на поток, но не уже четырех тайлов микроядра
+    int nc_share = cfg.nc / threads > 4 * nr ? cfg.nc / threads : 4 * nr;
+
+    // Блоки кратны тайлу и не больше самих матриц
+    int mc = round_up (m < cfg.mc ? m : cfg.mc, mr);
+    int nc = round_up (n < nc_share ? n : nc_share, nr);
+    int kc = k < cfg.kc ? k : cfg.kc;
+
+    int tiles_m = (m + mc - 1) / mc;
+    int tiles_n = (n + nc - 1) / nc;
+
+    // Если тайлов меньше, чем потоков, сужаем панели B
+    if (tiles_m * tiles_n < threads && nc > nr) {
+        int want = (threads + tiles_m - 1) / tiles_m;
+        nc       = round_up ((n + want - 1) / want, nr);
+        tiles_n  = (n + nc - 1) / nc;
+    }
+
+    if (epilogue && epilogue->count == 0) epilogue = NULL;
+
+    GemmJob job = {kernels, m,  n,       k,       A,       lda,      B,
+                   ldb,     C,  ldc,     mc,      nc,      kc,       tiles_m,
+                   trans_a, trans_b, epilogue, NULL, 0};
+    job.packed  = calloc ((size_t) threads, sizeof (MATRIX_TYPE*));
+
+    if (job.packed) {
+        thread_pool_run_workers (tiles_m * tiles_n, threads, gemm_task, &job);
+        res = atomic_load (&job.failed) ? -1 : 0;
+
+        for (int i = 0; i < threads; i++) free (job.packed[i]);
+        free (job.packed);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Вычисляет C = A x B блочным алгоритмом
+ *
+ * @param m Число строк A и C
+ * @param n Число столбцов B и C
+ * @param k Число столбцов A и строк B
+ * @param A Данные A с шагом строки lda
+ * @param lda Шаг строки A
+ * @param B Данные B с шагом строки ldb
+ * @param ldb Шаг строки B
+ * @param C Данные C с шагом строки ldc
+ * @param ldc Шаг строки C
+ *
+ * @return 0 при успехе, -1 при ошибке выделения памяти
+ */
+int gemm_multiply (int m, int n, int k, const MATRIX_TYPE* A, int lda,
+                   const MATRIX_TYPE* B, int ldb, MATRIX_TYPE* C, int ldc) {
+    return gemm_compute (0, 0, m, n, k, A, lda, B, ldb, C, ldc, NULL);
+}
@@ -0,0 +1,136 @@
+/**
+ * @file gemm.h
+ * @brief Блочное умножение матриц (GEMM) с упаковкой панелей
+ *
+ * @details
+ * Модуль реализует умножение C = A x B по схеме с тремя уровнями блоков:
+ * - kc - глубина панели, полоска B (kc x nr) помещается в L1
+ * - mc - высота панели A (mc x kc) помещается в L2
+ * - nc - ширина панели B (kc x nc) помещается в L3
+ *
+ * Панели A и B копируются в непрерывные буферы в порядке обхода
+ * микроядром, которое считает тайл mr x nr в регистрах. Микроядро и размер
+ * тайла выбираются во время выполнения (simd.h).
+ *
+ * Операнды могут быть транспонированы: транспонирование выполняется при
+ * упаковке панели, отдельная транспонированная копия не создается.
+ * Эпилог прибавляет к результату линейную комбинацию других матриц в момент
+ * последней записи тайла C.
+ *
+ * Размеры блоков и порог по умолчанию заменяются подобранными под
+ * процессор, если для него есть запись в файле настроек (tune.h).
+ *
+ * @see matrix.h simd.h tune.h
+ */
+
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "../../include/config.h"
+
+/// Глубина панели по умолчанию (блок L1)
+#define GEMM_KC_DEFAULT 256
+
+/// Высота панели A по умолчанию (блок L2)
+#define GEMM_MC_DEFAULT 128
+
+/// Ширина панели B по умолчанию (блок L3)
+#define GEMM_NC_DEFAULT 4096
+
+/// Порог по умолчанию: блочная схема при m * n * k >= порог^3
+#define GEMM_THRESHOLD_DEFAULT 64
+
+/**
+ * @struct GemmConfig
+ * @brief Размеры блоков и порог переключения на блочную схему
+ */
+typedef struct {
+    int mc;          ///< Высота панели A
+    int kc;          ///< Глубина панелей
+    int nc;          ///< Ширина панели B
+    int threshold;   ///< Линейный размер, начиная с которого работает GEMM
+} GemmConfig;
+
+/// Максимальное число слагаемых эпилога
+#define GEMM_MAX_ADDENDS 4
+
+/**
+ * @struct GemmAddend
+ * @brief Слагаемое эпилога: alpha * X
+ */
+typedef struct {
+    const MATRIX_TYPE* data;    ///< Матрица X размером m x n
+    int                ld;      ///< Шаг строки X
+    MATRIX_TYPE        alpha;   ///< Коэффициент
+} GemmAddend;
+
+/**
+ * @struct GemmEpilogue
+ * @brief Эпилог: C = A x B + sum (alpha_i * X_i)
+ */
+typedef struct {
+    int        count;                     ///< Число слагаемых
+    GemmAddend terms[GEMM_MAX_ADDENDS];   ///< Слагаемые
+} GemmEpilogue;
+
+/**
+ * @brief Возвращает текущие параметры блочного умножения
+ * @param config Указатель на структуру для заполнения
+ */
+void gemm_get_config (GemmConfig* config);
+
+/**
+ * @brief Устанавливает параметры блочного умножения
+ * @param config Новые параметры
+ * @note При умножении mc и nc округляются вверх до кратных размеру тайла
+ * @return 0 при успехе, -1 при некорректных параметрах
+ */
+int gemm_set_config (const GemmConfig* config);
+
+/**
+ * @brief Проверяет, стоит ли использовать блочную схему
+ * @param m Число строк A
+ * @param n Число столбцов B
+ * @param k Общая размерность
+ * @return 1, если объем работы превышает порог, иначе 0
+ */
+int gemm_use_blocked (int m, int n, int k);
+
+/**
+ * @brief Вычисляет C = A x B блочным алгоритмом
+ * @param m Число строк A и C
+ * @param n Число столбцов B и C
+ * @param k Число столбцов A и строк B
+ * @param A Данные A с шагом строки lda
+ * @param lda Шаг строки A
+ * @param B Данные B с шагом строки ldb
+ * @param ldb Шаг строки B
+ * @param C Данные C с шагом строки ldc
+ * @param ldc Шаг строки C
+ * @return 0 при успехе, -1 при ошибке выделения памяти
+ */
+int gemm_multiply (int m, int n, int k, const MATRIX_TYPE* A, int lda,
+                   const MATRIX_TYPE* B, int ldb, MATRIX_TYPE* C, int ldc);
+
+/**
+ * @brief Вычисляет C = op(A) x op(B) + эпилог блочным алгоритмом
+ * @param trans_a 1 - op(A) = A^T, A хранится как k x m
+ * @param trans_b 1 - op(B) = B^T, B хранится как n x k
+ * @param m Число строк op(A) и C
+ * @param n Число столбцов op(B) и C
+ * @param k Общая размерность
+ * @param A Данные A с шагом строки lda
+ * @param lda Шаг строки A
+ * @param B Данные B с шагом строки ldb
+ * @param ldb Шаг строки B
+ * @param C Данные C с шагом строки ldc
+ * @param ldc Шаг строки C
+ * @param epilogue Слагаемые эпилога или NULL
+ * @note Слагаемые эпилога не должны пересекаться с C
+ * @return 0 при успехе, -1 при ошибке
+ */
+int gemm_compute (int trans_a, int trans_b, int m, int n, int k,
+                  const MATRIX_TYPE* A, int lda, const MATRIX_TYPE* B, int ldb,
+                  MATRIX_TYPE* C, int ldc, const GemmEpilogue* epilogue);
+
+#endif   // GEMM_H
@@ -9,12 +9,15 @@
  * - Базовые арифметические операции (сложение, вычитание, умножение,
  * деление)
  * - Транспонирование и вычисление детерминанта матрицы
+ * - Выбор ядер по типу элементов (dtype.h)
  * - Освобождение памяти
  * - Вывод матрицы в консоль
  * - Чтение, запись и копирование матрицы из файла
  * - Копирование матрицы
  *
  * @note Все функции выполняют проверку входных параметров
+ * @note Публичные операции отмечаются в статистике (stats.h); объемы и
+ * число операций считаются только при включенной статистике
  *
  * @see matrix.h
  */
@@ -22,173 +25,417 @@
 #include "matrix.h"
 
 #include "../output/output.h"
+#include "dtype.h"
+#include "gemm.h"
+#include "simd.h"
+#include "small.h"
+#include "stats.h"
+#include "strassen.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/// Распределитель матриц текущего потока, NULL - aligned_alloc
+static _Thread_local const MatrixAllocator* thread_allocator = NULL;
+
+/// Тип элементов двоичного файла для каждого MatrixDtype
+static const OutputDtype file_dtypes[MATRIX_DTYPE_COUNT] = {
+    OUTPUT_DTYPE_FLOAT64, OUTPUT_DTYPE_FLOAT32, OUTPUT_DTYPE_INT32,
+    OUTPUT_DTYPE_INT64, OUTPUT_DTYPE_COMPLEX128};
 
 /**
- * @brief Создает матрицу заданного размера
+ * @brief Проверяет, что матрица задана и ее элементы не MATRIX_TYPE
+ */
+static int is_typed (const Matrix* matrix) {
+    return matrix != NULL && matrix->dtype != MATRIX_FLOAT64;
+}
+
+/**
+ * @brief Число элементов матрицы для статистики (0 для пустой матрицы)
+ */
+static uint64_t stats_elements (const Matrix* matrix) {
+    return matrix != NULL && matrix->data != NULL
+             ? (uint64_t) matrix->rows * (uint64_t) matrix->cols
+             : 0;
+}
+
+/**
+ * @brief Объем элементов матрицы в байтах для статистики
+ */
+static uint64_t stats_bytes (const Matrix* matrix) {
+    return matrix != NULL
+             ? stats_elements (matrix) * matrix_dtype_size (matrix->dtype)
+             : 0;
+}
+
+/**
+ * @brief Размер файла для статистики (0, если файл недоступен)
+ */
+static uint64_t stats_file_size (const char* filename) {
+    struct stat info;
+
+    return filename != NULL && stat (filename, &info) == 0 ? (uint64_t) info.st_size
+                                                           : 0;
+}
+
+/**
+ * @brief Задает распределитель матриц текущего потока
+ *
+ * @param allocator Распределитель или NULL
+ *
+ * @return Прежний распределитель
+ */
+const MatrixAllocator* matrix_set_allocator (const MatrixAllocator* allocator) {
+    const MatrixAllocator* previous = thread_allocator;
+
+    thread_allocator = allocator;
+
+    return previous;
+}
+
+/**
+ * @brief Возвращает распределитель матриц текущего потока
+ *
+ * @return Распределитель или NULL
+ */
+const MatrixAllocator* matrix_get_allocator (void) {
+    return thread_allocator;
+}
+
+/**
+ * @brief Создает матрицу с элементами dtype через заданный распределитель
+ *
+ * Память под все элементы выделяется одним блоком, выровненным по
+ * MATRIX_ALIGNMENT байт. Строки дополняются до шага stride.
  *
  * @param rows Количество строк (должно быть > 0)
  * @param cols Количетство столбцов (должно быть > 0)
+ * @param dtype Тип элементов
+ * @param allocator Распределитель или NULL - aligned_alloc
+ *
  * @return Структура Matrix при успехе, нулевая матрица при ошибке
  */
-Matrix create_matrix (int rows, int cols) {
-    Matrix mat = {0, 0, NULL};   // Инициализация пустой матрицы
-    char res = 1;   // Флаг успешности выполнения
+static Matrix allocate_matrix (int rows, int cols, MatrixDtype dtype,
+                               const MatrixAllocator* allocator) {
+    Matrix       mat  = {0};   // Инициализация пустой матрицы
+    char         res  = 1;     // Флаг успешности выполнения
+    const size_t elem = matrix_dtype_size (dtype);
 
-    // Проверка корректности размеров
-    if (rows <= 0 || cols <= 0) res = 0;
+    // Проверка корректности размеров и типа
+    if (rows <= 0 || cols <= 0 || elem == 0) res = 0;
     else {
-        mat.rows = rows;
-        mat.cols = cols;
-        mat.data = (MATRIX_TYPE**) malloc (rows * sizeof (MATRIX_TYPE*));
+        mat.rows     = rows;
+        mat.cols     = cols;
+        mat.stride   = MATRIX_STRIDE_FOR (cols, elem);
+        mat.capacity = (size_t) rows * mat.stride * elem;
+        mat.dtype    = dtype;
 
-        if (mat.data == NULL) res = 0;   // Ошибка выделения
-        else {
-            // Выделение памяти под каждую строку
-            for (int row = 0; row < rows && res; row++) {
-                mat.data[row] = (MATRIX_TYPE*) malloc (cols * sizeof (MATRIX_TYPE));
-                if (mat.data[row] == NULL) res = 0;   // Ошибка выделения памяти
-            }
+        if (allocator) {
+            mat.data      = allocator->allocate (allocator->state, mat.capacity);
+            mat.storage   = MATRIX_ALLOCATED;
+            mat.allocator = allocator;
+        } else {
+            mat.data = (MATRIX_TYPE*) aligned_alloc (MATRIX_ALIGNMENT, mat.capacity);
         }
+
+        if (mat.data == NULL) res = 0;   // Ошибка выделения
     }
 
-    if (!res) {   // Освобождаем память в случае ошибки
-        if (mat.data != NULL) {
-            for (int row = 0; row < mat.rows; row++) {
-                if (mat.data[row] != NULL) free (mat.data[row]);
-            }
-            free (mat.data);
-        }
-        mat.data = NULL;
-        mat.cols = 0;
-        mat.rows = 0;
+    if (!res) {   // Возвращаем нулевую матрицу в случае ошибки
+        mat = (Matrix) {0};
     }
 
     return mat;
 }
 
+/**
+ * @brief Создает матрицу через заданный распределитель
+ *
+ * @param rows Количество строк (должно быть > 0)
+ * @param cols Количетство столбцов (должно быть > 0)
+ * @param allocator Распределитель или NULL - aligned_alloc
+ *
+ * @return Структура Matrix при успехе, нулевая матрица при ошибке
+ */
+Matrix create_matrix_with (int rows, int cols, const MatrixAllocator* allocator) {
+    return allocate_matrix (rows, cols, MATRIX_FLOAT64, allocator);
+}
+
+/**
+ * @brief Создает матрицу с элементами заданного типа
+ *
+ * Память выделяет распределитель текущего потока (matrix_set_allocator).
+ *
+ * @param rows Количество строк (должно быть > 0)
+ * @param cols Количетство столбцов (должно быть > 0)
+ * @param dtype Тип элементов
+ *
+ * @return Структура Matrix при успехе, нулевая матрица при ошибке
+ */
+Matrix create_matrix_dtype (int rows, int cols, MatrixDtype dtype) {
+    return allocate_matrix (rows, cols, dtype, thread_allocator);
+}
+
+/**
+ * @brief Создает матрицу заданного размера
+ *
+ * Память выделяет распределитель текущего потока (matrix_set_allocator).
+ *
+ * @param rows Количество строк (должно быть > 0)
+ * @param cols Количетство столбцов (должно быть > 0)
+ * @return Структура Matrix при успехе, нулевая матрица при ошибке
+ */
+Matrix create_matrix (int rows, int cols) {
+    return create_matrix_with (rows, cols, thread_allocator);
+}
+
+/**
+ * @brief Создает представление подматрицы без копирования
+ *
+ * @param parent Матрица или другое представление
+ * @param row Первая строка окна
+ * @param col Первый столбец окна
+ * @param rows Число строк окна
+ * @param cols Число столбцов окна
+ *
+ * @return Представление или нулевая матрица при ошибке
+ */
+Matrix matrix_view (const Matrix* parent, int row, int col, int rows, int cols) {
+    Matrix view = {0};
+
+    if (parent && parent->data && row >= 0 && col >= 0 && rows > 0 && cols > 0 &&
+        rows <= parent->rows - row && cols <= parent->cols - col) {
+        const size_t elem   = matrix_dtype_size (parent->dtype);
+        const size_t offset = (size_t) row * (size_t) parent->stride + (size_t) col;
+
+        view.rows    = rows;
+        view.cols    = cols;
+        view.stride  = parent->stride;
+        view.data    = (MATRIX_TYPE*) (void*) ((char*) parent->data + offset * elem);
+        view.storage = MATRIX_VIEW;
+        view.dtype   = parent->dtype;
+    }
+
+    return view;
+}
+
 /**
  * @brief Освобождает память занятую матрицей
  *
+ * Буфер представления принадлежит родителю и не освобождается.
+ *
  * @param matrix Указатель на Matrix
  */
 void free_matrix (Matrix* matrix) {
-    if (matrix->data != NULL && matrix != NULL) {
-        for (int index_row = 0; index_row < matrix->rows; index_row++) {
-            free (matrix->data[index_row]);
-        }
-        free (matrix->data);
-        matrix->data = NULL;
-        matrix->rows = 0;
-        matrix->cols = 0;
+    if (matrix != NULL && matrix->data != NULL) {
+        if (matrix->storage == MATRIX_MAPPED)
+            output_unmap_matrix (matrix->data, matrix->capacity);
+        else if (matrix->storage == MATRIX_ALLOCATED)
+            matrix->allocator->release (matrix->allocator->state, matrix->data,
+                                        matrix->capacity);
+        else if (matrix->storage != MATRIX_VIEW)
+            free (matrix->data);
+        *matrix = (Matrix) {0};
     }
 }
 
 /**
  * @brief Загружает матрицу из файла
  *
+ * Двоичный файл (output.h) распознается по сигнатуре и отображается в
+ * память с копированием страниц при записи, текстовый - разбирается.
+ *
  * @param filename Путь к файлу с матрицей
  *
  * @return Загруженную матрицу или нулевую матрицу при ошибке
  */
 Matrix load_matrix_from_file (const char* filename) {
-    int     rows, cols;
-    double* data = NULL;
-    Matrix mat = {0, 0, NULL};   // Инициализация пустой матрицы
-    char res = 1;   // Флаг успешности выполнения
-
-    // Загрузка данных из файла через функцию из output.c
-    data = output_load_matrix_from_file (&rows, &cols, filename);
-    if (!data) res = 0;   // Ошибка загрузки
-    if (res) {
-        mat = create_matrix (rows, cols);
-        if (mat.data == NULL) res = 0;   // Ошибка создания матрицы
-    }
+    MatrixStatsScope stats = MATRIX_STATS_BEGIN (MATRIX_OP_LOAD_FROM_FILE);
+    int              rows, cols, stride;
+    double*          data = NULL;
+    Matrix           mat  = {0};   // Инициализация пустой матрицы
 
-    if (res) {
-        for (int row = 0; row < rows; row++) {
-            for (int col = 0; col < cols; col++) {
-                mat.data[row][col] = data[row * cols + col];
-            }
+    if (output_is_binary_matrix (filename)) {
+        mat = load_matrix_binary (filename, 1);
+    } else {
+        // Загрузка данных из файла через функцию из output.c. Буфер уже
+        // выровнен и разложен с шагом stride, поэтому матрица забирает его
+        // без копирования
+        data = output_load_matrix_from_file (&rows, &cols, &stride, filename);
+        if (data) {
+            mat.rows     = rows;
+            mat.cols     = cols;
+            mat.stride   = stride;
+            mat.data     = data;
+            mat.capacity = (size_t) rows * stride * sizeof (double);
         }
     }
+    MATRIX_STATS_END (stats, mat.data ? stats_file_size (filename) : 0, 0, 0);
+
+    return mat;
+}
 
-    if (data) free (data);
+/**
+ * @brief Отображает двоичный файл матрицы в память без копирования
+ *
+ * Матрица указывает прямо на страницы кэша файловой системы. Файл с
+ * другим порядком байт или типом элементов читается с преобразованием,
+ * тогда матрица владеет обычным буфером.
+ *
+ * @param filename Путь к двоичному файлу
+ * @param copy_on_write 0 - только чтение, 1 - частная копия при записи
+ *
+ * @return Матрица или нулевая матрица при ошибке
+ */
+Matrix load_matrix_binary (const char* filename, int copy_on_write) {
+    MatrixStatsScope stats = MATRIX_STATS_BEGIN (MATRIX_OP_LOAD_BINARY);
+    int              rows, cols, stride;
+    size_t           mapped = 0;
+    double*          data   = NULL;
+    Matrix           mat    = {0};
 
-    if (!res && mat.data != NULL) {
-        free_matrix (&mat);
-        mat.data = NULL;
-        mat.rows = 0;
-        mat.cols = 0;
+    data = output_map_matrix_binary (&rows, &cols, &stride, &mapped, copy_on_write,
+                                     filename);
+    if (data) {
+        mat.rows     = rows;
+        mat.cols     = cols;
+        mat.stride   = stride;
+        mat.data     = data;
+        mat.storage  = mapped ? MATRIX_MAPPED : MATRIX_OWNED;
+        mat.capacity = mapped ? mapped : (size_t) rows * stride * sizeof (double);
     }
+    MATRIX_STATS_END (stats, mat.data ? stats_file_size (filename) : 0, 0, 0);
 
     return mat;
 }
 
 /**
- * @brief Выводит матрицу в консоль
+ * @brief Отображает двоичный файл, сохраняя тип элементов файла
  *
- * @param matrix Указатель на матрицу для вывода
+ * @param filename Путь к двоичному файлу
+ * @param copy_on_write 0 - только чтение, 1 - частная копия при записи
+ *
+ * @return Матрица или нулевая матрица при ошибке
  */
-void print_matrix (const Matrix* matrix) {
-    double* data = NULL;
-    char    res  = 1;
+Matrix load_matrix_binary_native (const char* filename, int copy_on_write) {
+    MatrixStatsScope stats = MATRIX_STATS_BEGIN (MATRIX_OP_LOAD_BINARY_NATIVE);
+    int              rows, cols, stride;
+    size_t           mapped = 0;
+    OutputDtype      type   = OUTPUT_DTYPE_FLOAT64;
+    void*            data   = NULL;
+    Matrix           mat    = {0};
 
-    // Проверка входных данных
-    if (!matrix || !matrix->data) res = 0;
+    data = output_map_matrix_typed (&rows, &cols, &stride, &type, &mapped,
+                                    copy_on_write, filename);
+    for (int dtype = 0; data && dtype < MATRIX_DTYPE_COUNT; dtype++) {
+        if (file_dtypes[dtype] == type) mat.dtype = (MatrixDtype) dtype;
+    }
+
+    if (data) {
+        const size_t elem = matrix_dtype_size (mat.dtype);
 
-    if (res) {
-        data = malloc (matrix->rows * matrix->cols * sizeof (double));
-        if (!data) res = 0;
+        mat.rows     = rows;
+        mat.cols     = cols;
+        mat.stride   = stride;
+        mat.data     = data;
+        mat.storage  = mapped ? MATRIX_MAPPED : MATRIX_OWNED;
+        mat.capacity = mapped ? mapped : (size_t) rows * stride * elem;
     }
+    MATRIX_STATS_END (stats, mat.data ? stats_file_size (filename) : 0, 0, 0);
 
-    if (res) {
-        for (int row = 0; row < matrix->rows; row++) {
-            for (int col = 0; col < matrix->cols; col++) {
-                data[row * matrix->cols + col] = matrix->data[row][col];
-            }
-        }
-        // Вызов функции вывода
-        output_print_matrix (matrix->rows, matrix->cols, data);
+    return mat;
+}
+
+/**
+ * @brief Копия матрицы в MATRIX_FLOAT64 для текстового вывода
+ *
+ * @param matrix Матрица действительного или целого типа
+ * @param copy Копия; для MATRIX_FLOAT64 - та же матрица без копирования
+ *
+ * @return 0 при успехе, -1 при ошибке (в том числе для complex)
+ */
+static int as_float64 (const Matrix* matrix, Matrix* copy) {
+    int res = 0;
+
+    *copy = *matrix;
+    if (is_typed (matrix)) {
+        *copy = (Matrix) {0};
+        if (matrix->dtype != MATRIX_COMPLEX128)
+            *copy = create_matrix (matrix->rows, matrix->cols);
+        if (!copy->data || convert_matrix (matrix, copy) != 0) res = -1;
     }
 
-    if (data) free (data);
+    return res;
+}
+
+/**
+ * @brief Выводит матрицу в консоль
+ *
+ * Матрицы float и целых типов выводятся через копию в double.
+ *
+ * @param matrix Указатель на матрицу для вывода
+ */
+void print_matrix (const Matrix* matrix) {
+    MatrixStatsScope stats  = MATRIX_STATS_BEGIN (MATRIX_OP_PRINT);
+    Matrix           values = {0};
+
+    // Проверка входных данных
+    if (matrix && matrix->data && as_float64 (matrix, &values) == 0) {
+        output_print_matrix (values.rows, values.cols, values.stride, values.data);
+    }
+    if (is_typed (matrix)) free_matrix (&values);
+    MATRIX_STATS_END (stats, stats_bytes (matrix), 0, 0);
 }
 
 /**
  * @brief Сохраняет матрицу в файл
  *
+ * Матрицы float и целых типов записываются через копию в double.
+ *
  * @param matrix Указатель на сохраняемую матрицу
  * @param filename Имя выходного файла
  *
  * @return Возвращает -1 при ошибке и 0 при успешной отработке функции
  */
 int save_matrix_to_file (const Matrix* matrix, const char* filename) {
-    double* data   = NULL;
-    int     result = -1;
-    char    res    = 1;
+    MatrixStatsScope stats  = MATRIX_STATS_BEGIN (MATRIX_OP_SAVE_TO_FILE);
+    int              result = -1;
+    Matrix           values = {0};
 
     // Проверка входных данных
-    if (!matrix || !matrix->data) res = 0;
-
-    if (res) {
-        data = malloc (matrix->rows * matrix->cols * sizeof (double));
-        if (!data) res = 0;
+    if (matrix && matrix->data && as_float64 (matrix, &values) == 0) {
+        result = output_save_matrix_to_file (values.rows, values.cols,
+                                             values.stride, values.data, filename);
     }
+    if (is_typed (matrix)) free_matrix (&values);
+    MATRIX_STATS_END (stats, result == 0 ? stats_bytes (matrix) : 0,
+                      result == 0 ? stats_file_size (filename) : 0, 0);
 
-    if (res) {
-        for (int row = 0; row < matrix->rows; row++) {
-            for (int col = 0; col < matrix->cols; col++) {
-                data[row * matrix->cols + col] = matrix->data[row][col];
-            }
-        }
-        result =
-            output_save_matrix_to_file (matrix->rows, matrix->cols, data, filename);
-    }
+    return result;
+}
 
-    if (data) free (data);
+/**
+ * @brief Сохраняет матрицу в двоичном формате
+ *
+ * @param matrix Указатель на сохраняемую матрицу
+ * @param filename Имя выходного файла
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int save_matrix_binary (const Matrix* matrix, const char* filename) {
+    MatrixStatsScope stats  = MATRIX_STATS_BEGIN (MATRIX_OP_SAVE_BINARY);
+    int              result = -1;
+
+    if (matrix && matrix->data && matrix_dtype_size (matrix->dtype)) {
+        result = output_save_matrix_binary_typed (
+            matrix->rows, matrix->cols, matrix->stride, file_dtypes[matrix->dtype],
+            matrix->data, filename);
+    }
+    MATRIX_STATS_END (stats, result == 0 ? stats_bytes (matrix) : 0,
+                      result == 0 ? stats_file_size (filename) : 0, 0);
 
     return result;
 }
@@ -197,7 +444,8 @@ int save_matrix_to_file (const Matrix* matrix, const char* filename) {
  * @brief Складывает две матрицы
  *
  * Поэлементно складывает две матрицы одинакового размера.
- * Результат записывается в матрицу result.
+ * Результат записывается в матрицу result, которая может совпадать с A
+ * или B (каждый элемент читается до записи).
  *
  * @param A Указатель на первую матрицу
  * @param B Указатель на вторую матрицу
@@ -206,30 +454,36 @@ int save_matrix_to_file (const Matrix* matrix, const char* filename) {
  * @return 0 при успехе, -1 при ошибке
  */
 int add_matrices (const Matrix* A, const Matrix* B, Matrix* result) {
-    char res        = -1;   // Флаг ошибок
-    char rows_match = 0;    // Флаг совпадение числа строк
-    char cols_match = 0;   // Флаг совпадения числа столбцов
-    char pointers_valid = 0;   // Флаг для указателей
+    MatrixStatsScope stats          = MATRIX_STATS_BEGIN (MATRIX_OP_ADD);
+    char             res            = -1;   // Флаг ошибок
+    char             rows_match     = 0;    // Флаг совпадение числа строк
+    char             cols_match     = 0;    // Флаг совпадения числа столбцов
+    char             pointers_valid = 0;    // Флаг для указателей
 
     // Проверка указателей
     pointers_valid = (A != NULL) && (B != NULL) && (result != NULL);
 
     if (!pointers_valid) res = -1;
-    else {
+    else if (is_typed (A) || is_typed (B) || is_typed (result)) {
+        res = dtype_add (A, B, result);
+    } else {
         // Проверка размеров
         rows_match = (A->rows == B->rows);
         cols_match = (A->cols == B->cols);
         if (!rows_match || !cols_match) res = -1;
         else {
             // Выполнение сложения
+            SimdRowOp add = simd_kernels ()->add;
             for (int row = 0; row < A->rows; row++) {
-                for (int col = 0; col < A->cols; col++) {
-                    result->data[row][col] = A->data[row][col] + B->data[row][col];
-                }
+                add (A->cols, MATRIX_ROW (A, row), MATRIX_ROW (B, row),
+                     MATRIX_ROW (result, row));
             }
             res = 0;   // Успешное завершение
         }
     }
+    MATRIX_STATS_END (stats, res == 0 ? stats_bytes (A) + stats_bytes (B) : 0,
+                      res == 0 ? stats_bytes (result) : 0,
+                      res == 0 ? stats_elements (result) : 0);
 
     return res;
 }
@@ -238,7 +492,8 @@ int add_matrices (const Matrix* A, const Matrix* B, Matrix* result) {
  * @brief Вычитает две матрицы
  *
  * Поэлементно вычитает матрицу В из матрицы матрицы А.
- * Результат записывается в матрицу result.
+ * Результат записывается в матрицу result, которая может совпадать с A
+ * или B (каждый элемент читается до записи).
  *
  * @param A Указатель на первую матрицу
  * @param B Указатель на вторую матрицу
@@ -247,29 +502,216 @@ int add_matrices (const Matrix* A, const Matrix* B, Matrix* result) {
  * @return 0 при успехе, -1 при ошибке
  */
 int subtract_matrices (const Matrix* A, const Matrix* B, Matrix* result) {
-    char res            = -1;   // Флаг ошибок
-    char rows_match     = 0;    // Флаг совпадения строк
-    char cols_match     = 0;    // Флаг совпадения столбцов
-    char pointers_valid = 0;    // Флаг для указателей
+    MatrixStatsScope stats          = MATRIX_STATS_BEGIN (MATRIX_OP_SUBTRACT);
+    char             res            = -1;   // Флаг ошибок
+    char             rows_match     = 0;    // Флаг совпадения строк
+    char             cols_match     = 0;    // Флаг совпадения столбцов
+    char             pointers_valid = 0;    // Флаг для указателей
 
     // Проверка указателей
     pointers_valid = (A != NULL) && (B != NULL) && (result != NULL);
     if (!pointers_valid) res = -1;
-    else {
+    else if (is_typed (A) || is_typed (B) || is_typed (result)) {
+        res = dtype_subtract (A, B, result);
+    } else {
         // Проверка размеров
         rows_match = (A->rows == B->rows);
         cols_match = (A->cols == B->cols);
         if (!rows_match || !cols_match) res = -1;
         else {
             // Выполнение вычитания
+            SimdRowOp sub = simd_kernels ()->sub;
             for (int row = 0; row < A->rows; row++) {
-                for (int col = 0; col < A->cols; col++) {
-                    result->data[row][col] = A->data[row][col] - B->data[row][col];
-                }
+                sub (A->cols, MATRIX_ROW (A, row), MATRIX_ROW (B, row),
+                     MATRIX_ROW (result, row));
             }
             res = 0;   // Успешное завершение
         }
     }
+    MATRIX_STATS_END (stats, res == 0 ? stats_bytes (A) + stats_bytes (B) : 0,
+                      res == 0 ? stats_bytes (result) : 0,
+                      res == 0 ? stats_elements (result) : 0);
+
+    return res;
+}
+
+/**
+ * @brief Проверяет, пересекаются ли буферы двух матриц
+ */
+static int matrices_overlap (const Matrix* a, const Matrix* b) {
+    const MATRIX_TYPE* a_end = MATRIX_ROW (a, a->rows - 1) + a->cols;
+    const MATRIX_TYPE* b_end = MATRIX_ROW (b, b->rows - 1) + b->cols;
+
+    return a->data < b_end && b->data < a_end;
+}
+
+/**
+ * @brief Проверяет, что две матрицы - одни и те же элементы памяти
+ */
+static int matrices_same (const Matrix* a, const Matrix* b) {
+    return a->data == b->data && a->stride == b->stride && a->rows == b->rows &&
+           a->cols == b->cols;
+}
+
+/**
+ * @brief Линейная комбинация матриц с учетом совпадения result со входами
+ *
+ * Слагаемые, совпадающие с result, объединяются в один коэффициент при
+ * строке result, которая читается до записи. Поэтому каждая строка
+ * считается на месте (ядро axpby) без дополнительной памяти. Только
+ * слагаемое, частично перекрывающее result (другое смещение или шаг),
+ * предварительно копируется.
+ *
+ * @param result Результирующая матрица, может совпадать с любыми terms
+ * @param count Число слагаемых
+ * @param terms Слагаемые того же размера, что и result
+ * @param alphas Коэффициенты слагаемых
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int accumulate_matrices (Matrix* result, int count, const Matrix* const* terms,
+                         const MATRIX_TYPE* alphas) {
+    MatrixStatsScope stats   = MATRIX_STATS_BEGIN (MATRIX_OP_ACCUMULATE);
+    int              res     = -1;
+    int              aliased = 0;      // Есть слагаемые, совпадающие с result
+    int              others  = 0;      // Число остальных слагаемых
+    MATRIX_TYPE      self    = 0;      // Сумма коэффициентов совпадающих слагаемых
+    Matrix*          copies  = NULL;   // Копии частично перекрывающих слагаемых
+
+    if (result && result->data && count > 0 && terms && alphas &&
+        !is_typed (result)) {
+        res = 0;
+        for (int t = 0; t < count && res == 0; t++) {
+            if (!terms[t] || !terms[t]->data || terms[t]->rows != result->rows ||
+                terms[t]->cols != result->cols || is_typed (terms[t]))
+                res = -1;
+        }
+    }
+
+    if (res == 0) {
+        copies = calloc ((size_t) count, sizeof (Matrix));
+        if (!copies) res = -1;
+    }
+
+    for (int t = 0; t < count && res == 0; t++) {
+        if (matrices_same (terms[t], result)) {
+            self += alphas[t];
+            aliased = 1;
+        } else {
+            others++;
+            if (matrices_overlap (terms[t], result)) {
+                copies[t] = create_matrix (result->rows, result->cols);
+                if (copies[t].data) {
+                    for (int row = 0; row < result->rows; row++)
+                        memcpy (MATRIX_ROW (&copies[t], row),
+                                MATRIX_ROW (terms[t], row),
+                                (size_t) result->cols * sizeof (MATRIX_TYPE));
+                } else {
+                    res = -1;
+                }
+            }
+        }
+    }
+
+    if (res == 0) {
+        SimdRowAxpby axpby = simd_kernels ()->axpby;
+
+        for (int row = 0; row < result->rows; row++) {
+            MATRIX_TYPE* r     = MATRIX_ROW (result, row);
+            int          ready = aliased;   // Строка r уже содержит слагаемое
+            MATRIX_TYPE  beta  = self;
+
+            for (int t = 0; t < count; t++) {
+                if (!matrices_same (terms[t], result)) {
+                    const Matrix* x = copies[t].data ? &copies[t] : terms[t];
+                    axpby (result->cols, alphas[t], MATRIX_ROW (x, row),
+                           ready ? beta : 0.0, r);
+                    ready = 1;
+                    beta  = 1.0;
+                }
+            }
+            if (others == 0) axpby (result->cols, self, r, 0.0, r);
+        }
+    }
+
+    if (copies)
+        for (int t = 0; t < count; t++) free_matrix (&copies[t]);
+    free (copies);
+    MATRIX_STATS_END (stats, res == 0 ? (uint64_t) count * stats_bytes (result) : 0,
+                      res == 0 ? stats_bytes (result) : 0,
+                      res == 0 ? 2 * (uint64_t) count * stats_elements (result) : 0);
+
+    return res;
+}
+
+/**
+ * @brief Прибавляет матрицу на месте: A += B
+ *
+ * @param A Изменяемая матрица
+ * @param B Прибавляемая матрица того же размера (может совпадать с A)
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int add_matrices_inplace (Matrix* A, const Matrix* B) {
+    MatrixStatsScope  stats     = MATRIX_STATS_BEGIN (MATRIX_OP_ADD_INPLACE);
+    const Matrix*     terms[2]  = {A, B};
+    const MATRIX_TYPE alphas[2] = {1, 1};
+    const int         res       = is_typed (A) || is_typed (B)
+                                    ? dtype_add (A, B, A)
+                                    : accumulate_matrices (A, 2, terms, alphas);
+
+    MATRIX_STATS_END (stats, res == 0 ? 2 * stats_bytes (A) : 0,
+                      res == 0 ? stats_bytes (A) : 0,
+                      res == 0 ? stats_elements (A) : 0);
+
+    return res;
+}
+
+/**
+ * @brief Вычитает матрицу на месте: A -= B
+ *
+ * @param A Изменяемая матрица
+ * @param B Вычитаемая матрица того же размера (может совпадать с A)
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int subtract_matrices_inplace (Matrix* A, const Matrix* B) {
+    MatrixStatsScope  stats     = MATRIX_STATS_BEGIN (MATRIX_OP_SUBTRACT_INPLACE);
+    const Matrix*     terms[2]  = {A, B};
+    const MATRIX_TYPE alphas[2] = {1, -1};
+    const int         res       = is_typed (A) || is_typed (B)
+                                    ? dtype_subtract (A, B, A)
+                                    : accumulate_matrices (A, 2, terms, alphas);
+
+    MATRIX_STATS_END (stats, res == 0 ? 2 * stats_bytes (A) : 0,
+                      res == 0 ? stats_bytes (A) : 0,
+                      res == 0 ? stats_elements (A) : 0);
+
+    return res;
+}
+
+/**
+ * @brief Вычисляет Y = alpha * X + beta * Y на месте
+ *
+ * @param alpha Коэффициент при X
+ * @param X Матрица того же размера, что и Y (может совпадать с Y)
+ * @param beta Коэффициент при Y; при beta == 0 прежнее значение Y не читается
+ * @param Y Изменяемая матрица
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int axpby_matrices (MATRIX_TYPE alpha, const Matrix* X, MATRIX_TYPE beta,
+                    Matrix* Y) {
+    MatrixStatsScope  stats     = MATRIX_STATS_BEGIN (MATRIX_OP_AXPBY);
+    const Matrix*     terms[2]  = {Y, X};
+    const MATRIX_TYPE alphas[2] = {beta, alpha};
+    const int         res       = is_typed (X) || is_typed (Y)
+                                    ? dtype_axpby (alpha, X, beta, Y)
+                                    : accumulate_matrices (Y, 2, terms, alphas);
+
+    MATRIX_STATS_END (stats, res == 0 ? 2 * stats_bytes (Y) : 0,
+                      res == 0 ? stats_bytes (Y) : 0,
+                      res == 0 ? 3 * stats_elements (Y) : 0);
 
     return res;
 }
@@ -277,7 +719,12 @@ int subtract_matrices (const Matrix* A, const Matrix* B, Matrix* result) {
 /**
  * @brief Умножение двух матриц
  *
- * Выполняет матричное умножение A x B
+ * Выполняет матричное умножение A x B. Квадратные матрицы 2 x 2 ... 8 x 8
+ * умножают развернутые ядра small.c, остальные малые произведения
+ * считаются простым циклом i-k-j, начиная с порога gemm_use_blocked () работает
+ * блочный алгоритм с упаковкой панелей (gemm.c), а для очень больших
+ * матриц (strassen_use ()) - схема Штрассена-Винограда (strassen.c).
+ * Матрицы других типов умножает dtype_multiply () (dtype.c).
  *
  * @param A Указатель на первую матрицу
  * @param B Указатель на вторую матрицу
@@ -288,24 +735,114 @@ int subtract_matrices (const Matrix* A, const Matrix* B, Matrix* result) {
  * @return 0 при успехе, 1 при ошибке
  */
 int multiply_matrices (const Matrix* A, const Matrix* B, Matrix* result) {
-    char res            = 1;   // Флаг ошибок
-    char pointers_valid = (A != NULL) && (B != NULL) && (result != NULL);
-    char size_compatible =
+    MatrixStatsScope stats          = MATRIX_STATS_BEGIN (MATRIX_OP_MULTIPLY);
+    char             res            = 1;   // Флаг ошибок
+    char             pointers_valid = (A != NULL) && (B != NULL) && (result != NULL);
+    char             size_compatible =
         pointers_valid ? (A->cols == B->rows) : 0;   // Флаг совместимости размеров
+    const SmallKernels* small =   // Ядра фиксированного размера для n x n
+        size_compatible && A->rows == A->cols && B->cols == B->rows
+            ? small_kernels (A->rows)
+            : NULL;
 
     if (!pointers_valid || !size_compatible) res = 1;
-    else {
+    else if (is_typed (A) || is_typed (B) || is_typed (result)) {
+        res = dtype_multiply (A, B, result) == 0 ? 0 : 1;
+    } else if (small != NULL) {
+        small->multiply (A->data, A->stride, B->data, B->stride, result->data,
+                         result->stride);
+        res = 0;
+    } else if (strassen_use (A->rows, B->cols, A->cols)) {
+        res = strassen_multiply (A, B, result) == 0 ? 0 : 1;
+    } else if (gemm_use_blocked (A->rows, B->cols, A->cols)) {
+        res = gemm_multiply (A->rows, B->cols, A->cols, A->data, A->stride, B->data,
+                             B->stride, result->data, result->stride) == 0
+                ? 0
+                : 1;
+    } else {
+        // Строка B читается подряд, сумма накапливается в строке результата
         for (int row = 0; row < A->rows; row++) {
-            for (int col = 0; col < B->cols; col++) {
-                MATRIX_TYPE sum = 0;
-                for (int k = 0; k < A->cols; k++) {
-                    sum += A->data[row][k] * B->data[k][col];
-                }
-                result->data[row][col] = sum;
+            MATRIX_TYPE* r = MATRIX_ROW (result, row);
+            for (int col = 0; col < B->cols; col++) r[col] = 0;
+            for (int k = 0; k < A->cols; k++) {
+                const MATRIX_TYPE  a = MATRIX_AT (A, row, k);
+                const MATRIX_TYPE* b = MATRIX_ROW (B, k);
+                for (int col = 0; col < B->cols; col++) r[col] += a * b[col];
             }
         }
         res = 0;
     }
+    MATRIX_STATS_END (stats, res == 0 ? stats_bytes (A) + stats_bytes (B) : 0,
+                      res == 0 ? stats_bytes (result) : 0,
+                      res == 0 ? 2 * stats_elements (result) * A->cols : 0);
+
+    return res;
+}
+
+/**
+ * @brief Вычисляет A x B^T - C + D без промежуточных матриц
+ *
+ * B читается построчно в исходном виде: элемент (i, j) произведения равен
+ * скалярному произведению строк i матрицы A и j матрицы B. Начиная с порога
+ * gemm_use_blocked () транспонирование выполняется при упаковке панелей B,
+ * а -C + D прибавляется при последней записи тайла результата (gemm.c).
+ * Каждый элемент результата записывается один раз.
+ *
+ * @param A Матрица m x k
+ * @param B Матрица n x k
+ * @param C Вычитаемая матрица m x n
+ * @param D Прибавляемая матрица m x n
+ * @param result Результирующая матрица m x n
+ *
+ * @note result не должна совпадать с C и D: они читаются после записи
+ * частичных сумм, если k больше глубины панели.
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int fused_multiply_bt_sub_add (const Matrix* A, const Matrix* B, const Matrix* C,
+                               const Matrix* D, Matrix* result) {
+    MatrixStatsScope stats = MATRIX_STATS_BEGIN (MATRIX_OP_FUSED);
+    int              res   = -1;
+    int              valid = A != NULL && B != NULL && C != NULL && D != NULL &&
+                result != NULL && A->data != NULL && B->data != NULL &&
+                C->data != NULL && D->data != NULL && result->data != NULL;
+
+    valid = valid && A->cols == B->cols && C->rows == A->rows &&
+            C->cols == B->rows && D->rows == A->rows && D->cols == B->rows &&
+            result->rows == A->rows && result->cols == B->rows &&
+            result->data != C->data && result->data != D->data;
+    valid = valid && !is_typed (A) && !is_typed (B) && !is_typed (C) &&
+            !is_typed (D) && !is_typed (result);
+
+    if (valid && gemm_use_blocked (A->rows, B->rows, A->cols)) {
+        GemmEpilogue epilogue = {
+            2, {{C->data, C->stride, -1}, {D->data, D->stride, 1}}};
+
+        res = gemm_compute (0, 1, A->rows, B->rows, A->cols, A->data, A->stride,
+                            B->data, B->stride, result->data, result->stride,
+                            &epilogue);
+    } else if (valid) {
+        for (int row = 0; row < A->rows; row++) {
+            const MATRIX_TYPE* a = MATRIX_ROW (A, row);
+            const MATRIX_TYPE* c = MATRIX_ROW (C, row);
+            const MATRIX_TYPE* d = MATRIX_ROW (D, row);
+            MATRIX_TYPE*       r = MATRIX_ROW (result, row);
+
+            for (int col = 0; col < B->rows; col++) {
+                const MATRIX_TYPE* b   = MATRIX_ROW (B, col);
+                MATRIX_TYPE        sum = 0;
+                for (int k = 0; k < A->cols; k++) sum += a[k] * b[k];
+                r[col] = sum - c[col] + d[col];
+            }
+        }
+        res = 0;
+    }
+    MATRIX_STATS_END (stats,
+                      res == 0 ? stats_bytes (A) + stats_bytes (B) +
+                                     stats_bytes (C) + stats_bytes (D)
+                               : 0,
+                      res == 0 ? stats_bytes (result) : 0,
+                      res == 0 ? 2 * stats_elements (result) * (A->cols + 1) : 0);
 
     return res;
 }
@@ -316,26 +853,112 @@ int multiply_matrices (const Matrix* A, const Matrix* B, Matrix* result) {
  * Создает новую матрицу - транспонированную версию исходной.
  * Строки становятся столбцами и наоборот.
  *
+ * @see transpose_matrix_into
+ *
  * @param matrix Указатель на матрицу
  *
  * @return Транспонированная матрица или нулевая матрица при ошибке
  */
 Matrix transpose_matrix (const Matrix* matrix) {
-    Matrix res         = {0};
-    int    input_valid = 0;
+    MatrixStatsScope stats       = MATRIX_STATS_BEGIN (MATRIX_OP_TRANSPOSE);
+    Matrix           res         = {0};
+    int              input_valid = 0;
 
     // Проверка входных данных
     input_valid = (matrix != NULL) && (matrix->rows > 0) && (matrix->cols > 0);
 
     if (input_valid) {
-        res = create_matrix (matrix->cols, matrix->rows);
-        if (res.data != NULL) {
-            for (int row = 0; row < matrix->rows; row++) {
-                for (int col = 0; col < matrix->cols; col++) {
-                    res.data[col][row] = matrix->data[row][col];
+        res = create_matrix_dtype (matrix->cols, matrix->rows, matrix->dtype);
+        if (res.data != NULL && transpose_matrix_into (matrix, &res) != 0) {
+            free_matrix (&res);
+        }
+    }
+    MATRIX_STATS_END (stats, res.data ? stats_bytes (matrix) : 0, stats_bytes (&res),
+                      0);
+
+    return res;
+}
+
+/**
+ * @brief LU-разложение копии матрицы с частичным выбором ведущего элемента
+ *
+ * Копия разлагается на месте (PA = LU), детерминант равен произведению
+ * диагонали U со знаком перестановки. Произведение копится в двух формах:
+ * напрямую и как сумма логарифмов модулей.
+ *
+ * @param matrix Квадратная матрица
+ * @param det Детерминант (может быть NULL)
+ * @param log_abs Логарифм модуля детерминанта (может быть NULL)
+ * @param sign Знак детерминанта (может быть NULL)
+ *
+ * @return 0 при успехе, -1 при ошибке выделения памяти
+ */
+static int lu_determinant (const Matrix* matrix, MATRIX_TYPE* det,
+                           MATRIX_TYPE* log_abs, int* sign) {
+    const int   n         = matrix->rows;
+    Matrix      lu        = create_matrix (n, n);   // Единственное выделение памяти
+    MATRIX_TYPE product   = 1;   // Произведение диагонали U
+    MATRIX_TYPE log_sum   = 0;   // Сумма логарифмов модулей диагонали U
+    int         swap_sign = 1;   // Знак перестановки строк
+    int         diag_sign = 1;   // Знак произведения диагонали U
+    char        singular  = 0;   // Флаг вырожденности
+    int         res       = -1;
+
+    if (lu.data != NULL) {
+        for (int row = 0; row < n; row++) {
+            memcpy (MATRIX_ROW (&lu, row), MATRIX_ROW (matrix, row),
+                    (size_t) n * sizeof (MATRIX_TYPE));
+        }
+
+        for (int col = 0; col < n && !singular; col++) {
+            // Ведущий элемент - максимальный по модулю в столбце
+            int         pivot = col;
+            MATRIX_TYPE best  = fabs (MATRIX_AT (&lu, col, col));
+            for (int row = col + 1; row < n; row++) {
+                MATRIX_TYPE value = fabs (MATRIX_AT (&lu, row, col));
+                if (value > best) {
+                    best  = value;
+                    pivot = row;
+                }
+            }
+
+            if (best == 0) singular = 1;
+            else {
+                if (pivot != col) {
+                    MATRIX_TYPE* a = MATRIX_ROW (&lu, col);
+                    MATRIX_TYPE* b = MATRIX_ROW (&lu, pivot);
+                    for (int j = col; j < n; j++) {
+                        MATRIX_TYPE tmp = a[j];
+                        a[j]            = b[j];
+                        b[j]            = tmp;
+                    }
+                    swap_sign = -swap_sign;
+                }
+
+                const MATRIX_TYPE* pivot_row = MATRIX_ROW (&lu, col);
+                const MATRIX_TYPE  diag      = pivot_row[col];
+                product *= diag;
+                log_sum += log (fabs (diag));
+                if (diag < 0) diag_sign = -diag_sign;
+
+                // Исключение: строки ниже обновляются подряд по памяти
+                for (int row = col + 1; row < n; row++) {
+                    MATRIX_TYPE*      r      = MATRIX_ROW (&lu, row);
+                    const MATRIX_TYPE factor = r[col] / diag;
+                    if (factor != 0) {
+                        for (int j = col + 1; j < n; j++) {
+                            r[j] -= factor * pivot_row[j];
+                        }
+                    }
                 }
             }
         }
+
+        if (det) *det = singular ? 0 : swap_sign * product;
+        if (log_abs) *log_abs = singular ? -INFINITY : log_sum;
+        if (sign) *sign = singular ? 0 : swap_sign * diag_sign;
+        free_matrix (&lu);
+        res = 0;
     }
 
     return res;
@@ -348,48 +971,186 @@ Matrix transpose_matrix (const Matrix* matrix) {
  *
  * @param matrix Указатель на квадратную матрицу
  *
- * @note Используется рекурсивный алгоритм разложения по первой строке
+ * @note Для n от 2 до 8 работают ядра фиксированного размера (small.c) без
+ * выделения памяти, для больших n - LU-разложение с частичным выбором
+ * ведущего элемента на временной копии: O(n^3) операций и одно выделение.
+ * При переполнении результата следует использовать determinant_log ().
  *
  * @return 0 при ошибке или значение детерминанта
  */
 MATRIX_TYPE determinant (const Matrix* matrix) {
-    MATRIX_TYPE det = 0;   // Значение квадратной матрицы
-    char        is_square = 0;   // Флаг квадратности матрицы
+    MatrixStatsScope stats     = MATRIX_STATS_BEGIN (MATRIX_OP_DETERMINANT);
+    MATRIX_TYPE      det       = 0;   // Значение квадратной матрицы
+    char             is_square = 0;   // Флаг квадратности матрицы
 
     // Проверка входных данных
-    is_square =
-        (matrix != NULL) && (matrix->rows == matrix->cols) && (matrix->rows > 0);
+    is_square = (matrix != NULL) && (matrix->data != NULL) &&
+                (matrix->rows == matrix->cols) && (matrix->rows > 0) &&
+                !is_typed (matrix);
 
     if (is_square) {
         // Основная логика вычисления
-        const int n = matrix->rows;
-        if (n == 1) det = matrix->data[0][0];
-        else if (n == 2)
-            det = matrix->data[0][0] * matrix->data[1][1] -
-                  matrix->data[0][1] * matrix->data[1][0];
-        else {
-            for (int col = 0; col < n; col++) {
-                Matrix submat = create_matrix (n - 1, n - 1);
-                if (submat.data != NULL) {
-                    // Заполнение подматрицы
-                    for (int row = 1; row < n; row++) {
-                        int subcol_index = 0;
-                        for (int k = 0; k < n; k++) {
-                            if (k != col) {
-                                submat.data[row - 1][subcol_index++] =
-                                    matrix->data[row][k];
-                            }
-                        }
+        const int           n     = matrix->rows;
+        const SmallKernels* small = small_kernels (n);
+        if (n == 1) det = MATRIX_AT (matrix, 0, 0);
+        else if (small != NULL)
+            det = small->determinant (matrix->data, matrix->stride);
+        else if (lu_determinant (matrix, &det, NULL, NULL) != 0)
+            det = 0;
+    }
+    MATRIX_STATS_END (stats, is_square ? stats_bytes (matrix) : 0, 0,
+                      is_square ? 2 * stats_elements (matrix) * matrix->rows / 3
+                                : 0);
+
+    return det;
+}
+
+/**
+ * @brief Вычисляет логарифм модуля и знак детерминанта
+ *
+ * @param matrix Указатель на квадратную матрицу
+ * @param log_abs Натуральный логарифм |det|
+ * @param sign Знак детерминанта
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int determinant_log (const Matrix* matrix, MATRIX_TYPE* log_abs, int* sign) {
+    MatrixStatsScope stats = MATRIX_STATS_BEGIN (MATRIX_OP_DETERMINANT_LOG);
+    int              res   = -1;
+
+    if (matrix != NULL && matrix->data != NULL && log_abs != NULL && sign != NULL &&
+        matrix->rows == matrix->cols && matrix->rows > 0 && !is_typed (matrix)) {
+        res = lu_determinant (matrix, NULL, log_abs, sign);
+    }
+    MATRIX_STATS_END (stats, res == 0 ? stats_bytes (matrix) : 0, 0,
+                      res == 0 ? 2 * stats_elements (matrix) * matrix->rows / 3 : 0);
+
+    return res;
+}
+
+/**
+ * @brief Обращение методом Гаусса-Жордана с частичным выбором ведущего элемента
+ *
+ * Копия матрицы и накопитель обратной лежат в одном выделении из 2n строк,
+ * result записывается только при успехе.
+ *
+ * @param matrix Квадратная матрица
+ * @param result Матрица того же размера (может совпадать с matrix)
+ *
+ * @return 0 при успехе, -1 при ошибке выделения памяти или вырожденной матрице
+ */
+static int gauss_jordan_inverse (const Matrix* matrix, Matrix* result) {
+    const int n        = matrix->rows;
+    Matrix    work     = create_matrix (2 * n, n);
+    Matrix    a        = matrix_view (&work, 0, 0, n, n);   // Копия matrix
+    Matrix    r        = matrix_view (&work, n, 0, n, n);   // Накопитель A^-1
+    char      singular = 0;                                 // Флаг вырожденности
+    int       res      = -1;
+
+    if (work.data != NULL) {
+        for (int row = 0; row < n; row++) {
+            memcpy (MATRIX_ROW (&a, row), MATRIX_ROW (matrix, row),
+                    (size_t) n * sizeof (MATRIX_TYPE));
+            for (int col = 0; col < n; col++) MATRIX_AT (&r, row, col) = row == col;
+        }
+
+        for (int col = 0; col < n && !singular; col++) {
+            int         pivot = col;
+            MATRIX_TYPE best  = fabs (MATRIX_AT (&a, col, col));
+            for (int row = col + 1; row < n; row++) {
+                if (fabs (MATRIX_AT (&a, row, col)) > best) {
+                    best  = fabs (MATRIX_AT (&a, row, col));
+                    pivot = row;
+                }
+            }
+
+            if (best == 0) singular = 1;
+            else {
+                MATRIX_TYPE* pa = MATRIX_ROW (&a, col);
+                MATRIX_TYPE* pr = MATRIX_ROW (&r, col);
+                if (pivot != col) {
+                    MATRIX_TYPE* qa = MATRIX_ROW (&a, pivot);
+                    MATRIX_TYPE* qr = MATRIX_ROW (&r, pivot);
+                    for (int j = 0; j < n; j++) {
+                        const MATRIX_TYPE ta = pa[j];
+                        const MATRIX_TYPE tr = pr[j];
+                        pa[j]                = qa[j];
+                        pr[j]                = qr[j];
+                        qa[j]                = ta;
+                        qr[j]                = tr;
                     }
+                }
 
-                    // Рекурсивный вызов
-                    MATRIX_TYPE sub_det = determinant (&submat);
-                    det += (col % 2 == 0 ? 1 : -1) * matrix->data[0][col] * sub_det;
-                    free_matrix (&submat);
+                const MATRIX_TYPE inv = 1 / pa[col];
+                for (int j = 0; j < n; j++) {
+                    pa[j] *= inv;
+                    pr[j] *= inv;
+                }
+
+                // Столбец col исключается из всех остальных строк
+                for (int row = 0; row < n; row++) {
+                    MATRIX_TYPE*      ra     = MATRIX_ROW (&a, row);
+                    MATRIX_TYPE*      rr     = MATRIX_ROW (&r, row);
+                    const MATRIX_TYPE factor = ra[col];
+                    if (row != col && factor != 0) {
+                        for (int j = col; j < n; j++) ra[j] -= factor * pa[j];
+                        for (int j = 0; j < n; j++) rr[j] -= factor * pr[j];
+                    }
                 }
             }
         }
+
+        if (!singular) {
+            for (int row = 0; row < n; row++) {
+                memcpy (MATRIX_ROW (result, row), MATRIX_ROW (&r, row),
+                        (size_t) n * sizeof (MATRIX_TYPE));
+            }
+            res = 0;
+        }
+        free_matrix (&work);
     }
 
-    return det;
+    return res;
+}
+
+/**
+ * @brief Вычисляет обратную матрицу
+ *
+ * Матрицы 2 x 2 ... 8 x 8 обращают ядра фиксированного размера (small.c):
+ * явные формулы до 4 x 4 и развернутый метод Гаусса-Жордана дальше. Для
+ * больших n - метод Гаусса-Жордана с одним выделением памяти.
+ *
+ * @param matrix Указатель на квадратную матрицу
+ * @param result Матрица того же размера (может совпадать с matrix)
+ *
+ * @return 0 при успехе, -1 при ошибке или вырожденной матрице
+ */
+int inverse_matrix (const Matrix* matrix, Matrix* result) {
+    MatrixStatsScope stats = MATRIX_STATS_BEGIN (MATRIX_OP_INVERSE);
+    int              res   = -1;
+
+    if (matrix != NULL && result != NULL && matrix->data != NULL &&
+        result->data != NULL && matrix->rows == matrix->cols && matrix->rows > 0 &&
+        result->rows == matrix->rows && result->cols == matrix->cols &&
+        !is_typed (matrix) && !is_typed (result)) {
+        const int           n     = matrix->rows;
+        const SmallKernels* small = small_kernels (n);
+
+        if (n == 1) {
+            if (MATRIX_AT (matrix, 0, 0) != 0) {
+                MATRIX_AT (result, 0, 0) = 1 / MATRIX_AT (matrix, 0, 0);
+                res                      = 0;
+            }
+        } else if (small != NULL) {
+            res = small->inverse (matrix->data, matrix->stride, result->data,
+                                  result->stride);
+        } else {
+            res = gauss_jordan_inverse (matrix, result);
+        }
+    }
+    MATRIX_STATS_END (stats, res == 0 ? stats_bytes (matrix) : 0,
+                      res == 0 ? stats_bytes (result) : 0,
+                      res == 0 ? 2 * stats_elements (matrix) * matrix->rows : 0);
+
+    return res;
 }
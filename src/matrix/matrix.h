@@ -24,27 +24,166 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/**
+ * @brief Способ владения буфером данных матрицы
+ */
+typedef enum {
+    MATRIX_OWNED = 0,   ///< Буфер aligned_alloc, освобождается free
+    MATRIX_MAPPED,      ///< Отображение двоичного файла, освобождается munmap
+    MATRIX_ALLOCATED,   ///< Буфер распределителя, возвращается через release
+    MATRIX_VIEW         ///< Окно в буфере другой матрицы, не освобождается
+} MatrixStorage;
+
+/**
+ * @brief Тип элементов матрицы
+ *
+ * Нулевое значение - MATRIX_FLOAT64 (MATRIX_TYPE), поэтому матрицы, не
+ * знающие о типе, остаются матрицами double. Для остальных типов data
+ * указывает на элементы этого типа, stride считается в элементах типа.
+ */
+typedef enum {
+    MATRIX_FLOAT64 = 0,   ///< double
+    MATRIX_FLOAT32,       ///< float
+    MATRIX_INT32,         ///< int32_t
+    MATRIX_INT64,         ///< int64_t
+    MATRIX_COMPLEX128,    ///< double _Complex
+    MATRIX_DTYPE_COUNT    ///< Число типов
+} MatrixDtype;
+
+/**
+ * @struct MatrixAllocator
+ * @brief Подключаемый распределитель памяти для данных матриц
+ *
+ * Реализации - арена и пул размерных классов (alloc.h). Распределитель
+ * должен жить дольше всех матриц, созданных через него.
+ */
+typedef struct {
+    /// Выделяет bytes байт, выровненных по MATRIX_ALIGNMENT, или NULL
+    void* (*allocate) (void* state, size_t bytes);
+    /// Возвращает блок data размером bytes
+    void (*release) (void* state, void* data, size_t bytes);
+    void* state;   ///< Состояние, передаваемое в функции
+} MatrixAllocator;
+
 /**
  * @struct Matrix
  * @brief Структура, представляющая матрицы
+ *
+ * Элементы хранятся одним блоком, выровненным по MATRIX_ALIGNMENT байт.
+ * Строка row начинается с data + row * stride. У созданных матриц шаг
+ * stride кратен MATRIX_ALIGN_ELEMS, поэтому каждая строка тоже выровнена.
+ *
+ * Представление (matrix_view) - та же структура, указывающая на
+ * прямоугольник чужого буфера с шагом строки родителя. Все функции
+ * библиотеки работают через data и stride и принимают представления
+ * наравне с обычными матрицами; выравнивание строк представления не
+ * гарантируется.
+ *
+ * Матрицы других типов (dtype) принимают создание, представления,
+ * сложение, вычитание, axpby, умножение, транспонирование, преобразование
+ * типа и ввод-вывод; остальные операции работают только с MATRIX_FLOAT64
+ * и возвращают ошибку для других типов.
  */
 typedef struct {
-    int           rows;   ///< Количество строк
-    int           cols;   ///< Количество столбцов
-    MATRIX_TYPE** data;   ///< Двумерный массив данных
+    int                    rows;        ///< Количество строк
+    int                    cols;        ///< Количество столбцов
+    int                    stride;      ///< Шаг строки в элементах
+    MATRIX_TYPE*           data;        ///< Выровненный буфер данных
+    MatrixStorage          storage;     ///< Владение буфером
+    size_t                 capacity;    ///< Размер буфера (отображения) в байтах
+    const MatrixAllocator* allocator;   ///< Распределитель (MATRIX_ALLOCATED)
+    MatrixDtype            dtype;       ///< Тип элементов
 } Matrix;
 
+/**
+ * @brief Элемент (row, col) матрицы с учетом шага строки
+ * @param m Указатель на матрицу
+ */
+#define MATRIX_AT(m, row, col)                                                     \
+    ((m)->data[(size_t) (row) * (size_t) (m)->stride + (size_t) (col)])
+
+/**
+ * @brief Указатель на начало строки row
+ *
+ * Совместимый доступ в стиле прежнего data[row][col]:
+ * MATRIX_ROW (m, row)[col]
+ *
+ * @param m Указатель на матрицу
+ */
+#define MATRIX_ROW(m, row) ((m)->data + (size_t) (row) * (size_t) (m)->stride)
+
+/**
+ * @brief Элемент (row, col) матрицы с элементами типа type
+ *
+ * MATRIX_TYPED_AT (float, m, i, j) для матрицы MATRIX_FLOAT32
+ *
+ * @param m Указатель на матрицу
+ */
+#define MATRIX_TYPED_AT(type, m, row, col)                                         \
+    (((type*) (void*) (m)->data)[(size_t) (row) * (size_t) (m)->stride +          \
+                                 (size_t) (col)])
+
 /**
  * @brief Создает новую матрицу с заданными размерами
  * @param rows Количество строк
  * @param cols Количество столбцов
+ * @note Память выделяет распределитель потока (matrix_set_allocator)
  * @return Структура Matrix при успехе или нулевая матрица при ошибке
  */
 Matrix create_matrix (int rows, int cols);
 
+/**
+ * @brief Создает матрицу, выделяя память через заданный распределитель
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param allocator Распределитель или NULL - aligned_alloc
+ * @return Структура Matrix при успехе или нулевая матрица при ошибке
+ */
+Matrix create_matrix_with (int rows, int cols, const MatrixAllocator* allocator);
+
+/**
+ * @brief Создает матрицу с элементами заданного типа
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param dtype Тип элементов
+ * @note Шаг строки кратен MATRIX_ALIGNMENT байт; память выделяет
+ * распределитель потока
+ * @return Структура Matrix при успехе или нулевая матрица при ошибке
+ */
+Matrix create_matrix_dtype (int rows, int cols, MatrixDtype dtype);
+
+/**
+ * @brief Задает распределитель, через который create_matrix () и все
+ *        операции библиотеки выделяют матрицы в текущем потоке
+ * @param allocator Распределитель или NULL - aligned_alloc
+ * @return Прежний распределитель потока
+ */
+const MatrixAllocator* matrix_set_allocator (const MatrixAllocator* allocator);
+
+/**
+ * @brief Возвращает распределитель текущего потока
+ * @return Распределитель или NULL, если используется aligned_alloc
+ */
+const MatrixAllocator* matrix_get_allocator (void);
+
+/**
+ * @brief Создает представление подматрицы без копирования
+ * @param parent Матрица или другое представление
+ * @param row Первая строка окна
+ * @param col Первый столбец окна
+ * @param rows Число строк окна (> 0)
+ * @param cols Число столбцов окна (> 0)
+ * @note Запись через представление меняет parent; представление
+ * действительно, пока жив буфер parent
+ * @return Матрица с storage = MATRIX_VIEW или нулевая матрица, если окно
+ * выходит за границы parent
+ */
+Matrix matrix_view (const Matrix* parent, int row, int col, int rows, int cols);
+
 /**
  * @brief Освобождает память, выделенную под матрицу
  * @param matrix Указатель на матрицу
+ * @note Для представления только обнуляет структуру, буфер не трогается
  */
 void free_matrix (Matrix* matrix);
 
@@ -55,6 +194,25 @@ void free_matrix (Matrix* matrix);
  */
 Matrix load_matrix_from_file (const char* filename);
 
+/**
+ * @brief Отображает двоичный файл матрицы в память без копирования
+ * @param filename Путь к файлу, записанному save_matrix_binary ()
+ * @param copy_on_write 0 - только чтение (запись в данные недопустима),
+ * 1 - изменения попадают в частную копию страниц, файл не меняется
+ * @return Матрица или нулевая матрица при ошибке
+ */
+Matrix load_matrix_binary (const char* filename, int copy_on_write);
+
+/**
+ * @brief Отображает двоичный файл, сохраняя тип элементов файла
+ * @param filename Путь к файлу, записанному save_matrix_binary ()
+ * @param copy_on_write 0 - только чтение, 1 - частная копия страниц
+ * @note load_matrix_binary () приводит float и целые к double, эта функция
+ * возвращает матрицу с dtype файла
+ * @return Матрица или нулевая матрица при ошибке
+ */
+Matrix load_matrix_binary_native (const char* filename, int copy_on_write);
+
 /**
  * @brief Выводит матрицу в консоль
  * @param matrix Указатель на матрицу для вывода
@@ -65,15 +223,25 @@ void print_matrix (const Matrix* matrix);
  * @brief Сохраняет матрицу в текстовый файл
  * @param matrix Указатель на матрицу
  * @param filename Имя файла
+ * @note float и целые типы записываются как double, complex не поддерживается
  * @return 0 в случае успеха, -1 в случае ошибки
  */
 int save_matrix_to_file (const Matrix* matrix, const char* filename);
 
+/**
+ * @brief Сохраняет матрицу в двоичном формате (output.h)
+ * @param matrix Указатель на матрицу
+ * @param filename Имя файла
+ * @note Файл хранит тип элементов матрицы (dtype)
+ * @return 0 при успехе, -1 при ошибке
+ */
+int save_matrix_binary (const Matrix* matrix, const char* filename);
+
 /**
  * @brief Складывает две матрицы
  * @param A Указатель на первую матрицу
  * @param B Указатель на вторую матрицу
- * @param result Результирующая матрица
+ * @param result Результирующая матрица (может совпадать с A или B)
  * @return 0 при успехе, -1 при ошибке
  */
 int add_matrices (const Matrix* A, const Matrix* B, Matrix* result);
@@ -82,11 +250,52 @@ int add_matrices (const Matrix* A, const Matrix* B, Matrix* result);
  * @brief Вычитает две матрицы
  * @param A Указатель на первую матрицу
  * @param B Указатель на вторую матрицу
- * @param result Результирующая матрица
+ * @param result Результирующая матрица (может совпадать с A или B)
  * @return 0 при успехе, -1 при ошибке
  */
 int subtract_matrices (const Matrix* A, const Matrix* B, Matrix* result);
 
+/**
+ * @brief Прибавляет матрицу на месте: A += B
+ * @param A Изменяемая матрица
+ * @param B Прибавляемая матрица того же размера (может совпадать с A)
+ * @return 0 при успехе, -1 при ошибке
+ */
+int add_matrices_inplace (Matrix* A, const Matrix* B);
+
+/**
+ * @brief Вычитает матрицу на месте: A -= B
+ * @param A Изменяемая матрица
+ * @param B Вычитаемая матрица того же размера (может совпадать с A)
+ * @return 0 при успехе, -1 при ошибке
+ */
+int subtract_matrices_inplace (Matrix* A, const Matrix* B);
+
+/**
+ * @brief Вычисляет Y = alpha * X + beta * Y на месте
+ * @param alpha Коэффициент при X
+ * @param X Матрица того же размера, что и Y (может совпадать с Y)
+ * @param beta Коэффициент при Y; при beta == 0 прежнее значение Y не читается
+ * @param Y Изменяемая матрица
+ * @return 0 при успехе, -1 при ошибке
+ */
+int axpby_matrices (MATRIX_TYPE alpha, const Matrix* X, MATRIX_TYPE beta,
+                    Matrix* Y);
+
+/**
+ * @brief Вычисляет result = sum (alphas[i] * terms[i])
+ * @param result Результирующая матрица; может совпадать с любыми слагаемыми
+ * @param count Число слагаемых (> 0)
+ * @param terms Слагаемые того же размера, что и result
+ * @param alphas Коэффициенты слагаемых
+ * @note Каждая строка считается за один проход без промежуточных матриц.
+ * Дополнительная память нужна только слагаемому, которое перекрывает result
+ * частично (с другим началом или шагом строки), - оно копируется.
+ * @return 0 при успехе, -1 при ошибке
+ */
+int accumulate_matrices (Matrix* result, int count, const Matrix* const* terms,
+                         const MATRIX_TYPE* alphas);
+
 /**
  * @brief Умножает две матрицы
  * @param A Указатель на первую матрицу
@@ -96,6 +305,18 @@ int subtract_matrices (const Matrix* A, const Matrix* B, Matrix* result);
  */
 int multiply_matrices (const Matrix* A, const Matrix* B, Matrix* result);
 
+/**
+ * @brief Вычисляет A x B^T - C + D без промежуточных матриц
+ * @param A Матрица m x k
+ * @param B Матрица n x k (транспонируется при чтении)
+ * @param C Вычитаемая матрица m x n
+ * @param D Прибавляемая матрица m x n
+ * @param result Результирующая матрица m x n, не совпадает с C и D
+ * @return 0 при успехе, -1 при ошибке
+ */
+int fused_multiply_bt_sub_add (const Matrix* A, const Matrix* B, const Matrix* C,
+                               const Matrix* D, Matrix* result);
+
 /**
  * @brief Транспонирует матрицу
  * @param matrix Указатель на матрицу
@@ -103,12 +324,56 @@ int multiply_matrices (const Matrix* A, const Matrix* B, Matrix* result);
  */
 Matrix transpose_matrix (const Matrix* matrix);
 
+/**
+ * @brief Транспонирует матрицу в заранее созданную матрицу
+ * @param matrix Указатель на исходную матрицу rows x cols
+ * @param result Указатель на матрицу cols x rows (не совпадает с matrix)
+ * @note Кэш-независимый рекурсивный алгоритм
+ * @return 0 при успехе, -1 при ошибке
+ */
+int transpose_matrix_into (const Matrix* matrix, Matrix* result);
+
+/**
+ * @brief Транспонирует матрицу на месте
+ * @param matrix Указатель на матрицу
+ * @note Для прямоугольной матрицы используется обход циклов перестановки
+ * с битовой маской rows * cols бит, шаг строки может стать равным rows.
+ * Прямоугольное представление так транспонировать нельзя: буфер принадлежит
+ * родителю
+ * @return 0 при успехе, -1 при ошибке
+ */
+int transpose_matrix_inplace (Matrix* matrix);
+
 /**
  * @brief Вычисляет детерминант квадратной матрицы
  * @param matrix Указатель на квадратную матрицу
- * @note Использует рекурсивный алгоритм
+ * @note Использует LU-разложение с частичным выбором ведущего элемента, O(n^3)
  * @return Значение детерминанта матрицы или 0 при ошибке
  */
 MATRIX_TYPE determinant (const Matrix* matrix);
 
+/**
+ * @brief Вычисляет логарифм модуля и знак детерминанта
+ *
+ * Для больших n сам детерминант выходит за пределы диапазона double,
+ * тогда как det = sign * exp (log_abs) остается представимым.
+ *
+ * @param matrix Указатель на квадратную матрицу
+ * @param log_abs Натуральный логарифм |det|, -INFINITY для вырожденной матрицы
+ * @param sign Знак детерминанта: 1, -1 или 0 для вырожденной матрицы
+ * @return 0 при успехе, -1 при ошибке
+ */
+int determinant_log (const Matrix* matrix, MATRIX_TYPE* log_abs, int* sign);
+
+/**
+ * @brief Вычисляет обратную матрицу
+ * @param matrix Указатель на квадратную матрицу
+ * @param result Матрица того же размера (может совпадать с matrix)
+ * @note Метод Гаусса-Жордана с частичным выбором ведущего элемента; для
+ * 2 x 2 ... 8 x 8 - ядра фиксированного размера (small.h)
+ * @return 0 при успехе, -1 при ошибке или вырожденной матрице (result не
+ * изменяется)
+ */
+int inverse_matrix (const Matrix* matrix, Matrix* result);
+
 #endif   // MATRIX_H
@@ -0,0 +1,387 @@
+/**
+ * @file ooc.c
+ * @brief Реализация умножения матриц, не помещающихся в память
+ *
+ * @details
+ * Шаги вычисления перенумерованы: шаг s = (ti * tiles_n + tj) * tiles_k + tp
+ * прибавляет A[ti, tp] x B[tp, tj] к тайлу C[ti, tj]. Порядок шагов
+ * известен заранее, поэтому фоновый поток ввода-вывода загружает тайлы
+ * шага s + 1 во второй слот, пока считается шаг s.
+ *
+ * Накопление C идет попеременно в двух буферах: следующий буфер получает
+ * A x B плюс предыдущий через эпилог GEMM, отдельного прохода сложения нет.
+ * Готовый тайл передается фоновому потоку на запись, а вычисление
+ * продолжается в двух оставшихся буферах.
+ *
+ * Фоновый поток обслуживает запись раньше загрузки, чтобы буфер
+ * записываемого тайла освобождался как можно скорее.
+ *
+ * @see ooc.h gemm.h
+ */
+
+#include "ooc.h"
+
+#include "../output/output.h"
+#include "gemm.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// Число тайлов в памяти: два A, два B, три C
+#define OOC_TILES 7
+
+/**
+ * @struct OocFile
+ * @brief Открытый двоичный файл матрицы
+ */
+typedef struct {
+    int    fd;           ///< Дескриптор, -1 - не открыт
+    int    rows, cols;   ///< Размеры матрицы
+    int    stride;       ///< Шаг строки в файле
+    size_t offset;       ///< Смещение данных
+} OocFile;
+
+/**
+ * @struct OocJob
+ * @brief Состояние умножения, общее для вычисления и ввода-вывода
+ */
+typedef struct {
+    OocFile         a, b, c;                     ///< Файлы A, B и результата
+    int             tile;                        ///< Сторона тайла
+    int             ld;                          ///< Шаг строки буферов тайлов
+    int             tiles_m, tiles_n, tiles_k;   ///< Число тайлов по осям
+    long            steps;                       ///< Общее число шагов
+    MATRIX_TYPE*    a_buf[2];                    ///< Слоты тайлов A
+    MATRIX_TYPE*    b_buf[2];                    ///< Слоты тайлов B
+    MATRIX_TYPE*    c_buf[3];                    ///< Буферы тайлов C
+    pthread_mutex_t lock;                        ///< Защищает поля ниже
+    pthread_cond_t  cond;                        ///< Сигнал о смене состояния
+    long            loaded;                      ///< Число загруженных шагов
+    long            consumed;                    ///< Число посчитанных шагов
+    int             write_pending;               ///< Есть тайл C на запись
+    int             write_buffer;                ///< Буфер записываемого тайла
+    int             write_ti, write_tj;          ///< Номер записываемого тайла
+    int             finished;                    ///< Записей больше не будет
+    int             failed;                      ///< Ошибка ввода-вывода
+} OocJob;
+
+/**
+ * @brief Размер тайла для заданного объема памяти
+ *
+ * @param memory Объем памяти в байтах, 0 - OOC_MEMORY_DEFAULT
+ *
+ * @return Сторона тайла или 0, если памяти не хватает
+ */
+int ooc_tile_size (size_t memory) {
+    size_t budget = (memory ? memory : OOC_MEMORY_DEFAULT) /
+                    (OOC_TILES * sizeof (MATRIX_TYPE));
+    size_t tile   = 0;
+
+    // Наибольшее кратное MATRIX_ALIGN_ELEMS, для которого T^2 <= budget
+    while ((tile + MATRIX_ALIGN_ELEMS) * (tile + MATRIX_ALIGN_ELEMS) <= budget &&
+           tile + MATRIX_ALIGN_ELEMS <= (size_t) 1 << 20)
+        tile += MATRIX_ALIGN_ELEMS;
+
+    return (int) tile;
+}
+
+/**
+ * @brief Размер тайла index по оси длины total
+ */
+static int extent (int total, int tile, int index) {
+    int rest = total - index * tile;
+    return rest < tile ? rest : tile;
+}
+
+/**
+ * @brief Читает или пишет bytes байт целиком, повторяя частичные операции
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int transfer (int fd, void* buffer, size_t bytes, off_t pos, int write) {
+    char* p   = buffer;
+    int   res = 0;
+
+    while (bytes > 0 && res == 0) {
+        ssize_t done = write ? pwrite (fd, p, bytes, pos)
+                             : pread (fd, p, bytes, pos);
+        if (done > 0) {
+            p += done;
+            pos += done;
+            bytes -= (size_t) done;
+        } else {
+            res = -1;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief Передает тайл [row0, row0 + rows) x [col0, col0 + cols) файла
+ *
+ * @param file Файл матрицы
+ * @param buffer Буфер тайла с шагом строки ld
+ * @param write 0 - чтение в буфер, 1 - запись из буфера
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int transfer_tile (const OocFile* file, int row0, int col0, int rows,
+                          int cols, MATRIX_TYPE* buffer, int ld, int write) {
+    const off_t elem = (off_t) sizeof (MATRIX_TYPE);
+    const off_t base = (off_t) file->offset +
+                       ((off_t) row0 * file->stride + col0) * elem;
+    int         res  = 0;
+
+    if (col0 == 0 && cols == file->cols && ld == file->stride) {
+        // Тайл во всю ширину файла - один непрерывный участок
+        res = transfer (file->fd, buffer, (size_t) rows * ld * sizeof (MATRIX_TYPE),
+                        base, write);
+    } else {
+        for (int row = 0; row < rows && res == 0; row++) {
+            res = transfer (file->fd, buffer + (size_t) row * ld,
+                            (size_t) cols * sizeof (MATRIX_TYPE),
+                            base + (off_t) row * file->stride * elem, write);
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief Загружает тайлы A и B шага step в слот step % 2
+ */
+static int load_step (OocJob* job, long step) {
+    const int slot = (int) (step % 2);
+    const int tp   = (int) (step % job->tiles_k);
+    const int tj   = (int) (step / job->tiles_k % job->tiles_n);
+    const int ti   = (int) (step / job->tiles_k / job->tiles_n);
+    const int T    = job->tile;
+    const int mi   = extent (job->a.rows, T, ti);
+    const int nj   = extent (job->b.cols, T, tj);
+    const int kp   = extent (job->a.cols, T, tp);
+
+    int res = transfer_tile (&job->a, ti * T, tp * T, mi, kp, job->a_buf[slot],
+                             job->ld, 0);
+    if (res == 0)
+        res = transfer_tile (&job->b, tp * T, tj * T, kp, nj, job->b_buf[slot],
+                             job->ld, 0);
+
+    return res;
+}
+
+/**
+ * @brief Поток ввода-вывода: запись готовых тайлов C и загрузка A и B
+ */
+static void* io_main (void* arg) {
+    OocJob* job  = arg;
+    long    next = 0;
+
+    pthread_mutex_lock (&job->lock);
+    for (;;) {
+        if (job->write_pending) {
+            const int    T      = job->tile;
+            const int    ti     = job->write_ti;
+            const int    tj     = job->write_tj;
+            MATRIX_TYPE* buffer = job->c_buf[job->write_buffer];
+
+            pthread_mutex_unlock (&job->lock);
+            int res = transfer_tile (&job->c, ti * T, tj * T,
+                                     extent (job->c.rows, T, ti),
+                                     extent (job->c.cols, T, tj), buffer, job->ld,
+                                     1);
+            pthread_mutex_lock (&job->lock);
+
+            if (res != 0) job->failed = 1;
+            job->write_pending = 0;
+            pthread_cond_broadcast (&job->cond);
+        } else if (!job->failed && next < job->steps && next - job->consumed < 2) {
+            pthread_mutex_unlock (&job->lock);
+            int res = load_step (job, next);
+            pthread_mutex_lock (&job->lock);
+
+            if (res != 0) job->failed = 1;
+            job->loaded = ++next;
+            pthread_cond_broadcast (&job->cond);
+        } else if (job->finished) {
+            break;
+        } else {
+            pthread_cond_wait (&job->cond, &job->lock);
+        }
+    }
+    pthread_mutex_unlock (&job->lock);
+
+    return NULL;
+}
+
+/**
+ * @brief Основной цикл: считает шаги по мере загрузки и отдает тайлы C
+ *        на запись
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int compute (OocJob* job) {
+    const int T       = job->tile;
+    int       writing = -1;   // Буфер последнего отданного на запись тайла
+    int       acc     = 0;    // Буфер с накопленной суммой текущего тайла
+    int       res     = 0;
+
+    for (long step = 0; step < job->steps && res == 0; step++) {
+        const int slot = (int) (step % 2);
+        const int tp   = (int) (step % job->tiles_k);
+        const int tj   = (int) (step / job->tiles_k % job->tiles_n);
+        const int ti   = (int) (step / job->tiles_k / job->tiles_n);
+        const int mi   = extent (job->a.rows, T, ti);
+        const int nj   = extent (job->b.cols, T, tj);
+        const int kp   = extent (job->a.cols, T, tp);
+
+        pthread_mutex_lock (&job->lock);
+        while (job->loaded <= step && !job->failed)
+            pthread_cond_wait (&job->cond, &job->lock);
+        res = job->failed ? -1 : 0;
+        pthread_mutex_unlock (&job->lock);
+
+        if (res == 0 && tp == 0) {
+            acc = writing == 0 ? 1 : 0;
+            res = gemm_compute (0, 0, mi, nj, kp, job->a_buf[slot], job->ld,
+                                job->b_buf[slot], job->ld, job->c_buf[acc], job->ld,
+                                NULL);
+        } else if (res == 0) {
+            // Свободный буфер, не занятый ни суммой, ни записью
+            int          next     = 0;
+            GemmEpilogue epilogue = {1, {{job->c_buf[acc], job->ld, 1}}};
+
+            while (next == acc || next == writing) next++;
+
+            res = gemm_compute (0, 0, mi, nj, kp, job->a_buf[slot], job->ld,
+                                job->b_buf[slot], job->ld, job->c_buf[next], job->ld,
+                                &epilogue);
+            acc = next;
+        }
+
+        pthread_mutex_lock (&job->lock);
+        job->consumed = step + 1;
+        if (res == 0 && tp == job->tiles_k - 1) {
+            while (job->write_pending) pthread_cond_wait (&job->cond, &job->lock);
+            writing            = acc;
+            job->write_pending = 1;
+            job->write_buffer  = acc;
+            job->write_ti      = ti;
+            job->write_tj      = tj;
+        }
+        if (res != 0) job->failed = 1;
+        pthread_cond_broadcast (&job->cond);
+        pthread_mutex_unlock (&job->lock);
+    }
+
+    pthread_mutex_lock (&job->lock);
+    while (job->write_pending) pthread_cond_wait (&job->cond, &job->lock);
+    job->finished = 1;
+    if (job->failed) res = -1;
+    pthread_cond_broadcast (&job->cond);
+    pthread_mutex_unlock (&job->lock);
+
+    return res;
+}
+
+/**
+ * @brief Проверяет, что путь указывает на тот же файл, что и дескриптор
+ */
+static int same_file (const char* path, int fd) {
+    struct stat a, b;
+    return stat (path, &a) == 0 && fstat (fd, &b) == 0 && a.st_dev == b.st_dev &&
+           a.st_ino == b.st_ino;
+}
+
+/**
+ * @brief Вычисляет C = A x B для матриц в двоичных файлах
+ *
+ * @param a_file Файл матрицы A (m x k)
+ * @param b_file Файл матрицы B (k x n)
+ * @param result_file Файл результата (m x n)
+ * @param memory Объем памяти под тайлы в байтах, 0 - OOC_MEMORY_DEFAULT
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int ooc_multiply_files (const char* a_file, const char* b_file,
+                        const char* result_file, size_t memory) {
+    OocJob    job = {.a = {-1}, .b = {-1}, .c = {-1}};
+    pthread_t io;
+    int       res = -1;
+
+    job.a.fd = output_open_matrix_binary (a_file, &job.a.rows, &job.a.cols,
+                                          &job.a.stride, &job.a.offset);
+    job.b.fd = output_open_matrix_binary (b_file, &job.b.rows, &job.b.cols,
+                                          &job.b.stride, &job.b.offset);
+    job.tile = ooc_tile_size (memory);
+
+    if (job.a.fd >= 0 && job.b.fd >= 0 && job.tile > 0 && result_file != NULL &&
+        job.a.cols == job.b.rows && !same_file (result_file, job.a.fd) &&
+        !same_file (result_file, job.b.fd)) {
+        job.c.rows = job.a.rows;
+        job.c.cols = job.b.cols;
+        job.c.fd   = output_create_matrix_binary (result_file, job.c.rows,
+                                                  job.c.cols, &job.c.stride,
+                                                  &job.c.offset);
+    }
+
+    if (job.c.fd >= 0) {
+        // Тайл не больше самих матриц
+        int largest = job.a.rows > job.a.cols ? job.a.rows : job.a.cols;
+        if (job.b.cols > largest) largest = job.b.cols;
+        if (job.tile > MATRIX_STRIDE (largest)) job.tile = MATRIX_STRIDE (largest);
+
+        const size_t bytes =
+            (size_t) job.tile * MATRIX_STRIDE (job.tile) * sizeof (MATRIX_TYPE);
+
+        job.ld      = MATRIX_STRIDE (job.tile);
+        job.tiles_m = (job.a.rows + job.tile - 1) / job.tile;
+        job.tiles_n = (job.b.cols + job.tile - 1) / job.tile;
+        job.tiles_k = (job.a.cols + job.tile - 1) / job.tile;
+        job.steps   = (long) job.tiles_m * job.tiles_n * job.tiles_k;
+        res         = 0;
+
+        for (int i = 0; i < 2; i++) {
+            job.a_buf[i] = aligned_alloc (MATRIX_ALIGNMENT, bytes);
+            job.b_buf[i] = aligned_alloc (MATRIX_ALIGNMENT, bytes);
+            if (!job.a_buf[i] || !job.b_buf[i]) res = -1;
+        }
+        // Столбцы выравнивания тайла C GEMM не заполняет, а запись одним
+        // вызовом переносит строки целиком - обнуляем их один раз
+        for (int i = 0; i < 3; i++) {
+            job.c_buf[i] = aligned_alloc (MATRIX_ALIGNMENT, bytes);
+            if (job.c_buf[i]) memset (job.c_buf[i], 0, bytes);
+            else res = -1;
+        }
+    }
+
+    if (res == 0) {
+        pthread_mutex_init (&job.lock, NULL);
+        pthread_cond_init (&job.cond, NULL);
+
+        if (pthread_create (&io, NULL, io_main, &job) == 0) {
+            res = compute (&job);
+            pthread_join (io, NULL);
+        } else {
+            res = -1;
+        }
+
+        pthread_cond_destroy (&job.cond);
+        pthread_mutex_destroy (&job.lock);
+    }
+
+    for (int i = 0; i < 2; i++) {
+        free (job.a_buf[i]);
+        free (job.b_buf[i]);
+    }
+    for (int i = 0; i < 3; i++) free (job.c_buf[i]);
+
+    if (job.a.fd >= 0) close (job.a.fd);
+    if (job.b.fd >= 0) close (job.b.fd);
+    if (job.c.fd >= 0 && close (job.c.fd) != 0) res = -1;
+
+    return res;
+}
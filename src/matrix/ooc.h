@@ -0,0 +1,49 @@
+/**
+ * @file ooc.h
+ * @brief Умножение матриц, не помещающихся в память (out-of-core)
+ *
+ * @details
+ * Матрицы хранятся в двоичных файлах (output.h) и обрабатываются
+ * квадратными тайлами T x T. В памяти одновременно находятся только семь
+ * тайлов: по два тайла A и B (текущий и загружаемый фоновым потоком),
+ * два тайла накопления C и тайл C, который фоновый поток пишет на диск.
+ * Размер тайла выбирается по заданному объему памяти.
+ *
+ * Каждый тайл A читается tiles_n раз, тайл B - tiles_m раз, поэтому чем
+ * больше доступной памяти, тем меньше объем ввода-вывода.
+ *
+ * @see gemm.h output.h
+ */
+
+#ifndef OOC_H
+#define OOC_H
+
+#include "../../include/config.h"
+
+#include <stddef.h>
+
+/// Объем памяти под тайлы по умолчанию, байт
+#define OOC_MEMORY_DEFAULT ((size_t) 256 << 20)
+
+/**
+ * @brief Размер тайла для заданного объема памяти
+ * @param memory Объем памяти в байтах, 0 - OOC_MEMORY_DEFAULT
+ * @return Сторона тайла (кратна MATRIX_ALIGN_ELEMS) или 0, если памяти
+ * не хватает даже на минимальный тайл
+ */
+int ooc_tile_size (size_t memory);
+
+/**
+ * @brief Вычисляет C = A x B для матриц в двоичных файлах
+ * @param a_file Файл матрицы A (m x k)
+ * @param b_file Файл матрицы B (k x n)
+ * @param result_file Файл результата (m x n), создается или перезаписывается
+ * @param memory Объем памяти под тайлы в байтах, 0 - OOC_MEMORY_DEFAULT
+ * @note Файлы должны содержать double в порядке байт этой машины;
+ * result_file не должен совпадать с входными файлами
+ * @return 0 при успехе, -1 при ошибке
+ */
+int ooc_multiply_files (const char* a_file, const char* b_file,
+                        const char* result_file, size_t memory);
+
+#endif   // OOC_H
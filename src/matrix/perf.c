@@ -0,0 +1,173 @@
+/**
+ * @file perf.c
+ * @brief Реализация аппаратных счетчиков через perf_event_open
+ *
+ * @details
+ * Каждое событие открывается отдельным дескриптором без группы: группы
+ * несовместимы с наследованием счетчиков потоками, а отдельные события
+ * позволяют работать с тем подмножеством, которое есть на машине.
+ *
+ * @see perf.h
+ */
+
+// syscall () и SYS_perf_event_open объявлены только с расширениями GNU
+#define _GNU_SOURCE
+
+#include "perf.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#if defined(__linux__)
+#define PERF_LINUX 1
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#define PERF_LINUX 0
+#endif
+
+/// Имена событий в порядке MatrixPerfEvent
+static const char* const perf_names[MATRIX_PERF_EVENT_COUNT] = {
+    "cycles", "instructions", "L1D misses", "LLC misses", "branch misses"};
+
+/// Дескрипторы счетчиков, -1 - событие не открыто
+static atomic_int perf_fds[MATRIX_PERF_EVENT_COUNT] = {-1, -1, -1, -1, -1};
+
+/// Защищает открытие и закрытие
+static pthread_mutex_t perf_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#if PERF_LINUX
+
+/**
+ * @brief Тип и конфигурация события для perf_event_attr
+ */
+static void perf_config (MatrixPerfEvent event, uint32_t* type, uint64_t* config) {
+    const uint64_t l1d_read_miss =
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        ((uint64_t) PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    *type = PERF_TYPE_HARDWARE;
+    switch (event) {
+    case MATRIX_PERF_CYCLES: *config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case MATRIX_PERF_INSTRUCTIONS: *config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case MATRIX_PERF_L1D_MISSES:
+        *type   = PERF_TYPE_HW_CACHE;
+        *config = l1d_read_miss;
+        break;
+    case MATRIX_PERF_LLC_MISSES: *config = PERF_COUNT_HW_CACHE_MISSES; break;
+    default: *config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    }
+}
+
+/**
+ * @brief Открывает счетчик события для текущего потока и его потомков
+ *
+ * @return Дескриптор или -1
+ */
+static int perf_open_event (MatrixPerfEvent event) {
+    struct perf_event_attr attr;
+    uint32_t               type   = 0;
+    uint64_t               config = 0;
+
+    perf_config (event, &type, &config);
+    memset (&attr, 0, sizeof attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.size           = sizeof attr;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int) syscall (SYS_perf_event_open, &attr, 0, -1, -1,
+                          PERF_FLAG_FD_CLOEXEC);
+}
+
+/**
+ * @brief Читает значение счетчика с поправкой на деление регистров
+ */
+static uint64_t perf_read_event (int fd) {
+    uint64_t data[3] = {0};   // Значение, время включения, время счета
+    uint64_t res     = 0;
+
+    if (read (fd, data, sizeof data) == (ssize_t) sizeof data && data[2] > 0) {
+        res = data[2] < data[1]
+                ? (uint64_t) ((double) data[0] * (double) data[1] / (double) data[2])
+                : data[0];
+    }
+
+    return res;
+}
+
+#endif
+
+/**
+ * @brief Открывает счетчики всех событий
+ */
+int perf_open (void) {
+    pthread_mutex_lock (&perf_lock);
+#if PERF_LINUX
+    for (int event = 0; event < MATRIX_PERF_EVENT_COUNT; event++) {
+        if (atomic_load (&perf_fds[event]) < 0)
+            atomic_store (&perf_fds[event], perf_open_event (event));
+    }
+#endif
+    pthread_mutex_unlock (&perf_lock);
+
+    return perf_opened ();
+}
+
+/**
+ * @brief Закрывает счетчики
+ */
+void perf_close (void) {
+    pthread_mutex_lock (&perf_lock);
+    for (int event = 0; event < MATRIX_PERF_EVENT_COUNT; event++) {
+        const int fd = atomic_exchange (&perf_fds[event], -1);
+#if PERF_LINUX
+        if (fd >= 0) close (fd);
+#else
+        (void) fd;
+#endif
+    }
+    pthread_mutex_unlock (&perf_lock);
+}
+
+/**
+ * @brief Возвращает маску открытых событий
+ */
+int perf_opened (void) {
+    int res = 0;
+
+    for (int event = 0; event < MATRIX_PERF_EVENT_COUNT; event++) {
+        if (atomic_load (&perf_fds[event]) >= 0) res |= 1 << event;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Читает текущие значения счетчиков
+ */
+void perf_read (uint64_t values[MATRIX_PERF_EVENT_COUNT]) {
+    for (int event = 0; event < MATRIX_PERF_EVENT_COUNT; event++) {
+        const int fd  = atomic_load (&perf_fds[event]);
+        values[event] = 0;
+#if PERF_LINUX
+        if (fd >= 0) values[event] = perf_read_event (fd);
+#else
+        (void) fd;
+#endif
+    }
+}
+
+/**
+ * @brief Имя события для отчетов
+ */
+const char* perf_event_name (MatrixPerfEvent event) {
+    return event >= 0 && event < MATRIX_PERF_EVENT_COUNT ? perf_names[event]
+                                                         : "unknown";
+}
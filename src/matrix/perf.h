@@ -0,0 +1,67 @@
+/**
+ * @file perf.h
+ * @brief Аппаратные счетчики процессора через perf_event_open
+ *
+ * @details
+ * Счетчики открываются для вызывающего потока с наследованием: в них
+ * входят и потоки, созданные после открытия, поэтому при включении пул
+ * потоков перезапускается (рабочие потоки наследуют счетчики). Считается
+ * только пользовательский код. Если событий больше, чем регистров
+ * процессора, ядро делит регистры по времени, и perf_read () масштабирует
+ * значения по доле времени, когда событие считалось.
+ *
+ * Недоступные события (виртуальная машина без PMU, perf_event_paranoid,
+ * не Linux) не открываются; perf_opened () сообщает, какие события есть.
+ *
+ * @see stats.h
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+
+/**
+ * @brief Аппаратные события
+ */
+typedef enum {
+    MATRIX_PERF_CYCLES = 0,         ///< Такты процессора
+    MATRIX_PERF_INSTRUCTIONS,       ///< Выполненные инструкции
+    MATRIX_PERF_L1D_MISSES,         ///< Промахи чтения L1 данных
+    MATRIX_PERF_LLC_MISSES,         ///< Промахи последнего уровня кэша
+    MATRIX_PERF_BRANCH_MISSES,      ///< Ошибки предсказания переходов
+    MATRIX_PERF_EVENT_COUNT         ///< Число событий
+} MatrixPerfEvent;
+
+/**
+ * @brief Открывает счетчики всех событий
+ * @note Уже открытые счетчики не переоткрываются
+ * @return Маска открытых событий (бит 1 << MatrixPerfEvent), 0 - ни одного
+ */
+int perf_open (void);
+
+/**
+ * @brief Закрывает счетчики
+ */
+void perf_close (void);
+
+/**
+ * @brief Возвращает маску открытых событий
+ * @return Маска (бит 1 << MatrixPerfEvent)
+ */
+int perf_opened (void);
+
+/**
+ * @brief Читает текущие значения счетчиков
+ * @param values Значения по MatrixPerfEvent, 0 для неоткрытых событий
+ */
+void perf_read (uint64_t values[MATRIX_PERF_EVENT_COUNT]);
+
+/**
+ * @brief Имя события для отчетов ("cycles", "instructions", ...)
+ * @param event Событие
+ * @return Имя или "unknown"
+ */
+const char* perf_event_name (MatrixPerfEvent event);
+
+#endif   // PERF_H
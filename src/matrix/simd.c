@@ -0,0 +1,482 @@
+/**
+ * @file simd.c
+ * @brief Реализация векторных ядер и выбора уровня инструкций
+ *
+ * @details
+ * Каждая векторная функция собирается с атрибутом target для своего уровня,
+ * поэтому файл компилируется без флагов -m и выполняется на любом x86-64.
+ * Функция вызывается только после проверки cpuid.
+ *
+ * Размеры тайлов микроядер:
+ * - generic: 4 x 8
+ * - SSE2:    4 x 4 (8 регистров xmm под аккумуляторы)
+ * - AVX2:    6 x 8 (12 регистров ymm)
+ * - AVX-512: 8 x 16 (16 регистров zmm)
+ *
+ * @see simd.h
+ */
+
+#include "simd.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+// ==============================================================================
+//  Переносимые ядра
+// ==============================================================================
+
+static void gemm_kernel_generic (int kc, const double* a, const double* b,
+                                 double* C, int ldc, int first) {
+    double acc[4][8] = {{0}};
+
+    for (int p = 0; p < kc; p++) {
+        for (int i = 0; i < 4; i++) {
+            const double ai = a[i];
+            for (int j = 0; j < 8; j++) acc[i][j] += ai * b[j];
+        }
+        a += 4;
+        b += 8;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        double* c = C + (size_t) i * ldc;
+        for (int j = 0; j < 8; j++) c[j] = first ? acc[i][j] : c[j] + acc[i][j];
+    }
+}
+
+static void add_generic (int n, const double* a, const double* b, double* r) {
+    for (int i = 0; i < n; i++) r[i] = a[i] + b[i];
+}
+
+static void sub_generic (int n, const double* a, const double* b, double* r) {
+    for (int i = 0; i < n; i++) r[i] = a[i] - b[i];
+}
+
+static void axpby_generic (int n, double alpha, const double* x, double beta,
+                           double* y) {
+    if (beta == 0.0)
+        for (int i = 0; i < n; i++) y[i] = alpha * x[i];
+    else
+        for (int i = 0; i < n; i++) y[i] = alpha * x[i] + beta * y[i];
+}
+
+static void transpose_generic (const double* src, int lds, double* dst, int ldd) {
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            dst[(size_t) j * ldd + i] = src[(size_t) i * lds + j];
+        }
+    }
+}
+
+#if SIMD_X86
+
+// ==============================================================================
+//  SSE2
+// ==============================================================================
+
+__attribute__ ((target ("sse2"))) static void
+gemm_kernel_sse2 (int kc, const double* a, const double* b, double* C, int ldc,
+                  int first) {
+    __m128d acc[4][2];
+
+    for (int i = 0; i < 4; i++) acc[i][0] = acc[i][1] = _mm_setzero_pd ();
+
+    for (int p = 0; p < kc; p++) {
+        __m128d b0 = _mm_load_pd (b);
+        __m128d b1 = _mm_load_pd (b + 2);
+        for (int i = 0; i < 4; i++) {
+            __m128d ai = _mm_set1_pd (a[i]);
+            acc[i][0]  = _mm_add_pd (acc[i][0], _mm_mul_pd (ai, b0));
+            acc[i][1]  = _mm_add_pd (acc[i][1], _mm_mul_pd (ai, b1));
+        }
+        a += 4;
+        b += 4;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        double* c = C + (size_t) i * ldc;
+        if (!first) {
+            acc[i][0] = _mm_add_pd (acc[i][0], _mm_loadu_pd (c));
+            acc[i][1] = _mm_add_pd (acc[i][1], _mm_loadu_pd (c + 2));
+        }
+        _mm_storeu_pd (c, acc[i][0]);
+        _mm_storeu_pd (c + 2, acc[i][1]);
+    }
+}
+
+__attribute__ ((target ("sse2"))) static void add_sse2 (int n, const double* a,
+                                                        const double* b, double* r) {
+    int i = 0;
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd (r + i,
+                       _mm_add_pd (_mm_loadu_pd (a + i), _mm_loadu_pd (b + i)));
+    for (; i < n; i++) r[i] = a[i] + b[i];
+}
+
+__attribute__ ((target ("sse2"))) static void sub_sse2 (int n, const double* a,
+                                                        const double* b, double* r) {
+    int i = 0;
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd (r + i,
+                       _mm_sub_pd (_mm_loadu_pd (a + i), _mm_loadu_pd (b + i)));
+    for (; i < n; i++) r[i] = a[i] - b[i];
+}
+
+__attribute__ ((target ("sse2"))) static void
+axpby_sse2 (int n, double alpha, const double* x, double beta, double* y) {
+    const __m128d va = _mm_set1_pd (alpha);
+    const __m128d vb = _mm_set1_pd (beta);
+    int           i  = 0;
+
+    if (beta == 0.0) {
+        for (; i + 2 <= n; i += 2)
+            _mm_storeu_pd (y + i, _mm_mul_pd (va, _mm_loadu_pd (x + i)));
+    } else {
+        for (; i + 2 <= n; i += 2) {
+            __m128d ax = _mm_mul_pd (va, _mm_loadu_pd (x + i));
+            __m128d by = _mm_mul_pd (vb, _mm_loadu_pd (y + i));
+            _mm_storeu_pd (y + i, _mm_add_pd (ax, by));
+        }
+    }
+    axpby_generic (n - i, alpha, x + i, beta, y + i);
+}
+
+__attribute__ ((target ("sse2"))) static void
+transpose_sse2 (const double* src, int lds, double* dst, int ldd) {
+    __m128d r0 = _mm_loadu_pd (src);
+    __m128d r1 = _mm_loadu_pd (src + lds);
+    _mm_storeu_pd (dst, _mm_unpacklo_pd (r0, r1));
+    _mm_storeu_pd (dst + ldd, _mm_unpackhi_pd (r0, r1));
+}
+
+// ==============================================================================
+//  AVX2 + FMA
+// ==============================================================================
+
+__attribute__ ((target ("avx2,fma"))) static void
+gemm_kernel_avx2 (int kc, const double* a, const double* b, double* C, int ldc,
+                  int first) {
+    __m256d acc[6][2];
+
+    for (int i = 0; i < 6; i++) acc[i][0] = acc[i][1] = _mm256_setzero_pd ();
+
+    for (int p = 0; p < kc; p++) {
+        __m256d b0 = _mm256_load_pd (b);
+        __m256d b1 = _mm256_load_pd (b + 4);
+        for (int i = 0; i < 6; i++) {
+            __m256d ai = _mm256_broadcast_sd (a + i);
+            acc[i][0]  = _mm256_fmadd_pd (ai, b0, acc[i][0]);
+            acc[i][1]  = _mm256_fmadd_pd (ai, b1, acc[i][1]);
+        }
+        a += 6;
+        b += 8;
+    }
+
+    for (int i = 0; i < 6; i++) {
+        double* c = C + (size_t) i * ldc;
+        if (!first) {
+            acc[i][0] = _mm256_add_pd (acc[i][0], _mm256_loadu_pd (c));
+            acc[i][1] = _mm256_add_pd (acc[i][1], _mm256_loadu_pd (c + 4));
+        }
+        _mm256_storeu_pd (c, acc[i][0]);
+        _mm256_storeu_pd (c + 4, acc[i][1]);
+    }
+}
+
+__attribute__ ((target ("avx2"))) static void add_avx2 (int n, const double* a,
+                                                        const double* b, double* r) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm256_storeu_pd (r + i, _mm256_add_pd (_mm256_loadu_pd (a + i),
+                                                _mm256_loadu_pd (b + i)));
+    for (; i < n; i++) r[i] = a[i] + b[i];
+}
+
+__attribute__ ((target ("avx2"))) static void sub_avx2 (int n, const double* a,
+                                                        const double* b, double* r) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm256_storeu_pd (r + i, _mm256_sub_pd (_mm256_loadu_pd (a + i),
+                                                _mm256_loadu_pd (b + i)));
+    for (; i < n; i++) r[i] = a[i] - b[i];
+}
+
+__attribute__ ((target ("avx2,fma"))) static void
+axpby_avx2 (int n, double alpha, const double* x, double beta, double* y) {
+    const __m256d va = _mm256_set1_pd (alpha);
+    const __m256d vb = _mm256_set1_pd (beta);
+    int           i  = 0;
+
+    if (beta == 0.0) {
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd (y + i, _mm256_mul_pd (va, _mm256_loadu_pd (x + i)));
+    } else {
+        for (; i + 4 <= n; i += 4) {
+            __m256d by = _mm256_mul_pd (vb, _mm256_loadu_pd (y + i));
+            __m256d r  = _mm256_fmadd_pd (va, _mm256_loadu_pd (x + i), by);
+            _mm256_storeu_pd (y + i, r);
+        }
+    }
+    axpby_generic (n - i, alpha, x + i, beta, y + i);
+}
+
+__attribute__ ((target ("avx2"))) static void
+transpose_avx2 (const double* src, int lds, double* dst, int ldd) {
+    __m256d r0 = _mm256_loadu_pd (src);
+    __m256d r1 = _mm256_loadu_pd (src + lds);
+    __m256d r2 = _mm256_loadu_pd (src + 2 * (size_t) lds);
+    __m256d r3 = _mm256_loadu_pd (src + 3 * (size_t) lds);
+
+    __m256d t0 = _mm256_unpacklo_pd (r0, r1);
+    __m256d t1 = _mm256_unpackhi_pd (r0, r1);
+    __m256d t2 = _mm256_unpacklo_pd (r2, r3);
+    __m256d t3 = _mm256_unpackhi_pd (r2, r3);
+
+    _mm256_storeu_pd (dst, _mm256_permute2f128_pd (t0, t2, 0x20));
+    _mm256_storeu_pd (dst + ldd, _mm256_permute2f128_pd (t1, t3, 0x20));
+    _mm256_storeu_pd (dst + 2 * (size_t) ldd, _mm256_permute2f128_pd (t0, t2, 0x31));
+    _mm256_storeu_pd (dst + 3 * (size_t) ldd, _mm256_permute2f128_pd (t1, t3, 0x31));
+}
+
+// ==============================================================================
+//  AVX-512F
+// ==============================================================================
+
+__attribute__ ((target ("avx512f"))) static void
+gemm_kernel_avx512 (int kc, const double* a, const double* b, double* C, int ldc,
+                    int first) {
+    __m512d acc[8][2];
+
+    for (int i = 0; i < 8; i++) acc[i][0] = acc[i][1] = _mm512_setzero_pd ();
+
+    for (int p = 0; p < kc; p++) {
+        __m512d b0 = _mm512_load_pd (b);
+        __m512d b1 = _mm512_load_pd (b + 8);
+        for (int i = 0; i < 8; i++) {
+            __m512d ai = _mm512_set1_pd (a[i]);
+            acc[i][0]  = _mm512_fmadd_pd (ai, b0, acc[i][0]);
+            acc[i][1]  = _mm512_fmadd_pd (ai, b1, acc[i][1]);
+        }
+        a += 8;
+        b += 16;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        double* c = C + (size_t) i * ldc;
+        if (!first) {
+            acc[i][0] = _mm512_add_pd (acc[i][0], _mm512_loadu_pd (c));
+            acc[i][1] = _mm512_add_pd (acc[i][1], _mm512_loadu_pd (c + 8));
+        }
+        _mm512_storeu_pd (c, acc[i][0]);
+        _mm512_storeu_pd (c + 8, acc[i][1]);
+    }
+}
+
+__attribute__ ((target ("avx512f"))) static void
+add_avx512 (int n, const double* a, const double* b, double* r) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm512_storeu_pd (r + i, _mm512_add_pd (_mm512_loadu_pd (a + i),
+                                                _mm512_loadu_pd (b + i)));
+    if (i < n) {
+        __mmask8 tail = (__mmask8) ((1u << (n - i)) - 1);
+        _mm512_mask_storeu_pd (r + i, tail,
+                               _mm512_add_pd (_mm512_maskz_loadu_pd (tail, a + i),
+                                              _mm512_maskz_loadu_pd (tail, b + i)));
+    }
+}
+
+__attribute__ ((target ("avx512f"))) static void
+sub_avx512 (int n, const double* a, const double* b, double* r) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm512_storeu_pd (r + i, _mm512_sub_pd (_mm512_loadu_pd (a + i),
+                                                _mm512_loadu_pd (b + i)));
+    if (i < n) {
+        __mmask8 tail = (__mmask8) ((1u << (n - i)) - 1);
+        _mm512_mask_storeu_pd (r + i, tail,
+                               _mm512_sub_pd (_mm512_maskz_loadu_pd (tail, a + i),
+                                              _mm512_maskz_loadu_pd (tail, b + i)));
+    }
+}
+
+__attribute__ ((target ("avx512f"))) static void
+axpby_avx512 (int n, double alpha, const double* x, double beta, double* y) {
+    const __m512d va = _mm512_set1_pd (alpha);
+    const __m512d vb = _mm512_set1_pd (beta);
+    int           i  = 0;
+
+    for (; i < n; i += 8) {
+        const __mmask8 mask = n - i >= 8 ? 0xFF : (__mmask8) ((1u << (n - i)) - 1);
+        __m512d        r    = _mm512_maskz_loadu_pd (mask, x + i);
+
+        r = _mm512_mul_pd (va, r);
+        if (beta != 0.0)
+            r = _mm512_fmadd_pd (vb, _mm512_maskz_loadu_pd (mask, y + i), r);
+        _mm512_mask_storeu_pd (y + i, mask, r);
+    }
+}
+
+/**
+ * @brief Транспонирование блока 8 x 8
+ *
+ * Сначала unpack переставляет пары соседних строк, затем два шага
+ * shuffle_f64x2 собирают 128-битные дорожки в столбцы.
+ */
+__attribute__ ((target ("avx512f"))) static void
+transpose_avx512 (const double* src, int lds, double* dst, int ldd) {
+    __m512d r[8], t[8], u[8];
+
+    for (int i = 0; i < 8; i++) r[i] = _mm512_loadu_pd (src + (size_t) i * lds);
+
+    for (int i = 0; i < 8; i += 2) {
+        t[i]     = _mm512_unpacklo_pd (r[i], r[i + 1]);
+        t[i + 1] = _mm512_unpackhi_pd (r[i], r[i + 1]);
+    }
+
+    // u[0..3] - строки 0-3, u[4..7] - строки 4-7
+    for (int h = 0; h < 8; h += 4) {
+        u[h + 0] = _mm512_shuffle_f64x2 (t[h + 0], t[h + 2], 0x88);   // столбцы 0, 4
+        u[h + 1] = _mm512_shuffle_f64x2 (t[h + 0], t[h + 2], 0xDD);   // столбцы 2, 6
+        u[h + 2] = _mm512_shuffle_f64x2 (t[h + 1], t[h + 3], 0x88);   // столбцы 1, 5
+        u[h + 3] = _mm512_shuffle_f64x2 (t[h + 1], t[h + 3], 0xDD);   // столбцы 3, 7
+    }
+
+    static const int column[4] = {0, 2, 1, 3};
+    for (int q = 0; q < 4; q++) {
+        double* lo = dst + (size_t) column[q] * ldd;
+        double* hi = dst + (size_t) (column[q] + 4) * ldd;
+        _mm512_storeu_pd (lo, _mm512_shuffle_f64x2 (u[q], u[q + 4], 0x88));
+        _mm512_storeu_pd (hi, _mm512_shuffle_f64x2 (u[q], u[q + 4], 0xDD));
+    }
+}
+
+#endif   // SIMD_X86
+
+// ==============================================================================
+//  Таблицы ядер и выбор уровня
+// ==============================================================================
+
+static const SimdKernels simd_table[SIMD_LEVEL_COUNT] = {
+    {SIMD_GENERIC, "generic", 4, 8, gemm_kernel_generic, add_generic, sub_generic,
+     axpby_generic, 4, transpose_generic},
+#if SIMD_X86
+    {SIMD_SSE2, "sse2", 4, 4, gemm_kernel_sse2, add_sse2, sub_sse2, axpby_sse2, 2,
+     transpose_sse2},
+    {SIMD_AVX2, "avx2", 6, 8, gemm_kernel_avx2, add_avx2, sub_avx2, axpby_avx2, 4,
+     transpose_avx2},
+    {SIMD_AVX512, "avx512", 8, 16, gemm_kernel_avx512, add_avx512, sub_avx512,
+     axpby_avx512, 8, transpose_avx512},
+#endif
+};
+
+/// Выбранная таблица, NULL до первого обращения
+static _Atomic (const SimdKernels*) simd_active = NULL;
+
+/**
+ * @brief Проверяет, поддерживает ли процессор заданный уровень
+ *
+ * @param level Уровень инструкций
+ *
+ * @return 1 если поддерживается, иначе 0
+ */
+int simd_supported (SimdLevel level) {
+    int res = 0;
+
+    switch (level) {
+    case SIMD_GENERIC: res = 1; break;
+#if SIMD_X86
+    case SIMD_SSE2: res = __builtin_cpu_supports ("sse2"); break;
+    case SIMD_AVX2:
+        res = __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+        break;
+    case SIMD_AVX512: res = __builtin_cpu_supports ("avx512f"); break;
+#endif
+    default: res = 0; break;
+    }
+
+    return res != 0;
+}
+
+/**
+ * @brief Возвращает таблицу ядер заданного уровня
+ *
+ * @param level Уровень инструкций
+ *
+ * @return Указатель на таблицу или NULL, если уровень не поддерживается
+ */
+const SimdKernels* simd_kernels_for (SimdLevel level) {
+    const SimdKernels* res = NULL;
+
+    if (level >= SIMD_GENERIC && level < SIMD_LEVEL_COUNT &&
+        simd_supported (level) && simd_table[level].gemm_kernel != NULL) {
+        res = &simd_table[level];
+    }
+
+    return res;
+}
+
+/**
+ * @brief Определяет уровень по cpuid с учетом ограничения MATRIX_SIMD
+ */
+static const SimdKernels* simd_detect (void) {
+    const char* env   = getenv ("MATRIX_SIMD");
+    int         limit = SIMD_LEVEL_COUNT - 1;
+
+    if (env) {
+        for (int level = 0; level < SIMD_LEVEL_COUNT; level++) {
+            if (simd_table[level].name && strcmp (env, simd_table[level].name) == 0)
+                limit = level;
+        }
+    }
+
+    const SimdKernels* res = &simd_table[SIMD_GENERIC];
+    for (int level = limit; level > SIMD_GENERIC && res->level == SIMD_GENERIC;
+         level--) {
+        const SimdKernels* candidate = simd_kernels_for ((SimdLevel) level);
+        if (candidate) res = candidate;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Возвращает ядра, выбранные для текущего процессора
+ *
+ * @return Указатель на таблицу ядер
+ */
+const SimdKernels* simd_kernels (void) {
+    const SimdKernels* res =
+        atomic_load_explicit (&simd_active, memory_order_acquire);
+
+    if (!res) {
+        res = simd_detect ();
+        atomic_store_explicit (&simd_active, res, memory_order_release);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Принудительно выбирает уровень инструкций
+ *
+ * @param level Уровень инструкций
+ *
+ * @return 0 при успехе, -1 если процессор уровень не поддерживает
+ */
+int simd_select (SimdLevel level) {
+    const SimdKernels* kernels = simd_kernels_for (level);
+    int                res     = -1;
+
+    if (kernels) {
+        atomic_store_explicit (&simd_active, kernels, memory_order_release);
+        res = 0;
+    }
+
+    return res;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file simd.h
+ * @brief Векторные ядра с выбором реализации во время выполнения
+ *
+ * @details
+ * Для горячих операций есть несколько реализаций:
+ * - generic - переносимый C
+ * - SSE2
+ * - AVX2 + FMA
+ * - AVX-512F
+ *
+ * При первом обращении набор инструкций процессора определяется через
+ * cpuid и выбирается самая широкая доступная реализация. Все варианты
+ * собираются в один бинарный файл через атрибут target, поэтому пересборка
+ * под конкретную машину не нужна.
+ *
+ * Переменная окружения MATRIX_SIMD (generic, sse2, avx2, avx512) ограничивает
+ * выбор сверху.
+ *
+ * @note Ядра рассчитаны на MATRIX_TYPE = double
+ *
+ * @see gemm.h matrix.h
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+/// 1 на x86 и x86-64: собираются варианты ядер с атрибутом target
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+/**
+ * @brief Автовекторизация функции, написанной простыми циклами
+ *
+ * Сборка -O2 не векторизует циклы, поэтому ядрам на простых циклах
+ * (dtype.c, batch.c, small.c) векторизация включается явно, а варианты
+ * AVX2 добавляют к ней target ("avx2,fma").
+ */
+#define SIMD_VECTORIZE __attribute__ ((optimize ("tree-vectorize")))
+
+/// Максимальная высота тайла микроядра среди всех реализаций
+#define SIMD_GEMM_MR_MAX 8
+
+/// Максимальная ширина тайла микроядра среди всех реализаций
+#define SIMD_GEMM_NR_MAX 16
+
+/**
+ * @enum SimdLevel
+ * @brief Уровни набора векторных инструкций
+ */
+typedef enum {
+    SIMD_GENERIC = 0,   ///< Без векторных инструкций
+    SIMD_SSE2,          ///< SSE2
+    SIMD_AVX2,          ///< AVX2 + FMA
+    SIMD_AVX512,        ///< AVX-512F
+    SIMD_LEVEL_COUNT    ///< Количество уровней
+} SimdLevel;
+
+/**
+ * @brief Микроядро GEMM: полный тайл mr x nr из упакованных полосок
+ * @param kc Глубина
+ * @param a Полоска A (kc x mr), для каждого p подряд mr значений
+ * @param b Полоска B (kc x nr), для каждого p подряд nr значений
+ * @param C Левый верхний угол тайла
+ * @param ldc Шаг строки C
+ * @param first 1 - записать тайл, 0 - прибавить к C
+ */
+typedef void (*SimdGemmKernel) (int kc, const double* a, const double* b, double* C,
+                                int ldc, int first);
+
+/**
+ * @brief Поэлементная операция над строкой: r[i] = a[i] op b[i]
+ */
+typedef void (*SimdRowOp) (int n, const double* a, const double* b, double* r);
+
+/**
+ * @brief Линейная комбинация строк: y[i] = alpha * x[i] + beta * y[i]
+ *
+ * При beta == 0 строка y не читается. x и y могут совпадать.
+ */
+typedef void (*SimdRowAxpby) (int n, double alpha, const double* x, double beta,
+                              double* y);
+
+/**
+ * @brief Транспонирование квадратного блока transpose_block x transpose_block
+ */
+typedef void (*SimdTransposeBlock) (const double* src, int lds, double* dst,
+                                    int ldd);
+
+/**
+ * @struct SimdKernels
+ * @brief Таблица ядер одного уровня инструкций
+ */
+typedef struct {
+    SimdLevel          level;             ///< Уровень инструкций
+    const char*        name;              ///< Имя уровня
+    int                gemm_mr;           ///< Высота тайла микроядра
+    int                gemm_nr;           ///< Ширина тайла микроядра
+    SimdGemmKernel     gemm_kernel;       ///< Микроядро GEMM
+    SimdRowOp          add;               ///< Сложение строк
+    SimdRowOp          sub;               ///< Вычитание строк
+    SimdRowAxpby       axpby;             ///< Линейная комбинация строк
+    int                transpose_block;   ///< Размер блока транспонирования
+    SimdTransposeBlock transpose;         ///< Транспонирование блока
+} SimdKernels;
+
+/**
+ * @brief Возвращает ядра, выбранные для текущего процессора
+ * @return Указатель на таблицу ядер (не NULL)
+ */
+const SimdKernels* simd_kernels (void);
+
+/**
+ * @brief Проверяет, поддерживает ли процессор заданный уровень
+ * @param level Уровень инструкций
+ * @return 1 если поддерживается, иначе 0
+ */
+int simd_supported (SimdLevel level);
+
+/**
+ * @brief Возвращает таблицу ядер заданного уровня
+ * @param level Уровень инструкций
+ * @return Указатель на таблицу или NULL, если уровень не поддерживается
+ */
+const SimdKernels* simd_kernels_for (SimdLevel level);
+
+/**
+ * @brief Принудительно выбирает уровень инструкций
+ * @param level Уровень инструкций
+ * @return 0 при успехе, -1 если процессор уровень не поддерживает
+ */
+int simd_select (SimdLevel level);
+
+#endif   // SIMD_H
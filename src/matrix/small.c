@@ -0,0 +1,457 @@
+/**
+ * @file small.c
+ * @brief Ядра фиксированных размеров 2 x 2 ... 8 x 8
+ *
+ * @details
+ * Ядра каждого размера порождают макросы SMALL_LINEAR (n) и SMALL_GAUSS (n):
+ * размер в них - константа, и циклы разворачиваются полностью (SMALL_UNROLL).
+ * Умножение копит строку результата в массиве из n элементов, который
+ * после развертки целиком лежит в регистрах: строка B складывается с
+ * весом a[i][k] векторными операциями.
+ *
+ * Детерминант и обращение 2 x 2, 3 x 3 и 4 x 4 записаны явными формулами
+ * без ветвлений. Для 4 x 4 обе операции строятся из двенадцати миноров
+ * 2 x 2 (по шесть из верхней и нижней пары строк): детерминант - сумма
+ * их попарных произведений, присоединенная матрица - их комбинации. Для
+ * 5 x 5 ... 8 x 8 - исключение Гаусса (Жордана для обращения) с частичным
+ * выбором ведущего элемента на копии в стеке.
+ *
+ * @see small.h
+ */
+
+#include "small.h"
+
+#include "simd.h"
+
+#include <math.h>
+#include <stddef.h>
+
+/// Полная развертка цикла с постоянным числом шагов (не больше SMALL_MAX)
+#define SMALL_UNROLL _Pragma ("GCC unroll 8")
+
+/// Элемент (i, j) матрицы с шагом строки ld
+#define SMALL_AT(p, ld, i, j) ((p)[(size_t) (i) * (size_t) (ld) + (size_t) (j)])
+
+/**
+ * @brief Умножение и транспонирование размера n с атрибутами attr
+ */
+#define SMALL_LINEAR(n, name, attr)                                                \
+    attr static void multiply_##n##_##name (const MATRIX_TYPE* A, int lda,         \
+                                            const MATRIX_TYPE* B, int ldb,         \
+                                            MATRIX_TYPE* C, int ldc) {             \
+        SMALL_UNROLL                                                               \
+        for (int i = 0; i < n; i++) {                                              \
+            MATRIX_TYPE r[n];                                                      \
+            SMALL_UNROLL                                                           \
+            for (int j = 0; j < n; j++)                                            \
+                r[j] = SMALL_AT (A, lda, i, 0) * SMALL_AT (B, ldb, 0, j);          \
+            SMALL_UNROLL                                                           \
+            for (int k = 1; k < n; k++) {                                          \
+                SMALL_UNROLL                                                       \
+                for (int j = 0; j < n; j++)                                        \
+                    r[j] += SMALL_AT (A, lda, i, k) * SMALL_AT (B, ldb, k, j);     \
+            }                                                                      \
+            SMALL_UNROLL                                                           \
+            for (int j = 0; j < n; j++) SMALL_AT (C, ldc, i, j) = r[j];            \
+        }                                                                          \
+    }                                                                              \
+                                                                                   \
+    attr static void transpose_##n##_##name (const MATRIX_TYPE* A, int lda,        \
+                                             MATRIX_TYPE* R, int ldr) {            \
+        SMALL_UNROLL                                                               \
+        for (int i = 0; i < n; i++) {                                              \
+            SMALL_UNROLL                                                           \
+            for (int j = 0; j < n; j++)                                            \
+                SMALL_AT (R, ldr, j, i) = SMALL_AT (A, lda, i, j);                 \
+        }                                                                          \
+    }                                                                              \
+                                                                                   \
+    attr static void transpose_inplace_##n##_##name (MATRIX_TYPE* A, int lda) {    \
+        SMALL_UNROLL                                                               \
+        for (int i = 0; i < n; i++) {                                              \
+            SMALL_UNROLL                                                           \
+            for (int j = i + 1; j < n; j++) {                                      \
+                const MATRIX_TYPE tmp   = SMALL_AT (A, lda, i, j);                 \
+                SMALL_AT (A, lda, i, j) = SMALL_AT (A, lda, j, i);                 \
+                SMALL_AT (A, lda, j, i) = tmp;                                     \
+            }                                                                      \
+        }                                                                          \
+    }
+
+/**
+ * @brief Детерминант и обращение размера n исключением Гаусса
+ *
+ * Строки копии a переставляются вместе со строками r, ведущая строка
+ * нормируется умножением на обратный ведущий элемент.
+ */
+#define SMALL_GAUSS(n)                                                             \
+    static MATRIX_TYPE determinant_##n (const MATRIX_TYPE* A, int lda) {           \
+        MATRIX_TYPE a[n][n];                                                       \
+        MATRIX_TYPE det = 1;                                                       \
+                                                                                   \
+        SMALL_UNROLL                                                               \
+        for (int i = 0; i < n; i++) {                                              \
+            SMALL_UNROLL                                                           \
+            for (int j = 0; j < n; j++) a[i][j] = SMALL_AT (A, lda, i, j);         \
+        }                                                                          \
+                                                                                   \
+        SMALL_UNROLL                                                               \
+        for (int col = 0; col < n && det != 0; col++) {                            \
+            int         pivot = col;                                               \
+            MATRIX_TYPE best  = fabs (a[col][col]);                                \
+            SMALL_UNROLL                                                           \
+            for (int row = col + 1; row < n; row++) {                              \
+                if (fabs (a[row][col]) > best) {                                   \
+                    best  = fabs (a[row][col]);                                    \
+                    pivot = row;                                                   \
+                }                                                                  \
+            }                                                                      \
+                                                                                   \
+            if (best == 0) det = 0;                                                \
+            else {                                                                 \
+                if (pivot != col) {                                                \
+                    SMALL_UNROLL                                                   \
+                    for (int j = col; j < n; j++) {                                \
+                        const MATRIX_TYPE tmp = a[col][j];                         \
+                        a[col][j]             = a[pivot][j];                       \
+                        a[pivot][j]           = tmp;                               \
+                    }                                                              \
+                    det = -det;                                                    \
+                }                                                                  \
+                                                                                   \
+                const MATRIX_TYPE inv = 1 / a[col][col];                           \
+                det *= a[col][col];                                                \
+                SMALL_UNROLL                                                       \
+                for (int row = col + 1; row < n; row++) {                          \
+                    const MATRIX_TYPE factor = a[row][col] * inv;                  \
+                    SMALL_UNROLL                                                   \
+                    for (int j = col + 1; j < n; j++)                              \
+                        a[row][j] -= factor * a[col][j];                           \
+                }                                                                  \
+            }                                                                      \
+        }                                                                          \
+                                                                                   \
+        return det;                                                                \
+    }                                                                              \
+                                                                                   \
+    static int inverse_##n (const MATRIX_TYPE* A, int lda, MATRIX_TYPE* R,         \
+                            int ldr) {                                             \
+        MATRIX_TYPE a[n][n];                                                       \
+        MATRIX_TYPE r[n][n];                                                       \
+        int         res = 0;                                                       \
+                                                                                   \
+        SMALL_UNROLL                                                               \
+        for (int i = 0; i < n; i++) {                                              \
+            SMALL_UNROLL                                                           \
+            for (int j = 0; j < n; j++) {                                          \
+                a[i][j] = SMALL_AT (A, lda, i, j);                                 \
+                r[i][j] = i == j;                                                  \
+            }                                                                      \
+        }                                                                          \
+                                                                                   \
+        SMALL_UNROLL                                                               \
+        for (int col = 0; col < n && res == 0; col++) {                            \
+            int         pivot = col;                                               \
+            MATRIX_TYPE best  = fabs (a[col][col]);                                \
+            SMALL_UNROLL                                                           \
+            for (int row = col + 1; row < n; row++) {                              \
+                if (fabs (a[row][col]) > best) {                                   \
+                    best  = fabs (a[row][col]);                                    \
+                    pivot = row;                                                   \
+                }                                                                  \
+            }                                                                      \
+                                                                                   \
+            if (best == 0) res = -1;                                               \
+            else {                                                                 \
+                if (pivot != col) {                                                \
+                    SMALL_UNROLL                                                   \
+                    for (int j = 0; j < n; j++) {                                  \
+                        const MATRIX_TYPE ta = a[col][j];                          \
+                        const MATRIX_TYPE tr = r[col][j];                          \
+                        a[col][j]            = a[pivot][j];                        \
+                        r[col][j]            = r[pivot][j];                        \
+                        a[pivot][j]          = ta;                                 \
+                        r[pivot][j]          = tr;                                 \
+                    }                                                              \
+                }                                                                  \
+                                                                                   \
+                const MATRIX_TYPE inv = 1 / a[col][col];                           \
+                SMALL_UNROLL                                                       \
+                for (int j = 0; j < n; j++) {                                      \
+                    a[col][j] *= inv;                                              \
+                    r[col][j] *= inv;                                              \
+                }                                                                  \
+                SMALL_UNROLL                                                       \
+                for (int row = 0; row < n; row++) {                                \
+                    const MATRIX_TYPE factor = row == col ? 0 : a[row][col];       \
+                    SMALL_UNROLL                                                   \
+                    for (int j = 0; j < n; j++) {                                  \
+                        a[row][j] -= factor * a[col][j];                           \
+                        r[row][j] -= factor * r[col][j];                           \
+                    }                                                              \
+                }                                                                  \
+            }                                                                      \
+        }                                                                          \
+                                                                                   \
+        if (res == 0) {                                                            \
+            SMALL_UNROLL                                                           \
+            for (int i = 0; i < n; i++) {                                          \
+                SMALL_UNROLL                                                       \
+                for (int j = 0; j < n; j++) SMALL_AT (R, ldr, i, j) = r[i][j];     \
+            }                                                                      \
+        }                                                                          \
+                                                                                   \
+        return res;                                                                \
+    }
+
+/// Все линейные ядра одного варианта сборки
+#define SMALL_LINEAR_ALL(name, attr)                                               \
+    SMALL_LINEAR (2, name, attr)                                                   \
+    SMALL_LINEAR (3, name, attr)                                                   \
+    SMALL_LINEAR (4, name, attr)                                                   \
+    SMALL_LINEAR (5, name, attr)                                                   \
+    SMALL_LINEAR (6, name, attr)                                                   \
+    SMALL_LINEAR (7, name, attr)                                                   \
+    SMALL_LINEAR (8, name, attr)
+
+SMALL_LINEAR_ALL (generic, SIMD_VECTORIZE)
+
+#if SIMD_X86
+SMALL_LINEAR_ALL (avx2, SIMD_VECTORIZE __attribute__ ((target ("avx2,fma"))))
+#endif
+
+SMALL_GAUSS (5)
+SMALL_GAUSS (6)
+SMALL_GAUSS (7)
+SMALL_GAUSS (8)
+
+/**
+ * @brief Детерминант 2 x 2
+ */
+static MATRIX_TYPE determinant_2 (const MATRIX_TYPE* A, int lda) {
+    return SMALL_AT (A, lda, 0, 0) * SMALL_AT (A, lda, 1, 1) -
+           SMALL_AT (A, lda, 0, 1) * SMALL_AT (A, lda, 1, 0);
+}
+
+/**
+ * @brief Обращение 2 x 2 через присоединенную матрицу
+ */
+static int inverse_2 (const MATRIX_TYPE* A, int lda, MATRIX_TYPE* R, int ldr) {
+    const MATRIX_TYPE a   = SMALL_AT (A, lda, 0, 0);
+    const MATRIX_TYPE b   = SMALL_AT (A, lda, 0, 1);
+    const MATRIX_TYPE c   = SMALL_AT (A, lda, 1, 0);
+    const MATRIX_TYPE d   = SMALL_AT (A, lda, 1, 1);
+    const MATRIX_TYPE det = a * d - b * c;
+    int               res = -1;
+
+    if (det != 0) {
+        const MATRIX_TYPE inv   = 1 / det;
+        SMALL_AT (R, ldr, 0, 0) = d * inv;
+        SMALL_AT (R, ldr, 0, 1) = -b * inv;
+        SMALL_AT (R, ldr, 1, 0) = -c * inv;
+        SMALL_AT (R, ldr, 1, 1) = a * inv;
+        res                     = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Детерминант 3 x 3 разложением по первой строке
+ */
+static MATRIX_TYPE determinant_3 (const MATRIX_TYPE* A, int lda) {
+    const MATRIX_TYPE* r0 = A;
+    const MATRIX_TYPE* r1 = A + lda;
+    const MATRIX_TYPE* r2 = A + 2 * (size_t) lda;
+
+    return r0[0] * (r1[1] * r2[2] - r1[2] * r2[1]) -
+           r0[1] * (r1[0] * r2[2] - r1[2] * r2[0]) +
+           r0[2] * (r1[0] * r2[1] - r1[1] * r2[0]);
+}
+
+/**
+ * @brief Обращение 3 x 3 через присоединенную матрицу
+ */
+static int inverse_3 (const MATRIX_TYPE* A, int lda, MATRIX_TYPE* R, int ldr) {
+    const MATRIX_TYPE a = SMALL_AT (A, lda, 0, 0), b = SMALL_AT (A, lda, 0, 1);
+    const MATRIX_TYPE c = SMALL_AT (A, lda, 0, 2), d = SMALL_AT (A, lda, 1, 0);
+    const MATRIX_TYPE e = SMALL_AT (A, lda, 1, 1), f = SMALL_AT (A, lda, 1, 2);
+    const MATRIX_TYPE g = SMALL_AT (A, lda, 2, 0), h = SMALL_AT (A, lda, 2, 1);
+    const MATRIX_TYPE i = SMALL_AT (A, lda, 2, 2);
+
+    // Алгебраические дополнения первой строки
+    const MATRIX_TYPE c0  = e * i - f * h;
+    const MATRIX_TYPE c1  = f * g - d * i;
+    const MATRIX_TYPE c2  = d * h - e * g;
+    const MATRIX_TYPE det = a * c0 + b * c1 + c * c2;
+    int               res = -1;
+
+    if (det != 0) {
+        const MATRIX_TYPE inv   = 1 / det;
+        SMALL_AT (R, ldr, 0, 0) = c0 * inv;
+        SMALL_AT (R, ldr, 0, 1) = (c * h - b * i) * inv;
+        SMALL_AT (R, ldr, 0, 2) = (b * f - c * e) * inv;
+        SMALL_AT (R, ldr, 1, 0) = c1 * inv;
+        SMALL_AT (R, ldr, 1, 1) = (a * i - c * g) * inv;
+        SMALL_AT (R, ldr, 1, 2) = (c * d - a * f) * inv;
+        SMALL_AT (R, ldr, 2, 0) = c2 * inv;
+        SMALL_AT (R, ldr, 2, 1) = (b * g - a * h) * inv;
+        SMALL_AT (R, ldr, 2, 2) = (a * e - b * d) * inv;
+        res                     = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @struct SmallMinors
+ * @brief Миноры 2 x 2 матрицы 4 x 4
+ *
+ * s - из строк 0 и 1, c - из строк 2 и 3; индекс - пара столбцов
+ * (01, 02, 03, 12, 13, 23) для s и обратный порядок пар для c.
+ */
+typedef struct {
+    MATRIX_TYPE s[6];   ///< Миноры верхней пары строк
+    MATRIX_TYPE c[6];   ///< Миноры нижней пары строк
+} SmallMinors;
+
+/**
+ * @brief Считает миноры 2 x 2 матрицы 4 x 4 (строки a)
+ */
+static inline SmallMinors minors_4 (const MATRIX_TYPE a[4][4]) {
+    SmallMinors m;
+
+    m.s[0] = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+    m.s[1] = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+    m.s[2] = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+    m.s[3] = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+    m.s[4] = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+    m.s[5] = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+    m.c[5] = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+    m.c[4] = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+    m.c[3] = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+    m.c[2] = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+    m.c[1] = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+    m.c[0] = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+    return m;
+}
+
+/**
+ * @brief Детерминант по минорам 2 x 2 (теорема Лапласа для пар строк)
+ */
+static inline MATRIX_TYPE minors_det (const SmallMinors* m) {
+    return m->s[0] * m->c[5] - m->s[1] * m->c[4] + m->s[2] * m->c[3] +
+           m->s[3] * m->c[2] - m->s[4] * m->c[1] + m->s[5] * m->c[0];
+}
+
+/**
+ * @brief Копирует матрицу 4 x 4 в локальный массив
+ */
+static inline void load_4 (const MATRIX_TYPE* A, int lda, MATRIX_TYPE a[4][4]) {
+    SMALL_UNROLL
+    for (int i = 0; i < 4; i++) {
+        SMALL_UNROLL
+        for (int j = 0; j < 4; j++) a[i][j] = SMALL_AT (A, lda, i, j);
+    }
+}
+
+/**
+ * @brief Детерминант 4 x 4 по минорам 2 x 2
+ */
+static MATRIX_TYPE determinant_4 (const MATRIX_TYPE* A, int lda) {
+    MATRIX_TYPE a[4][4];
+
+    load_4 (A, lda, a);
+    const SmallMinors m = minors_4 (a);
+
+    return minors_det (&m);
+}
+
+/**
+ * @brief Обращение 4 x 4: присоединенная матрица из миноров 2 x 2
+ */
+static int inverse_4 (const MATRIX_TYPE* A, int lda, MATRIX_TYPE* R, int ldr) {
+    MATRIX_TYPE a[4][4];
+    int         res = -1;
+
+    load_4 (A, lda, a);
+    const SmallMinors  m   = minors_4 (a);
+    const MATRIX_TYPE  det = minors_det (&m);
+    const MATRIX_TYPE* s   = m.s;
+    const MATRIX_TYPE* c   = m.c;
+
+    if (det != 0) {
+        const MATRIX_TYPE inv     = 1 / det;
+        const MATRIX_TYPE r[4][4] = {
+            {a[1][1] * c[5] - a[1][2] * c[4] + a[1][3] * c[3],
+             -a[0][1] * c[5] + a[0][2] * c[4] - a[0][3] * c[3],
+             a[3][1] * s[5] - a[3][2] * s[4] + a[3][3] * s[3],
+             -a[2][1] * s[5] + a[2][2] * s[4] - a[2][3] * s[3]},
+            {-a[1][0] * c[5] + a[1][2] * c[2] - a[1][3] * c[1],
+             a[0][0] * c[5] - a[0][2] * c[2] + a[0][3] * c[1],
+             -a[3][0] * s[5] + a[3][2] * s[2] - a[3][3] * s[1],
+             a[2][0] * s[5] - a[2][2] * s[2] + a[2][3] * s[1]},
+            {a[1][0] * c[4] - a[1][1] * c[2] + a[1][3] * c[0],
+             -a[0][0] * c[4] + a[0][1] * c[2] - a[0][3] * c[0],
+             a[3][0] * s[4] - a[3][1] * s[2] + a[3][3] * s[0],
+             -a[2][0] * s[4] + a[2][1] * s[2] - a[2][3] * s[0]},
+            {-a[1][0] * c[3] + a[1][1] * c[1] - a[1][2] * c[0],
+             a[0][0] * c[3] - a[0][1] * c[1] + a[0][2] * c[0],
+             -a[3][0] * s[3] + a[3][1] * s[1] - a[3][2] * s[0],
+             a[2][0] * s[3] - a[2][1] * s[1] + a[2][2] * s[0]}};
+
+        SMALL_UNROLL
+        for (int i = 0; i < 4; i++) {
+            SMALL_UNROLL
+            for (int j = 0; j < 4; j++) SMALL_AT (R, ldr, i, j) = r[i][j] * inv;
+        }
+        res = 0;
+    }
+
+    return res;
+}
+
+/// Строка таблицы ядер размера n
+#define SMALL_ENTRY(n, name)                                                       \
+    {n,                                                                            \
+     multiply_##n##_##name,                                                        \
+     transpose_##n##_##name,                                                       \
+     transpose_inplace_##n##_##name,                                               \
+     determinant_##n,                                                              \
+     inverse_##n}
+
+/// Таблица ядер всех размеров одного варианта сборки
+#define SMALL_TABLE(name)                                                          \
+    {SMALL_ENTRY (2, name), SMALL_ENTRY (3, name), SMALL_ENTRY (4, name),         \
+     SMALL_ENTRY (5, name), SMALL_ENTRY (6, name), SMALL_ENTRY (7, name),         \
+     SMALL_ENTRY (8, name)}
+
+static const SmallKernels small_generic[SMALL_MAX - SMALL_MIN + 1] =
+    SMALL_TABLE (generic);
+
+#if SIMD_X86
+static const SmallKernels small_avx2[SMALL_MAX - SMALL_MIN + 1] =
+    SMALL_TABLE (avx2);
+#endif
+
+/**
+ * @brief Возвращает ядра размера n для текущего процессора
+ *
+ * @param n Размер матриц
+ *
+ * @return Указатель на таблицу или NULL, если n вне SMALL_MIN..SMALL_MAX
+ */
+const SmallKernels* small_kernels (int n) {
+    const SmallKernels* res = NULL;
+
+    if (n >= SMALL_MIN && n <= SMALL_MAX) {
+        res = &small_generic[n - SMALL_MIN];
+#if SIMD_X86
+        if (simd_kernels ()->level >= SIMD_AVX2) res = &small_avx2[n - SMALL_MIN];
+#endif
+    }
+
+    return res;
+}
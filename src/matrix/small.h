@@ -0,0 +1,84 @@
+/**
+ * @file small.h
+ * @brief Ядра фиксированных размеров 2 x 2 ... 8 x 8
+ *
+ * @details
+ * Для каждого n от SMALL_MIN до SMALL_MAX макросы small.c порождают свои
+ * умножение, транспонирование, детерминант и обращение с размером в виде
+ * константы: циклы разворачиваются полностью, строки держатся в
+ * регистрах, рабочие копии лежат на стеке без выделения памяти. 2 x 2,
+ * 3 x 3 и 4 x 4 считаются явными формулами (4 x 4 - через общие миноры
+ * 2 x 2), 5 x 5 ... 8 x 8 - развернутым исключением Гаусса с выбором
+ * ведущего элемента.
+ *
+ * multiply_matrices (), determinant (), inverse_matrix () и
+ * transpose_matrix_into () сами переходят на эти ядра для квадратных
+ * матриц double подходящего размера; умножение и транспонирование собраны
+ * также с target ("avx2,fma") и выбираются по simd_kernels ().
+ *
+ * @see matrix.h simd.h
+ */
+
+#ifndef SMALL_H
+#define SMALL_H
+
+#include "../../include/config.h"
+
+/// Наименьший размер с собственными ядрами
+#define SMALL_MIN 2
+
+/// Наибольший размер с собственными ядрами
+#define SMALL_MAX 8
+
+/**
+ * @brief C = A x B для матриц n x n
+ * @note C не пересекается с A и B
+ */
+typedef void (*SmallMultiply) (const MATRIX_TYPE* A, int lda, const MATRIX_TYPE* B,
+                               int ldb, MATRIX_TYPE* C, int ldc);
+
+/**
+ * @brief R = A^T для матриц n x n, R не пересекается с A
+ */
+typedef void (*SmallTranspose) (const MATRIX_TYPE* A, int lda, MATRIX_TYPE* R,
+                                int ldr);
+
+/**
+ * @brief Транспонирование матрицы n x n на месте
+ */
+typedef void (*SmallTransposeInplace) (MATRIX_TYPE* A, int lda);
+
+/**
+ * @brief Детерминант матрицы n x n
+ */
+typedef MATRIX_TYPE (*SmallDeterminant) (const MATRIX_TYPE* A, int lda);
+
+/**
+ * @brief R = A^-1 для матриц n x n
+ * @note R может совпадать с A: матрица читается целиком до первой записи
+ * @return 0 при успехе, -1 для вырожденной матрицы (R не изменяется)
+ */
+typedef int (*SmallInverse) (const MATRIX_TYPE* A, int lda, MATRIX_TYPE* R,
+                             int ldr);
+
+/**
+ * @struct SmallKernels
+ * @brief Ядра одного размера
+ */
+typedef struct {
+    int                   n;                   ///< Размер матриц
+    SmallMultiply         multiply;            ///< Умножение
+    SmallTranspose        transpose;           ///< Транспонирование в другую матрицу
+    SmallTransposeInplace transpose_inplace;   ///< Транспонирование на месте
+    SmallDeterminant      determinant;         ///< Детерминант
+    SmallInverse          inverse;             ///< Обращение
+} SmallKernels;
+
+/**
+ * @brief Возвращает ядра размера n для текущего процессора
+ * @param n Размер матриц
+ * @return Указатель на таблицу или NULL, если n вне SMALL_MIN..SMALL_MAX
+ */
+const SmallKernels* small_kernels (int n);
+
+#endif   // SMALL_H
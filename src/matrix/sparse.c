@@ -0,0 +1,808 @@
+/**
+ * @file sparse.c
+ * @brief Реализация разреженных матриц CSR и CSC
+ *
+ * @details
+ * Параллельные операции делят линии на куски и выполняются пулом потоков
+ * (thread_pool.h); при малом числе элементов работа идет в одном потоке.
+ *
+ * Плотная матрица переводится в CSR за два прохода: первый считает
+ * ненулевые в каждой строке, префиксные суммы дают offsets, второй
+ * записывает элементы. CSC получается из CSR сортировкой подсчетом.
+ *
+ * SpGEMM (Густавсон): символьный проход считает число различных столбцов
+ * в каждой строке результата через массив меток потока, затем численный
+ * проход накапливает строку в плотном буфере потока и собирает ее по
+ * списку затронутых столбцов.
+ *
+ * @see sparse.h
+ */
+
+#include "sparse.h"
+
+#include "../output/output.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Меньше этого числа элементов операции выполняются в одном потоке
+#define SPARSE_PARALLEL_MIN 32768
+
+/**
+ * @struct LineJob
+ * @brief Общие данные параллельного прохода по линиям
+ */
+typedef struct {
+    const SparseMatrix* A;          ///< Разреженный операнд
+    const SparseMatrix* B;          ///< Второй операнд SpGEMM
+    SparseMatrix*       C;          ///< Результат
+    const Matrix*       dense;      ///< Плотный операнд или результат
+    const MATRIX_TYPE*  x;          ///< Вектор SpMV
+    MATRIX_TYPE*        y;          ///< Результат SpMV или буферы потоков
+    int*                markers;    ///< Метки столбцов потоков (SpGEMM)
+    MATRIX_TYPE*        sums;       ///< Накопители строк потоков (SpGEMM)
+    int                 chunk;      ///< Линий в подзадаче
+    int                 lines;      ///< Всего линий
+    MATRIX_TYPE         sign;       ///< Знак разреженного слагаемого
+} LineJob;
+
+/**
+ * @brief Число линий матрицы: строк для CSR, столбцов для CSC
+ */
+static int sparse_lines (const SparseMatrix* matrix) {
+    return matrix->format == SPARSE_CSR ? matrix->rows : matrix->cols;
+}
+
+/**
+ * @brief Делит lines линий на подзадачи по объему работы work
+ *
+ * @return Число подзадач, в job->chunk - линий в подзадаче
+ */
+static int split_lines (LineJob* job, int lines, size_t work) {
+    int tasks = work < SPARSE_PARALLEL_MIN ? 1 : thread_pool_threads () * 4;
+
+    if (tasks > lines) tasks = lines;
+    job->lines = lines;
+    job->chunk = tasks > 0 ? (lines + tasks - 1) / tasks : 0;
+
+    return job->chunk > 0 ? (lines + job->chunk - 1) / job->chunk : 0;
+}
+
+/**
+ * @brief Переводит счетчики offsets[1..lines] в начала линий
+ *
+ * @return Общее число элементов
+ */
+static size_t prefix_sum (size_t* offsets, int lines) {
+    offsets[0] = 0;
+    for (int i = 0; i < lines; i++) offsets[i + 1] += offsets[i];
+
+    return offsets[lines];
+}
+
+/**
+ * @brief Создает разреженную матрицу с местом под nnz элементов
+ *
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param nnz Число элементов
+ * @param format Формат
+ *
+ * @return Матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_create (int rows, int cols, size_t nnz, SparseFormat format) {
+    SparseMatrix matrix = {0};
+    const int    lines  = format == SPARSE_CSR ? rows : cols;
+
+    if (rows > 0 && cols > 0 && (format == SPARSE_CSR || format == SPARSE_CSC)) {
+        matrix.rows    = rows;
+        matrix.cols    = cols;
+        matrix.format  = format;
+        matrix.nnz     = nnz;
+        matrix.offsets = calloc ((size_t) lines + 1, sizeof (size_t));
+        matrix.indices = malloc ((nnz ? nnz : 1) * sizeof (int));
+        matrix.values  = malloc ((nnz ? nnz : 1) * sizeof (MATRIX_TYPE));
+        if (!matrix.offsets || !matrix.indices || !matrix.values)
+            sparse_free (&matrix);
+    }
+
+    return matrix;
+}
+
+/**
+ * @brief Освобождает разреженную матрицу и обнуляет структуру
+ *
+ * @param matrix Указатель на матрицу
+ */
+void sparse_free (SparseMatrix* matrix) {
+    if (matrix) {
+        free (matrix->offsets);
+        free (matrix->indices);
+        free (matrix->values);
+        *matrix = (SparseMatrix) {0};
+    }
+}
+
+/**
+ * @brief Подзадача первого прохода: считает ненулевые в строках куска
+ */
+static void count_dense_rows (void* ctx, int task, int worker) {
+    LineJob*  job   = ctx;
+    const int first = task * job->chunk;
+    const int last  = first + job->chunk < job->lines ? first + job->chunk
+                                                      : job->lines;
+
+    (void) worker;
+    for (int row = first; row < last; row++) {
+        const MATRIX_TYPE* values = MATRIX_ROW (job->dense, row);
+        size_t             count  = 0;
+
+        for (int col = 0; col < job->dense->cols; col++) count += values[col] != 0;
+        job->C->offsets[row + 1] = count;
+    }
+}
+
+/**
+ * @brief Подзадача второго прохода: записывает ненулевые строк куска
+ */
+static void fill_dense_rows (void* ctx, int task, int worker) {
+    LineJob*  job   = ctx;
+    const int first = task * job->chunk;
+    const int last  = first + job->chunk < job->lines ? first + job->chunk
+                                                      : job->lines;
+
+    (void) worker;
+    for (int row = first; row < last; row++) {
+        const MATRIX_TYPE* values = MATRIX_ROW (job->dense, row);
+        size_t             p      = job->C->offsets[row];
+
+        for (int col = 0; col < job->dense->cols; col++) {
+            if (values[col] != 0) {
+                job->C->indices[p] = col;
+                job->C->values[p]  = values[col];
+                p++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Строит разреженную матрицу из плотной
+ *
+ * @param dense Плотная матрица
+ * @param format Формат результата
+ *
+ * @return Матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_from_dense (const Matrix* dense, SparseFormat format) {
+    SparseMatrix csr = {0};
+    SparseMatrix res = {0};
+    LineJob      job = {0};
+
+    if (dense && dense->data && dense->rows > 0 && dense->cols > 0 &&
+        dense->dtype == MATRIX_FLOAT64) {
+        const size_t size  = (size_t) dense->rows * dense->cols;
+        const int    tasks = split_lines (&job, dense->rows, size);
+
+        // Сначала только offsets: число элементов еще неизвестно
+        csr.offsets = calloc ((size_t) dense->rows + 1, sizeof (size_t));
+        job.dense   = dense;
+        job.C       = &csr;
+        if (csr.offsets) {
+            thread_pool_run (tasks, count_dense_rows, &job);
+            csr.rows    = dense->rows;
+            csr.cols    = dense->cols;
+            csr.format  = SPARSE_CSR;
+            csr.nnz     = prefix_sum (csr.offsets, dense->rows);
+            csr.indices = malloc ((csr.nnz ? csr.nnz : 1) * sizeof (int));
+            csr.values  = malloc ((csr.nnz ? csr.nnz : 1) * sizeof (MATRIX_TYPE));
+        }
+
+        if (csr.indices && csr.values) {
+            thread_pool_run (tasks, fill_dense_rows, &job);
+            if (format == SPARSE_CSR) {
+                res = csr;
+                csr = (SparseMatrix) {0};
+            } else {
+                res = sparse_convert (&csr, format);
+            }
+        }
+        sparse_free (&csr);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Подзадача: разносит линии куска по плотной матрице
+ *
+ * Разные линии касаются разных элементов, поэтому куски независимы.
+ */
+static void scatter_lines (void* ctx, int task, int worker) {
+    LineJob*            job   = ctx;
+    const SparseMatrix* A     = job->A;
+    const int           first = task * job->chunk;
+    const int           last  = first + job->chunk < job->lines ? first + job->chunk
+                                                                : job->lines;
+
+    (void) worker;
+    for (int line = first; line < last; line++) {
+        for (size_t p = A->offsets[line]; p < A->offsets[line + 1]; p++) {
+            MATRIX_TYPE* target = A->format == SPARSE_CSR
+                                      ? &MATRIX_AT (job->dense, line, A->indices[p])
+                                      : &MATRIX_AT (job->dense, A->indices[p], line);
+            *target += job->sign * A->values[p];
+        }
+    }
+}
+
+/**
+ * @brief Записывает разреженную матрицу в плотную
+ *
+ * @param matrix Разреженная матрица
+ * @param result Плотная матрица того же размера
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int sparse_to_dense (const SparseMatrix* matrix, Matrix* result) {
+    int res = -1;
+
+    if (matrix && matrix->offsets && result && result->data &&
+        result->dtype == MATRIX_FLOAT64 && matrix->rows == result->rows &&
+        matrix->cols == result->cols) {
+        LineJob   job   = {0};
+        const int tasks = split_lines (&job, sparse_lines (matrix), matrix->nnz);
+
+        for (int row = 0; row < result->rows; row++)
+            memset (MATRIX_ROW (result, row), 0,
+                    (size_t) result->cols * sizeof (MATRIX_TYPE));
+
+        job.A     = matrix;
+        job.dense = result;
+        job.sign  = 1;
+        thread_pool_run (tasks, scatter_lines, &job);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Переводит матрицу в заданный формат
+ *
+ * Смена формата - транспонирование структуры сортировкой подсчетом:
+ * линии исходной матрицы просматриваются по порядку, поэтому номера
+ * внутри новых линий получаются упорядоченными.
+ *
+ * @param matrix Разреженная матрица
+ * @param format Формат результата
+ *
+ * @return Новая матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_convert (const SparseMatrix* matrix, SparseFormat format) {
+    SparseMatrix res = {0};
+
+    if (matrix && matrix->offsets)
+        res = sparse_create (matrix->rows, matrix->cols, matrix->nnz, format);
+
+    if (res.offsets && format == matrix->format) {
+        const size_t lines = (size_t) sparse_lines (matrix) + 1;
+
+        memcpy (res.offsets, matrix->offsets, lines * sizeof (size_t));
+        memcpy (res.indices, matrix->indices, matrix->nnz * sizeof (int));
+        memcpy (res.values, matrix->values, matrix->nnz * sizeof (MATRIX_TYPE));
+    } else if (res.offsets) {
+        const int lines  = sparse_lines (matrix);
+        const int target = sparse_lines (&res);
+        size_t*   next   = malloc (((size_t) target + 1) * sizeof (size_t));
+
+        if (next) {
+            for (size_t p = 0; p < matrix->nnz; p++)
+                res.offsets[matrix->indices[p] + 1]++;
+            prefix_sum (res.offsets, target);
+            memcpy (next, res.offsets, ((size_t) target + 1) * sizeof (size_t));
+
+            for (int line = 0; line < lines; line++) {
+                for (size_t p = matrix->offsets[line]; p < matrix->offsets[line + 1];
+                     p++) {
+                    size_t q       = next[matrix->indices[p]]++;
+                    res.indices[q] = line;
+                    res.values[q]  = matrix->values[p];
+                }
+            }
+            free (next);
+        } else {
+            sparse_free (&res);
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief Собирает матрицу из списка элементов
+ *
+ * Две устойчивые сортировки подсчетом: сначала по номеру внутри линии,
+ * затем по номеру линии, после чего повторы стоят рядом и складываются.
+ *
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param count Число элементов
+ * @param row_index Номера строк
+ * @param col_index Номера столбцов
+ * @param values Значения
+ * @param format Формат результата
+ *
+ * @return Матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_from_triplets (int rows, int cols, size_t count,
+                                   const int* row_index, const int* col_index,
+                                   const MATRIX_TYPE* values, SparseFormat format) {
+    const int*   major   = format == SPARSE_CSR ? row_index : col_index;
+    const int*   minor   = format == SPARSE_CSR ? col_index : row_index;
+    const int    lines   = format == SPARSE_CSR ? rows : cols;
+    const int    width   = format == SPARSE_CSR ? cols : rows;
+    SparseMatrix res     = {0};
+    size_t*      bucket  = NULL;
+    int*         order   = NULL;   // Номера элементов, упорядоченные по minor
+    int          correct = rows > 0 && cols > 0 && count <= (size_t) INT_MAX &&
+                  (count == 0 || (row_index && col_index && values));
+
+    for (size_t i = 0; i < count && correct; i++)
+        correct = row_index[i] >= 0 && row_index[i] < rows && col_index[i] >= 0 &&
+                  col_index[i] < cols;
+
+    if (correct) {
+        res    = sparse_create (rows, cols, count, format);
+        bucket = calloc ((size_t) (lines > width ? lines : width) + 1,
+                         sizeof (size_t));
+        order  = malloc ((count ? count : 1) * sizeof (int));
+    }
+
+    if (res.offsets && bucket && order) {
+        size_t out = 0;
+
+        for (size_t i = 0; i < count; i++) bucket[minor[i] + 1]++;
+        prefix_sum (bucket, width);
+        for (size_t i = 0; i < count; i++) order[bucket[minor[i]]++] = (int) i;
+
+        for (size_t i = 0; i < count; i++) res.offsets[major[i] + 1]++;
+        prefix_sum (res.offsets, lines);
+        memcpy (bucket, res.offsets, ((size_t) lines + 1) * sizeof (size_t));
+        for (size_t i = 0; i < count; i++) {
+            int    e = order[i];
+            size_t q = bucket[major[e]]++;
+
+            res.indices[q] = minor[e];
+            res.values[q]  = values[e];
+        }
+
+        // Сложение повторов со сдвигом элементов к началу
+        for (int line = 0; line < lines; line++) {
+            const size_t begin = res.offsets[line];
+            const size_t end   = res.offsets[line + 1];
+
+            res.offsets[line] = out;
+            for (size_t p = begin; p < end; p++) {
+                if (out > res.offsets[line] &&
+                    res.indices[out - 1] == res.indices[p]) {
+                    res.values[out - 1] += res.values[p];
+                } else {
+                    res.indices[out] = res.indices[p];
+                    res.values[out]  = res.values[p];
+                    out++;
+                }
+            }
+        }
+        res.offsets[lines] = out;
+        res.nnz            = out;
+    } else {
+        sparse_free (&res);
+    }
+
+    free (bucket);
+    free (order);
+
+    return res;
+}
+
+/**
+ * @brief Первая строка с offsets[row] >= target (двоичный поиск)
+ */
+static int row_at (const SparseMatrix* A, size_t target) {
+    int low  = 0;
+    int high = A->rows;
+
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (A->offsets[mid] < target) low = mid + 1;
+        else high = mid;
+    }
+
+    return low;
+}
+
+/**
+ * @brief Подзадача SpMV для CSR: строки с равной долей элементов
+ */
+static void spmv_rows (void* ctx, int task, int worker) {
+    LineJob*            job   = ctx;
+    const SparseMatrix* A     = job->A;
+    const size_t        share = A->nnz * (size_t) task / (size_t) job->chunk;
+    const size_t        next  = A->nnz * (size_t) (task + 1) / (size_t) job->chunk;
+    const int           first = task == 0 ? 0 : row_at (A, share);
+    const int           last  = task + 1 == job->chunk ? A->rows : row_at (A, next);
+
+    (void) worker;
+    for (int row = first; row < last; row++) {
+        MATRIX_TYPE sum = 0;
+
+        for (size_t p = A->offsets[row]; p < A->offsets[row + 1]; p++)
+            sum += A->values[p] * job->x[A->indices[p]];
+        job->y[row] = sum;
+    }
+}
+
+/**
+ * @brief Подзадача SpMV для CSC: столбцы куска в буфер потока worker
+ */
+static void spmv_cols (void* ctx, int task, int worker) {
+    LineJob*            job   = ctx;
+    const SparseMatrix* A     = job->A;
+    MATRIX_TYPE*        y     = job->y + (size_t) worker * A->rows;
+    const int           first = task * job->chunk;
+    const int           last  = first + job->chunk < job->lines ? first + job->chunk
+                                                                : job->lines;
+
+    for (int col = first; col < last; col++) {
+        const MATRIX_TYPE x = job->x[col];
+
+        for (size_t p = A->offsets[col]; p < A->offsets[col + 1]; p++)
+            y[A->indices[p]] += A->values[p] * x;
+    }
+}
+
+/**
+ * @brief Умножает матрицу на вектор: y = A x
+ *
+ * @param A Разреженная матрица
+ * @param x Вектор длины cols
+ * @param y Вектор длины rows
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int sparse_multiply_vector (const SparseMatrix* A, const MATRIX_TYPE* x,
+                            MATRIX_TYPE* y) {
+    LineJob job = {0};
+    int     res = -1;
+
+    if (A && A->offsets && x && y) {
+        job.A = A;
+        job.x = x;
+        res   = 0;
+    }
+
+    if (res == 0 && A->format == SPARSE_CSR) {
+        // chunk здесь - число подзадач, границы ищутся по offsets
+        job.y     = y;
+        job.chunk = split_lines (&job, A->rows, A->nnz);
+        thread_pool_run (job.chunk, spmv_rows, &job);
+    } else if (res == 0) {
+        const int tasks   = split_lines (&job, A->cols, A->nnz);
+        const int buffers = tasks > 1 ? thread_pool_threads () : 1;
+
+        job.y = calloc ((size_t) buffers * A->rows, sizeof (MATRIX_TYPE));
+        if (job.y) {
+            thread_pool_run_workers (tasks, buffers, spmv_cols, &job);
+            for (int row = 0; row < A->rows; row++) {
+                MATRIX_TYPE sum = 0;
+                for (int b = 0; b < buffers; b++)
+                    sum += job.y[(size_t) b * A->rows + row];
+                y[row] = sum;
+            }
+            free (job.y);
+        } else {
+            res = -1;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief Подзадача символьного прохода SpGEMM: размеры строк C
+ */
+static void spgemm_count (void* ctx, int task, int worker) {
+    LineJob*            job    = ctx;
+    const SparseMatrix* A      = job->A;
+    const SparseMatrix* B      = job->B;
+    int*                marker = job->markers + (size_t) worker * B->cols;
+    const int           first  = task * job->chunk;
+    const int           last   = first + job->chunk < job->lines ? first + job->chunk
+                                                                 : job->lines;
+
+    for (int row = first; row < last; row++) {
+        size_t count = 0;
+
+        for (size_t p = A->offsets[row]; p < A->offsets[row + 1]; p++) {
+            const int k = A->indices[p];
+
+            for (size_t q = B->offsets[k]; q < B->offsets[k + 1]; q++) {
+                if (marker[B->indices[q]] != row) {
+                    marker[B->indices[q]] = row;
+                    count++;
+                }
+            }
+        }
+        job->C->offsets[row + 1] = count;
+    }
+}
+
+/**
+ * @brief Сравнение номеров столбцов для qsort
+ */
+static int compare_index (const void* a, const void* b) {
+    const int x = *(const int*) a;
+    const int y = *(const int*) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Подзадача численного прохода SpGEMM: значения строк C
+ */
+static void spgemm_fill (void* ctx, int task, int worker) {
+    LineJob*            job    = ctx;
+    const SparseMatrix* A      = job->A;
+    const SparseMatrix* B      = job->B;
+    SparseMatrix*       C      = job->C;
+    int*                marker = job->markers + (size_t) worker * B->cols;
+    MATRIX_TYPE*        sums   = job->sums + (size_t) worker * B->cols;
+    const int           first  = task * job->chunk;
+    const int           last   = first + job->chunk < job->lines ? first + job->chunk
+                                                                 : job->lines;
+
+    for (int row = first; row < last; row++) {
+        const size_t begin = C->offsets[row];
+        size_t       end   = begin;
+
+        for (size_t p = A->offsets[row]; p < A->offsets[row + 1]; p++) {
+            const int         k = A->indices[p];
+            const MATRIX_TYPE a = A->values[p];
+
+            for (size_t q = B->offsets[k]; q < B->offsets[k + 1]; q++) {
+                const int col = B->indices[q];
+
+                if (marker[col] != row) {
+                    marker[col]       = row;
+                    sums[col]         = a * B->values[q];
+                    C->indices[end++] = col;
+                } else {
+                    sums[col] += a * B->values[q];
+                }
+            }
+        }
+
+        qsort (C->indices + begin, end - begin, sizeof (int), compare_index);
+        for (size_t p = begin; p < end; p++) C->values[p] = sums[C->indices[p]];
+    }
+}
+
+/**
+ * @brief Умножает разреженные матрицы: C = A x B
+ *
+ * @param A Матрица m x k
+ * @param B Матрица k x n
+ *
+ * @return Матрица CSR или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_multiply (const SparseMatrix* A, const SparseMatrix* B) {
+    SparseMatrix a_csr = {0};
+    SparseMatrix b_csr = {0};
+    SparseMatrix C     = {0};
+    LineJob      job   = {0};
+    int          tasks   = 0;
+    int          threads = 0;
+    int          res     = A && B && A->offsets && B->offsets && A->cols == B->rows;
+
+    // Оба операнда нужны построчно
+    if (res && A->format != SPARSE_CSR) {
+        a_csr = sparse_convert (A, SPARSE_CSR);
+        res   = a_csr.offsets != NULL;
+    }
+    if (res && B->format != SPARSE_CSR) {
+        b_csr = sparse_convert (B, SPARSE_CSR);
+        res   = b_csr.offsets != NULL;
+    }
+
+    if (res) {
+        threads     = thread_pool_threads ();
+        job.A       = a_csr.offsets ? &a_csr : A;
+        job.B       = b_csr.offsets ? &b_csr : B;
+        job.C       = &C;
+        tasks       = split_lines (&job, A->rows, job.A->nnz + job.B->nnz);
+        job.markers = malloc ((size_t) threads * B->cols * sizeof (int));
+        job.sums    = malloc ((size_t) threads * B->cols * sizeof (MATRIX_TYPE));
+        C.offsets   = calloc ((size_t) A->rows + 1, sizeof (size_t));
+        res         = job.markers && job.sums && C.offsets;
+    }
+
+    if (res) {
+        const size_t marker_bytes = (size_t) threads * B->cols * sizeof (int);
+
+        memset (job.markers, 0xff, marker_bytes);
+        thread_pool_run_workers (tasks, threads, spgemm_count, &job);
+
+        C.rows    = A->rows;
+        C.cols    = B->cols;
+        C.format  = SPARSE_CSR;
+        C.nnz     = prefix_sum (C.offsets, A->rows);
+        C.indices = malloc ((C.nnz ? C.nnz : 1) * sizeof (int));
+        C.values  = malloc ((C.nnz ? C.nnz : 1) * sizeof (MATRIX_TYPE));
+        res       = C.indices && C.values;
+
+        // Метки символьного прохода совпали бы с номерами строк
+        memset (job.markers, 0xff, marker_bytes);
+        if (res) thread_pool_run_workers (tasks, threads, spgemm_fill, &job);
+    }
+
+    if (!res) sparse_free (&C);
+    sparse_free (&a_csr);
+    sparse_free (&b_csr);
+    free (job.markers);
+    free (job.sums);
+
+    return C;
+}
+
+/**
+ * @brief result = B * b_sign + A * sign
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int combine_dense (const SparseMatrix* A, const Matrix* B, Matrix* result,
+                          MATRIX_TYPE sign, MATRIX_TYPE b_sign) {
+    int res = -1;
+
+    if (A && A->offsets && B && B->data && result && result->data &&
+        B->dtype == MATRIX_FLOAT64 && result->dtype == MATRIX_FLOAT64 &&
+        A->rows == B->rows && A->cols == B->cols && B->rows == result->rows &&
+        B->cols == result->cols) {
+        SimdRowAxpby axpby = simd_kernels ()->axpby;
+        LineJob      job   = {0};
+        const int    tasks = split_lines (&job, sparse_lines (A), A->nnz);
+
+        // При beta = 0 строка result не читается, поэтому result == B допустим
+        for (int row = 0; row < B->rows; row++) {
+            axpby (B->cols, b_sign, MATRIX_ROW (B, row), 0,
+                   MATRIX_ROW (result, row));
+        }
+
+        job.A     = A;
+        job.dense = result;
+        job.sign  = sign;
+        thread_pool_run (tasks, scatter_lines, &job);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Складывает разреженную и плотную матрицы: result = A + B
+ *
+ * @param A Разреженная матрица
+ * @param B Плотная матрица
+ * @param result Плотная матрица результата
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int sparse_add_dense (const SparseMatrix* A, const Matrix* B, Matrix* result) {
+    return combine_dense (A, B, result, 1, 1);
+}
+
+/**
+ * @brief Вычитает плотную матрицу из разреженной: result = A - B
+ *
+ * @param A Разреженная матрица
+ * @param B Плотная матрица
+ * @param result Плотная матрица результата
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int sparse_subtract_dense (const SparseMatrix* A, const Matrix* B, Matrix* result) {
+    return combine_dense (A, B, result, 1, -1);
+}
+
+/**
+ * @brief Загружает разреженную матрицу из текстового файла
+ *
+ * @param filename Путь к файлу
+ * @param format Формат результата
+ *
+ * @return Матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_load_from_file (const char* filename, SparseFormat format) {
+    SparseMatrix res       = {0};
+    int          rows      = 0;
+    int          cols      = 0;
+    size_t       count     = 0;
+    int*         row_index = NULL;
+    int*         col_index = NULL;
+    double*      values    = NULL;
+
+    if (output_load_sparse_from_file (filename, &rows, &cols, &count, &row_index,
+                                      &col_index, &values) == 0) {
+        res = sparse_from_triplets (rows, cols, count, row_index, col_index, values,
+                                    format);
+    }
+
+    free (row_index);
+    free (col_index);
+    free (values);
+
+    return res;
+}
+
+/**
+ * @brief Загружает разреженную матрицу из двоичного файла
+ *
+ * @param filename Путь к файлу
+ * @param format Формат результата
+ *
+ * @return Матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_load_binary (const char* filename, SparseFormat format) {
+    SparseMatrix res    = {0};
+    Matrix       dense  = {0};
+    size_t       mapped = 0;
+
+    dense.data = output_map_matrix_binary (&dense.rows, &dense.cols, &dense.stride,
+                                           &mapped, 0, filename);
+    if (dense.data) {
+        dense.storage = MATRIX_VIEW;
+        res           = sparse_from_dense (&dense, format);
+        if (mapped) output_unmap_matrix (dense.data, mapped);
+        else free (dense.data);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Сохраняет разреженную матрицу в формате Matrix Market
+ *
+ * @param matrix Разреженная матрица
+ * @param filename Путь к файлу
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int sparse_save_to_file (const SparseMatrix* matrix, const char* filename) {
+    int* lines = NULL;
+    int  res   = -1;
+
+    if (matrix && matrix->offsets)
+        lines = malloc ((matrix->nnz ? matrix->nnz : 1) * sizeof (int));
+
+    if (lines) {
+        // Номер линии каждого элемента; второй индекс уже лежит в indices
+        for (int line = 0; line < sparse_lines (matrix); line++) {
+            const size_t end = matrix->offsets[line + 1];
+            for (size_t p = matrix->offsets[line]; p < end; p++) lines[p] = line;
+        }
+
+        res = matrix->format == SPARSE_CSR
+                  ? output_save_sparse_to_file (matrix->rows, matrix->cols,
+                                                matrix->nnz, lines, matrix->indices,
+                                                matrix->values, filename)
+                  : output_save_sparse_to_file (matrix->rows, matrix->cols,
+                                                matrix->nnz, matrix->indices, lines,
+                                                matrix->values, filename);
+        free (lines);
+    }
+
+    return res;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file sparse.h
+ * @brief Разреженные матрицы в форматах CSR и CSC
+ *
+ * @details
+ * Хранятся только ненулевые элементы, поэтому память пропорциональна их
+ * числу nnz, а не rows * cols. Матрица делится на линии: в CSR линия -
+ * строка, в CSC - столбец. Элементы линии line лежат в indices и values
+ * с offsets[line] по offsets[line + 1] - 1, indices - номера столбцов
+ * (CSR) или строк (CSC), внутри линии по возрастанию без повторов.
+ *
+ * Операции:
+ * - преобразование из плотной матрицы и обратно, CSR <-> CSC
+ * - сборка из списка элементов (триплетов) с суммированием повторов
+ * - умножение на вектор (SpMV), параллельно по линиям
+ * - произведение разреженных матриц (SpGEMM) по схеме Густавсона
+ * - сложение и вычитание с плотной матрицей
+ * - загрузка из текстового (плотного или Matrix Market) и двоичного
+ *   файла без плотного буфера в куче, сохранение в Matrix Market
+ *
+ * @code
+ * SparseMatrix A = sparse_load_from_file ("a.mtx", SPARSE_CSR);
+ * sparse_multiply_vector (&A, x, y);
+ * sparse_free (&A);
+ * @endcode
+ *
+ * @see matrix.h output.h
+ */
+
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include "matrix.h"
+
+/**
+ * @brief Формат разреженной матрицы
+ */
+typedef enum {
+    SPARSE_CSR = 0,   ///< Сжатые строки: линия - строка
+    SPARSE_CSC        ///< Сжатые столбцы: линия - столбец
+} SparseFormat;
+
+/**
+ * @struct SparseMatrix
+ * @brief Разреженная матрица
+ */
+typedef struct {
+    int          rows;      ///< Количество строк
+    int          cols;      ///< Количество столбцов
+    SparseFormat format;    ///< CSR или CSC
+    size_t       nnz;       ///< Число хранимых элементов
+    size_t*      offsets;   ///< Начала линий, lines + 1 элемент
+    int*         indices;   ///< Номера столбцов (CSR) или строк (CSC)
+    MATRIX_TYPE* values;    ///< Значения элементов
+} SparseMatrix;
+
+/**
+ * @brief Создает разреженную матрицу с местом под nnz элементов
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param nnz Число элементов
+ * @param format Формат
+ * @note offsets заполнены нулями, indices и values не инициализированы
+ * @return Матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_create (int rows, int cols, size_t nnz, SparseFormat format);
+
+/**
+ * @brief Освобождает разреженную матрицу и обнуляет структуру
+ * @param matrix Указатель на матрицу (может быть NULL)
+ */
+void sparse_free (SparseMatrix* matrix);
+
+/**
+ * @brief Строит разреженную матрицу из плотной
+ * @param dense Плотная матрица или представление
+ * @param format Формат результата
+ * @note Сохраняются элементы, не равные нулю; строки просматриваются
+ * параллельно
+ * @return Матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_from_dense (const Matrix* dense, SparseFormat format);
+
+/**
+ * @brief Записывает разреженную матрицу в плотную
+ * @param matrix Разреженная матрица
+ * @param result Плотная матрица того же размера
+ * @return 0 при успехе, -1 при ошибке
+ */
+int sparse_to_dense (const SparseMatrix* matrix, Matrix* result);
+
+/**
+ * @brief Переводит матрицу в заданный формат
+ * @param matrix Разреженная матрица
+ * @param format Формат результата
+ * @note При совпадении форматов возвращается копия
+ * @return Новая матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_convert (const SparseMatrix* matrix, SparseFormat format);
+
+/**
+ * @brief Собирает матрицу из списка элементов
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param count Число элементов списка
+ * @param row_index Номера строк от нуля
+ * @param col_index Номера столбцов от нуля
+ * @param values Значения
+ * @param format Формат результата
+ * @note Элементы могут идти в любом порядке, повторы складываются
+ * @return Матрица или нулевая матрица при ошибке (в том числе при индексе
+ * вне матрицы)
+ */
+SparseMatrix sparse_from_triplets (int rows, int cols, size_t count,
+                                   const int* row_index, const int* col_index,
+                                   const MATRIX_TYPE* values, SparseFormat format);
+
+/**
+ * @brief Умножает матрицу на вектор: y = A x
+ * @param A Разреженная матрица rows x cols
+ * @param x Вектор длины cols
+ * @param y Вектор длины rows, не пересекается с x
+ * @note CSR делится между потоками поровну по числу элементов; CSC
+ * накапливает сумму в буферах потоков
+ * @return 0 при успехе, -1 при ошибке
+ */
+int sparse_multiply_vector (const SparseMatrix* A, const MATRIX_TYPE* x,
+                            MATRIX_TYPE* y);
+
+/**
+ * @brief Умножает разреженные матрицы: C = A x B
+ * @param A Матрица m x k
+ * @param B Матрица k x n
+ * @note Результат в формате CSR; взаимно уничтожившиеся слагаемые
+ * остаются явными нулями
+ * @return Матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_multiply (const SparseMatrix* A, const SparseMatrix* B);
+
+/**
+ * @brief Складывает разреженную и плотную матрицы: result = A + B
+ * @param A Разреженная матрица
+ * @param B Плотная матрица того же размера
+ * @param result Плотная матрица того же размера (может совпадать с B)
+ * @return 0 при успехе, -1 при ошибке
+ */
+int sparse_add_dense (const SparseMatrix* A, const Matrix* B, Matrix* result);
+
+/**
+ * @brief Вычитает плотную матрицу из разреженной: result = A - B
+ * @param A Разреженная матрица
+ * @param B Плотная матрица того же размера
+ * @param result Плотная матрица того же размера (может совпадать с B)
+ * @return 0 при успехе, -1 при ошибке
+ */
+int sparse_subtract_dense (const SparseMatrix* A, const Matrix* B, Matrix* result);
+
+/**
+ * @brief Загружает разреженную матрицу из текстового файла
+ * @param filename Плотный текст (формат output.h) или Matrix Market
+ * @param format Формат результата
+ * @note Нули плотного текста отбрасываются при разборе
+ * @return Матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_load_from_file (const char* filename, SparseFormat format);
+
+/**
+ * @brief Загружает разреженную матрицу из двоичного файла
+ * @param filename Двоичный файл плотной матрицы (output.h)
+ * @param format Формат результата
+ * @note Файл просматривается через отображение в память, плотная копия в
+ * куче не создается (кроме файлов с чужим порядком байт или float)
+ * @return Матрица или нулевая матрица при ошибке
+ */
+SparseMatrix sparse_load_binary (const char* filename, SparseFormat format);
+
+/**
+ * @brief Сохраняет разреженную матрицу в формате Matrix Market
+ * @param matrix Разреженная матрица
+ * @param filename Путь к файлу
+ * @return 0 при успехе, -1 при ошибке
+ */
+int sparse_save_to_file (const SparseMatrix* matrix, const char* filename);
+
+#endif   // SPARSE_H
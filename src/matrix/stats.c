@@ -0,0 +1,427 @@
+/**
+ * @file stats.c
+ * @brief Реализация счетчиков и таймеров публичных операций
+ *
+ * @details
+ * Счетчики - атомарные 64-битные значения, по строке на операцию и на
+ * категорию; потоки копят их без блокировок. Наибольшее время обновляется
+ * циклом сравнения с обменом. Глубина вложенных замеров хранится в
+ * переменной потока: итоги категорий получают только замеры глубины 0.
+ * В режиме трассировки замер также пишет начало и конец интервала
+ * (trace.c). Аппаратные счетчики (perf.c) читаются в начале и конце
+ * замера, начальные значения хранятся в стеке потока по глубине.
+ *
+ * @see stats.h trace.h
+ */
+
+#include "stats.h"
+
+#include "thread_pool.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @struct StatsCounters
+ * @brief Атомарные счетчики одной строки таблицы
+ */
+typedef struct {
+    atomic_uint_least64_t calls;           ///< Число вызовов
+    atomic_uint_least64_t total_ns;        ///< Общее время
+    atomic_uint_least64_t max_ns;          ///< Наибольшее время вызова
+    atomic_uint_least64_t bytes_read;      ///< Прочитано байт
+    atomic_uint_least64_t bytes_written;   ///< Записано байт
+    atomic_uint_least64_t flops;           ///< Операций с плавающей точкой
+    atomic_uint_least64_t perf[MATRIX_PERF_EVENT_COUNT];   ///< Аппаратные события
+} StatsCounters;
+
+/**
+ * @struct StatsOpInfo
+ * @brief Имя и категория операции
+ */
+typedef struct {
+    const char*         name;       ///< Имя функции
+    MatrixStatsCategory category;   ///< Категория
+} StatsOpInfo;
+
+/// Имена и категории операций в порядке MatrixOp
+static const StatsOpInfo stats_ops[MATRIX_OP_COUNT] = {
+    {"load_matrix_from_file", MATRIX_STATS_LOAD},
+    {"load_matrix_binary", MATRIX_STATS_LOAD},
+    {"load_matrix_binary_native", MATRIX_STATS_LOAD},
+    {"print_matrix", MATRIX_STATS_SAVE},
+    {"save_matrix_to_file", MATRIX_STATS_SAVE},
+    {"save_matrix_binary", MATRIX_STATS_SAVE},
+    {"add_matrices", MATRIX_STATS_COMPUTE},
+    {"subtract_matrices", MATRIX_STATS_COMPUTE},
+    {"add_matrices_inplace", MATRIX_STATS_COMPUTE},
+    {"subtract_matrices_inplace", MATRIX_STATS_COMPUTE},
+    {"axpby_matrices", MATRIX_STATS_COMPUTE},
+    {"accumulate_matrices", MATRIX_STATS_COMPUTE},
+    {"multiply_matrices", MATRIX_STATS_COMPUTE},
+    {"fused_multiply_bt_sub_add", MATRIX_STATS_COMPUTE},
+    {"transpose_matrix", MATRIX_STATS_COMPUTE},
+    {"determinant", MATRIX_STATS_COMPUTE},
+    {"determinant_log", MATRIX_STATS_COMPUTE},
+    {"inverse_matrix", MATRIX_STATS_COMPUTE},
+    {"output_print_matrix", MATRIX_STATS_SAVE},
+    {"output_save_matrix_to_file", MATRIX_STATS_SAVE},
+    {"output_load_matrix_from_file", MATRIX_STATS_LOAD},
+    {"output_save_matrix_binary", MATRIX_STATS_SAVE},
+    {"output_map_matrix_binary", MATRIX_STATS_LOAD},
+    {"output_load_sparse_from_file", MATRIX_STATS_LOAD},
+    {"output_save_sparse_to_file", MATRIX_STATS_SAVE},
+};
+
+/// Имена категорий в порядке MatrixStatsCategory
+static const char* const stats_categories[MATRIX_STATS_CATEGORY_COUNT] = {
+    "load",
+    "compute",
+    "save",
+};
+
+atomic_int matrix_stats_on = -1;
+
+static StatsCounters stats_op_counters[MATRIX_OP_COUNT];
+static StatsCounters stats_category_counters[MATRIX_STATS_CATEGORY_COUNT];
+
+/// Глубина вложенных замеров текущего потока
+static _Thread_local int stats_depth = 0;
+
+/// Наибольшая глубина замеров с аппаратными счетчиками
+#define STATS_PERF_DEPTH 8
+
+/// Аппаратные счетчики в начале замеров текущего потока по глубине
+static _Thread_local uint64_t stats_perf_start[STATS_PERF_DEPTH]
+                                              [MATRIX_PERF_EVENT_COUNT];
+
+/// События, открытые при последнем включении аппаратных счетчиков
+static atomic_int stats_perf_events = 0;
+
+/// Файл таблицы при выходе (NULL - stderr)
+static char* stats_exit_path = NULL;
+
+/**
+ * @brief Печатает таблицу при выходе из программы
+ */
+static void stats_exit_dump (void) {
+    FILE* out = stats_exit_path ? fopen (stats_exit_path, "w") : stderr;
+
+    if (out) {
+        matrix_stats_dump (out);
+        if (out != stderr) fclose (out);
+    }
+    free (stats_exit_path);
+    stats_exit_path = NULL;
+}
+
+/**
+ * @brief Читает MATRIX_STATS и MATRIX_TRACE при первой операции
+ *
+ * @return Режимы после чтения
+ */
+static int stats_init (void) {
+    const char* env     = getenv ("MATRIX_STATS");
+    const char* trace   = getenv ("MATRIX_TRACE");
+    const char* perf    = getenv ("MATRIX_STATS_PERF");
+    const int   enabled = env && *env && strcmp (env, "0") != 0;
+    int         unknown = -1;
+
+    if (atomic_compare_exchange_strong (&matrix_stats_on, &unknown,
+                                        enabled ? MATRIX_STATS_COUNTERS : 0)) {
+        if (enabled) {
+            if (strcmp (env, "1") != 0 && strcmp (env, "stderr") != 0)
+                stats_exit_path = strdup (env);
+            atexit (stats_exit_dump);
+        }
+        if (trace && *trace) trace_start (trace);
+        if (perf && *perf && strcmp (perf, "0") != 0) matrix_stats_enable_perf (1);
+    }
+
+    return atomic_load (&matrix_stats_on);
+}
+
+/**
+ * @brief Начинает замер при ненулевом флаге
+ */
+MatrixStatsScope matrix_stats_start (MatrixOp op) {
+    MatrixStatsScope scope = {op, 0, 0};
+    int              on    = atomic_load_explicit (&matrix_stats_on,
+                                                   memory_order_relaxed);
+
+    if (on < 0) on = stats_init ();
+    if (op >= 0 && op < MATRIX_OP_COUNT) {
+        scope.active =
+            on & (MATRIX_STATS_COUNTERS | MATRIX_STATS_TRACE | MATRIX_STATS_PERF);
+        if (scope.active & MATRIX_STATS_TRACE)
+            trace_begin (stats_ops[op].name,
+                         stats_categories[stats_ops[op].category]);
+        if (!(scope.active & MATRIX_STATS_COUNTERS) ||
+            stats_depth >= STATS_PERF_DEPTH)
+            scope.active &= ~MATRIX_STATS_PERF;
+        if (scope.active & MATRIX_STATS_PERF)
+            perf_read (stats_perf_start[stats_depth]);
+        if (scope.active & MATRIX_STATS_COUNTERS) {
+            scope.start = trace_now ();
+            stats_depth++;
+        }
+    }
+
+    return scope;
+}
+
+/**
+ * @brief Прибавляет вызов к строке счетчиков
+ */
+static void stats_add (StatsCounters* counters, uint64_t elapsed, uint64_t read,
+                       uint64_t written, uint64_t flops, const uint64_t* perf) {
+    uint64_t max = atomic_load_explicit (&counters->max_ns, memory_order_relaxed);
+
+    atomic_fetch_add_explicit (&counters->calls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit (&counters->total_ns, elapsed, memory_order_relaxed);
+    atomic_fetch_add_explicit (&counters->bytes_read, read, memory_order_relaxed);
+    atomic_fetch_add_explicit (&counters->bytes_written, written,
+                               memory_order_relaxed);
+    atomic_fetch_add_explicit (&counters->flops, flops, memory_order_relaxed);
+    for (int e = 0; perf && e < MATRIX_PERF_EVENT_COUNT; e++)
+        atomic_fetch_add_explicit (&counters->perf[e], perf[e],
+                                   memory_order_relaxed);
+    while (elapsed > max &&
+           !atomic_compare_exchange_weak_explicit (&counters->max_ns, &max,
+                                                   elapsed, memory_order_relaxed,
+                                                   memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Учитывает завершенный замер
+ */
+void matrix_stats_finish (const MatrixStatsScope* scope, uint64_t read,
+                          uint64_t written, uint64_t flops) {
+    const MatrixStatsCategory category = stats_ops[scope->op].category;
+
+    if (scope->active & MATRIX_STATS_COUNTERS) {
+        const uint64_t elapsed = trace_now () - scope->start;
+        uint64_t       perf[MATRIX_PERF_EVENT_COUNT];
+
+        stats_depth--;
+        if (scope->active & MATRIX_STATS_PERF) {
+            perf_read (perf);
+            // Значения с поправкой на деление регистров могут немного убывать
+            for (int e = 0; e < MATRIX_PERF_EVENT_COUNT; e++)
+                perf[e] = perf[e] > stats_perf_start[stats_depth][e]
+                            ? perf[e] - stats_perf_start[stats_depth][e]
+                            : 0;
+        }
+
+        const uint64_t* events = scope->active & MATRIX_STATS_PERF ? perf : NULL;
+        stats_add (&stats_op_counters[scope->op], elapsed, read, written, flops,
+                   events);
+        if (stats_depth == 0)
+            stats_add (&stats_category_counters[category], elapsed, read, written,
+                       flops, events);
+    }
+    if (scope->active & MATRIX_STATS_TRACE)
+        trace_end (stats_ops[scope->op].name, stats_categories[category]);
+}
+
+/**
+ * @brief Включает или выключает режимы замеров
+ */
+void matrix_stats_set_mode (int mode, int enabled) {
+    matrix_stats_mode ();
+
+    if (enabled) atomic_fetch_or (&matrix_stats_on, mode);
+    else atomic_fetch_and (&matrix_stats_on, ~mode);
+}
+
+/**
+ * @brief Включает или выключает статистику
+ */
+void matrix_stats_enable (int enabled) {
+    matrix_stats_set_mode (MATRIX_STATS_COUNTERS, enabled);
+}
+
+/**
+ * @brief Включает или выключает аппаратные счетчики вызовов
+ */
+int matrix_stats_enable_perf (int enabled) {
+    int res = 0;
+
+    if (enabled) {
+        res = perf_open ();
+        if (res) {
+            // Рабочие потоки, созданные заново, наследуют счетчики
+            thread_pool_shutdown ();
+            atomic_store (&stats_perf_events, res);
+            matrix_stats_set_mode (MATRIX_STATS_COUNTERS | MATRIX_STATS_PERF, 1);
+        } else {
+            res = -1;
+        }
+    } else {
+        matrix_stats_set_mode (MATRIX_STATS_PERF, 0);
+        perf_close ();
+    }
+
+    return res;
+}
+
+/**
+ * @brief Возвращает включенные режимы замеров
+ */
+int matrix_stats_mode (void) {
+    int on = atomic_load (&matrix_stats_on);
+
+    if (on < 0) on = stats_init ();
+
+    return on;
+}
+
+/**
+ * @brief Проверяет, включена ли статистика
+ */
+int matrix_stats_enabled (void) {
+    return (matrix_stats_mode () & MATRIX_STATS_COUNTERS) != 0;
+}
+
+/**
+ * @brief Обнуляет строку счетчиков
+ */
+static void stats_clear (StatsCounters* counters) {
+    atomic_store (&counters->calls, 0);
+    atomic_store (&counters->total_ns, 0);
+    atomic_store (&counters->max_ns, 0);
+    atomic_store (&counters->bytes_read, 0);
+    atomic_store (&counters->bytes_written, 0);
+    atomic_store (&counters->flops, 0);
+    for (int e = 0; e < MATRIX_PERF_EVENT_COUNT; e++)
+        atomic_store (&counters->perf[e], 0);
+}
+
+/**
+ * @brief Обнуляет накопленную статистику
+ */
+void matrix_stats_reset (void) {
+    for (int op = 0; op < MATRIX_OP_COUNT; op++)
+        stats_clear (&stats_op_counters[op]);
+    for (int c = 0; c < MATRIX_STATS_CATEGORY_COUNT; c++)
+        stats_clear (&stats_category_counters[c]);
+}
+
+/**
+ * @brief Копирует строку счетчиков в MatrixStatsEntry
+ */
+static void stats_read (const StatsCounters* counters, const char* name,
+                        MatrixStatsCategory category, MatrixStatsEntry* entry) {
+    entry->name          = name;
+    entry->category      = category;
+    entry->calls         = atomic_load (&counters->calls);
+    entry->total_ns      = atomic_load (&counters->total_ns);
+    entry->max_ns        = atomic_load (&counters->max_ns);
+    entry->bytes_read    = atomic_load (&counters->bytes_read);
+    entry->bytes_written = atomic_load (&counters->bytes_written);
+    entry->flops         = atomic_load (&counters->flops);
+    for (int e = 0; e < MATRIX_PERF_EVENT_COUNT; e++)
+        entry->perf[e] = atomic_load (&counters->perf[e]);
+}
+
+/**
+ * @brief Возвращает статистику операции
+ */
+int matrix_stats_get (MatrixOp op, MatrixStatsEntry* entry) {
+    int res = -1;
+
+    if (op >= 0 && op < MATRIX_OP_COUNT && entry) {
+        stats_read (&stats_op_counters[op], stats_ops[op].name,
+                    stats_ops[op].category, entry);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Возвращает итог категории по внешним вызовам
+ */
+int matrix_stats_total (MatrixStatsCategory category, MatrixStatsEntry* entry) {
+    int res = -1;
+
+    if (category >= 0 && category < MATRIX_STATS_CATEGORY_COUNT && entry) {
+        stats_read (&stats_category_counters[category], stats_categories[category],
+                    category, entry);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Печатает строку таблицы
+ */
+static void stats_print (FILE* out, const MatrixStatsEntry* entry) {
+    const double total_ms = (double) entry->total_ns / 1e6;
+    const double mean_us  = (double) entry->total_ns / 1e3 / (double) entry->calls;
+    const double max_us   = (double) entry->max_ns / 1e3;
+    const double gflops   = entry->total_ns
+                              ? (double) entry->flops / (double) entry->total_ns
+                              : 0;
+
+    fprintf (out, "%-30s %10llu %12.3f %12.3f %12.3f %14llu %14llu %9.3f\n",
+             entry->name, (unsigned long long) entry->calls, total_ms, mean_us,
+             max_us, (unsigned long long) entry->bytes_read,
+             (unsigned long long) entry->bytes_written, gflops);
+}
+
+/**
+ * @brief Печатает строку таблицы аппаратных событий
+ *
+ * Неоткрытые события печатаются прочерком.
+ */
+static void stats_print_perf (FILE* out, const MatrixStatsEntry* entry, int events) {
+    const uint64_t cycles       = entry->perf[MATRIX_PERF_CYCLES];
+    const uint64_t instructions = entry->perf[MATRIX_PERF_INSTRUCTIONS];
+
+    fprintf (out, "%-30s", entry->name);
+    for (int e = 0; e < MATRIX_PERF_EVENT_COUNT; e++) {
+        if (events & (1 << e))
+            fprintf (out, " %15llu", (unsigned long long) entry->perf[e]);
+        else fprintf (out, " %15s", "-");
+    }
+    if (cycles && (events & (1 << MATRIX_PERF_INSTRUCTIONS)))
+        fprintf (out, " %6.2f\n", (double) instructions / (double) cycles);
+    else fprintf (out, " %6s\n", "-");
+}
+
+/**
+ * @brief Печатает таблицу вызванных операций и итоги категорий
+ *
+ * После включения аппаратных счетчиков добавляется таблица событий.
+ */
+void matrix_stats_dump (FILE* out) {
+    MatrixStatsEntry entry;
+    const int        events = atomic_load (&stats_perf_events);
+
+    fprintf (out, "%-30s %10s %12s %12s %12s %14s %14s %9s\n", "operation", "calls",
+             "total, ms", "mean, us", "max, us", "read, B", "written, B", "GFLOP/s");
+    for (int op = 0; op < MATRIX_OP_COUNT; op++) {
+        matrix_stats_get ((MatrixOp) op, &entry);
+        if (entry.calls) stats_print (out, &entry);
+    }
+    fprintf (out, "\n");
+    for (int c = 0; c < MATRIX_STATS_CATEGORY_COUNT; c++) {
+        matrix_stats_total ((MatrixStatsCategory) c, &entry);
+        if (entry.calls) stats_print (out, &entry);
+    }
+
+    if (events) {
+        fprintf (out, "\n%-30s", "operation");
+        for (int e = 0; e < MATRIX_PERF_EVENT_COUNT; e++)
+            fprintf (out, " %15s", perf_event_name ((MatrixPerfEvent) e));
+        fprintf (out, " %6s\n", "IPC");
+        for (int op = 0; op < MATRIX_OP_COUNT; op++) {
+            matrix_stats_get ((MatrixOp) op, &entry);
+            if (entry.calls) stats_print_perf (out, &entry, events);
+        }
+    }
+}
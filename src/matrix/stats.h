@@ -0,0 +1,248 @@
+/**
+ * @file stats.h
+ * @brief Счетчики и таймеры публичных операций библиотеки
+ *
+ * @details
+ * Каждая публичная операция matrix.c и output.c отмечает начало и конец
+ * замером MatrixStatsScope. Пока статистика выключена, замер стоит одного
+ * чтения флага и ветвления: время не запрашивается, объемы не считаются.
+ * Включенная статистика копит по каждой операции число вызовов, общее и
+ * наибольшее время, прочитанные и записанные байты и число операций с
+ * плавающей точкой.
+ *
+ * Вызовы, сделанные изнутри другой замеренной операции (save_matrix_to_file
+ * -> output_save_matrix_to_file), учитываются в своей строке, но в итоги
+ * по категориям (загрузка, вычисления, сохранение) входят только внешние
+ * вызовы: время не считается дважды.
+ *
+ * Переменная окружения MATRIX_STATS читается при первой операции и
+ * включает статистику с печатью таблицы при выходе из программы: "1" или
+ * "stderr" - в stderr, иное значение - путь файла для таблицы, "0" или
+ * пустое значение - статистика выключена. Из программы статистику включает
+ * matrix_stats_enable (), печатает - matrix_stats_dump ().
+ *
+ * Переменная MATRIX_STATS_PERF=1 или matrix_stats_enable_perf () добавляют
+ * к статистике аппаратные события каждого вызова (perf.h): такты,
+ * инструкции, промахи L1D и LLC, ошибки предсказания переходов.
+ *
+ * Тот же замер отмечает операцию на временной шкале, если включена
+ * трассировка (trace.h): флаг matrix_stats_on хранит оба режима, поэтому
+ * выключенные статистика и трассировка проверяются одним чтением.
+ *
+ * @code
+ * matrix_stats_enable (1);
+ * Matrix A = load_matrix_from_file ("A.txt");
+ * multiply_matrices (&A, &A, &C);
+ * matrix_stats_dump (stderr);
+ * @endcode
+ *
+ * @see matrix.h output.h
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "perf.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Категория операции для итогов
+ */
+typedef enum {
+    MATRIX_STATS_LOAD = 0,        ///< Загрузка матриц
+    MATRIX_STATS_COMPUTE,         ///< Вычисления
+    MATRIX_STATS_SAVE,            ///< Сохранение и вывод
+    MATRIX_STATS_CATEGORY_COUNT   ///< Число категорий
+} MatrixStatsCategory;
+
+/**
+ * @brief Замеряемые операции
+ */
+typedef enum {
+    MATRIX_OP_LOAD_FROM_FILE = 0,    ///< load_matrix_from_file
+    MATRIX_OP_LOAD_BINARY,           ///< load_matrix_binary
+    MATRIX_OP_LOAD_BINARY_NATIVE,    ///< load_matrix_binary_native
+    MATRIX_OP_PRINT,                 ///< print_matrix
+    MATRIX_OP_SAVE_TO_FILE,          ///< save_matrix_to_file
+    MATRIX_OP_SAVE_BINARY,           ///< save_matrix_binary
+    MATRIX_OP_ADD,                   ///< add_matrices
+    MATRIX_OP_SUBTRACT,              ///< subtract_matrices
+    MATRIX_OP_ADD_INPLACE,           ///< add_matrices_inplace
+    MATRIX_OP_SUBTRACT_INPLACE,      ///< subtract_matrices_inplace
+    MATRIX_OP_AXPBY,                 ///< axpby_matrices
+    MATRIX_OP_ACCUMULATE,            ///< accumulate_matrices
+    MATRIX_OP_MULTIPLY,              ///< multiply_matrices
+    MATRIX_OP_FUSED,                 ///< fused_multiply_bt_sub_add
+    MATRIX_OP_TRANSPOSE,             ///< transpose_matrix
+    MATRIX_OP_DETERMINANT,           ///< determinant
+    MATRIX_OP_DETERMINANT_LOG,       ///< determinant_log
+    MATRIX_OP_INVERSE,               ///< inverse_matrix
+    MATRIX_OP_OUTPUT_PRINT,          ///< output_print_matrix
+    MATRIX_OP_OUTPUT_SAVE_TEXT,      ///< output_save_matrix_to_file
+    MATRIX_OP_OUTPUT_LOAD_TEXT,      ///< output_load_matrix_from_file
+    MATRIX_OP_OUTPUT_SAVE_BINARY,    ///< output_save_matrix_binary(_typed)
+    MATRIX_OP_OUTPUT_MAP_BINARY,     ///< output_map_matrix_binary / _typed
+    MATRIX_OP_OUTPUT_LOAD_SPARSE,    ///< output_load_sparse_from_file
+    MATRIX_OP_OUTPUT_SAVE_SPARSE,    ///< output_save_sparse_to_file
+    MATRIX_OP_COUNT                  ///< Число операций
+} MatrixOp;
+
+/**
+ * @struct MatrixStatsEntry
+ * @brief Накопленная статистика операции или категории
+ */
+typedef struct {
+    const char*         name;            ///< Имя функции или категории
+    MatrixStatsCategory category;        ///< Категория
+    uint64_t            calls;           ///< Число вызовов
+    uint64_t            total_ns;        ///< Общее время
+    uint64_t            max_ns;          ///< Наибольшее время вызова
+    uint64_t            bytes_read;      ///< Прочитано байт
+    uint64_t            bytes_written;   ///< Записано байт
+    uint64_t            flops;           ///< Операций с плавающей точкой
+    /// Аппаратные события по MatrixPerfEvent (perf.h)
+    uint64_t            perf[MATRIX_PERF_EVENT_COUNT];
+} MatrixStatsEntry;
+
+/**
+ * @struct MatrixStatsScope
+ * @brief Замер одного вызова
+ */
+typedef struct {
+    MatrixOp op;       ///< Операция
+    int      active;   ///< Режимы замера MATRIX_STATS_*, 0 - замер не идет
+    uint64_t start;    ///< Время начала, нс
+} MatrixStatsScope;
+
+/// Режим: счетчики и таймеры
+#define MATRIX_STATS_COUNTERS 1
+
+/// Режим: интервалы на временной шкале (trace.h)
+#define MATRIX_STATS_TRACE 2
+
+/// Режим: аппаратные счетчики вызовов (вместе с MATRIX_STATS_COUNTERS)
+#define MATRIX_STATS_PERF 4
+
+/// Включенные режимы MATRIX_STATS_*, -1 - переменные окружения еще не прочитаны
+extern atomic_int matrix_stats_on;
+
+/**
+ * @brief Начинает замер операции op
+ */
+#define MATRIX_STATS_BEGIN(op) matrix_stats_begin (op)
+
+/**
+ * @brief Завершает замер; аргументы вычисляются только при включенной
+ * статистике
+ * @param scope Замер, начатый MATRIX_STATS_BEGIN
+ * @param read Прочитано байт
+ * @param written Записано байт
+ * @param flops Операций с плавающей точкой
+ */
+#define MATRIX_STATS_END(scope, read, written, flops)                          \
+    do {                                                                       \
+        if ((scope).active)                                                    \
+            matrix_stats_finish (&(scope), (uint64_t) (read),                  \
+                                 (uint64_t) (written), (uint64_t) (flops));    \
+    } while (0)
+
+/**
+ * @brief Начинает замер при ненулевом флаге (вызывается MATRIX_STATS_BEGIN)
+ *
+ * При первом вызове читает MATRIX_STATS и MATRIX_TRACE; если оба режима
+ * выключены, возвращает неактивный замер.
+ */
+MatrixStatsScope matrix_stats_start (MatrixOp op);
+
+/**
+ * @brief Учитывает завершенный замер (вызывается MATRIX_STATS_END)
+ */
+void matrix_stats_finish (const MatrixStatsScope* scope, uint64_t read,
+                          uint64_t written, uint64_t flops);
+
+/**
+ * @brief Начинает замер; при выключенной статистике - одно чтение флага
+ */
+static inline MatrixStatsScope matrix_stats_begin (MatrixOp op) {
+    MatrixStatsScope scope = {op, 0, 0};
+
+    if (atomic_load_explicit (&matrix_stats_on, memory_order_relaxed))
+        scope = matrix_stats_start (op);
+
+    return scope;
+}
+
+/**
+ * @brief Включает или выключает статистику
+ * @param enabled 1 - включить, 0 - выключить (накопленное сохраняется)
+ */
+void matrix_stats_enable (int enabled);
+
+/**
+ * @brief Включает или выключает аппаратные счетчики вызовов
+ *
+ * Включение открывает счетчики perf_event_open для вызывающего потока,
+ * перезапускает пул потоков (рабочие потоки наследуют счетчики) и
+ * включает статистику. Считаются вызывающий поток и потоки, созданные им
+ * после включения; события других уже работающих потоков программы не
+ * считаются. Счетчики общие: вызовы, идущие одновременно из считаемых
+ * потоков, получают события друг друга.
+ *
+ * @param enabled 1 - включить, 0 - выключить
+ * @return Маска открытых событий (perf_opened ()) при включении, 0 при
+ * выключении, -1 если ни одно событие не открывается
+ */
+int matrix_stats_enable_perf (int enabled);
+
+/**
+ * @brief Возвращает включенные режимы замеров
+ * @note При первом вызове читает MATRIX_STATS и MATRIX_TRACE
+ * @return Режимы MATRIX_STATS_*
+ */
+int matrix_stats_mode (void);
+
+/**
+ * @brief Включает или выключает режимы замеров
+ * @param mode Режимы MATRIX_STATS_COUNTERS и/или MATRIX_STATS_TRACE
+ * @param enabled 1 - включить, 0 - выключить
+ * @note Для трассировки используется trace_start () / trace_stop ()
+ */
+void matrix_stats_set_mode (int mode, int enabled);
+
+/**
+ * @brief Проверяет, включена ли статистика
+ * @return 1 или 0
+ */
+int matrix_stats_enabled (void);
+
+/**
+ * @brief Обнуляет накопленную статистику
+ */
+void matrix_stats_reset (void);
+
+/**
+ * @brief Возвращает статистику операции
+ * @param op Операция
+ * @param entry Статистика
+ * @return 0 при успехе, -1 для неизвестной операции
+ */
+int matrix_stats_get (MatrixOp op, MatrixStatsEntry* entry);
+
+/**
+ * @brief Возвращает итог категории по внешним вызовам
+ * @param category Категория
+ * @param entry Статистика
+ * @return 0 при успехе, -1 для неизвестной категории
+ */
+int matrix_stats_total (MatrixStatsCategory category, MatrixStatsEntry* entry);
+
+/**
+ * @brief Печатает таблицу вызванных операций и итоги категорий
+ * @param out Поток вывода
+ */
+void matrix_stats_dump (FILE* out);
+
+#endif   // STATS_H
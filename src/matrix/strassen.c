@@ -0,0 +1,312 @@
+/**
+ * @file strassen.c
+ * @brief Реализация умножения по схеме Штрассена-Винограда
+ *
+ * @details
+ * Обозначения формул Винограда:
+ * S1 = A21 + A22, S2 = S1 - A11, S3 = A11 - A21, S4 = A12 - S2
+ * T1 = B12 - B11, T2 = B22 - T1, T3 = B22 - B12, T4 = T2 - B21
+ * P1 = A11 B11, P2 = A12 B21, P3 = S4 B22, P4 = A22 T4,
+ * P5 = S1 T1, P6 = S2 T2, P7 = S3 T3
+ * C11 = P1 + P2, C12 = P1 + P6 + P5 + P3, C21 = P1 + P6 + P7 - P4,
+ * C22 = P1 + P6 + P7 + P5
+ *
+ * Порядок вычисления (strassen_split) хранит S в буфере X, T в буфере Y,
+ * а промежуточные произведения - в квадрантах C, поэтому на уровень нужно
+ * только два временных квадранта. Буферы всех уровней выделяются заранее:
+ * в каждый момент активна одна ветвь рекурсии, и уровень d пользуется
+ * буферами d независимо от ветви.
+ *
+ * Сложения квадрантов выполняются потоками пула по полосам строк.
+ *
+ * @see strassen.h
+ */
+
+#include "strassen.h"
+
+#include "gemm.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "tune.h"
+
+/// Меньше этого числа элементов сложение выполняется в одном потоке
+#define STRASSEN_PARALLEL_MIN (256 * 1024)
+
+/// Текущие параметры
+static StrassenConfig strassen_config = {STRASSEN_THRESHOLD_DEFAULT,
+                                         STRASSEN_CROSSOVER_DEFAULT};
+
+/**
+ * @struct Workspace
+ * @brief Временные квадранты уровней рекурсии
+ */
+typedef struct {
+    int    levels;                      ///< Число уровней рекурсии
+    Matrix x[STRASSEN_DEPTH_MAX];       ///< Буферы S и P1: m/2 x max (k, n)/2
+    Matrix y[STRASSEN_DEPTH_MAX];       ///< Буферы T: k/2 x n/2
+} Workspace;
+
+/**
+ * @struct CombineJob
+ * @brief Общие данные параллельного dst = a * P + b * Q
+ */
+typedef struct {
+    Matrix*       dst;     ///< Результат
+    const Matrix* p;       ///< Первое слагаемое
+    const Matrix* q;       ///< Второе слагаемое
+    MATRIX_TYPE   a, b;    ///< Коэффициенты
+    int           chunk;   ///< Строк в подзадаче
+} CombineJob;
+
+/**
+ * @brief Возвращает текущие параметры
+ *
+ * @param config Указатель на структуру для заполнения
+ */
+void strassen_get_config (StrassenConfig* config) {
+    tune_init ();
+    if (config) *config = strassen_config;
+}
+
+/**
+ * @brief Устанавливает параметры
+ *
+ * @param config Новые параметры
+ *
+ * @return 0 при успехе, -1 при некорректных параметрах
+ */
+int strassen_set_config (const StrassenConfig* config) {
+    int res = -1;
+
+    // Файл настроек загружается раньше, чтобы не заменить явные параметры
+    tune_init ();
+    if (config && config->threshold >= 0 && config->crossover > 0) {
+        strassen_config = *config;
+        res             = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Число уровней рекурсии для размеров m x k x n
+ */
+static int strassen_levels (int m, int n, int k, int crossover) {
+    int levels = 0;
+
+    while (levels < STRASSEN_DEPTH_MAX && m / 2 >= crossover &&
+           n / 2 >= crossover && k / 2 >= crossover) {
+        m /= 2;
+        n /= 2;
+        k /= 2;
+        levels++;
+    }
+
+    return levels;
+}
+
+/**
+ * @brief Проверяет, стоит ли multiply_matrices () использовать схему
+ *
+ * @param m Число строк A
+ * @param n Число столбцов B
+ * @param k Общая размерность
+ *
+ * @return 1 или 0
+ */
+int strassen_use (int m, int n, int k) {
+    tune_init ();
+    const StrassenConfig cfg   = strassen_config;
+    const int            least = m < n ? (m < k ? m : k) : (n < k ? n : k);
+
+    return cfg.threshold > 0 && least >= cfg.threshold &&
+           strassen_levels (m, n, k, cfg.crossover) > 0;
+}
+
+/**
+ * @brief Подзадача: строки полосы task для dst = a * P + b * Q
+ */
+static void combine_rows (void* ctx, int task, int worker) {
+    CombineJob*  job   = ctx;
+    SimdRowAxpby axpby = simd_kernels ()->axpby;
+    const int    first = task * job->chunk;
+    const int    last  = first + job->chunk < job->dst->rows ? first + job->chunk
+                                                             : job->dst->rows;
+
+    (void) worker;
+    for (int row = first; row < last; row++) {
+        MATRIX_TYPE*       d = MATRIX_ROW (job->dst, row);
+        const MATRIX_TYPE* p = MATRIX_ROW (job->p, row);
+        const MATRIX_TYPE* q = MATRIX_ROW (job->q, row);
+        const int          n = job->dst->cols;
+
+        // При beta = 0 строка y не читается; совпадение dst с P или Q
+        // сводится к одному вызову
+        if (d == q) {
+            axpby (n, job->a, p, job->b, d);
+        } else if (d == p) {
+            axpby (n, job->b, q, job->a, d);
+        } else {
+            axpby (n, job->b, q, 0, d);
+            axpby (n, job->a, p, 1, d);
+        }
+    }
+}
+
+/**
+ * @brief dst = a * P + b * Q; dst может совпадать с P или Q
+ */
+static void combine (Matrix* dst, MATRIX_TYPE a, const Matrix* p, MATRIX_TYPE b,
+                     const Matrix* q) {
+    const size_t size  = (size_t) dst->rows * dst->cols;
+    CombineJob   job   = {dst, p, q, a, b, 0};
+    int          tasks = thread_pool_threads () * 2;
+
+    if (size < STRASSEN_PARALLEL_MIN) tasks = 1;
+
+    if (tasks > dst->rows) tasks = dst->rows;
+    job.chunk = (dst->rows + tasks - 1) / tasks;
+    thread_pool_run ((dst->rows + job.chunk - 1) / job.chunk, combine_rows, &job);
+}
+
+/**
+ * @brief Квадрант (i, j) матрицы, разделенной на блоки rows x cols
+ */
+static Matrix quadrant (const Matrix* m, int i, int j, int rows, int cols) {
+    return matrix_view (m, i * rows, j * cols, rows, cols);
+}
+
+static int strassen_step (const Matrix* A, const Matrix* B, Matrix* C,
+                          Workspace* ws, int level);
+
+/**
+ * @brief Один уровень рекурсии: семь произведений квадрантов
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int strassen_split (const Matrix* A, const Matrix* B, Matrix* C,
+                           Workspace* ws, int level) {
+    const int m   = A->rows / 2;
+    const int k   = A->cols / 2;
+    const int n   = B->cols / 2;
+    int       res = 0;
+
+    Matrix a11 = quadrant (A, 0, 0, m, k), a12 = quadrant (A, 0, 1, m, k);
+    Matrix a21 = quadrant (A, 1, 0, m, k), a22 = quadrant (A, 1, 1, m, k);
+    Matrix b11 = quadrant (B, 0, 0, k, n), b12 = quadrant (B, 0, 1, k, n);
+    Matrix b21 = quadrant (B, 1, 0, k, n), b22 = quadrant (B, 1, 1, k, n);
+    Matrix c11 = quadrant (C, 0, 0, m, n), c12 = quadrant (C, 0, 1, m, n);
+    Matrix c21 = quadrant (C, 1, 0, m, n), c22 = quadrant (C, 1, 1, m, n);
+    Matrix x   = matrix_view (&ws->x[level], 0, 0, m, k);
+    Matrix p1  = matrix_view (&ws->x[level], 0, 0, m, n);
+    Matrix y   = matrix_view (&ws->y[level], 0, 0, k, n);
+
+    // Отсеченная нечетная часть досчитывается после четной
+    Matrix even = matrix_view (C, 0, 0, 2 * m, 2 * n);
+
+    combine (&x, 1, &a11, -1, &a21);                                  // S3
+    combine (&y, 1, &b22, -1, &b12);                                  // T3
+    res |= strassen_step (&x, &y, &c21, ws, level + 1);               // P7
+    combine (&x, 1, &a21, 1, &a22);                                   // S1
+    combine (&y, 1, &b12, -1, &b11);                                  // T1
+    res |= strassen_step (&x, &y, &c22, ws, level + 1);               // P5
+    combine (&x, 1, &x, -1, &a11);                                    // S2
+    combine (&y, 1, &b22, -1, &y);                                    // T2
+    res |= strassen_step (&x, &y, &c12, ws, level + 1);               // P6
+    combine (&x, 1, &a12, -1, &x);                                    // S4
+    res |= strassen_step (&x, &b22, &c11, ws, level + 1);             // P3
+    res |= strassen_step (&a11, &b11, &p1, ws, level + 1);            // P1
+    combine (&c12, 1, &p1, 1, &c12);                                  // U2
+    combine (&c21, 1, &c12, 1, &c21);                                 // U3
+    combine (&c12, 1, &c12, 1, &c22);                                 // U4
+    combine (&c22, 1, &c21, 1, &c22);                                 // U7
+    combine (&c12, 1, &c12, 1, &c11);                                 // U5
+    combine (&y, 1, &y, -1, &b21);                                    // T4
+    res |= strassen_step (&a22, &y, &c11, ws, level + 1);             // P4
+    combine (&c21, 1, &c21, -1, &c11);                                // U6
+    res |= strassen_step (&a12, &b21, &c11, ws, level + 1);           // P2
+    combine (&c11, 1, &c11, 1, &p1);                                  // U1
+
+    // Нечетное k: C[even] += A[:, k-1] B[k-1, :]
+    if (res == 0 && A->cols % 2) {
+        SimdRowAxpby       axpby = simd_kernels ()->axpby;
+        const MATRIX_TYPE* last  = MATRIX_ROW (B, A->cols - 1);
+
+        for (int row = 0; row < even.rows; row++)
+            axpby (even.cols, MATRIX_AT (A, row, A->cols - 1), last, 1,
+                   MATRIX_ROW (&even, row));
+    }
+
+    // Нечетное n: последний столбец строк четной части
+    if (res == 0 && B->cols % 2) {
+        res = gemm_compute (0, 0, 2 * m, 1, A->cols, A->data, A->stride,
+                            B->data + B->cols - 1, B->stride,
+                            C->data + B->cols - 1, C->stride, NULL);
+    }
+
+    // Нечетное m: последняя строка целиком
+    if (res == 0 && A->rows % 2) {
+        res = gemm_compute (0, 0, 1, B->cols, A->cols, MATRIX_ROW (A, A->rows - 1),
+                            A->stride, B->data, B->stride,
+                            MATRIX_ROW (C, A->rows - 1), C->stride, NULL);
+    }
+
+    return res ? -1 : 0;
+}
+
+/**
+ * @brief Умножение на уровне level: C = A x B
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int strassen_step (const Matrix* A, const Matrix* B, Matrix* C,
+                          Workspace* ws, int level) {
+    return level < ws->levels
+               ? strassen_split (A, B, C, ws, level)
+               : gemm_compute (0, 0, A->rows, B->cols, A->cols, A->data, A->stride,
+                               B->data, B->stride, C->data, C->stride, NULL);
+}
+
+/**
+ * @brief Вычисляет result = A x B по схеме Штрассена-Винограда
+ *
+ * @param A Матрица m x k
+ * @param B Матрица k x n
+ * @param result Матрица m x n
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int strassen_multiply (const Matrix* A, const Matrix* B, Matrix* result) {
+    Workspace ws  = {0};
+    int       res = -1;
+
+    tune_init ();
+    if (A && B && result && A->data && B->data && result->data &&
+        A->cols == B->rows && result->rows == A->rows && result->cols == B->cols &&
+        A->dtype == MATRIX_FLOAT64 && B->dtype == MATRIX_FLOAT64 &&
+        result->dtype == MATRIX_FLOAT64) {
+        int m = A->rows;
+        int n = B->cols;
+        int k = A->cols;
+
+        ws.levels = strassen_levels (m, n, k, strassen_config.crossover);
+        res       = 0;
+        for (int level = 0; level < ws.levels && res == 0; level++) {
+            m /= 2;
+            n /= 2;
+            k /= 2;
+            ws.x[level] = create_matrix (m, k > n ? k : n);
+            ws.y[level] = create_matrix (k, n);
+            if (!ws.x[level].data || !ws.y[level].data) res = -1;
+        }
+    }
+
+    if (res == 0) res = strassen_step (A, B, result, &ws, 0);
+
+    for (int level = 0; level < ws.levels; level++) {
+        free_matrix (&ws.x[level]);
+        free_matrix (&ws.y[level]);
+    }
+
+    return res;
+}
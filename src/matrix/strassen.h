@@ -0,0 +1,85 @@
+/**
+ * @file strassen.h
+ * @brief Умножение матриц по схеме Штрассена-Винограда
+ *
+ * @details
+ * Произведение делится на квадранты, и вместо восьми умножений половинного
+ * размера выполняется семь плюс пятнадцать сложений квадрантов. Рекурсия
+ * продолжается, пока квадрант не меньше размера перехода crossover, затем
+ * работает блочный GEMM (gemm.h). Каждый уровень экономит 1/8 умножений,
+ * поэтому выигрыш заметен только на очень больших матрицах.
+ *
+ * Рабочая память - два временных квадранта на уровень рекурсии (схема
+ * Бойера-Дюма-Перне-Чжоу), выделяется один раз перед вычислением и не
+ * превышает трети суммарного размера A, B и результата. Нечетные размеры
+ * обрабатываются отсечением крайней строки и столбца, они досчитываются
+ * отдельно.
+ *
+ * multiply_matrices () переключается на эту схему, когда наименьший из
+ * размеров m, n, k не меньше порога threshold. Порог и размер перехода
+ * подбираются под процессор tune_run () (tune.h).
+ *
+ * @note Погрешность схемы больше, чем у классического умножения (оценка
+ * нормы вместо поэлементной), порядка 10 * eps * ||A|| ||B|| на уровень
+ *
+ * @see gemm.h matrix.h
+ */
+
+#ifndef STRASSEN_H
+#define STRASSEN_H
+
+#include "matrix.h"
+
+/// Порог по умолчанию: наименьший размер, с которого работает схема
+#define STRASSEN_THRESHOLD_DEFAULT 4096
+
+/// Размер перехода по умолчанию: наименьшая сторона квадранта рекурсии
+#define STRASSEN_CROSSOVER_DEFAULT 1024
+
+/// Наибольшая глубина рекурсии
+#define STRASSEN_DEPTH_MAX 16
+
+/**
+ * @struct StrassenConfig
+ * @brief Параметры переключения на схему Штрассена-Винограда
+ */
+typedef struct {
+    int threshold;   ///< Наименьший размер для multiply_matrices (), 0 - выключено
+    int crossover;   ///< Наименьшая сторона квадранта, ниже - GEMM
+} StrassenConfig;
+
+/**
+ * @brief Возвращает текущие параметры
+ * @param config Указатель на структуру для заполнения
+ */
+void strassen_get_config (StrassenConfig* config);
+
+/**
+ * @brief Устанавливает параметры
+ * @param config Новые параметры: threshold >= 0, crossover > 0
+ * @return 0 при успехе, -1 при некорректных параметрах
+ */
+int strassen_set_config (const StrassenConfig* config);
+
+/**
+ * @brief Проверяет, стоит ли multiply_matrices () использовать схему
+ * @param m Число строк A
+ * @param n Число столбцов B
+ * @param k Общая размерность
+ * @return 1, если min (m, n, k) >= threshold и хотя бы один уровень
+ * рекурсии не меньше crossover, иначе 0
+ */
+int strassen_use (int m, int n, int k);
+
+/**
+ * @brief Вычисляет result = A x B по схеме Штрассена-Винограда
+ * @param A Матрица m x k
+ * @param B Матрица k x n
+ * @param result Матрица m x n, не пересекается с A и B
+ * @note Порог threshold не проверяется; если квадрант меньше crossover,
+ * умножение сразу выполняет GEMM
+ * @return 0 при успехе, -1 при ошибке
+ */
+int strassen_multiply (const Matrix* A, const Matrix* B, Matrix* result);
+
+#endif   // STRASSEN_H
@@ -0,0 +1,282 @@
+/**
+ * @file thread_pool.c
+ * @brief Реализация постоянного пула потоков
+ *
+ * @details
+ * Рабочие потоки ждут на условной переменной смены номера поколения.
+ * Вызывающий поток публикует задачу, увеличивает поколение, сам разбирает
+ * подзадачи вместе с рабочими и ждет, пока каждый рабочий отметится
+ * о завершении. Следующая задача публикуется только после этого, поэтому
+ * ни один рабочий не пропускает поколение.
+ *
+ * @see thread_pool.h
+ */
+
+#include "thread_pool.h"
+
+#include "trace.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * @struct ThreadPool
+ * @brief Состояние пула и текущей задачи
+ */
+typedef struct {
+    pthread_mutex_t lock;         ///< Защищает поля ниже
+    pthread_cond_t  wake;         ///< Сигнал рабочим о новой задаче
+    pthread_cond_t  done;         ///< Сигнал вызывающему о завершении
+    pthread_t*      workers;      ///< Рабочие потоки (threads - 1 штук)
+    int             count;        ///< Число запущенных рабочих потоков
+    int             threads;      ///< Заданное число потоков, 0 - не задано
+    unsigned long   generation;   ///< Номер последней опубликованной задачи
+    unsigned long   spawned;      ///< Поколение на момент запуска рабочих
+    int             stop;         ///< Флаг остановки рабочих
+    int             active;       ///< Рабочие, не закончившие текущую задачу
+    ThreadPoolTask  fn;           ///< Функция текущей задачи
+    void*           ctx;          ///< Контекст текущей задачи
+    int             tasks;        ///< Число подзадач текущей задачи
+    int             limit;        ///< Потоки с номером от limit пропускают ее
+    atomic_int      next;         ///< Следующая неразобранная подзадача
+} ThreadPool;
+
+static ThreadPool pool = {.lock = PTHREAD_MUTEX_INITIALIZER,
+                          .wake = PTHREAD_COND_INITIALIZER,
+                          .done = PTHREAD_COND_INITIALIZER};
+
+/// Сериализует вызовы thread_pool_run из разных пользовательских потоков
+static pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/// 1 в потоках пула: вложенные вызовы выполняются последовательно
+static _Thread_local int inside_pool = 0;
+
+/**
+ * @brief Разбирает подзадачи текущей задачи до исчерпания
+ *
+ * Участие потока в задаче - один интервал на временной шкале (trace.h).
+ */
+static void run_tasks (int worker) {
+    int task;
+
+    TRACE_BEGIN ("thread_pool_run", "thread_pool");
+    while ((task = atomic_fetch_add_explicit (&pool.next, 1,
+                                              memory_order_relaxed)) < pool.tasks) {
+        pool.fn (pool.ctx, task, worker);
+    }
+    TRACE_END ("thread_pool_run", "thread_pool");
+}
+
+/**
+ * @brief Цикл рабочего потока
+ *
+ * @param arg Номер потока (1..count), упакованный в указатель
+ */
+static void* worker_main (void* arg) {
+    const int     worker = (int) (size_t) arg;
+    unsigned long seen;
+
+    inside_pool = 1;
+    trace_name_thread ("worker", worker);
+
+    // Не pool.generation: задача может быть опубликована раньше, чем
+    // поток впервые захватит pool.lock, и тогда он ее пропустит
+    pthread_mutex_lock (&pool.lock);
+    seen = pool.spawned;
+    for (;;) {
+        while (!pool.stop && pool.generation == seen) {
+            pthread_cond_wait (&pool.wake, &pool.lock);
+        }
+        if (pool.stop) break;
+        seen             = pool.generation;
+        const int joined = worker < pool.limit;
+        pthread_mutex_unlock (&pool.lock);
+
+        if (joined) run_tasks (worker);
+
+        pthread_mutex_lock (&pool.lock);
+        if (--pool.active == 0) pthread_cond_signal (&pool.done);
+    }
+    pthread_mutex_unlock (&pool.lock);
+
+    return NULL;
+}
+
+/**
+ * @brief Число потоков по умолчанию: MATRIX_THREADS или число ядер
+ */
+static int default_threads (void) {
+    const char* env = getenv ("MATRIX_THREADS");
+    long        res = env ? strtol (env, NULL, 10) : 0;
+
+    if (res <= 0) res = sysconf (_SC_NPROCESSORS_ONLN);
+    if (res <= 0) res = 1;
+
+    return (int) res;
+}
+
+/**
+ * @brief Запускает рабочие потоки, если они еще не запущены
+ *
+ * Вызывается под run_lock. Рабочие начинают отсчет с поколения spawned,
+ * поэтому задача, опубликованная до их первого захвата pool.lock, не
+ * будет пропущена.
+ *
+ * @return Число запущенных рабочих потоков
+ */
+static int ensure_started (void) {
+    static int exit_registered = 0;
+    const int  wanted          = thread_pool_threads () - 1;
+
+    if (pool.count == 0 && wanted > 0) {
+        pthread_mutex_lock (&pool.lock);
+        pool.spawned = pool.generation;
+        pool.workers = malloc ((size_t) wanted * sizeof (pthread_t));
+        if (pool.workers) {
+            for (int i = 0; i < wanted; i++) {
+                if (pthread_create (&pool.workers[i], NULL, worker_main,
+                                    (void*) (size_t) (i + 1)) != 0)
+                    break;
+                pool.count++;
+            }
+        }
+        pthread_mutex_unlock (&pool.lock);
+
+        if (!exit_registered) {
+            atexit (thread_pool_shutdown);
+            exit_registered = 1;
+        }
+    }
+
+    return pool.count;
+}
+
+/**
+ * @brief Останавливает рабочие потоки (вызывается под run_lock)
+ */
+static void stop_workers (void) {
+    pthread_mutex_lock (&pool.lock);
+    pool.stop = 1;
+    pthread_cond_broadcast (&pool.wake);
+    pthread_mutex_unlock (&pool.lock);
+
+    for (int i = 0; i < pool.count; i++) pthread_join (pool.workers[i], NULL);
+
+    free (pool.workers);
+    pool.workers = NULL;
+    pool.count   = 0;
+    pool.stop    = 0;
+}
+
+/**
+ * @brief Возвращает число потоков, с которым работает пул
+ *
+ * @return Число потоков (не меньше 1)
+ */
+int thread_pool_threads (void) {
+    pthread_mutex_lock (&pool.lock);
+    if (pool.threads == 0) pool.threads = default_threads ();
+    int res = pool.threads;
+    pthread_mutex_unlock (&pool.lock);
+
+    return res;
+}
+
+/**
+ * @brief Задает число потоков пула
+ *
+ * @param threads Число потоков, 0 - по числу доступных ядер
+ *
+ * @return 0 при успехе, -1 при некорректном значении
+ */
+int thread_pool_set_threads (int threads) {
+    int res = -1;
+
+    if (threads >= 0) {
+        pthread_mutex_lock (&run_lock);
+        stop_workers ();
+        pthread_mutex_lock (&pool.lock);
+        pool.threads = threads > 0 ? threads : default_threads ();
+        pthread_mutex_unlock (&pool.lock);
+        pthread_mutex_unlock (&run_lock);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Выполняет подзадачи 0..tasks-1 на потоках пула
+ *
+ * @param tasks Количество подзадач
+ * @param fn Функция подзадачи
+ * @param ctx Контекст, передаваемый в fn
+ *
+ * @return 0 после завершения всех подзадач, -1 при ошибке аргументов
+ */
+int thread_pool_run (int tasks, ThreadPoolTask fn, void* ctx) {
+    return thread_pool_run_workers (tasks, INT_MAX, fn, ctx);
+}
+
+/**
+ * @brief Выполняет подзадачи, передавая fn номера потоков меньше workers
+ *
+ * @param tasks Количество подзадач
+ * @param workers Число буферов потоков у вызывающего
+ * @param fn Функция подзадачи
+ * @param ctx Контекст, передаваемый в fn
+ *
+ * @return 0 после завершения всех подзадач, -1 при ошибке аргументов
+ */
+int thread_pool_run_workers (int tasks, int workers, ThreadPoolTask fn, void* ctx) {
+    int res      = -1;
+    int parallel = 0;
+
+    if (tasks >= 0 && workers > 0 && fn != NULL) {
+        res = 0;
+        if (!inside_pool && tasks > 1 && workers > 1 &&
+            thread_pool_threads () > 1 && pthread_mutex_trylock (&run_lock) == 0) {
+            parallel = ensure_started () > 0;
+            if (!parallel) pthread_mutex_unlock (&run_lock);
+        }
+
+        if (!parallel) {
+            for (int task = 0; task < tasks; task++) fn (ctx, task, 0);
+        } else {
+            pthread_mutex_lock (&pool.lock);
+            pool.fn     = fn;
+            pool.ctx    = ctx;
+            pool.tasks  = tasks;
+            pool.limit  = workers;
+            pool.active = pool.count;
+            atomic_store_explicit (&pool.next, 0, memory_order_relaxed);
+            pool.generation++;
+            pthread_cond_broadcast (&pool.wake);
+            pthread_mutex_unlock (&pool.lock);
+
+            inside_pool = 1;
+            run_tasks (0);
+            inside_pool = 0;
+
+            pthread_mutex_lock (&pool.lock);
+            while (pool.active > 0) pthread_cond_wait (&pool.done, &pool.lock);
+            pthread_mutex_unlock (&pool.lock);
+
+            pthread_mutex_unlock (&run_lock);
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief Останавливает и освобождает потоки пула
+ */
+void thread_pool_shutdown (void) {
+    pthread_mutex_lock (&run_lock);
+    stop_workers ();
+    pthread_mutex_unlock (&run_lock);
+}
@@ -0,0 +1,73 @@
+/**
+ * @file thread_pool.h
+ * @brief Постоянный пул потоков библиотеки
+ *
+ * @details
+ * Потоки создаются один раз при первой параллельной операции и живут до
+ * завершения программы или вызова thread_pool_shutdown (). Задача пула -
+ * параллельный цикл по номерам подзадач: потоки разбирают номера через
+ * общий атомарный счетчик, вызывающий поток участвует в работе наравне
+ * с остальными.
+ *
+ * Число потоков задается вызовом thread_pool_set_threads () или переменной
+ * окружения MATRIX_THREADS, по умолчанию равно числу доступных ядер.
+ *
+ * @see gemm.h
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/**
+ * @brief Функция одной подзадачи
+ * @param ctx Общий контекст задачи
+ * @param task Номер подзадачи от 0 до tasks - 1
+ * @param worker Номер потока от 0 до thread_pool_threads () - 1
+ */
+typedef void (*ThreadPoolTask) (void* ctx, int task, int worker);
+
+/**
+ * @brief Возвращает число потоков, с которым работает пул
+ * @return Число потоков (не меньше 1)
+ */
+int thread_pool_threads (void);
+
+/**
+ * @brief Задает число потоков пула
+ * @param threads Число потоков, 0 - по числу доступных ядер
+ * @note Работающие потоки останавливаются, новые создаются при следующем
+ * вызове thread_pool_run ()
+ * @return 0 при успехе, -1 при некорректном значении
+ */
+int thread_pool_set_threads (int threads);
+
+/**
+ * @brief Выполняет подзадачи 0..tasks-1 на потоках пула
+ * @param tasks Количество подзадач
+ * @param fn Функция подзадачи
+ * @param ctx Контекст, передаваемый в fn
+ * @note Вызов из потока пула или параллельно с другим вызовом выполняется
+ * последовательно в вызывающем потоке с worker = 0
+ * @return 0 после завершения всех подзадач, -1 при ошибке аргументов
+ */
+int thread_pool_run (int tasks, ThreadPoolTask fn, void* ctx);
+
+/**
+ * @brief Выполняет подзадачи, передавая fn номера потоков меньше workers
+ * @param tasks Количество подзадач
+ * @param workers Число буферов потоков у вызывающего (не меньше 1)
+ * @param fn Функция подзадачи
+ * @param ctx Контекст, передаваемый в fn
+ * @note Буферы по числу thread_pool_threads () может опередить
+ * thread_pool_set_threads () из другого потока; лишние потоки пула тогда
+ * пропускают задачу, и номер worker не выходит за буферы
+ * @return 0 после завершения всех подзадач, -1 при ошибке аргументов
+ */
+int thread_pool_run_workers (int tasks, int workers, ThreadPoolTask fn, void* ctx);
+
+/**
+ * @brief Останавливает и освобождает потоки пула
+ */
+void thread_pool_shutdown (void);
+
+#endif   // THREAD_POOL_H
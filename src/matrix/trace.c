@@ -0,0 +1,225 @@
+/**
+ * @file trace.c
+ * @brief Запись временной шкалы в формате Chrome trace event
+ *
+ * @details
+ * События пишутся в поток stdio под мьютексом, по строке на событие.
+ * Номер потока на шкале выдается при первом событии потока, вместе с ним
+ * пишется событие "M" с подписью потока. Номер трассы (generation)
+ * отличает потоки, подписанные в прежнем файле.
+ *
+ * @see trace.h
+ */
+
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/// Длина подписи потока
+#define TRACE_NAME_SIZE 32
+
+/**
+ * @struct TraceFile
+ * @brief Состояние записываемой трассы
+ */
+typedef struct {
+    pthread_mutex_t lock;         ///< Защищает поля ниже
+    FILE*           out;          ///< Файл трассы, NULL - трасса не пишется
+    uint64_t        origin;       ///< Время начала трассы, нс
+    int             pid;          ///< Номер процесса для событий
+    int             generation;   ///< Номер трассы
+    int             first;        ///< Следующее событие - первое в файле
+} TraceFile;
+
+static TraceFile trace = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+/// Следующий свободный номер потока на шкале
+static atomic_int trace_next_tid = 1;
+
+/// Номер текущего потока на шкале, 0 - не выдан
+static _Thread_local int trace_tid = 0;
+
+/// Трасса, в которой поток уже подписан
+static _Thread_local int trace_named = 0;
+
+/// Подпись текущего потока
+static _Thread_local char trace_thread[TRACE_NAME_SIZE] = "";
+
+/**
+ * @brief Монотонное время в наносекундах
+ */
+uint64_t trace_now (void) {
+    struct timespec now;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * @brief Пишет строку JSON с экранированием
+ */
+void trace_json_string (FILE* out, const char* value) {
+    fputc ('"', out);
+    for (const char* p = value ? value : ""; *p; p++) {
+        if (*p == '"' || *p == '\\') fprintf (out, "\\%c", *p);
+        else if ((unsigned char) *p < 0x20) fprintf (out, "\\u%04x", *p);
+        else fputc (*p, out);
+    }
+    fputc ('"', out);
+}
+
+/**
+ * @brief Начинает событие: разделитель, подпись потока, общие поля
+ *
+ * Вызывается под trace.lock при открытом файле.
+ */
+static void event_head (const char* name, const char* category, char phase,
+                        uint64_t at) {
+    FILE* out = trace.out;
+
+    if (trace_tid == 0) trace_tid = atomic_fetch_add (&trace_next_tid, 1);
+    if (trace_named != trace.generation) {
+        fprintf (out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, "
+                      "\"tid\": %d, \"args\": {\"name\": ",
+                 trace.first ? "" : ",\n", trace.pid, trace_tid);
+        trace_json_string (out, trace_thread[0] ? trace_thread : "thread");
+        fprintf (out, "}}");
+        trace.first = 0;
+        trace_named = trace.generation;
+    }
+
+    fprintf (out, "%s{\"name\": ", trace.first ? "" : ",\n");
+    trace_json_string (out, name);
+    fprintf (out, ", \"cat\": ");
+    trace_json_string (out, category);
+    fprintf (out, ", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": %d, \"tid\": %d", phase,
+             (double) (at - trace.origin) / 1e3, trace.pid, trace_tid);
+    trace.first = 0;
+}
+
+/**
+ * @brief Записывает событие "B" или "E"
+ */
+static void trace_event (const char* name, const char* category, char phase) {
+    const uint64_t at = trace_now ();
+
+    pthread_mutex_lock (&trace.lock);
+    if (trace.out && at >= trace.origin) {
+        event_head (name, category, phase, at);
+        fputc ('}', trace.out);
+    }
+    pthread_mutex_unlock (&trace.lock);
+}
+
+/**
+ * @brief Записывает начало интервала
+ */
+void trace_begin (const char* name, const char* category) {
+    // Флаг может быть поднят только потому, что MATRIX_TRACE еще не прочитана
+    if (trace_enabled ()) trace_event (name, category, 'B');
+}
+
+/**
+ * @brief Записывает конец интервала
+ */
+void trace_end (const char* name, const char* category) {
+    if (trace_enabled ()) trace_event (name, category, 'E');
+}
+
+/**
+ * @brief Записывает завершенный интервал с аргументами
+ */
+void trace_complete (const char* name, const char* category, uint64_t start_ns,
+                     const char* args) {
+    const uint64_t at = trace_now ();
+
+    pthread_mutex_lock (&trace.lock);
+    if (trace.out && start_ns >= trace.origin) {
+        event_head (name, category, 'X', start_ns);
+        fprintf (trace.out, ", \"dur\": %.3f", (double) (at - start_ns) / 1e3);
+        if (args) fprintf (trace.out, ", \"args\": %s", args);
+        fputc ('}', trace.out);
+    }
+    pthread_mutex_unlock (&trace.lock);
+}
+
+/**
+ * @brief Подписывает текущий поток
+ */
+void trace_name_thread (const char* name, int index) {
+    if (index >= 0)
+        snprintf (trace_thread, sizeof trace_thread, "%s %d", name, index);
+    else snprintf (trace_thread, sizeof trace_thread, "%s", name);
+    trace_named = 0;
+}
+
+/**
+ * @brief Дописывает трассу при выходе из программы
+ */
+static void trace_exit (void) {
+    trace_stop ();
+}
+
+/**
+ * @brief Начинает запись трассы в файл
+ */
+int trace_start (const char* filename) {
+    static int exit_registered = 0;
+    FILE*      out             = NULL;
+    int        res             = -1;
+
+    // MATRIX_TRACE читается раньше, чтобы явный вызов заменил трассу из нее
+    matrix_stats_mode ();
+    out = filename ? fopen (filename, "w") : NULL;
+    if (out) {
+        trace_stop ();
+        pthread_mutex_lock (&trace.lock);
+        fprintf (out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+        trace.out    = out;
+        trace.origin = trace_now ();
+        trace.pid    = (int) getpid ();
+        trace.first  = 1;
+        trace.generation++;
+        if (!exit_registered) {
+            atexit (trace_exit);
+            exit_registered = 1;
+        }
+        pthread_mutex_unlock (&trace.lock);
+
+        if (!trace_thread[0]) trace_name_thread ("main", -1);
+        matrix_stats_set_mode (MATRIX_STATS_TRACE, 1);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Завершает трассу и закрывает файл
+ */
+int trace_stop (void) {
+    int res = -1;
+
+    pthread_mutex_lock (&trace.lock);
+    if (trace.out) {
+        matrix_stats_set_mode (MATRIX_STATS_TRACE, 0);
+        fprintf (trace.out, "\n]}\n");
+        res       = fclose (trace.out) == 0 ? 0 : -1;
+        trace.out = NULL;
+    }
+    pthread_mutex_unlock (&trace.lock);
+
+    return res;
+}
+
+/**
+ * @brief Проверяет, пишется ли трасса
+ */
+int trace_enabled (void) {
+    return (matrix_stats_mode () & MATRIX_STATS_TRACE) != 0;
+}
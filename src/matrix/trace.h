@@ -0,0 +1,132 @@
+/**
+ * @file trace.h
+ * @brief Временная шкала в формате Chrome trace event
+ *
+ * @details
+ * В режиме трассировки библиотека пишет файл JSON, который открывается в
+ * chrome://tracing и ui.perfetto.dev. Интервалы начала и конца ("B"/"E")
+ * получают:
+ * - публичные операции matrix.c и output.c (через замеры stats.h);
+ * - участие каждого потока пула в задаче thread_pool_run ();
+ * - тайлы блочного умножения (gemm.c) с координатами тайла;
+ * - этапы программы, отмеченные TRACE_BEGIN / TRACE_END (main.c).
+ *
+ * На шкале видны простои потоков, неравномерность тайлов и перекрытие
+ * ввода-вывода с вычислениями. Время - микросекунды от начала трассы,
+ * потоки подписаны ("main", "worker 1", ...).
+ *
+ * Трассировку включает переменная окружения MATRIX_TRACE (путь файла,
+ * читается при первой операции) или trace_start (). Файл дописывается при
+ * trace_stop () или при выходе из программы. Выключенная трассировка
+ * стоит одного чтения флага на интервал.
+ *
+ * @code
+ * trace_start ("trace.json");
+ * TRACE_BEGIN ("compute", "stage");
+ * multiply_matrices (&A, &B, &C);
+ * TRACE_END ("compute", "stage");
+ * trace_stop ();
+ * @endcode
+ *
+ * @see stats.h
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "stats.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Проверяет флаг трассировки (до чтения MATRIX_TRACE - истина)
+ */
+#define TRACE_ACTIVE()                                                         \
+    (atomic_load_explicit (&matrix_stats_on, memory_order_relaxed) &          \
+     MATRIX_STATS_TRACE)
+
+/**
+ * @brief Начинает интервал name категории category в текущем потоке
+ */
+#define TRACE_BEGIN(name, category)                                            \
+    do {                                                                       \
+        if (TRACE_ACTIVE ()) trace_begin ((name), (category));                 \
+    } while (0)
+
+/**
+ * @brief Завершает интервал, начатый TRACE_BEGIN
+ */
+#define TRACE_END(name, category)                                              \
+    do {                                                                       \
+        if (TRACE_ACTIVE ()) trace_end ((name), (category));                   \
+    } while (0)
+
+/**
+ * @brief Начинает запись трассы в файл
+ * @param filename Путь файла JSON
+ * @note Прежняя трасса завершается. Завершение при выходе регистрируется
+ * автоматически
+ * @return 0 при успехе, -1 если файл не открывается
+ */
+int trace_start (const char* filename);
+
+/**
+ * @brief Завершает трассу и закрывает файл
+ * @return 0 при успехе, -1 при ошибке записи или если трасса не начата
+ */
+int trace_stop (void);
+
+/**
+ * @brief Проверяет, пишется ли трасса
+ * @return 1 или 0
+ */
+int trace_enabled (void);
+
+/**
+ * @brief Записывает начало интервала ("B") в текущем потоке
+ * @param name Имя интервала
+ * @param category Категория ("matrix", "thread_pool", "gemm", "stage", ...)
+ */
+void trace_begin (const char* name, const char* category);
+
+/**
+ * @brief Записывает конец интервала ("E") в текущем потоке
+ * @param name Имя интервала
+ * @param category Категория
+ */
+void trace_end (const char* name, const char* category);
+
+/**
+ * @brief Записывает завершенный интервал ("X") с аргументами
+ * @param name Имя интервала
+ * @param category Категория
+ * @param start_ns Начало интервала по trace_now ()
+ * @param args Объект JSON аргументов ("{\"ic\": 0}") или NULL
+ */
+void trace_complete (const char* name, const char* category, uint64_t start_ns,
+                     const char* args);
+
+/**
+ * @brief Монотонное время в наносекундах
+ * @note Общие часы библиотеки: замеры stats.h, начала интервалов
+ * trace_complete (), подбор tune.h и замеры bench
+ */
+uint64_t trace_now (void);
+
+/**
+ * @brief Пишет строку JSON в кавычках с экранированием кавычек, обратной
+ * косой черты и управляющих символов
+ * @param out Поток
+ * @param value Строка (NULL - пустая строка)
+ */
+void trace_json_string (FILE* out, const char* value);
+
+/**
+ * @brief Подписывает текущий поток на шкале ("worker 3")
+ * @param name Имя потока
+ * @param index Номер, дописываемый к имени, или -1
+ */
+void trace_name_thread (const char* name, int index);
+
+#endif   // TRACE_H
@@ -0,0 +1,253 @@
+/**
+ * @file transpose.c
+ * @brief Кэш-независимое транспонирование матриц
+ *
+ * @details
+ * Все варианты делят матрицу пополам по большей стороне, пока блок не станет
+ * меньше TRANSPOSE_LEAF x TRANSPOSE_LEAF. На каждом уровне кэша найдется
+ * размер блока, целиком помещающийся в него, поэтому подбирать размеры под
+ * конкретный процессор не нужно.
+ *
+ * - transpose_matrix_into - в заранее созданную матрицу
+ * - transpose_matrix_inplace - на месте: обмен блоков для квадратной матрицы,
+ *   обход циклов перестановки для прямоугольной
+ *
+ * Матрицы других типов (dtype.h) транспонируются блочным ядром своего типа,
+ * на месте - не поддерживаются.
+ *
+ * @see matrix.h simd.h
+ */
+
+#include "matrix.h"
+
+#include "dtype.h"
+#include "simd.h"
+#include "small.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Сторона листового блока рекурсии (два блока помещаются в L1)
+#define TRANSPOSE_LEAF 32
+
+/**
+ * @brief Транспонирует лист src[r0:r1, c0:c1] в dst
+ *
+ * Полные квадратные блоки переставляются векторным ядром, края -
+ * поэлементно.
+ */
+static void transpose_leaf (const SimdKernels* kernels, const Matrix* src,
+                            Matrix* dst, int r0, int r1, int c0, int c1) {
+    const int tb   = kernels->transpose_block;
+    const int rows = r0 + (r1 - r0) / tb * tb;
+    const int cols = c0 + (c1 - c0) / tb * tb;
+
+    for (int row = r0; row < rows; row += tb) {
+        for (int col = c0; col < cols; col += tb) {
+            kernels->transpose (&MATRIX_AT (src, row, col), src->stride,
+                                &MATRIX_AT (dst, col, row), dst->stride);
+        }
+    }
+
+    // Края, не покрытые полными блоками
+    for (int row = r0; row < r1; row++) {
+        for (int col = row < rows ? cols : c0; col < c1; col++) {
+            MATRIX_AT (dst, col, row) = MATRIX_AT (src, row, col);
+        }
+    }
+}
+
+/**
+ * @brief Рекурсивное транспонирование src[r0:r1, c0:c1] в dst
+ */
+static void transpose_recursive (const SimdKernels* kernels, const Matrix* src,
+                                 Matrix* dst, int r0, int r1, int c0, int c1) {
+    if (r1 - r0 <= TRANSPOSE_LEAF && c1 - c0 <= TRANSPOSE_LEAF) {
+        transpose_leaf (kernels, src, dst, r0, r1, c0, c1);
+    } else if (r1 - r0 >= c1 - c0) {
+        int mid = r0 + (r1 - r0) / 2;
+        transpose_recursive (kernels, src, dst, r0, mid, c0, c1);
+        transpose_recursive (kernels, src, dst, mid, r1, c0, c1);
+    } else {
+        int mid = c0 + (c1 - c0) / 2;
+        transpose_recursive (kernels, src, dst, r0, r1, c0, mid);
+        transpose_recursive (kernels, src, dst, r0, r1, mid, c1);
+    }
+}
+
+/**
+ * @brief Транспонирует матрицу в заранее созданную матрицу
+ *
+ * @param matrix Исходная матрица rows x cols
+ * @param result Матрица cols x rows для результата
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int transpose_matrix_into (const Matrix* matrix, Matrix* result) {
+    int res = -1;
+
+    if (matrix != NULL && result != NULL &&
+        (matrix->dtype != MATRIX_FLOAT64 || result->dtype != MATRIX_FLOAT64)) {
+        res = dtype_transpose (matrix, result);
+    } else if (matrix != NULL && result != NULL && matrix->data != NULL &&
+               result->data != NULL && matrix->data != result->data &&
+               result->rows == matrix->cols && result->cols == matrix->rows) {
+        const SmallKernels* small =
+            matrix->rows == matrix->cols ? small_kernels (matrix->rows) : NULL;
+
+        if (small != NULL)
+            small->transpose (matrix->data, matrix->stride, result->data,
+                              result->stride);
+        else
+            transpose_recursive (simd_kernels (), matrix, result, 0, matrix->rows, 0,
+                                 matrix->cols);
+        res = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Обменивает блок [r0:r1, c0:c1] с блоком [c0:c1, r0:r1] транспонированно
+ *
+ * Блоки лежат по разные стороны от диагонали и не пересекаются.
+ */
+static void swap_recursive (Matrix* m, int r0, int r1, int c0, int c1) {
+    if (r1 - r0 <= TRANSPOSE_LEAF && c1 - c0 <= TRANSPOSE_LEAF) {
+        for (int row = r0; row < r1; row++) {
+            for (int col = c0; col < c1; col++) {
+                MATRIX_TYPE tmp         = MATRIX_AT (m, row, col);
+                MATRIX_AT (m, row, col) = MATRIX_AT (m, col, row);
+                MATRIX_AT (m, col, row) = tmp;
+            }
+        }
+    } else if (r1 - r0 >= c1 - c0) {
+        int mid = r0 + (r1 - r0) / 2;
+        swap_recursive (m, r0, mid, c0, c1);
+        swap_recursive (m, mid, r1, c0, c1);
+    } else {
+        int mid = c0 + (c1 - c0) / 2;
+        swap_recursive (m, r0, r1, c0, mid);
+        swap_recursive (m, r0, r1, mid, c1);
+    }
+}
+
+/**
+ * @brief Транспонирует на месте диагональный блок [lo:hi, lo:hi]
+ */
+static void square_recursive (Matrix* m, int lo, int hi) {
+    if (hi - lo <= TRANSPOSE_LEAF) {
+        for (int row = lo; row < hi; row++) {
+            for (int col = row + 1; col < hi; col++) {
+                MATRIX_TYPE tmp         = MATRIX_AT (m, row, col);
+                MATRIX_AT (m, row, col) = MATRIX_AT (m, col, row);
+                MATRIX_AT (m, col, row) = tmp;
+            }
+        }
+    } else {
+        int mid = lo + (hi - lo) / 2;
+        square_recursive (m, lo, mid);
+        square_recursive (m, mid, hi);
+        swap_recursive (m, mid, hi, lo, mid);
+    }
+}
+
+/**
+ * @brief Транспонирует на месте плотный массив rows x cols обходом циклов
+ *
+ * Элемент с индексом i (кроме первого и последнего) переходит на место
+ * i * rows mod (rows * cols - 1). Пройденные позиции отмечаются в битовой
+ * маске visited размером rows * cols бит (1/64 объема данных для double).
+ */
+static void cycle_transpose (MATRIX_TYPE* data, int rows, int cols,
+                             uint64_t* visited) {
+    const size_t total   = (size_t) rows * cols;
+    const size_t modulus = total - 1;
+
+    for (size_t start = 1; start + 1 < total; start++) {
+        if (visited[start / 64] & ((uint64_t) 1 << (start % 64))) continue;
+
+        // Сдвигаем значения вдоль цикла, начинающегося в start
+        size_t      pos   = start;
+        MATRIX_TYPE carry = data[start];
+        do {
+            size_t next = (size_t) ((unsigned __int128) pos * rows % modulus);
+            MATRIX_TYPE saved = data[next];
+            data[next]        = carry;
+            carry             = saved;
+            visited[next / 64] |= (uint64_t) 1 << (next % 64);
+            pos = next;
+        } while (pos != start);
+    }
+}
+
+/**
+ * @brief Транспонирует матрицу на месте
+ *
+ * Квадратная матрица транспонируется рекурсивным обменом блоков
+ * относительно диагонали без дополнительной памяти.
+ *
+ * Прямоугольная матрица сначала уплотняется до шага cols, затем
+ * переставляется обходом циклов и, если позволяет размер буфера,
+ * снова раскладывается с выровненным шагом MATRIX_STRIDE (rows).
+ * Иначе шаг результата равен новому числу столбцов. Прямоугольное
+ * представление (MATRIX_VIEW) не транспонируется: буфер общий с родителем.
+ *
+ * @param matrix Указатель на матрицу
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int transpose_matrix_inplace (Matrix* matrix) {
+    int res = -1;
+
+    if (matrix != NULL && matrix->data != NULL && matrix->rows > 0 &&
+        matrix->cols > 0 && matrix->dtype == MATRIX_FLOAT64) {
+        const SmallKernels* small = small_kernels (matrix->rows);
+
+        if (matrix->rows == matrix->cols && small != NULL) {
+            small->transpose_inplace (matrix->data, matrix->stride);
+            res = 0;
+        } else if (matrix->rows == matrix->cols) {
+            square_recursive (matrix, 0, matrix->rows);
+            res = 0;
+        } else if (matrix->storage != MATRIX_VIEW) {
+            const int    rows     = matrix->rows;
+            const int    cols     = matrix->cols;
+            const size_t capacity = (size_t) rows * matrix->stride;
+            const int    aligned  = MATRIX_STRIDE (rows);
+            uint64_t*    visited =
+                calloc (((size_t) rows * cols + 63) / 64, sizeof (uint64_t));
+
+            if (visited) {
+                // Уплотнение строк: каждая строка сдвигается только влево
+                for (int row = 1; row < rows; row++) {
+                    memmove (matrix->data + (size_t) row * cols,
+                             MATRIX_ROW (matrix, row),
+                             (size_t) cols * sizeof (MATRIX_TYPE));
+                }
+
+                cycle_transpose (matrix->data, rows, cols, visited);
+                free (visited);
+
+                matrix->rows   = cols;
+                matrix->cols   = rows;
+                matrix->stride = rows;
+
+                // Раскладка с выровненным шагом: строки сдвигаются вправо,
+                // поэтому идем с конца
+                if ((size_t) cols * aligned <= capacity) {
+                    for (int row = cols - 1; row > 0; row--) {
+                        memmove (matrix->data + (size_t) row * aligned,
+                                 matrix->data + (size_t) row * rows,
+                                 (size_t) rows * sizeof (MATRIX_TYPE));
+                    }
+                    matrix->stride = aligned;
+                }
+                res = 0;
+            }
+        }
+    }
+
+    return res;
+}
@@ -0,0 +1,541 @@
+/**
+ * @file tune.c
+ * @brief Подбор параметров замерами и файл настроек
+ *
+ * @details
+ * Параметры подбираются по очереди, остальные при этом фиксированы:
+ * kc и mc на квадратных матрицах, nc - на широкой матрице B, где панель
+ * kc x nc не помещается целиком (только TUNE_FULL). Порог GEMM - наименьший
+ * размер, начиная с которого блочное умножение быстрее простого цикла на
+ * всех больших кандидатах. Схема Штрассена включается, только если один
+ * уровень рекурсии заметно быстрее GEMM (TUNE_FULL). Время кандидата -
+ * наименьшее из нескольких замеров, оно меньше всего зависит от помех.
+ *
+ * Файл настроек читается целиком в массив записей и переписывается через
+ * временный файл, чтобы параллельная загрузка не увидела половину записи.
+ *
+ * @see tune.h
+ */
+
+#include "tune.h"
+
+#include "simd.h"
+#include "trace.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/// Имя файла настроек в каталоге кэша
+#define TUNE_FILE_NAME "matrix_tune.txt"
+
+/// Наибольшее число записей в файле настроек
+#define TUNE_RECORDS_MAX 64
+
+/// Длина строки файла настроек и /proc/cpuinfo
+#define TUNE_LINE 512
+
+/// Длина пути файла
+#define TUNE_PATH 1024
+
+/// Число замеров кандидата
+#define TUNE_SAMPLES 3
+
+/// Наименьшая длительность замера, нс: короткие умножения повторяются
+#define TUNE_SAMPLE_NS 1e7
+
+/// Доля времени GEMM, которую схема Штрассена должна не превысить: выигрыш
+/// меньше не окупает большую погрешность
+#define TUNE_STRASSEN_GAIN 0.9
+
+/// Поля записи: строка gemm и строка strassen
+#define TUNE_FIELD_GEMM     1
+#define TUNE_FIELD_STRASSEN 2
+#define TUNE_FIELDS         (TUNE_FIELD_GEMM | TUNE_FIELD_STRASSEN)
+
+/**
+ * @struct TuneRecord
+ * @brief Запись файла настроек
+ */
+typedef struct {
+    char       cpu[TUNE_CPU_SIZE];   ///< Модель процессора
+    char       simd[16];             ///< Уровень инструкций
+    TuneParams params;               ///< Параметры
+    int        fields;               ///< Прочитанные поля TUNE_FIELD_*
+} TuneRecord;
+
+/**
+ * @struct TuneOperands
+ * @brief Матрицы замера C = A x B
+ */
+typedef struct {
+    Matrix A;   ///< m x k
+    Matrix B;   ///< k x n
+    Matrix C;   ///< m x n
+} TuneOperands;
+
+/// Кандидаты глубины панели kc
+static const int tune_kc[] = {64, 128, 192, 256, 384, 512};
+
+/// Кандидаты высоты панели mc
+static const int tune_mc[] = {32, 64, 96, 128, 192, 256};
+
+/// Кандидаты ширины панели nc
+static const int tune_nc[] = {512, 1024, 2048, 4096, 8192};
+
+/// Кандидаты порога GEMM по возрастанию (меньше 16 работают ядра small.h)
+static const int tune_threshold[] = {16, 24, 32, 48, 64, 96, 128, 192};
+
+/// Кандидаты размера перехода Штрассена по возрастанию
+static const int tune_crossover[] = {256, 512, 1024};
+
+/// Файл настроек по умолчанию уже загружен или загружается
+static atomic_int tune_loaded = 0;
+
+/**
+ * @brief Модель процессора из /proc/cpuinfo
+ */
+const char* tune_cpu_model (char* buffer, size_t size) {
+    FILE* f     = fopen ("/proc/cpuinfo", "r");
+    char  line[TUNE_LINE];
+    int   found = 0;
+
+    while (f && !found && fgets (line, sizeof line, f)) {
+        const char* colon = strchr (line, ':');
+        if (strncmp (line, "model name", 10) == 0 && colon) {
+            snprintf (buffer, size, "%s", colon + 1 + (colon[1] == ' '));
+            buffer[strcspn (buffer, "\n")] = '\0';
+            found                          = 1;
+        }
+    }
+    if (f) fclose (f);
+    if (!found) snprintf (buffer, size, "unknown");
+
+    return buffer;
+}
+
+/**
+ * @brief Путь файла настроек по умолчанию
+ */
+const char* tune_default_file (char* buffer, size_t size) {
+    const char* file  = getenv ("MATRIX_TUNE_FILE");
+    const char* cache = getenv ("XDG_CACHE_HOME");
+    const char* home  = getenv ("HOME");
+    int         len   = -1;
+
+    if (file) len = *file ? snprintf (buffer, size, "%s", file) : -1;
+    else if (cache && *cache)
+        len = snprintf (buffer, size, "%s/%s", cache, TUNE_FILE_NAME);
+    else if (home && *home)
+        len = snprintf (buffer, size, "%s/.cache/%s", home, TUNE_FILE_NAME);
+
+    return len >= 0 && (size_t) len < size ? buffer : NULL;
+}
+
+/**
+ * @brief Убирает пробелы в начале и конце строки
+ */
+static char* trim (char* text) {
+    size_t len;
+
+    while (*text == ' ' || *text == '\t') text++;
+    len = strlen (text);
+    while (len > 0 && strchr (" \t\r\n", text[len - 1])) text[--len] = '\0';
+
+    return text;
+}
+
+/**
+ * @brief Читает записи файла настроек
+ *
+ * Строки "ключ = значение" до первой строки cpu и комментарии "#"
+ * пропускаются, записи сверх max отбрасываются.
+ *
+ * @return Число прочитанных записей
+ */
+static int tune_parse (FILE* f, TuneRecord records[], int max) {
+    char        line[TUNE_LINE];
+    TuneRecord* record = NULL;
+    int         count  = 0;
+
+    while (fgets (line, sizeof line, f)) {
+        char* value = strchr (line, '=');
+        if (line[0] == '#' || !value) continue;
+
+        *value++        = '\0';
+        const char* key = trim (line);
+        value           = trim (value);
+
+        if (strcmp (key, "cpu") == 0) {
+            record = count < max ? &records[count++] : NULL;
+            if (record) {
+                memset (record, 0, sizeof *record);
+                snprintf (record->cpu, sizeof record->cpu, "%s", value);
+            }
+        } else if (record && strcmp (key, "simd") == 0) {
+            snprintf (record->simd, sizeof record->simd, "%s", value);
+        } else if (record && strcmp (key, "gemm") == 0) {
+            GemmConfig* gemm = &record->params.gemm;
+            if (sscanf (value, "%d %d %d %d", &gemm->mc, &gemm->kc, &gemm->nc,
+                        &gemm->threshold) == 4)
+                record->fields |= TUNE_FIELD_GEMM;
+        } else if (record && strcmp (key, "strassen") == 0) {
+            StrassenConfig* strassen = &record->params.strassen;
+            if (sscanf (value, "%d %d", &strassen->threshold,
+                        &strassen->crossover) == 2)
+                record->fields |= TUNE_FIELD_STRASSEN;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Проверяет, что запись относится к текущему процессору
+ */
+static int tune_matches (const TuneRecord* record, const char* cpu) {
+    return strcmp (record->cpu, cpu) == 0 &&
+           strcmp (record->simd, simd_kernels ()->name) == 0;
+}
+
+/**
+ * @brief Устанавливает параметры: либо все, либо ни одного
+ *
+ * @return 0 при успехе, -1 при некорректных параметрах
+ */
+static int tune_apply (const TuneParams* params) {
+    GemmConfig saved;
+    int        res = -1;
+
+    gemm_get_config (&saved);
+    if (gemm_set_config (&params->gemm) == 0) {
+        res = strassen_set_config (&params->strassen);
+        if (res != 0) gemm_set_config (&saved);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Загружает и устанавливает параметры текущего процессора
+ */
+int tune_load (const char* filename, TuneParams* params) {
+    char        path[TUNE_PATH];
+    char        cpu[TUNE_CPU_SIZE];
+    TuneRecord* records = NULL;
+    FILE*       f       = NULL;
+    int         res     = -1;
+
+    // Явная загрузка заменяет файл по умолчанию
+    atomic_store (&tune_loaded, 1);
+
+    if (!filename) filename = tune_default_file (path, sizeof path);
+    f = filename ? fopen (filename, "r") : NULL;
+    if (f) records = calloc (TUNE_RECORDS_MAX, sizeof (TuneRecord));
+
+    if (records) {
+        const int count = tune_parse (f, records, TUNE_RECORDS_MAX);
+        tune_cpu_model (cpu, sizeof cpu);
+
+        // Последняя подходящая запись - самая новая
+        for (int i = count - 1; i >= 0 && res != 0; i--) {
+            if (records[i].fields == TUNE_FIELDS &&
+                tune_matches (&records[i], cpu) &&
+                tune_apply (&records[i].params) == 0) {
+                if (params) *params = records[i].params;
+                res = 0;
+            }
+        }
+    }
+
+    free (records);
+    if (f) fclose (f);
+
+    return res;
+}
+
+/**
+ * @brief Загружает файл настроек по умолчанию при первом вызове
+ */
+void tune_init (void) {
+    // tune_load () вызывает gemm_set_config (), который снова попадает сюда.
+    // Другие потоки до конца загрузки работают с прежними параметрами
+    if (!atomic_load_explicit (&tune_loaded, memory_order_acquire) &&
+        !atomic_exchange (&tune_loaded, 1))
+        tune_load (NULL, NULL);
+}
+
+/**
+ * @brief Создает каталог файла, если его нет (один уровень)
+ */
+static void tune_make_dir (const char* filename) {
+    char        dir[TUNE_PATH];
+    const char* slash = strrchr (filename, '/');
+
+    if (slash && slash > filename && (size_t) (slash - filename) < sizeof dir) {
+        memcpy (dir, filename, (size_t) (slash - filename));
+        dir[slash - filename] = '\0';
+        mkdir (dir, 0755);
+    }
+}
+
+/**
+ * @brief Записывает запись файла настроек
+ */
+static void tune_write_record (FILE* out, const char* cpu, const char* simd,
+                               const TuneParams* params) {
+    fprintf (out, "cpu = %s\nsimd = %s\ngemm = %d %d %d %d\nstrassen = %d %d\n\n",
+             cpu, simd, params->gemm.mc, params->gemm.kc, params->gemm.nc,
+             params->gemm.threshold, params->strassen.threshold,
+             params->strassen.crossover);
+}
+
+/**
+ * @brief Сохраняет параметры текущего процессора в файл настроек
+ */
+int tune_save (const char* filename, const TuneParams* params) {
+    char        path[TUNE_PATH];
+    char        temp[TUNE_PATH + 8];
+    char        cpu[TUNE_CPU_SIZE];
+    TuneRecord* records = NULL;
+    FILE*       f       = NULL;
+    FILE*       out     = NULL;
+    int         count   = 0;
+    int         res     = -1;
+
+    if (!filename) filename = tune_default_file (path, sizeof path);
+    if (params && filename &&
+        snprintf (temp, sizeof temp, "%s.tmp", filename) < (int) sizeof temp)
+        records = calloc (TUNE_RECORDS_MAX, sizeof (TuneRecord));
+
+    if (records) {
+        f = fopen (filename, "r");
+        if (f) {
+            count = tune_parse (f, records, TUNE_RECORDS_MAX);
+            fclose (f);
+        }
+        tune_make_dir (filename);
+        out = fopen (temp, "w");
+    }
+
+    if (out) {
+        tune_cpu_model (cpu, sizeof cpu);
+        fprintf (out, "# Параметры matrix (tune.h): gemm = mc kc nc порог, "
+                      "strassen = порог переход\n\n");
+        for (int i = 0; i < count; i++) {
+            if (records[i].fields == TUNE_FIELDS && !tune_matches (&records[i], cpu))
+                tune_write_record (out, records[i].cpu, records[i].simd,
+                                   &records[i].params);
+        }
+        tune_write_record (out, cpu, simd_kernels ()->name, params);
+
+        res = ferror (out) ? -1 : 0;
+        if (fclose (out) != 0) res = -1;
+        if (res == 0 && rename (temp, filename) != 0) res = -1;
+        if (res != 0) remove (temp);
+    }
+
+    free (records);
+
+    return res;
+}
+
+/**
+ * @brief Создает и заполняет матрицы замера
+ *
+ * @return 0 при успехе, -1 при ошибке выделения памяти
+ */
+static int tune_operands (TuneOperands* ops, int m, int n, int k) {
+    ops->A = create_matrix (m, k);
+    ops->B = create_matrix (k, n);
+    ops->C = create_matrix (m, n);
+
+    for (int i = 0; ops->A.data && i < m; i++)
+        for (int j = 0; j < k; j++) MATRIX_AT (&ops->A, i, j) = (i + j) % 7 - 3;
+    for (int i = 0; ops->B.data && i < k; i++)
+        for (int j = 0; j < n; j++) MATRIX_AT (&ops->B, i, j) = (i * j) % 5 - 2;
+
+    return ops->A.data && ops->B.data && ops->C.data ? 0 : -1;
+}
+
+/**
+ * @brief Освобождает матрицы замера
+ */
+static void tune_free (TuneOperands* ops) {
+    free_matrix (&ops->A);
+    free_matrix (&ops->B);
+    free_matrix (&ops->C);
+}
+
+/**
+ * @brief Время умножения при текущих параметрах, нс
+ *
+ * Первый вызов прогревает кэши и пул потоков и задает число повторов в
+ * замере.
+ */
+static double tune_time (TuneOperands* ops) {
+    double start = (double) trace_now ();
+    double res   = 0;
+    int    repeat;
+
+    multiply_matrices (&ops->A, &ops->B, &ops->C);
+    res    = (double) trace_now () - start;
+    repeat = res < TUNE_SAMPLE_NS ? (int) (TUNE_SAMPLE_NS / (res + 1)) + 1 : 1;
+
+    for (int sample = 0; sample < TUNE_SAMPLES; sample++) {
+        start = (double) trace_now ();
+        for (int i = 0; i < repeat; i++)
+            multiply_matrices (&ops->A, &ops->B, &ops->C);
+        const double elapsed = ((double) trace_now () - start) / repeat;
+        if (sample == 0 || elapsed < res) res = elapsed;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Подбирает одно поле GemmConfig, остальные фиксированы
+ */
+static void tune_gemm_field (TuneOperands* ops, GemmConfig* config, int* field,
+                             const int candidates[], int count) {
+    double best_ns = 0;
+    int    best    = *field;
+
+    for (int i = 0; i < count; i++) {
+        *field = candidates[i];
+        gemm_set_config (config);
+        const double elapsed = tune_time (ops);
+        if (i == 0 || elapsed < best_ns) {
+            best_ns = elapsed;
+            best    = candidates[i];
+        }
+    }
+
+    *field = best;
+    gemm_set_config (config);
+}
+
+/**
+ * @brief Подбирает порог GEMM: блочная схема быстрее на этом и больших
+ * размерах
+ *
+ * @return 0 при успехе, -1 при ошибке выделения памяти
+ */
+static int tune_gemm_threshold (GemmConfig* config) {
+    const int count = (int) (sizeof tune_threshold / sizeof tune_threshold[0]);
+    int       res   = 0;
+
+    // Если GEMM проигрывает и на наибольшем кандидате, порог - вдвое больше
+    config->threshold = 2 * tune_threshold[count - 1];
+    for (int i = count - 1; i >= 0 && res == 0; i--) {
+        const int    size = tune_threshold[i];
+        TuneOperands ops;
+        double       loop_ns = 0, gemm_ns = 0;
+
+        res = tune_operands (&ops, size, size, size);
+        if (res == 0) {
+            GemmConfig probe = *config;
+            probe.threshold  = size + 1;
+            gemm_set_config (&probe);
+            loop_ns         = tune_time (&ops);
+            probe.threshold = 1;
+            gemm_set_config (&probe);
+            gemm_ns = tune_time (&ops);
+        }
+        tune_free (&ops);
+
+        if (res == 0 && gemm_ns >= loop_ns) break;
+        if (res == 0) config->threshold = size;
+    }
+
+    gemm_set_config (config);
+
+    return res;
+}
+
+/**
+ * @brief Включает схему Штрассена с наименьшего размера, где один уровень
+ * рекурсии заметно быстрее GEMM, или выключает ее, если такого размера нет
+ *
+ * @return 0 при успехе, -1 при ошибке выделения памяти
+ */
+static int tune_strassen (StrassenConfig* config) {
+    const int      count = (int) (sizeof tune_crossover / sizeof tune_crossover[0]);
+    StrassenConfig off   = {0, STRASSEN_CROSSOVER_DEFAULT};
+    int            found = 0;
+    int            res   = 0;
+
+    for (int i = 0; i < count && !found && res == 0; i++) {
+        const int      crossover = tune_crossover[i];
+        StrassenConfig probe     = {2 * crossover, crossover};
+        TuneOperands   ops;
+
+        res = tune_operands (&ops, 2 * crossover, 2 * crossover, 2 * crossover);
+        if (res == 0) {
+            strassen_set_config (&off);
+            const double gemm_ns = tune_time (&ops);
+            strassen_set_config (&probe);
+            if (tune_time (&ops) < TUNE_STRASSEN_GAIN * gemm_ns) {
+                *config = probe;
+                found   = 1;
+            }
+        }
+        tune_free (&ops);
+    }
+    if (res == 0 && !found) *config = off;
+
+    strassen_set_config (config);
+
+    return res;
+}
+
+/**
+ * @brief Подбирает параметры замерами и устанавливает лучшие
+ */
+int tune_run (TuneLevel level, TuneParams* params) {
+    const StrassenConfig off  = {0, STRASSEN_CROSSOVER_DEFAULT};
+    const int            size = level == TUNE_FULL ? 768 : 384;
+    TuneParams           saved, tuned;
+    TuneOperands         ops;
+    int                  res;
+
+    gemm_get_config (&saved.gemm);
+    strassen_get_config (&saved.strassen);
+    tuned = saved;
+
+    // Блоки подбираются на GEMM без схемы Штрассена
+    strassen_set_config (&off);
+    tuned.gemm.threshold = 1;
+
+    res = tune_operands (&ops, size, size, size);
+    if (res == 0) {
+        tune_gemm_field (&ops, &tuned.gemm, &tuned.gemm.kc, tune_kc,
+                         (int) (sizeof tune_kc / sizeof tune_kc[0]));
+        tune_gemm_field (&ops, &tuned.gemm, &tuned.gemm.mc, tune_mc,
+                         (int) (sizeof tune_mc / sizeof tune_mc[0]));
+    }
+    tune_free (&ops);
+
+    // Ширина панели влияет, только когда B шире nc
+    if (res == 0 && level == TUNE_FULL) {
+        res = tune_operands (&ops, 256, 8192, 256);
+        if (res == 0)
+            tune_gemm_field (&ops, &tuned.gemm, &tuned.gemm.nc, tune_nc,
+                             (int) (sizeof tune_nc / sizeof tune_nc[0]));
+        tune_free (&ops);
+    }
+
+    if (res == 0) res = tune_gemm_threshold (&tuned.gemm);
+    if (res == 0 && level == TUNE_FULL) res = tune_strassen (&tuned.strassen);
+
+    if (res == 0) {
+        tune_apply (&tuned);
+        if (params) *params = tuned;
+    } else {
+        tune_apply (&saved);
+    }
+
+    return res;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file tune.h
+ * @brief Подбор размеров блоков и порогов под процессор
+ *
+ * @details
+ * Лучшие размеры блоков GEMM, порог перехода на блочное умножение и порог
+ * схемы Штрассена зависят от кэшей и векторных регистров процессора.
+ * tune_run () замеряет кандидатов на текущей машине и устанавливает
+ * победителей, tune_save () сохраняет их в файл настроек.
+ *
+ * Файл настроек - текстовый, по записи на процессор. Запись выбирается по
+ * модели процессора (/proc/cpuinfo) и уровню инструкций (simd.h), поэтому
+ * один файл подходит для машин разных поколений:
+ * @code
+ * cpu = Intel(R) Xeon(R) Gold 6230 CPU @ 2.10GHz
+ * simd = avx512
+ * gemm = 96 384 4096 48
+ * strassen = 4096 1024
+ * @endcode
+ * Строка gemm - mc, kc, nc и порог (GemmConfig), строка strassen - порог
+ * и размер перехода (StrassenConfig).
+ *
+ * Запись текущего процессора загружается при первом обращении к
+ * параметрам gemm.h или strassen.h. Путь файла задает переменная
+ * MATRIX_TUNE_FILE (пустое значение выключает загрузку), по умолчанию -
+ * $XDG_CACHE_HOME/matrix_tune.txt или ~/.cache/matrix_tune.txt. Параметры,
+ * заданные gemm_set_config () и strassen_set_config (), заменяют
+ * загруженные.
+ *
+ * @code
+ * TuneParams params;
+ * if (tune_run (TUNE_QUICK, &params) == 0) tune_save (NULL, &params);
+ * @endcode
+ *
+ * @see gemm.h strassen.h
+ */
+
+#ifndef TUNE_H
+#define TUNE_H
+
+#include "gemm.h"
+#include "strassen.h"
+
+#include <stddef.h>
+
+/// Размер буфера модели процессора
+#define TUNE_CPU_SIZE 128
+
+/**
+ * @brief Объем подбора
+ */
+typedef enum {
+    TUNE_QUICK = 0,   ///< Блоки mc, kc и порог GEMM, около секунды
+    TUNE_FULL         ///< Также ширина nc и схема Штрассена, десятки секунд
+} TuneLevel;
+
+/**
+ * @struct TuneParams
+ * @brief Подбираемые параметры
+ */
+typedef struct {
+    GemmConfig     gemm;       ///< Блоки и порог блочного умножения
+    StrassenConfig strassen;   ///< Порог и размер перехода Штрассена
+} TuneParams;
+
+/**
+ * @brief Подбирает параметры замерами и устанавливает лучшие
+ * @param level Объем подбора
+ * @param params Подобранные параметры или NULL
+ * @note Занимает пул потоков библиотеки; параметры, которые не
+ * подбирались на этом уровне, остаются текущими
+ * @return 0 при успехе, -1 при ошибке выделения памяти (параметры не
+ * меняются)
+ */
+int tune_run (TuneLevel level, TuneParams* params);
+
+/**
+ * @brief Сохраняет параметры текущего процессора в файл настроек
+ * @param filename Путь файла или NULL - путь по умолчанию
+ * @param params Параметры
+ * @note Записи других процессоров сохраняются, файл заменяется целиком
+ * @return 0 при успехе, -1 при ошибке
+ */
+int tune_save (const char* filename, const TuneParams* params);
+
+/**
+ * @brief Загружает и устанавливает параметры текущего процессора
+ * @param filename Путь файла или NULL - путь по умолчанию
+ * @param params Загруженные параметры или NULL
+ * @return 0 при успехе, -1 если файла или записи нет или параметры
+ * некорректны
+ */
+int tune_load (const char* filename, TuneParams* params);
+
+/**
+ * @brief Загружает файл настроек по умолчанию при первом вызове
+ * @note Вызывается из gemm.c и strassen.c, повторные вызовы ничего не
+ * делают
+ */
+void tune_init (void);
+
+/**
+ * @brief Путь файла настроек по умолчанию
+ * @param buffer Буфер
+ * @param size Размер буфера
+ * @return buffer или NULL, если загрузка выключена или путь неизвестен
+ */
+const char* tune_default_file (char* buffer, size_t size);
+
+/**
+ * @brief Модель процессора из /proc/cpuinfo
+ * @param buffer Буфер
+ * @param size Размер буфера
+ * @return buffer ("unknown", если модель не найдена)
+ */
+const char* tune_cpu_model (char* buffer, size_t size);
+
+#endif   // TUNE_H
@@ -0,0 +1,379 @@
+/**
+ * @file dtoa.c
+ * @brief Форматирование double: кратчайшая десятичная и шестнадцатеричная запись
+ *
+ * @details
+ * Десятичная запись строится алгоритмом Grisu2 (F. Loitsch, "Printing
+ * Floating-Point Numbers Quickly and Accurately with Integers", 2010):
+ * границы интервала округления числа умножаются на заранее вычисленную
+ * степень десяти в 64-битной арифметике, после чего цифры извлекаются
+ * целочисленным делением. Результат всегда читается обратно в то же
+ * число; в редких случаях он на одну цифру длиннее кратчайшего.
+ *
+ * @see dtoa.h
+ */
+
+#include "dtoa.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @struct DiyFp
+ * @brief Число f * 2^e с 64-битной мантиссой
+ */
+typedef struct {
+    uint64_t f;   ///< Мантисса
+    int      e;   ///< Двоичный порядок
+} DiyFp;
+
+/// Скрытый бит мантиссы double
+#define DTOA_HIDDEN_BIT ((uint64_t) 1 << 52)
+
+/// Маска дробной части мантиссы double
+#define DTOA_FRACTION_MASK (DTOA_HIDDEN_BIT - 1)
+
+/// Смещение порядка double вместе с длиной мантиссы
+#define DTOA_EXPONENT_BIAS (1023 + 52)
+
+/// Мантиссы 10^k, k = -348, -340, ..., 340, нормализованные к 64 битам
+static const uint64_t cached_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+/// Двоичные порядки к cached_f
+static const int16_t cached_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954,
+    -927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635,
+    -608, -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316,
+    -289, -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30, 56,
+    83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348, 375, 402, 428, 455,
+    481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853,
+    880, 907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+/// Степени десяти, помещающиеся в uint32_t
+static const uint32_t pow10_32[] = {1,      10,      100,      1000,      10000,
+                                    100000, 1000000, 10000000, 100000000,
+                                    1000000000};
+
+/**
+ * @brief Сдвигает мантиссу влево до установленного старшего бита
+ */
+static DiyFp normalize (DiyFp x) {
+    while (!(x.f & ((uint64_t) 1 << 63))) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+/**
+ * @brief Произведение с округлением старших 64 бит
+ */
+static DiyFp multiply (DiyFp x, DiyFp y) {
+    const uint64_t mask = 0xFFFFFFFFu;
+    const uint64_t a = x.f >> 32, b = x.f & mask, c = y.f >> 32, d = y.f & mask;
+    const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t       tmp = (bd >> 32) + (ad & mask) + (bc & mask);
+
+    tmp += (uint64_t) 1 << 31;
+
+    DiyFp res = {ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64};
+    return res;
+}
+
+/**
+ * @brief Закэшированная степень десяти c_k, для которой порядок
+ *        произведения на число с порядком e попадает в [-60, -32]
+ *
+ * @param e Порядок числа
+ * @param k Возвращаемый десятичный порядок -k степени
+ */
+static DiyFp cached_power (int e, int* k) {
+    const double dk    = (-61 - e) * 0.30102999566398114 + 347;
+    int          index = (int) dk;
+
+    if (dk - index > 0.0) index++;
+    index = (index >> 3) + 1;
+    *k    = -(-348 + index * 8);
+
+    DiyFp res = {cached_f[index], cached_e[index]};
+    return res;
+}
+
+/**
+ * @brief Уменьшает последнюю цифру, пока результат ближе к точному значению
+ */
+static void grisu_round (char* buffer, int length, uint64_t delta, uint64_t rest,
+                         uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+/**
+ * @brief Число десятичных цифр n
+ */
+static int count_digits (uint32_t n) {
+    int res = 1;
+    while (res < 10 && n >= pow10_32[res]) res++;
+    return res;
+}
+
+/**
+ * @brief Извлекает цифры верхней границы mp, пока они не выходят из интервала
+ *        шириной delta
+ *
+ * @param w Масштабированное число
+ * @param mp Масштабированная верхняя граница
+ * @param delta Ширина интервала
+ * @param buffer Буфер цифр
+ * @param length Возвращаемое число цифр
+ * @param k Десятичный порядок последней цифры (дополняется)
+ */
+static void digit_gen (DiyFp w, DiyFp mp, uint64_t delta, char* buffer,
+                       int* length, int* k) {
+    const int      shift = -mp.e;
+    const uint64_t one   = (uint64_t) 1 << shift;
+    const uint64_t wp_w  = mp.f - w.f;
+    uint32_t       p1    = (uint32_t) (mp.f >> shift);
+    uint64_t       p2    = mp.f & (one - 1);
+    int            kappa = count_digits (p1);
+    int            done  = 0;
+
+    *length = 0;
+
+    // Целая часть
+    while (kappa > 0 && !done) {
+        const uint32_t d = p1 / pow10_32[kappa - 1];
+
+        p1 %= pow10_32[kappa - 1];
+        if (d || *length) buffer[(*length)++] = (char) ('0' + d);
+        kappa--;
+
+        const uint64_t rest = ((uint64_t) p1 << shift) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            grisu_round (buffer, *length, delta, rest,
+                         (uint64_t) pow10_32[kappa] << shift, wp_w);
+            done = 1;
+        }
+    }
+
+    // Дробная часть
+    while (!done) {
+        p2 *= 10;
+        delta *= 10;
+
+        const char d = (char) (p2 >> shift);
+        if (d || *length) buffer[(*length)++] = (char) ('0' + d);
+        p2 &= one - 1;
+        kappa--;
+
+        if (p2 < delta) {
+            *k += kappa;
+            grisu_round (buffer, *length, delta, p2, one,
+                         -kappa < 9 ? wp_w * pow10_32[-kappa] : 0);
+            done = 1;
+        }
+    }
+}
+
+/**
+ * @brief Записывает десятичный порядок со знаком
+ *
+ * @return Число записанных символов
+ */
+static int write_exponent (int exponent, char* buffer) {
+    char digits[8];
+    int  count = 0;
+    int  res   = 0;
+
+    if (exponent < 0) {
+        buffer[res++] = '-';
+        exponent      = -exponent;
+    }
+    do {
+        digits[count++] = (char) ('0' + exponent % 10);
+        exponent /= 10;
+    } while (exponent);
+    while (count) buffer[res++] = digits[--count];
+
+    return res;
+}
+
+/**
+ * @brief Расставляет точку и порядок в цифрах buffer[0..length) * 10^k
+ *
+ * @return Длина записи
+ */
+static int prettify (char* buffer, int length, int k) {
+    const int point = length + k;   // 10^(point - 1) <= v < 10^point
+    int       res   = 0;
+
+    if (k >= 0 && point <= 21) {
+        // 1234e2 -> 123400
+        memset (buffer + length, '0', (size_t) k);
+        res = point;
+    } else if (point > 0 && point <= 21) {
+        // 1234e-2 -> 12.34
+        memmove (buffer + point + 1, buffer + point, (size_t) (length - point));
+        buffer[point] = '.';
+        res           = length + 1;
+    } else if (point > -6 && point <= 0) {
+        // 1234e-6 -> 0.001234
+        const int offset = 2 - point;
+
+        memmove (buffer + offset, buffer, (size_t) length);
+        buffer[0] = '0';
+        buffer[1] = '.';
+        memset (buffer + 2, '0', (size_t) (offset - 2));
+        res = length + offset;
+    } else if (length == 1) {
+        // 1e30
+        buffer[1] = 'e';
+        res       = 2 + write_exponent (point - 1, buffer + 2);
+    } else {
+        // 1234e30 -> 1.234e33
+        memmove (buffer + 2, buffer + 1, (size_t) (length - 1));
+        buffer[1]          = '.';
+        buffer[length + 1] = 'e';
+        res = length + 2 + write_exponent (point - 1, buffer + length + 2);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Кратчайшая десятичная запись, читаемая обратно без потерь
+ *
+ * @param value Число
+ * @param buffer Буфер не короче DTOA_BUFFER_SIZE
+ *
+ * @return Длина записи (без завершающего нуля)
+ */
+int dtoa_shortest (double value, char* buffer) {
+    uint64_t bits;
+    char*    p   = buffer;
+    int      res = 0;
+
+    memcpy (&bits, &value, sizeof (bits));
+    if (bits >> 63) *p++ = '-';
+
+    const int      biased      = (int) ((bits >> 52) & 0x7FF);
+    const uint64_t significand = bits & DTOA_FRACTION_MASK;
+
+    if (biased == 0x7FF) {
+        memcpy (p, significand ? "nan" : "inf", 3);
+        p += 3;
+    } else if (biased == 0 && significand == 0) {
+        *p++ = '0';
+    } else {
+        DiyFp v = {significand, 1 - DTOA_EXPONENT_BIAS};
+        if (biased) {
+            v.f += DTOA_HIDDEN_BIT;
+            v.e = biased - DTOA_EXPONENT_BIAS;
+        }
+
+        // Границы интервала значений, округляющихся в v
+        DiyFp plus  = {(v.f << 1) + 1, v.e - 1};
+        DiyFp minus = v.f == DTOA_HIDDEN_BIT && biased > 1
+                          ? (DiyFp) {(v.f << 2) - 1, v.e - 2}
+                          : (DiyFp) {(v.f << 1) - 1, v.e - 1};
+        plus        = normalize (plus);
+        minus.f <<= minus.e - plus.e;
+        minus.e = plus.e;
+
+        int         k    = 0;
+        const DiyFp c_mk = cached_power (plus.e, &k);
+        const DiyFp w    = multiply (normalize (v), c_mk);
+        DiyFp       wp   = multiply (plus, c_mk);
+        DiyFp       wm   = multiply (minus, c_mk);
+        int         length;
+
+        wm.f++;
+        wp.f--;
+        digit_gen (w, wp, wp.f - wm.f, p, &length, &k);
+        p += prettify (p, length, k);
+    }
+
+    *p  = '\0';
+    res = (int) (p - buffer);
+
+    return res;
+}
+
+/**
+ * @brief Шестнадцатеричная запись, как у printf ("%a")
+ *
+ * @param value Число
+ * @param buffer Буфер не короче DTOA_BUFFER_SIZE
+ *
+ * @return Длина записи (без завершающего нуля)
+ */
+int dtoa_hex (double value, char* buffer) {
+    static const char hex[] = "0123456789abcdef";
+
+    uint64_t bits;
+    char*    p = buffer;
+
+    memcpy (&bits, &value, sizeof (bits));
+    if (bits >> 63) *p++ = '-';
+
+    const int biased      = (int) ((bits >> 52) & 0x7FF);
+    uint64_t  significand = bits & DTOA_FRACTION_MASK;
+
+    if (biased == 0x7FF) {
+        memcpy (p, significand ? "nan" : "inf", 3);
+        p += 3;
+    } else {
+        // Нормальное число 0x1.xxxp+e, субнормальное и ноль - 0x0.xxxp-1022
+        const int exponent = biased ? biased - 1023 : significand ? -1022 : 0;
+
+        *p++ = '0';
+        *p++ = 'x';
+        *p++ = biased ? '1' : '0';
+        if (significand) *p++ = '.';
+        while (significand) {
+            *p++        = hex[significand >> 48];
+            significand = (significand << 4) & DTOA_FRACTION_MASK;
+        }
+        *p++ = 'p';
+        *p++ = exponent < 0 ? '-' : '+';
+        p += write_exponent (exponent < 0 ? -exponent : exponent, p);
+    }
+    *p = '\0';
+
+    return (int) (p - buffer);
+}
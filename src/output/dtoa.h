@@ -0,0 +1,38 @@
+/**
+ * @file dtoa.h
+ * @brief Быстрое форматирование double для текстового вывода матриц
+ *
+ * @details
+ * Функции пишут число в буфер без вызова printf и без обращения к локали:
+ * - dtoa_shortest - кратчайшая десятичная запись, которая читается strtod
+ *   обратно в то же самое число (алгоритм Grisu2)
+ * - dtoa_hex - точная шестнадцатеричная запись в формате "%a"
+ *
+ * Бесконечности и NaN записываются как inf, -inf и nan.
+ *
+ * @see output.h
+ */
+
+#ifndef DTOA_H
+#define DTOA_H
+
+/// Достаточный размер буфера для одного числа, включая завершающий ноль
+#define DTOA_BUFFER_SIZE 32
+
+/**
+ * @brief Кратчайшая десятичная запись, читаемая обратно без потерь
+ * @param value Число
+ * @param buffer Буфер не короче DTOA_BUFFER_SIZE
+ * @return Длина записи (без завершающего нуля)
+ */
+int dtoa_shortest (double value, char* buffer);
+
+/**
+ * @brief Шестнадцатеричная запись, как у printf ("%a")
+ * @param value Число
+ * @param buffer Буфер не короче DTOA_BUFFER_SIZE
+ * @return Длина записи (без завершающего нуля)
+ */
+int dtoa_hex (double value, char* buffer);
+
+#endif   // DTOA_H
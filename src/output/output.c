@@ -6,63 +6,315 @@
  * Содержит реализацию операций с файлами и консольным выводом для
  * матричных операций:
  * - Вывод матрицы в консоль
- * - Сохранение матрицы в файл
- * - Загрузка матрицы из файла
+ * - Сохранение матрицы в файл (параллельное форматирование, точная запись)
+ * - Загрузка матрицы из файла (параллельный разбор отображенного текста)
+ * - Двоичный формат: сохранение и отображение в память через mmap
  *
  * @note Все функции включают проверку входных параметров
+ * @note Публичные операции отмечаются в статистике (stats.h) с объемом
+ * прочитанного и записанного файла
  */
 
 #include "output.h"
 
+#include "../matrix/stats.h"
+#include "../matrix/thread_pool.h"
+#include "dtoa.h"
+
+#include <fcntl.h>
+#include <float.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// Метка порядка байт: читается как есть только на машине того же порядка
+#define OUTPUT_ENDIAN_MARK 0x01020304u
+
+/**
+ * @struct BinaryHeader
+ * @brief Заголовок двоичного файла (описание полей - в output.h)
+ */
+typedef struct {
+    char     magic[4];      ///< OUTPUT_BINARY_MAGIC без завершающего нуля
+    uint32_t version;       ///< Версия формата
+    uint32_t endian;        ///< OUTPUT_ENDIAN_MARK
+    uint32_t dtype;         ///< OutputDtype
+    uint64_t rows;          ///< Количество строк
+    uint64_t cols;          ///< Количество столбцов
+    uint64_t stride;        ///< Шаг строки в элементах
+    uint32_t alignment;     ///< Выравнивание в байтах
+    uint32_t data_offset;   ///< Смещение данных
+    uint8_t  reserved[16];  ///< Резерв
+} BinaryHeader;
+
+_Static_assert (sizeof (BinaryHeader) == OUTPUT_BINARY_HEADER_SIZE,
+                "размер заголовка двоичного формата");
+
+/**
+ * @brief Размер файла для статистики (0, если файл недоступен)
+ */
+static uint64_t stats_file_size (const char* filename) {
+    struct stat info;
+
+    return filename != NULL && stat (filename, &info) == 0 ? (uint64_t) info.st_size
+                                                           : 0;
+}
 
 /**
  * @brief Функция для вывода матрицы
  *
  * @param rows Количество строк
  * @param cols Количество стоблцов
+ * @param stride Шаг строки в элементах
  * @param data Указатель на массив данных
  */
-void output_print_matrix (int rows, int cols, const double* data) {
+void output_print_matrix (int rows, int cols, int stride, const double* data) {
+    MatrixStatsScope stats = MATRIX_STATS_BEGIN (MATRIX_OP_OUTPUT_PRINT);
+
     if (!data) printf ("Данные матрицы отсутствуют.");
     else {
         printf ("Матрица %dx%d:\n", rows, cols);
         for (int index_row = 0; index_row < rows; index_row++) {
             for (int index_col = 0; index_col < cols; index_col++) {
-                printf ("%.2f ", data[index_row * cols + index_col]);
+                printf ("%.2f ", data[(size_t) index_row * stride + index_col]);
             }
             printf ("\n");
         }
     }
+    MATRIX_STATS_END (stats, data ? (size_t) rows * cols * sizeof (double) : 0, 0,
+                      0);
+}
+
+/// Примерный объем текста на одну подзадачу записи
+#define TEXT_WRITE_CHUNK (1024 * 1024)
+
+/// Текущий формат чисел в текстовых файлах
+static OutputFormat text_format = OUTPUT_FORMAT_SHORTEST;
+
+/// Число знаков после точки для OUTPUT_FORMAT_FIXED
+static int text_precision = 2;
+
+/**
+ * @brief Устанавливает формат чисел для сохранения в текстовый файл
+ *
+ * @param format Формат
+ * @param precision Число знаков после точки для OUTPUT_FORMAT_FIXED
+ *
+ * @return 0 при успехе, -1 при некорректных параметрах
+ */
+int output_set_format (OutputFormat format, int precision) {
+    int res = -1;
+
+    if ((format == OUTPUT_FORMAT_SHORTEST || format == OUTPUT_FORMAT_FIXED ||
+         format == OUTPUT_FORMAT_HEX) &&
+        precision >= 0 && precision <= OUTPUT_PRECISION_MAX) {
+        text_format    = format;
+        text_precision = precision;
+        res            = 0;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Возвращает текущий формат чисел текстовых файлов
+ *
+ * @param format Формат (может быть NULL)
+ * @param precision Число знаков после точки (может быть NULL)
+ */
+void output_get_format (OutputFormat* format, int* precision) {
+    if (format) *format = text_format;
+    if (precision) *precision = text_precision;
+}
+
+/**
+ * @struct TextBuffer
+ * @brief Растущий буфер текста одной подзадачи записи
+ */
+typedef struct {
+    char*  data;       ///< Текст
+    size_t length;     ///< Занято байт
+    size_t capacity;   ///< Выделено байт
+} TextBuffer;
+
+/**
+ * @struct WriteJob
+ * @brief Общие данные параллельного форматирования
+ *
+ * Строки записываются пакетами: подзадача task пакета форматирует
+ * chunk_rows строк начиная с first + task * chunk_rows в свой буфер,
+ * затем буферы пакета пишутся в файл по порядку.
+ */
+typedef struct {
+    const double* data;          ///< Данные матрицы
+    int           rows, cols;    ///< Размеры матрицы
+    int           stride;        ///< Шаг строки
+    int           first;         ///< Первая строка пакета
+    int           chunk_rows;    ///< Строк в подзадаче
+    OutputFormat  format;        ///< Формат чисел
+    int           precision;     ///< Знаков после точки
+    size_t        element_max;   ///< Наибольшая длина числа с разделителем
+    TextBuffer*   buffers;       ///< Буферы подзадач
+    atomic_int    failed;        ///< Ошибка выделения памяти
+} WriteJob;
+
+/**
+ * @brief Записывает число в формате задачи
+ *
+ * @return Длина записи
+ */
+static int format_value (const WriteJob* job, double value, char* out) {
+    int res = 0;
+
+    switch (job->format) {
+        case OUTPUT_FORMAT_FIXED:
+            res = snprintf (out, job->element_max, "%.*f", job->precision, value);
+            break;
+        case OUTPUT_FORMAT_HEX: res = dtoa_hex (value, out); break;
+        default: res = dtoa_shortest (value, out); break;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Подзадача: форматирует строки куска task в буфер task
+ */
+static void format_chunk (void* ctx, int task, int worker) {
+    WriteJob*   job    = ctx;
+    TextBuffer* buffer = &job->buffers[task];
+    int         row    = job->first + task * job->chunk_rows;
+    int         end    = job->rows - row < job->chunk_rows ? job->rows
+                                                           : row + job->chunk_rows;
+    int         ok     = 1;
+
+    (void) worker;
+    buffer->length = 0;
+    for (; row < end && ok; row++) {
+        const double* values = job->data + (size_t) row * job->stride;
+
+        for (int col = 0; col < job->cols && ok; col++) {
+            if (buffer->capacity - buffer->length < job->element_max) {
+                size_t capacity = buffer->capacity * 2 + job->element_max;
+                char*  data     = realloc (buffer->data, capacity);
+
+                if (data) {
+                    buffer->data     = data;
+                    buffer->capacity = capacity;
+                } else {
+                    atomic_store (&job->failed, 1);
+                    ok = 0;
+                }
+            }
+
+            if (ok) {
+                char* p = buffer->data + buffer->length;
+
+                p += format_value (job, values[col], p);
+                *p++           = col + 1 < job->cols ? ' ' : '\n';
+                buffer->length = (size_t) (p - buffer->data);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Пишет length байт целиком, повторяя частичные записи
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int write_all (int fd, const char* data, size_t length) {
+    int res = 0;
+
+    while (length > 0 && res == 0) {
+        ssize_t done = write (fd, data, length);
+        if (done > 0) {
+            data += done;
+            length -= (size_t) done;
+        } else {
+            res = -1;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief Форматирует матрицу потоками пула и пишет текст в fd
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int write_text (int fd, int rows, int cols, int stride, const double* data) {
+    const int    fixed    = text_format == OUTPUT_FORMAT_FIXED;
+    const int    tasks    = thread_pool_threads () * 2;
+    const size_t estimate = fixed ? (size_t) text_precision + 8 : 20;
+    const size_t by_size  = TEXT_WRITE_CHUNK / ((size_t) cols * estimate + 1) + 1;
+    char         header[32];
+    int          length = snprintf (header, sizeof (header), "%d %d\n", rows, cols);
+    WriteJob     job    = {data,
+                           rows,
+                           cols,
+                           stride,
+                           0,
+                           by_size < (size_t) rows ? (int) by_size : rows,
+                           text_format,
+                           text_precision,
+                           fixed ? (size_t) (DBL_MAX_10_EXP + text_precision + 5)
+                                 : DTOA_BUFFER_SIZE,
+                           calloc ((size_t) tasks, sizeof (TextBuffer)),
+                           0};
+    int          res = job.buffers ? write_all (fd, header, (size_t) length) : -1;
+
+    while (job.first < rows && res == 0) {
+        const int left  = (rows - job.first + job.chunk_rows - 1) / job.chunk_rows;
+        const int count = left < tasks ? left : tasks;
+
+        thread_pool_run (count, format_chunk, &job);
+        if (atomic_load (&job.failed)) res = -1;
+        for (int i = 0; i < count && res == 0; i++)
+            res = write_all (fd, job.buffers[i].data, job.buffers[i].length);
+        job.first += count * job.chunk_rows;
+    }
+
+    if (job.buffers)
+        for (int i = 0; i < tasks; i++) free (job.buffers[i].data);
+    free (job.buffers);
+
+    return res;
 }
 
 /**
  * @brief Функция сохранения матрицы в файл
  *
+ * Строки форматируются потоками пула (thread_pool.h) в собственные буферы
+ * без printf и пишутся в файл крупными блоками по порядку. Формат чисел
+ * задается output_set_format.
+ *
  * @param rows Количество строк
  * @param cols Количество столбцов
+ * @param stride Шаг строки в элементах
  * @param data Указатель на массив данных
  * @param filename Указатель на файл для сохранения матрицы
  *
  * @return 0 при успехе, -1 при ошибке
  */
-int output_save_matrix_to_file (int rows, int cols, const double* data,
+int output_save_matrix_to_file (int rows, int cols, int stride, const double* data,
                                 const char* filename) {
-    int   result = -1;
-    FILE* file   = NULL;
+    MatrixStatsScope stats  = MATRIX_STATS_BEGIN (MATRIX_OP_OUTPUT_SAVE_TEXT);
+    int              result = -1;
+    int              fd     = -1;
 
     if (data) {
-        file = fopen (filename, "w");
-        if (file) {
-            fprintf (file, "%d %d\n", rows, cols);
-            for (int index_row = 0; index_row < rows; index_row++) {
-                for (int index_col = 0; index_col < cols; index_col++) {
-                    fprintf (file, "%.2f ", data[index_row * cols + index_col]);
-                }
-                fprintf (file, "\n");
-            }
-            result = 0;
+        fd = filename ? open (filename, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+        if (fd >= 0) {
+            result = write_text (fd, rows, cols, stride, data);
+            if (result != 0) fprintf (stderr, "Ошибка записи файла.\n");
         } else {
             fprintf (stderr, "Ошибка открытия файла.\n");
         }
@@ -70,60 +322,1370 @@ int output_save_matrix_to_file (int rows, int cols, const double* data,
         printf ("Данные матрицы отсутствуют.\n");
     }
 
-    if (file) fclose (file);
+    if (fd >= 0 && close (fd) != 0) result = -1;
+    MATRIX_STATS_END (stats,
+                      result == 0 ? (size_t) rows * cols * sizeof (double) : 0,
+                      result == 0 ? stats_file_size (filename) : 0, 0);
 
     return result;
 }
 
+/// Минимальный размер куска текста на одну подзадачу разбора
+#define TEXT_CHUNK_MIN (256 * 1024)
+
+/// Максимальная длина числа, копируемого для разбора через strtod
+#define TEXT_TOKEN_MAX 128
+
 /**
- * @brief Загружает матрицу из файла
+ * @brief Разделитель чисел в текстовом файле (как isspace в локали "C")
+ */
+static int is_separator (char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+           c == '\f';
+}
+
+/**
+ * @brief Разбирает число через strtod (редкие формы: inf, nan, 0x...,
+ *        больше 19 значащих цифр, большой порядок)
  *
- * @param rows Количество строк
- * @param cols Количество столбцов
- * @param filename Указатель на файл с матрицей для чтения
- * @return NULL при ошибке или указатель на созданную матрицу
+ * @return 1 при успехе, 0 если токен не является числом целиком
  */
-double* output_load_matrix_from_file (int* rows, int* cols, const char* filename) {
-    FILE*   file = NULL;
-    double* data = NULL;
-    int     res  = 1;
+static int parse_double_slow (const char* token, size_t length, double* value) {
+    char  buffer[TEXT_TOKEN_MAX];
+    char* copy = length < sizeof (buffer) ? buffer : malloc (length + 1);
+    char* tail = NULL;
+    int   res  = 0;
 
-    file = fopen (filename, "r");
-    if (!file) {
-        fprintf (stderr, "Ошибка чтения файла.\n");
-        res = 0;
+    if (copy) {
+        memcpy (copy, token, length);
+        copy[length] = '\0';
+        *value       = strtod (copy, &tail);
+        res          = tail == copy + length;
+        if (copy != buffer) free (copy);
     }
 
-    if (res) {
-        if (fscanf (file, "%d %d", rows, cols) != 2) {
-            fprintf (stderr, "Ошибка чтения размеров матрицы.\n");
+    return res;
+}
+
+/**
+ * @brief Разбирает десятичное число token[0..length)
+ *
+ * Мантисса до 19 цифр копится в uint64_t. Если она точно представима в
+ * double (не больше 2^53) и десятичный порядок по модулю не больше 22,
+ * результат m * 10^e или m / 10^e - одна правильно округленная операция
+ * над точными операндами. Остальные случаи уходят в parse_double_slow.
+ *
+ * @return 1 при успехе, 0 если токен не является числом
+ */
+static int parse_double (const char* token, size_t length, double* value) {
+    static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                    1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                    1e18, 1e19, 1e20, 1e21, 1e22};
+
+    const char* p        = token;
+    const char* end      = token + length;
+    uint64_t    mantissa = 0;
+    int         digits   = 0;   // Значащие цифры в мантиссе
+    int         seen     = 0;   // Всего цифр до порядка
+    int         exponent = 0;
+    int         exact    = 1;   // Отброшенные цифры были нулями
+    int         negative = 0;
+    int         res      = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    for (int fraction = 0; p < end; p++) {
+        if (*p >= '0' && *p <= '9') {
+            seen++;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+                if (mantissa) digits++;
+                exponent -= fraction;
+            } else {
+                exponent += !fraction;
+                if (*p != '0') exact = 0;
+            }
+        } else if (*p == '.' && !fraction) {
+            fraction = 1;
+        } else {
+            break;
+        }
+    }
+
+    if (seen > 0 && p < end && (*p == 'e' || *p == 'E')) {
+        const char* mark = p++;
+        int         sign = 1;
+        int         power = 0;
+
+        if (p < end && (*p == '-' || *p == '+')) sign = *p++ == '-' ? -1 : 1;
+        if (p < end && *p >= '0' && *p <= '9') {
+            for (; p < end && *p >= '0' && *p <= '9'; p++)
+                if (power < 100000) power = power * 10 + (*p - '0');
+            exponent += sign * power;
+        } else {
+            p = mark;
+        }
+    }
+
+    if (seen > 0 && p == end && exact && mantissa <= ((uint64_t) 1 << 53) &&
+        exponent >= -22 && exponent <= 22) {
+        double result = (double) mantissa;
+
+        if (exponent < 0) result /= powers[-exponent];
+        else result *= powers[exponent];
+        *value = negative ? -result : result;
+        res    = 1;
+    } else {
+        res = parse_double_slow (token, length, value);
+    }
+
+    return res;
+}
+
+/**
+ * @brief Разбирает целое число в начале текста
+ *
+ * @return Указатель за числом или NULL, если числа нет
+ */
+static const char* parse_int (const char* p, const char* end, int* value) {
+    const char* res      = NULL;
+    long long   number   = 0;
+    int         negative = 0;
+
+    while (p < end && is_separator (*p)) p++;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    if (p < end && *p >= '0' && *p <= '9') {
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            if (number <= INT_MAX) number = number * 10 + (*p - '0');
+        if (number <= INT_MAX) {
+            *value = (int) (negative ? -number : number);
+            res    = p;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @struct TripletBuffer
+ * @brief Растущий список ненулевых элементов одного куска
+ */
+typedef struct {
+    int*    rows;       ///< Номера строк
+    int*    cols;       ///< Номера столбцов
+    double* values;     ///< Значения
+    size_t  count;      ///< Занято элементов
+    size_t  capacity;   ///< Выделено элементов
+} TripletBuffer;
+
+/**
+ * @struct TextJob
+ * @brief Общие данные параллельного разбора текста
+ *
+ * Область чисел делится на куски по границам строк. Первый проход считает
+ * числа в каждом куске, префиксные суммы дают номер первого числа куска,
+ * второй проход разбирает числа прямо в итоговый буфер.
+ */
+typedef struct {
+    const char**   starts;     ///< Границы кусков: [starts[i], starts[i+1])
+    size_t*        first;      ///< Число чисел в куске, затем номер первого
+    size_t         total;      ///< Нужное количество чисел rows * cols
+    int            cols;       ///< Количество столбцов
+    int            stride;     ///< Шаг строки буфера
+    double*        data;       ///< Итоговый буфер
+    TripletBuffer* triplets;   ///< Буферы кусков при разборе в разреженный вид
+    atomic_int     failed;     ///< Признак ошибки разбора
+} TextJob;
+
+/**
+ * @brief Подзадача первого прохода: считает числа в куске task
+ */
+static void count_chunk (void* ctx, int task, int worker) {
+    TextJob*    job   = ctx;
+    const char* p     = job->starts[task];
+    const char* end   = job->starts[task + 1];
+    size_t      count = 0;
+    int         space = 1;
+
+    (void) worker;
+    for (; p < end; p++) {
+        int sep = is_separator (*p);
+        count += space && !sep;
+        space = sep;
+    }
+    job->first[task] = count;
+}
+
+/**
+ * @brief Подзадача второго прохода: разбирает числа куска task в буфер
+ */
+static void parse_chunk (void* ctx, int task, int worker) {
+    TextJob*    job   = ctx;
+    const char* p     = job->starts[task];
+    const char* end   = job->starts[task + 1];
+    size_t      index = job->first[task];
+    int         row   = (int) (index / (size_t) job->cols);
+    int         col   = (int) (index % (size_t) job->cols);
+
+    (void) worker;
+    while (index < job->total && !atomic_load_explicit (&job->failed,
+                                                        memory_order_relaxed)) {
+        while (p < end && is_separator (*p)) p++;
+        if (p == end) break;
+
+        const char* token = p;
+        while (p < end && !is_separator (*p)) p++;
+
+        if (!parse_double (token, (size_t) (p - token),
+                           &job->data[(size_t) row * job->stride + col])) {
+            atomic_store (&job->failed, 1);
+        }
+        index++;
+        if (++col == job->cols) {
+            col = 0;
+            row++;
+        }
+    }
+}
+
+/**
+ * @brief Добавляет элемент в буфер куска
+ *
+ * @return 1 при успехе, 0 при ошибке выделения памяти
+ */
+static int push_triplet (TripletBuffer* buffer, int row, int col, double value) {
+    int res = 1;
+
+    if (buffer->count == buffer->capacity) {
+        size_t  capacity = buffer->capacity * 2 + 256;
+        size_t  bytes    = capacity * sizeof (double);
+        int*    rows     = realloc (buffer->rows, capacity * sizeof (int));
+        int*    cols     = rows ? realloc (buffer->cols, capacity * sizeof (int))
+                                : NULL;
+        double* values   = cols ? realloc (buffer->values, bytes) : NULL;
+
+        if (rows) buffer->rows = rows;
+        if (cols) buffer->cols = cols;
+        if (values) {
+            buffer->values   = values;
+            buffer->capacity = capacity;
+        } else {
             res = 0;
         }
     }
 
     if (res) {
-        data = (double*) malloc ((*rows) * (*cols) * sizeof (double));
-        if (!data) res = 0;
+        buffer->rows[buffer->count]   = row;
+        buffer->cols[buffer->count]   = col;
+        buffer->values[buffer->count] = value;
+        buffer->count++;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Подзадача второго прохода: собирает ненулевые числа куска task
+ */
+static void sparse_chunk (void* ctx, int task, int worker) {
+    TextJob*       job    = ctx;
+    TripletBuffer* buffer = &job->triplets[task];
+    const char*    p      = job->starts[task];
+    const char*    end    = job->starts[task + 1];
+    size_t         index  = job->first[task];
+    int            row    = (int) (index / (size_t) job->cols);
+    int            col    = (int) (index % (size_t) job->cols);
+
+    (void) worker;
+    while (index < job->total && !atomic_load_explicit (&job->failed,
+                                                        memory_order_relaxed)) {
+        double value = 0.0;
+
+        while (p < end && is_separator (*p)) p++;
+        if (p == end) break;
+
+        const char* token = p;
+        while (p < end && !is_separator (*p)) p++;
+
+        if (!parse_double (token, (size_t) (p - token), &value) ||
+            (value != 0.0 && !push_triplet (buffer, row, col, value))) {
+            atomic_store (&job->failed, 1);
+        }
+        index++;
+        if (++col == job->cols) {
+            col = 0;
+            row++;
+        }
+    }
+}
+
+/**
+ * @brief Делит текст на куски по границам строк и нумерует числа
+ *
+ * Заполняет job->starts и job->first: после вызова first[i] - номер
+ * первого числа куска i.
+ *
+ * @param found Всего чисел в тексте
+ *
+ * @return Число кусков или 0 при ошибке выделения памяти
+ */
+static int split_text (const char* text, size_t length, TextJob* job,
+                       size_t* found) {
+    const size_t threads = (size_t) thread_pool_threads () * 4;
+    const size_t by_size = length / TEXT_CHUNK_MIN + 1;
+    const int    chunks  = (int) (by_size < threads ? by_size : threads);
+    const size_t step    = length / (size_t) chunks;
+    const char*  end     = text + length;
+    int          res     = 0;
+
+    job->starts = malloc ((size_t) (chunks + 1) * sizeof (const char*));
+    job->first  = malloc ((size_t) chunks * sizeof (size_t));
+
+    if (job->starts && job->first) {
+        // Граница куска сдвигается к началу следующей строки; если строка
+        // длиннее куска - к ближайшему разделителю
+        job->starts[0]      = text;
+        job->starts[chunks] = end;
+        for (int i = 1; i < chunks; i++) {
+            const char* nominal = text + step * (size_t) i;
+            const char* p       = nominal < job->starts[i - 1] ? job->starts[i - 1]
+                                                               : nominal;
+            const char* limit   = (size_t) (end - p) > step ? p + step : end;
+            const char* line    = memchr (p, '\n', (size_t) (limit - p));
+
+            if (line) {
+                p = line + 1;
+            } else {
+                while (p < end && !is_separator (*p)) p++;
+            }
+            job->starts[i] = p;
+        }
+
+        thread_pool_run (chunks, count_chunk, job);
+
+        *found = 0;
+        for (int i = 0; i < chunks; i++) {
+            size_t count  = job->first[i];
+            job->first[i] = *found;
+            *found += count;
+        }
+        res = chunks;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Разбирает числа text[0..length) в буфер rows x cols
+ *
+ * @return 1 при успехе, 0 при ошибке
+ */
+static int parse_text (const char* text, size_t length, int rows, int cols,
+                       int stride, double* data) {
+    TextJob job    = {NULL, NULL, (size_t) rows * cols, cols, stride, data, NULL, 0};
+    size_t  found  = 0;
+    int     chunks = split_text (text, length, &job, &found);
+    int     res    = 0;
+
+    if (chunks > 0 && found >= job.total) {
+        thread_pool_run (chunks, parse_chunk, &job);
+        res = !atomic_load (&job.failed);
+    }
+
+    free (job.starts);
+    free (job.first);
+
+    return res;
+}
+
+/**
+ * @brief Разбирает плотный текст rows x cols, сохраняя только ненулевые
+ *
+ * Куски разбираются параллельно в свои буферы, затем буферы склеиваются по
+ * порядку, поэтому элементы идут по строкам, в строке - по столбцам.
+ *
+ * @return 1 при успехе, 0 при ошибке
+ */
+static int parse_text_sparse (const char* text, size_t length, int rows, int cols,
+                              size_t* count, int** row_index, int** col_index,
+                              double** values) {
+    TextJob job    = {NULL, NULL, (size_t) rows * cols, cols, cols, NULL, NULL, 0};
+    size_t  found  = 0;
+    int     chunks = split_text (text, length, &job, &found);
+    int     res    = 0;
+
+    if (chunks > 0 && found >= job.total) {
+        job.triplets = calloc ((size_t) chunks, sizeof (TripletBuffer));
+        if (job.triplets) {
+            thread_pool_run (chunks, sparse_chunk, &job);
+            res = !atomic_load (&job.failed);
+        }
     }
 
     if (res) {
-        for (int index_row = 0; index_row < *rows && res; index_row++) {
-            for (int index_col = 0; index_col < *cols && res; index_col++) {
-                if (fscanf (file, "%lf", &data[index_row * (*cols) + index_col]) !=
-                    1) {
-                    fprintf (stderr, "Ошибка чтения элементов матрицы.\n");
-                    res = 0;
-                }
+        size_t total = 0;
+
+        for (int i = 0; i < chunks; i++) total += job.triplets[i].count;
+        *row_index = malloc ((total ? total : 1) * sizeof (int));
+        *col_index = malloc ((total ? total : 1) * sizeof (int));
+        *values    = malloc ((total ? total : 1) * sizeof (double));
+        if (*row_index && *col_index && *values) {
+            size_t done = 0;
+
+            for (int i = 0; i < chunks; i++) {
+                const TripletBuffer* buffer = &job.triplets[i];
+                const size_t         bytes  = buffer->count * sizeof (int);
+
+                if (buffer->count == 0) continue;
+                memcpy (*row_index + done, buffer->rows, bytes);
+                memcpy (*col_index + done, buffer->cols, bytes);
+                memcpy (*values + done, buffer->values,
+                        buffer->count * sizeof (double));
+                done += buffer->count;
             }
+            *count = total;
+        } else {
+            res = 0;
         }
     }
 
-    if (file) fclose (file);
+    if (job.triplets)
+        for (int i = 0; i < chunks; i++) {
+            free (job.triplets[i].rows);
+            free (job.triplets[i].cols);
+            free (job.triplets[i].values);
+        }
+    free (job.triplets);
+    free (job.starts);
+    free (job.first);
 
-    if (!res && data) {
-        free (data);
-        data = NULL;
+    return res;
+}
+
+/**
+ * @brief Отображает текстовый файл в память для чтения
+ *
+ * @param text Начало текста (NULL для пустого файла)
+ * @param length Длина текста
+ *
+ * @return 1 при успехе, 0 при ошибке
+ */
+static int map_text (const char* filename, const char** text, size_t* length) {
+    struct stat st;
+    int         res = 1;
+    int         fd  = filename ? open (filename, O_RDONLY) : -1;
+
+    *text   = NULL;
+    *length = 0;
+    if (fd < 0 || fstat (fd, &st) != 0) {
+        fprintf (stderr, "Ошибка чтения файла.\n");
+        res = 0;
     }
 
-    return data;
+    if (res && st.st_size > 0) {
+        *length = (size_t) st.st_size;
+        *text   = mmap (NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (*text == MAP_FAILED) {
+            *text = NULL;
+            fprintf (stderr, "Ошибка чтения файла.\n");
+            res = 0;
+        } else {
+            posix_madvise ((void*) *text, *length, POSIX_MADV_SEQUENTIAL);
+        }
+    }
+
+    if (fd >= 0) close (fd);
+
+    return res;
+}
+
+/**
+ * @brief Загружает матрицу из файла
+ *
+ * Файл отображается в память, область чисел делится на куски по
+ * границам строк и разбирается потоками пула (thread_pool.h). Числа
+ * разбираются собственным парсером сразу в итоговый буфер.
+ *
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки загруженного буфера
+ * @param filename Указатель на файл с матрицей для чтения
+ *
+ * @note Буфер выделяется через aligned_alloc и освобождается free
+ *
+ * @return NULL при ошибке или указатель на созданную матрицу
+ */
+double* output_load_matrix_from_file (int* rows, int* cols, int* stride,
+                                      const char* filename) {
+    MatrixStatsScope stats  = MATRIX_STATS_BEGIN (MATRIX_OP_OUTPUT_LOAD_TEXT);
+    double*          data   = NULL;
+    const char*      text   = NULL;
+    const char*      body   = NULL;
+    size_t           length = 0;
+    int              res    = map_text (filename, &text, &length);
+
+    if (res) {
+        body = text ? parse_int (text, text + length, rows) : NULL;
+        body = body ? parse_int (body, text + length, cols) : NULL;
+        if (!body) {
+            fprintf (stderr, "Ошибка чтения размеров матрицы.\n");
+            res = 0;
+        } else if (*rows <= 0 || *cols <= 0) {
+            fprintf (stderr, "Некорректные размеры матрицы.\n");
+            res = 0;
+        }
+    }
+
+    if (res) {
+        size_t bytes;
+
+        *stride = MATRIX_STRIDE (*cols);
+        bytes   = (size_t) (*rows) * (*stride) * sizeof (double);
+        data    = (double*) aligned_alloc (MATRIX_ALIGNMENT, bytes);
+        if (!data) res = 0;
+    }
+
+    if (res && !parse_text (body, (size_t) (text + length - body), *rows, *cols,
+                            *stride, data)) {
+        fprintf (stderr, "Ошибка чтения элементов матрицы.\n");
+        res = 0;
+    }
+
+    if (text) munmap ((void*) text, length);
+
+    if (!res && data) {
+        free (data);
+        data = NULL;
+    }
+    MATRIX_STATS_END (stats, length,
+                      data ? (size_t) *rows * *cols * sizeof (double) : 0, 0);
+
+    return data;
+}
+
+/// Начало файла в формате Matrix Market
+#define MARKET_BANNER "%%MatrixMarket"
+
+/**
+ * @brief Сравнивает слово text[0..length) со словом word без учета регистра
+ */
+static int same_word (const char* text, size_t length, const char* word) {
+    size_t i = 0;
+
+    for (; i < length && word[i]; i++) {
+        char c = text[i] >= 'A' && text[i] <= 'Z' ? (char) (text[i] - 'A' + 'a')
+                                                  : text[i];
+        if (c != word[i]) break;
+    }
+
+    return i == length && word[i] == '\0';
+}
+
+/**
+ * @brief Разбирает строку-заголовок Matrix Market
+ *
+ * Поддерживаются "matrix coordinate" с полем real, integer или pattern и
+ * симметрией general, symmetric или skew-symmetric.
+ *
+ * @param fields Чисел в строке элемента: 3 или 2 для pattern
+ * @param symmetry 0 - general, 1 - symmetric, -1 - skew-symmetric
+ *
+ * @return Указатель на следующую строку или NULL, если формат не поддержан
+ */
+static const char* parse_market_banner (const char* p, const char* end, int* fields,
+                                        int* symmetry) {
+    const char* words[5];
+    size_t      lengths[5];
+    int         count = 0;
+    const char* res   = NULL;
+
+    while (p < end && *p != '\n') {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (p == end || *p == '\n' || *p == '\r') break;
+        if (count == 5) {
+            count++;
+            break;
+        }
+        words[count] = p;
+        while (p < end && !is_separator (*p)) p++;
+        lengths[count] = (size_t) (p - words[count]);
+        count++;
+    }
+
+    if (count == 5 && same_word (words[1], lengths[1], "matrix") &&
+        same_word (words[2], lengths[2], "coordinate")) {
+        *fields   = same_word (words[3], lengths[3], "pattern") ? 2 : 3;
+        *symmetry = same_word (words[4], lengths[4], "symmetric")        ? 1
+                    : same_word (words[4], lengths[4], "skew-symmetric") ? -1
+                                                                         : 0;
+        if ((*fields == 2 || same_word (words[3], lengths[3], "real") ||
+             same_word (words[3], lengths[3], "integer")) &&
+            (*symmetry != 0 || same_word (words[4], lengths[4], "general"))) {
+            const char* line = memchr (p, '\n', (size_t) (end - p));
+            res              = line ? line + 1 : end;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief Проверяет, что индекс Matrix Market - целое от 1 до limit
+ */
+static int market_index (double value, int limit, int* index) {
+    int res = value >= 1.0 && value <= (double) limit && value == (int) value;
+
+    if (res) *index = (int) value - 1;
+
+    return res;
+}
+
+/**
+ * @brief Разбирает файл Matrix Market в список элементов
+ *
+ * Строки элементов разбираются параллельно parse_text () как плотная
+ * таблица count x fields, затем индексы проверяются и переводятся в
+ * отсчет от нуля; для симметричных матриц добавляются отраженные элементы.
+ *
+ * @return 1 при успехе, 0 при ошибке
+ */
+static int parse_matrix_market (const char* text, const char* end, int* rows,
+                                int* cols, size_t* count, int** row_index,
+                                int** col_index, double** values) {
+    int         fields   = 3;
+    int         symmetry = 0;
+    int         entries  = 0;
+    double*     table    = NULL;
+    size_t      total    = 0;
+    const char* p        = parse_market_banner (text, end, &fields, &symmetry);
+    int         res      = p != NULL;
+
+    if (!res) fprintf (stderr, "Неподдерживаемый формат Matrix Market.\n");
+
+    // Строки комментариев до строки размеров
+    while (res && p < end && *p == '%') {
+        const char* line = memchr (p, '\n', (size_t) (end - p));
+        p                = line ? line + 1 : end;
+    }
+
+    if (res) {
+        p = p ? parse_int (p, end, rows) : NULL;
+        p = p ? parse_int (p, end, cols) : NULL;
+        p = p ? parse_int (p, end, &entries) : NULL;
+        if (!p || *rows <= 0 || *cols <= 0 || entries < 0 ||
+            (symmetry && *rows != *cols)) {
+            fprintf (stderr, "Некорректные размеры матрицы.\n");
+            res = 0;
+        }
+    }
+
+    if (res && entries > 0) {
+        table = malloc ((size_t) entries * (size_t) fields * sizeof (double));
+        if (!table || !parse_text (p, (size_t) (end - p), entries, fields, fields,
+                                   table)) {
+            fprintf (stderr, "Ошибка чтения элементов матрицы.\n");
+            res = 0;
+        }
+    }
+
+    if (res) {
+        total = (size_t) entries;
+        if (symmetry)
+            for (size_t e = 0; e < (size_t) entries * fields; e += fields)
+                total += table[e] != table[e + 1];
+
+        *row_index = malloc ((total ? total : 1) * sizeof (int));
+        *col_index = malloc ((total ? total : 1) * sizeof (int));
+        *values    = malloc ((total ? total : 1) * sizeof (double));
+        res        = *row_index && *col_index && *values;
+    }
+
+    for (size_t e = 0, out = 0; res && e < (size_t) entries; e++) {
+        const double* entry = table + e * (size_t) fields;
+        int           row   = 0;
+        int           col   = 0;
+        double        value = fields == 3 ? entry[2] : 1.0;
+
+        if (!market_index (entry[0], *rows, &row) ||
+            !market_index (entry[1], *cols, &col)) {
+            fprintf (stderr, "Индекс элемента вне матрицы.\n");
+            res = 0;
+        } else {
+            (*row_index)[out] = row;
+            (*col_index)[out] = col;
+            (*values)[out++]  = value;
+            if (symmetry && row != col) {
+                (*row_index)[out] = col;
+                (*col_index)[out] = row;
+                (*values)[out++]  = symmetry > 0 ? value : -value;
+            }
+        }
+    }
+
+    if (res) *count = total;
+    free (table);
+
+    return res;
+}
+
+/**
+ * @brief Загружает матрицу из текстового файла в виде списка ненулевых
+ *
+ * Плотный текст разбирается параллельно, как в output_load_matrix_from_file,
+ * но нули не сохраняются: память пропорциональна числу ненулевых. Файл,
+ * начинающийся с "%%MatrixMarket", читается как Matrix Market.
+ *
+ * @param filename Указатель на файл
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param count Число элементов
+ * @param row_index Номера строк (malloc, освобождается free)
+ * @param col_index Номера столбцов (malloc)
+ * @param values Значения (malloc)
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int output_load_sparse_from_file (const char* filename, int* rows, int* cols,
+                                  size_t* count, int** row_index, int** col_index,
+                                  double** values) {
+    MatrixStatsScope stats  = MATRIX_STATS_BEGIN (MATRIX_OP_OUTPUT_LOAD_SPARSE);
+    const char*      text   = NULL;
+    const char*      body   = NULL;
+    size_t           length = 0;
+    int              res    = map_text (filename, &text, &length);
+
+    *row_index = NULL;
+    *col_index = NULL;
+    *values    = NULL;
+
+    if (res && text && length >= sizeof (MARKET_BANNER) - 1 &&
+        memcmp (text, MARKET_BANNER, sizeof (MARKET_BANNER) - 1) == 0) {
+        res = parse_matrix_market (text, text + length, rows, cols, count,
+                                   row_index, col_index, values);
+    } else if (res) {
+        body = text ? parse_int (text, text + length, rows) : NULL;
+        body = body ? parse_int (body, text + length, cols) : NULL;
+        if (!body) {
+            fprintf (stderr, "Ошибка чтения размеров матрицы.\n");
+            res = 0;
+        } else if (*rows <= 0 || *cols <= 0) {
+            fprintf (stderr, "Некорректные размеры матрицы.\n");
+            res = 0;
+        } else if (!parse_text_sparse (body, (size_t) (text + length - body), *rows,
+                                       *cols, count, row_index, col_index, values)) {
+            fprintf (stderr, "Ошибка чтения элементов матрицы.\n");
+            res = 0;
+        }
+    }
+
+    if (text) munmap ((void*) text, length);
+
+    if (!res) {
+        free (*row_index);
+        free (*col_index);
+        free (*values);
+        *row_index = NULL;
+        *col_index = NULL;
+        *values    = NULL;
+    }
+    MATRIX_STATS_END (stats, length,
+                      res ? *count * (2 * sizeof (int) + sizeof (double)) : 0, 0);
+
+    return res ? 0 : -1;
+}
+
+/**
+ * @brief Сохраняет список ненулевых элементов в формате Matrix Market
+ *
+ * Числа пишутся в кратчайшей точной записи независимо от
+ * output_set_format: шестнадцатеричную запись другие программы не читают.
+ *
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param count Число элементов
+ * @param row_index Номера строк от нуля
+ * @param col_index Номера столбцов от нуля
+ * @param values Значения
+ * @param filename Указатель на файл
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int output_save_sparse_to_file (int rows, int cols, size_t count,
+                                const int* row_index, const int* col_index,
+                                const double* values, const char* filename) {
+    MatrixStatsScope stats    = MATRIX_STATS_BEGIN (MATRIX_OP_OUTPUT_SAVE_SPARSE);
+    const size_t     line_max = 2 * 12 + DTOA_BUFFER_SIZE + 2;
+    char*            buffer   = malloc (TEXT_WRITE_CHUNK + line_max);
+    size_t           length   = 0;
+    int              fd       = -1;
+    int              res      = -1;
+
+    if (buffer && (count == 0 || (row_index && col_index && values))) {
+        fd = filename ? open (filename, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+        if (fd >= 0) {
+            length = (size_t) snprintf (buffer, TEXT_WRITE_CHUNK,
+                                        "%s matrix coordinate real general\n"
+                                        "%d %d %zu\n",
+                                        MARKET_BANNER, rows, cols, count);
+            res    = 0;
+        } else {
+            fprintf (stderr, "Ошибка открытия файла.\n");
+        }
+    }
+
+    for (size_t i = 0; i < count && res == 0; i++) {
+        char* p = buffer + length;
+
+        p += sprintf (p, "%d %d ", row_index[i] + 1, col_index[i] + 1);
+        p += dtoa_shortest (values[i], p);
+        *p++   = '\n';
+        length = (size_t) (p - buffer);
+        if (length >= TEXT_WRITE_CHUNK) {
+            res    = write_all (fd, buffer, length);
+            length = 0;
+        }
+    }
+
+    if (res == 0) res = write_all (fd, buffer, length);
+    if (fd >= 0 && close (fd) != 0) res = -1;
+    if (fd >= 0 && res != 0) fprintf (stderr, "Ошибка записи файла.\n");
+    free (buffer);
+    MATRIX_STATS_END (stats,
+                      res == 0 ? count * (2 * sizeof (int) + sizeof (double)) : 0,
+                      res == 0 ? stats_file_size (filename) : 0, 0);
+
+    return res;
+}
+
+/**
+ * @brief Смещение данных: заголовок, дополненный до MATRIX_ALIGNMENT
+ */
+static size_t binary_data_offset (void) {
+    return ((OUTPUT_BINARY_HEADER_SIZE + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT) *
+           MATRIX_ALIGNMENT;
+}
+
+/**
+ * @brief Размер элемента типа dtype в байтах, 0 - неизвестный тип
+ */
+static size_t dtype_size (uint32_t dtype) {
+    size_t size = 0;
+
+    switch (dtype) {
+    case OUTPUT_DTYPE_FLOAT32:
+    case OUTPUT_DTYPE_INT32: size = 4; break;
+    case OUTPUT_DTYPE_FLOAT64:
+    case OUTPUT_DTYPE_INT64: size = 8; break;
+    case OUTPUT_DTYPE_COMPLEX128: size = 16; break;
+    default: size = 0; break;
+    }
+
+    return size;
+}
+
+/**
+ * @brief Заполняет заголовок для матрицы rows x cols этой машины
+ */
+static BinaryHeader make_header (int rows, int cols, OutputDtype dtype,
+                                 int file_stride) {
+    BinaryHeader header = {{0},
+                           OUTPUT_BINARY_VERSION,
+                           OUTPUT_ENDIAN_MARK,
+                           (uint32_t) dtype,
+                           (uint64_t) rows,
+                           (uint64_t) cols,
+                           (uint64_t) file_stride,
+                           MATRIX_ALIGNMENT,
+                           (uint32_t) binary_data_offset (),
+                           {0}};
+
+    memcpy (header.magic, OUTPUT_BINARY_MAGIC, sizeof (header.magic));
+
+    return header;
+}
+
+/**
+ * @brief Сохраняет матрицу в двоичном формате
+ *
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки в элементах
+ * @param data Указатель на массив данных
+ * @param filename Указатель на файл для сохранения матрицы
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int output_save_matrix_binary (int rows, int cols, int stride, const double* data,
+                               const char* filename) {
+    return output_save_matrix_binary_typed (rows, cols, stride, OUTPUT_DTYPE_FLOAT64,
+                                            data, filename);
+}
+
+/**
+ * @brief Сохраняет матрицу с элементами типа dtype в двоичном формате
+ *
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки в элементах
+ * @param dtype Тип элементов
+ * @param data Указатель на массив элементов dtype
+ * @param filename Указатель на файл для сохранения матрицы
+ *
+ * @return 0 при успехе, -1 при ошибке
+ */
+int output_save_matrix_binary_typed (int rows, int cols, int stride,
+                                     OutputDtype dtype, const void* data,
+                                     const char* filename) {
+    MatrixStatsScope stats   = MATRIX_STATS_BEGIN (MATRIX_OP_OUTPUT_SAVE_BINARY);
+    const size_t     elem    = dtype_size (dtype);
+    size_t           written = 0;   // Байт в файле после успешной записи
+    int              result  = -1;
+    FILE*            file    = NULL;
+
+    if (data && elem && rows > 0 && cols > 0 && stride >= cols) {
+        file = fopen (filename, "wb");
+        if (file) {
+            static const unsigned char zeros[MATRIX_ALIGNMENT] = {0};
+
+            const char*  bytes       = data;
+            const int    file_stride = MATRIX_STRIDE_FOR (cols, elem);
+            const size_t offset      = binary_data_offset ();
+            const BinaryHeader header =
+                make_header (rows, cols, dtype, file_stride);
+            int ok;
+
+            ok = fwrite (&header, sizeof (header), 1, file) == 1 &&
+                 fwrite (zeros, 1, offset - sizeof (header), file) ==
+                     offset - sizeof (header);
+
+            // Строки дополняются нулями до шага файла
+            for (int index_row = 0; index_row < rows && ok; index_row++) {
+                const size_t pad = (size_t) (file_stride - cols) * elem;
+                ok = fwrite (bytes + (size_t) index_row * stride * elem, elem,
+                             (size_t) cols, file) == (size_t) cols &&
+                     fwrite (zeros, 1, pad, file) == pad;
+            }
+
+            if (fclose (file) != 0) ok = 0;
+            file    = NULL;
+            result  = ok ? 0 : -1;
+            written = ok ? offset + (size_t) rows * file_stride * elem : 0;
+            if (!ok) fprintf (stderr, "Ошибка записи файла.\n");
+        } else {
+            fprintf (stderr, "Ошибка открытия файла.\n");
+        }
+    } else {
+        printf ("Данные матрицы отсутствуют.\n");
+    }
+    MATRIX_STATS_END (stats, written ? (size_t) rows * cols * elem : 0, written, 0);
+
+    return result;
+}
+
+/**
+ * @brief Проверяет, записан ли файл в двоичном формате
+ *
+ * @param filename Указатель на файл
+ *
+ * @return 1, если файл начинается с OUTPUT_BINARY_MAGIC, иначе 0
+ */
+int output_is_binary_matrix (const char* filename) {
+    int   result = 0;
+    char  magic[4];
+    FILE* file = filename ? fopen (filename, "rb") : NULL;
+
+    if (file) {
+        result = fread (magic, 1, sizeof (magic), file) == sizeof (magic) &&
+                 memcmp (magic, OUTPUT_BINARY_MAGIC, sizeof (magic)) == 0;
+        fclose (file);
+    }
+
+    return result;
+}
+
+/**
+ * @brief Переставляет байты значения размером size в обратном порядке
+ */
+static void swap_bytes (void* value, size_t size) {
+    unsigned char* bytes = value;
+
+    for (size_t i = 0; i < size / 2; i++) {
+        unsigned char tmp    = bytes[i];
+        bytes[i]             = bytes[size - 1 - i];
+        bytes[size - 1 - i] = tmp;
+    }
+}
+
+/**
+ * @brief Приводит числовые поля заголовка к порядку байт этой машины
+ */
+static void swap_header (BinaryHeader* header) {
+    swap_bytes (&header->version, sizeof (header->version));
+    swap_bytes (&header->endian, sizeof (header->endian));
+    swap_bytes (&header->dtype, sizeof (header->dtype));
+    swap_bytes (&header->rows, sizeof (header->rows));
+    swap_bytes (&header->cols, sizeof (header->cols));
+    swap_bytes (&header->stride, sizeof (header->stride));
+    swap_bytes (&header->alignment, sizeof (header->alignment));
+    swap_bytes (&header->data_offset, sizeof (header->data_offset));
+}
+
+/**
+ * @brief Читает данные с преобразованием типа и порядка байт
+ *
+ * @param fd Открытый файл
+ * @param header Заголовок в порядке байт этой машины
+ * @param elem Размер элемента в файле
+ * @param swap 1 - порядок байт файла отличается
+ *
+ * @return Буфер aligned_alloc с шагом MATRIX_STRIDE (cols) или NULL
+ */
+static double* read_converted (int fd, const BinaryHeader* header, size_t elem,
+                               int swap) {
+    const int      cols   = (int) header->cols;
+    const size_t   stride = (size_t) MATRIX_STRIDE (cols);
+    const size_t   bytes  = (size_t) header->cols * elem;
+    const size_t   total  = (size_t) header->rows * stride * sizeof (double);
+    double*        data   = aligned_alloc (MATRIX_ALIGNMENT, total);
+    unsigned char* row    = malloc (bytes);
+    int            ok     = data && row;
+
+    for (uint64_t index_row = 0; index_row < header->rows && ok; index_row++) {
+        off_t pos = (off_t) header->data_offset +
+                    (off_t) (index_row * header->stride * elem);
+        ok = pread (fd, row, bytes, pos) == (ssize_t) bytes;
+
+        for (int index_col = 0; index_col < cols && ok; index_col++) {
+            unsigned char* cell = row + (size_t) index_col * elem;
+            double*        out  = &data[index_row * stride + index_col];
+
+            if (swap) swap_bytes (cell, elem);
+            if (header->dtype == OUTPUT_DTYPE_FLOAT32) {
+                float value;
+                memcpy (&value, cell, sizeof (value));
+                *out = value;
+            } else if (header->dtype == OUTPUT_DTYPE_INT32) {
+                int32_t value;
+                memcpy (&value, cell, sizeof (value));
+                *out = value;
+            } else if (header->dtype == OUTPUT_DTYPE_INT64) {
+                int64_t value;
+                memcpy (&value, cell, sizeof (value));
+                *out = (double) value;
+            } else {
+                memcpy (out, cell, sizeof (double));
+            }
+        }
+    }
+
+    free (row);
+    if (!ok) {
+        free (data);
+        data = NULL;
+    }
+
+    return data;
+}
+
+/**
+ * @brief Читает данные в типе файла с перестановкой байт
+ *
+ * complex переставляется по половинам (re и im - отдельные double).
+ *
+ * @param fd Открытый файл
+ * @param header Заголовок в порядке байт этой машины
+ * @param elem Размер элемента в файле
+ *
+ * @return Буфер aligned_alloc с шагом MATRIX_STRIDE_FOR (cols, elem) или NULL
+ */
+static void* read_swapped (int fd, const BinaryHeader* header, size_t elem) {
+    const size_t   unit   = header->dtype == OUTPUT_DTYPE_COMPLEX128 ? 8 : elem;
+    const size_t   stride = (size_t) MATRIX_STRIDE_FOR ((int) header->cols, elem);
+    const size_t   bytes  = (size_t) header->cols * elem;
+    const size_t   total  = header->rows * stride * elem;
+    unsigned char* data   = aligned_alloc (MATRIX_ALIGNMENT, total);
+    int            ok     = data != NULL;
+
+    for (uint64_t index_row = 0; index_row < header->rows && ok; index_row++) {
+        unsigned char* row = data + index_row * stride * elem;
+        off_t          pos = (off_t) header->data_offset +
+                    (off_t) (index_row * header->stride * elem);
+
+        ok = pread (fd, row, bytes, pos) == (ssize_t) bytes;
+        for (size_t at = 0; at < bytes && ok; at += unit)
+            swap_bytes (row + at, unit);
+    }
+
+    if (!ok) {
+        free (data);
+        data = NULL;
+    }
+
+    return data;
+}
+
+/**
+ * @brief Читает и проверяет заголовок двоичного файла
+ *
+ * @param fd Открытый файл
+ * @param header Заголовок, приведенный к порядку байт этой машины
+ * @param swap 1 - порядок байт файла отличается
+ * @param elem Размер элемента в файле
+ *
+ * @return 1 при корректном заголовке, 0 при ошибке (с сообщением)
+ */
+static int read_header (int fd, BinaryHeader* header, int* swap, size_t* elem) {
+    const ssize_t size = (ssize_t) sizeof (*header);
+    struct stat   st;
+    int           res = fstat (fd, &st) == 0 &&
+              pread (fd, header, sizeof (*header), 0) == size &&
+              memcmp (header->magic, OUTPUT_BINARY_MAGIC, 4) == 0;
+
+    *swap = 0;
+    *elem = 0;
+    if (res && header->endian != OUTPUT_ENDIAN_MARK) {
+        swap_header (header);
+        *swap = 1;
+    }
+    if (res) {
+        *elem = dtype_size (header->dtype);
+    }
+    if (!res || header->endian != OUTPUT_ENDIAN_MARK ||
+        header->version != OUTPUT_BINARY_VERSION || *elem == 0) {
+        fprintf (stderr, "Некорректный заголовок двоичного файла.\n");
+        res = 0;
+    }
+
+    // Размеры должны помещаться в int, а данные - в файл
+    if (res) {
+        uint64_t limit = (uint64_t) st.st_size;
+        res = header->rows > 0 && header->rows <= INT_MAX && header->cols > 0 &&
+              header->cols <= INT_MAX && header->stride >= header->cols &&
+              header->stride <= INT_MAX && header->data_offset >= sizeof (*header) &&
+              header->data_offset <= limit &&
+              header->rows <= (limit - header->data_offset) / *elem / header->stride;
+        if (!res) fprintf (stderr, "Некорректные размеры матрицы.\n");
+    }
+
+    return res;
+}
+
+/**
+ * @brief Отображает файл или читает его с преобразованием
+ *
+ * Если порядок байт совпадает с этой машиной, а тип - с запрошенным
+ * (native - любой тип файла, иначе double), файл отображается через mmap
+ * и данные не копируются: страницы подгружаются из кэша страниц при первом
+ * обращении. Отображение начинается с границы страницы не дальше
+ * data_offset, поэтому начало отображения всегда получается округлением
+ * адреса данных вниз до размера страницы.
+ *
+ * @return Указатель на данные или NULL при ошибке
+ */
+static void* map_binary (int* rows, int* cols, int* stride, OutputDtype* dtype,
+                         size_t* mapped, int copy_on_write, int native,
+                         const char* filename) {
+    void*        data = NULL;
+    BinaryHeader header;
+    int          swap = 0;
+    size_t       elem = 0;
+    int          res  = rows && cols && stride && mapped && filename;
+    int          fd   = res ? open (filename, O_RDONLY) : -1;
+
+    if (res && fd < 0) {
+        fprintf (stderr, "Ошибка чтения файла.\n");
+        res = 0;
+    }
+
+    if (res) res = read_header (fd, &header, &swap, &elem);
+
+    if (res && !native && header.dtype == OUTPUT_DTYPE_COMPLEX128) {
+        fprintf (stderr, "Комплексная матрица не приводится к double.\n");
+        res = 0;
+    }
+
+    if (res && !swap && (native || header.dtype == OUTPUT_DTYPE_FLOAT64) &&
+        header.data_offset % elem == 0) {
+        const size_t page   = (size_t) sysconf (_SC_PAGESIZE);
+        const size_t start  = header.data_offset - header.data_offset % page;
+        const size_t length = header.data_offset - start +
+                              header.rows * header.stride * elem;
+        const int    prot   = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+        const int    flags  = copy_on_write ? MAP_PRIVATE : MAP_SHARED;
+        void* base = mmap (NULL, length, prot, flags, fd, (off_t) start);
+
+        if (base != MAP_FAILED) {
+            data    = (char*) base + (header.data_offset - start);
+            *stride = (int) header.stride;
+            *mapped = length;
+        }
+    } else if (res && native) {
+        data    = read_swapped (fd, &header, elem);
+        *stride = MATRIX_STRIDE_FOR ((int) header.cols, elem);
+        *mapped = 0;
+    } else if (res) {
+        data    = read_converted (fd, &header, elem, swap);
+        *stride = MATRIX_STRIDE ((int) header.cols);
+        *mapped = 0;
+    }
+
+    if (data) {
+        *rows = (int) header.rows;
+        *cols = (int) header.cols;
+        if (dtype) *dtype = (OutputDtype) header.dtype;
+    } else if (res) {
+        fprintf (stderr, "Ошибка отображения файла.\n");
+    }
+
+    if (fd >= 0) close (fd);
+
+    return data;
+}
+
+/**
+ * @brief Отображает двоичный файл матрицы в память
+ *
+ * Файл double в порядке байт этой машины отображается без копирования,
+ * остальные читаются с преобразованием в double.
+ *
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки в элементах
+ * @param mapped Длина отображения в байтах, 0 - буфер скопирован
+ * @param copy_on_write 0 - только чтение, 1 - запись в частную копию страниц
+ * @param filename Указатель на файл для чтения матрицы
+ *
+ * @return Указатель на данные или NULL при ошибке
+ */
+double* output_map_matrix_binary (int* rows, int* cols, int* stride,
+                                  size_t* mapped, int copy_on_write,
+                                  const char* filename) {
+    MatrixStatsScope stats = MATRIX_STATS_BEGIN (MATRIX_OP_OUTPUT_MAP_BINARY);
+    double*          data  = map_binary (rows, cols, stride, NULL, mapped,
+                                         copy_on_write, 0, filename);
+
+    MATRIX_STATS_END (stats, data ? stats_file_size (filename) : 0, 0, 0);
+
+    return data;
+}
+
+/**
+ * @brief Отображает двоичный файл матрицы, сохраняя тип элементов
+ *
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки в элементах
+ * @param dtype Тип элементов файла
+ * @param mapped Длина отображения в байтах, 0 - буфер скопирован
+ * @param copy_on_write 0 - только чтение, 1 - запись в частную копию страниц
+ * @param filename Указатель на файл для чтения матрицы
+ *
+ * @return Указатель на данные или NULL при ошибке
+ */
+void* output_map_matrix_typed (int* rows, int* cols, int* stride,
+                               OutputDtype* dtype, size_t* mapped,
+                               int copy_on_write, const char* filename) {
+    MatrixStatsScope stats = MATRIX_STATS_BEGIN (MATRIX_OP_OUTPUT_MAP_BINARY);
+    void*            data  = dtype ? map_binary (rows, cols, stride, dtype, mapped,
+                                                 copy_on_write, 1, filename)
+                                   : NULL;
+
+    MATRIX_STATS_END (stats, data ? stats_file_size (filename) : 0, 0, 0);
+
+    return data;
+}
+
+/**
+ * @brief Снимает отображение, созданное output_map_matrix_binary ()
+ *
+ * @param data Указатель на данные
+ * @param mapped Длина отображения в байтах
+ */
+void output_unmap_matrix (double* data, size_t mapped) {
+    if (data && mapped) {
+        const size_t page = (size_t) sysconf (_SC_PAGESIZE);
+        char*        base = (char*) data - (uintptr_t) data % page;
+        munmap (base, mapped);
+    }
+}
+
+/**
+ * @brief Открывает двоичный файл матрицы для поблочного чтения
+ *
+ * @param filename Указатель на файл
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки в файле в элементах
+ * @param offset Смещение данных от начала файла в байтах
+ *
+ * @return Дескриптор файла или -1 при ошибке
+ */
+int output_open_matrix_binary (const char* filename, int* rows, int* cols,
+                               int* stride, size_t* offset) {
+    BinaryHeader header;
+    int          swap, res;
+    size_t       elem;
+    int          fd = filename ? open (filename, O_RDONLY) : -1;
+
+    if (fd < 0) fprintf (stderr, "Ошибка чтения файла.\n");
+
+    res = fd >= 0 && read_header (fd, &header, &swap, &elem);
+    if (res && (swap || header.dtype != OUTPUT_DTYPE_FLOAT64)) {
+        fprintf (stderr, "Поблочное чтение требует double в порядке байт машины.\n");
+        res = 0;
+    }
+
+    if (res) {
+        *rows   = (int) header.rows;
+        *cols   = (int) header.cols;
+        *stride = (int) header.stride;
+        *offset = header.data_offset;
+    } else if (fd >= 0) {
+        close (fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Создает двоичный файл матрицы для поблочной записи
+ *
+ * Записывается заголовок, файл сразу получает полный размер (без
+ * выделения места на диске под еще не записанные данные).
+ *
+ * @param filename Указатель на файл
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки в файле в элементах (MATRIX_STRIDE (cols))
+ * @param offset Смещение данных от начала файла в байтах
+ *
+ * @return Дескриптор файла, открытого на чтение и запись, или -1
+ */
+int output_create_matrix_binary (const char* filename, int rows, int cols,
+                                 int* stride, size_t* offset) {
+    const int          file_stride = MATRIX_STRIDE (cols);
+    const size_t       data_offset = binary_data_offset ();
+    const BinaryHeader header =
+        make_header (rows, cols, OUTPUT_DTYPE_FLOAT64, file_stride);
+    const int          flags       = O_RDWR | O_CREAT | O_TRUNC;
+    int fd = filename && rows > 0 && cols > 0 ? open (filename, flags, 0644) : -1;
+
+    if (fd >= 0 &&
+        (pwrite (fd, &header, sizeof (header), 0) != (ssize_t) sizeof (header) ||
+         ftruncate (fd, (off_t) (data_offset + (size_t) rows * file_stride *
+                                                   sizeof (double))) != 0)) {
+        close (fd);
+        fd = -1;
+    }
+
+    if (fd >= 0) {
+        *stride = file_stride;
+        *offset = data_offset;
+    } else {
+        fprintf (stderr, "Ошибка создания файла.\n");
+    }
+
+    return fd;
 }
@@ -7,11 +7,31 @@
  * - Вывод матрицы в консоль
  * - Сохранение матрицы в файл
  * - Загрузка матрицы из текстового файла
+ * - Загрузка и сохранение списка ненулевых элементов (Matrix Market)
+ * - Сохранение и отображение в память (mmap) двоичного файла
  *
  * Формат файла:
  * Первые два числа - размеры матрицы (rows cols)
  * Затем идут элементы построчно
  *
+ * По умолчанию числа сохраняются в кратчайшей записи, которая читается
+ * обратно без потерь; формат меняется через output_set_format.
+ *
+ * Двоичный формат: заголовок OUTPUT_BINARY_HEADER_SIZE байт, затем с
+ * выровненного смещения data_offset - строки по stride элементов.
+ * Поля заголовка (в порядке байт записавшей машины):
+ * - magic[4] - "MTXB"
+ * - uint32 version - OUTPUT_BINARY_VERSION
+ * - uint32 endian - 0x01020304, по нему определяется порядок байт
+ * - uint32 dtype - тип элементов (OutputDtype)
+ * - uint64 rows, cols, stride - размеры и шаг строки в элементах
+ * - uint32 alignment - выравнивание данных и строк в байтах
+ * - uint32 data_offset - смещение данных от начала файла
+ * - 16 байт резерва (нули)
+ *
+ * Данные в памяти хранятся одним блоком построчно, строки следуют с шагом
+ * stride элементов (stride >= cols)
+ *
  * @note Все функции проверяют корректность входных данных
  *
  * @see matrix.h
@@ -20,32 +40,226 @@
 #ifndef OUTPUT_H
 #define OUTPUT_H
 
+#include "../../include/config.h"
+
+#include <stddef.h>
+
+/// Сигнатура двоичного файла матрицы
+#define OUTPUT_BINARY_MAGIC "MTXB"
+
+/// Версия двоичного формата
+#define OUTPUT_BINARY_VERSION 1
+
+/// Размер заголовка двоичного файла в байтах
+#define OUTPUT_BINARY_HEADER_SIZE 64
+
+/**
+ * @brief Тип элементов в двоичном файле
+ */
+typedef enum {
+    OUTPUT_DTYPE_FLOAT32    = 1,   ///< float, 4 байта
+    OUTPUT_DTYPE_FLOAT64    = 2,   ///< double, 8 байт
+    OUTPUT_DTYPE_INT32      = 3,   ///< int32_t, 4 байта
+    OUTPUT_DTYPE_INT64      = 4,   ///< int64_t, 8 байт
+    OUTPUT_DTYPE_COMPLEX128 = 5    ///< double _Complex, 16 байт (re, im)
+} OutputDtype;
+
+/// Наибольшее число знаков после точки для OUTPUT_FORMAT_FIXED
+#define OUTPUT_PRECISION_MAX 100
+
+/**
+ * @brief Формат чисел при сохранении в текстовый файл
+ */
+typedef enum {
+    OUTPUT_FORMAT_SHORTEST = 0,   ///< Кратчайшая десятичная запись, читается точно
+    OUTPUT_FORMAT_FIXED,          ///< Заданное число знаков после точки ("%.Nf")
+    OUTPUT_FORMAT_HEX             ///< Шестнадцатеричная запись ("%a"), точная
+} OutputFormat;
+
+/**
+ * @brief Устанавливает формат чисел для output_save_matrix_to_file
+ * @param format Формат (по умолчанию OUTPUT_FORMAT_SHORTEST)
+ * @param precision Число знаков после точки для OUTPUT_FORMAT_FIXED,
+ * от 0 до OUTPUT_PRECISION_MAX
+ * @return 0 при успехе, -1 при некорректных параметрах
+ */
+int output_set_format (OutputFormat format, int precision);
+
+/**
+ * @brief Возвращает текущий формат чисел текстовых файлов
+ * @param format Формат (может быть NULL)
+ * @param precision Число знаков после точки (может быть NULL)
+ */
+void output_get_format (OutputFormat* format, int* precision);
+
 /**
  * @brief Выводит матрицу в консоль
  * @param rows Количество строк
  * @param cols Количество столбцов
+ * @param stride Шаг строки в элементах
  * @param data Указатель на массив
  */
-void output_print_matrix (int rows, int cols, const double* data);
+void output_print_matrix (int rows, int cols, int stride, const double* data);
 
 /**
  * @brief Сохраняет матрицу в файл
  * @param rows Количество строк
  * @param cols Количество столбцов
+ * @param stride Шаг строки в элементах
  * @param data Указатель на массив
  * @param filename Указатель на файл для сохранения матрицы
  * @return 0 при успехе, -1 при ошибке
  */
-int output_save_matrix_to_file (int rows, int cols, const double* data,
+int output_save_matrix_to_file (int rows, int cols, int stride, const double* data,
                                 const char* filename);
 
 /**
  * @brief Загружает матрицу из файла
+ * @details Файл отображается в память и разбирается параллельно потоками
+ * пула собственным парсером чисел, без fscanf
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки загруженного буфера (MATRIX_STRIDE (cols))
+ * @param filename Указатель на файл для чтения матрицы
+ * @return Выровненный по MATRIX_ALIGNMENT буфер или NULL в случае ошибки
+ */
+double* output_load_matrix_from_file (int* rows, int* cols, int* stride,
+                                      const char* filename);
+
+/**
+ * @brief Загружает ненулевые элементы матрицы из текстового файла
+ * @details Плотный текст разбирается параллельно без хранения нулей;
+ * файл, начинающийся с "%%MatrixMarket", читается как Matrix Market
+ * (matrix coordinate real/integer/pattern general/symmetric/skew-symmetric)
+ * @param filename Указатель на файл для чтения матрицы
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param count Число элементов
+ * @param row_index Номера строк от нуля (malloc, освобождается free)
+ * @param col_index Номера столбцов от нуля (malloc)
+ * @param values Значения (malloc)
+ * @note Плотный текст дает элементы по строкам; элементы Matrix Market идут
+ * в порядке файла и могут повторяться
+ * @return 0 при успехе, -1 при ошибке
+ */
+int output_load_sparse_from_file (const char* filename, int* rows, int* cols,
+                                  size_t* count, int** row_index, int** col_index,
+                                  double** values);
+
+/**
+ * @brief Сохраняет ненулевые элементы в формате Matrix Market
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param count Число элементов
+ * @param row_index Номера строк от нуля
+ * @param col_index Номера столбцов от нуля
+ * @param values Значения
+ * @param filename Указатель на файл для сохранения матрицы
+ * @return 0 при успехе, -1 при ошибке
+ */
+int output_save_sparse_to_file (int rows, int cols, size_t count,
+                                const int* row_index, const int* col_index,
+                                const double* values, const char* filename);
+
+/**
+ * @brief Сохраняет матрицу в двоичном формате
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки в элементах
+ * @param data Указатель на массив
+ * @param filename Указатель на файл для сохранения матрицы
+ * @note В файле строки идут с шагом MATRIX_STRIDE (cols) и выровнены
+ * @return 0 при успехе, -1 при ошибке
+ */
+int output_save_matrix_binary (int rows, int cols, int stride, const double* data,
+                               const char* filename);
+
+/**
+ * @brief Сохраняет матрицу с элементами типа dtype в двоичном формате
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки в элементах
+ * @param dtype Тип элементов
+ * @param data Указатель на массив элементов dtype
+ * @param filename Указатель на файл для сохранения матрицы
+ * @note Строки файла выровнены по MATRIX_ALIGNMENT байт
+ * @return 0 при успехе, -1 при ошибке
+ */
+int output_save_matrix_binary_typed (int rows, int cols, int stride,
+                                     OutputDtype dtype, const void* data,
+                                     const char* filename);
+
+/**
+ * @brief Проверяет, записан ли файл в двоичном формате
+ * @param filename Указатель на файл
+ * @return 1, если файл начинается с OUTPUT_BINARY_MAGIC, иначе 0
+ */
+int output_is_binary_matrix (const char* filename);
+
+/**
+ * @brief Отображает двоичный файл матрицы в память
  * @param rows Количество строк
  * @param cols Количество столбцов
+ * @param stride Шаг строки в элементах
+ * @param mapped Длина отображения в байтах, 0 - буфер скопирован
+ * @param copy_on_write 0 - только чтение, 1 - запись в частную копию страниц
  * @param filename Указатель на файл для чтения матрицы
- * @return Указатель на созданную матрицу или NULL в случае ошибки
+ * @note Файл с чужим порядком байт или типом float, int32, int64
+ * читается с преобразованием в буфер aligned_alloc, тогда *mapped = 0;
+ * complex не преобразуется (ошибка)
+ * @return Указатель на данные или NULL при ошибке
+ */
+double* output_map_matrix_binary (int* rows, int* cols, int* stride,
+                                  size_t* mapped, int copy_on_write,
+                                  const char* filename);
+
+/**
+ * @brief Отображает двоичный файл матрицы, сохраняя тип элементов
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки в элементах
+ * @param dtype Тип элементов файла
+ * @param mapped Длина отображения в байтах, 0 - буфер скопирован
+ * @param copy_on_write 0 - только чтение, 1 - запись в частную копию страниц
+ * @param filename Указатель на файл для чтения матрицы
+ * @note Файл с чужим порядком байт читается в буфер aligned_alloc
+ * (complex - перестановкой байт каждой половины), тогда *mapped = 0
+ * @return Указатель на данные или NULL при ошибке
+ */
+void* output_map_matrix_typed (int* rows, int* cols, int* stride,
+                               OutputDtype* dtype, size_t* mapped,
+                               int copy_on_write, const char* filename);
+
+/**
+ * @brief Снимает отображение, созданное output_map_matrix_binary ()
+ * @param data Указатель на данные
+ * @param mapped Длина отображения в байтах
+ */
+void output_unmap_matrix (double* data, size_t mapped);
+
+/**
+ * @brief Открывает двоичный файл матрицы для поблочного чтения
+ * @param filename Указатель на файл
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки в файле в элементах
+ * @param offset Смещение данных от начала файла в байтах
+ * @note Поддерживаются только файлы double в порядке байт этой машины
+ * @return Дескриптор файла (закрывается close) или -1 при ошибке
+ */
+int output_open_matrix_binary (const char* filename, int* rows, int* cols,
+                               int* stride, size_t* offset);
+
+/**
+ * @brief Создает двоичный файл матрицы для поблочной записи
+ * @param filename Указатель на файл
+ * @param rows Количество строк
+ * @param cols Количество столбцов
+ * @param stride Шаг строки в файле в элементах
+ * @param offset Смещение данных от начала файла в байтах
+ * @return Дескриптор файла (закрывается close) или -1 при ошибке
  */
-double* output_load_matrix_from_file (int* rows, int* cols, const char* filename);
+int output_create_matrix_binary (const char* filename, int rows, int cols,
+                                 int* stride, size_t* offset);
 
 #endif   // OUTPUT_H
@@ -3,17 +3,41 @@
  *
  * @brief Модуль реализации тестов для matrix.c
  */
+#include "matrix/alloc.h"
+#include "matrix/batch.h"
+#include "matrix/dtype.h"
+#include "matrix/expr.h"
+#include "matrix/gemm.h"
 #include "matrix/matrix.h"
+#include "matrix/ooc.h"
+#include "matrix/simd.h"
+#include "matrix/small.h"
+#include "matrix/sparse.h"
+#include "matrix/stats.h"
+#include "matrix/strassen.h"
+#include "matrix/thread_pool.h"
+#include "matrix/trace.h"
+#include "matrix/tune.h"
+#include "output/output.h"
 
 #include <CUnit/Basic.h>
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 void test_matrix_creation (void) {
     Matrix m = create_matrix (2, 3);
     CU_ASSERT_PTR_NOT_NULL (m.data);
     CU_ASSERT_EQUAL (m.rows, 2);
     CU_ASSERT_EQUAL (m.cols, 3);
+
+    // Данные лежат одним выровненным блоком, строки дополнены до шага stride
+    CU_ASSERT (m.stride >= m.cols);
+    CU_ASSERT_EQUAL (m.stride % MATRIX_ALIGN_ELEMS, 0);
+    CU_ASSERT_EQUAL ((size_t) m.data % MATRIX_ALIGNMENT, 0);
+    CU_ASSERT_PTR_EQUAL (MATRIX_ROW (&m, 1), &MATRIX_AT (&m, 1, 0));
     free_matrix (&m);
 
     Matrix invalid = create_matrix (-1, 0);
@@ -29,8 +53,8 @@ void test_matrix_addition (void) {
     // Заполняем матрицы тестовыми данными
     for (int i = 0; i < 2; i++) {
         for (int j = 0; j < 2; j++) {
-            a.data[i][j] = i + j;
-            b.data[i][j] = (i + j) * 2;
+            MATRIX_AT (&a, i, j) = i + j;
+            MATRIX_AT (&b, i, j) = (i + j) * 2;
         }
     }
 
@@ -38,8 +62,8 @@ void test_matrix_addition (void) {
     int    add_result = add_matrices (&a, &b, &result);
 
     CU_ASSERT_EQUAL (add_result, 0);
-    CU_ASSERT_DOUBLE_EQUAL (result.data[0][0], 0.0, 0.001);
-    CU_ASSERT_DOUBLE_EQUAL (result.data[1][1], 6.0, 0.001);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&result, 0, 0), 0.0, 0.001);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&result, 1, 1), 6.0, 0.001);
 
     free_matrix (&a);
     free_matrix (&b);
@@ -55,6 +79,71 @@ void test_matrix_addition (void) {
     free_matrix (&invalid_add);
 }
 
+void test_inplace_accumulate (void) {
+    const int rows = 7, cols = 11;
+
+    Matrix a = create_matrix (rows, cols);
+    Matrix b = create_matrix (rows, cols);
+    Matrix x = create_matrix (rows, cols);
+
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            MATRIX_AT (&a, i, j) = i - j;
+            MATRIX_AT (&b, i, j) = i * j % 5;
+        }
+    }
+
+    // x = a; x += b; x -= a; x += x => x = 2b
+    CU_ASSERT_EQUAL (axpby_matrices (1, &a, 0, &x), 0);
+    CU_ASSERT_EQUAL (add_matrices_inplace (&x, &b), 0);
+    CU_ASSERT_EQUAL (subtract_matrices_inplace (&x, &a), 0);
+    CU_ASSERT_EQUAL (add_matrices_inplace (&x, &x), 0);
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++)
+            CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&x, i, j), 2 * MATRIX_AT (&b, i, j),
+                                    0);
+
+    // result совпадает со вторым и четвертым слагаемыми:
+    // x = a + 3x - b - x = a + 2 * (2b) - b = a + 3b
+    const Matrix*     terms[4]  = {&a, &x, &b, &x};
+    const MATRIX_TYPE alphas[4] = {1, 3, -1, -1};
+    CU_ASSERT_EQUAL (accumulate_matrices (&x, 4, terms, alphas), 0);
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++)
+            CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&x, i, j),
+                                    MATRIX_AT (&a, i, j) + 3 * MATRIX_AT (&b, i, j),
+                                    0);
+
+    // Слагаемое, сдвинутое на строку внутри того же буфера, копируется
+    Matrix shifted = a;
+    Matrix top     = a;
+    shifted.rows   = rows - 1;
+    shifted.data   = MATRIX_ROW (&a, 1);
+    top.rows       = rows - 1;
+    Matrix expect  = create_matrix (rows - 1, cols);
+    for (int i = 0; i < rows - 1; i++)
+        for (int j = 0; j < cols; j++)
+            MATRIX_AT (&expect, i, j) =
+                MATRIX_AT (&a, i, j) + MATRIX_AT (&a, i + 1, j);
+    CU_ASSERT_EQUAL (add_matrices_inplace (&top, &shifted), 0);
+    for (int i = 0; i < rows - 1; i++)
+        for (int j = 0; j < cols; j++)
+            CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&a, i, j), MATRIX_AT (&expect, i, j),
+                                    0);
+
+    // Несовпадение размеров и пустой список
+    Matrix small = create_matrix (2, 2);
+    CU_ASSERT_EQUAL (add_matrices_inplace (&x, &small), -1);
+    CU_ASSERT_EQUAL (accumulate_matrices (&x, 0, terms, alphas), -1);
+    CU_ASSERT_EQUAL (axpby_matrices (1, NULL, 1, &x), -1);
+
+    free_matrix (&a);
+    free_matrix (&b);
+    free_matrix (&x);
+    free_matrix (&expect);
+    free_matrix (&small);
+}
+
 void test_matrix_multiplication (void) {
     Matrix a = create_matrix (2, 3);
     Matrix b = create_matrix (3, 2);
@@ -62,13 +151,13 @@ void test_matrix_multiplication (void) {
     // Заполняем матрицы тестовыми данными
     for (int i = 0; i < 2; i++) {
         for (int j = 0; j < 3; j++) {
-            a.data[i][j] = i + j;
+            MATRIX_AT (&a, i, j) = i + j;
         }
     }
 
     for (int i = 0; i < 3; i++) {
         for (int j = 0; j < 2; j++) {
-            b.data[i][j] = i * j;
+            MATRIX_AT (&b, i, j) = i * j;
         }
     }
 
@@ -76,8 +165,8 @@ void test_matrix_multiplication (void) {
     int    mul_result = multiply_matrices (&a, &b, &result);
 
     CU_ASSERT_EQUAL (mul_result, 0);
-    CU_ASSERT_DOUBLE_EQUAL (result.data[0][0], 0.0, 0.001);
-    CU_ASSERT_DOUBLE_EQUAL (result.data[1][1], 8.0, 0.001);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&result, 0, 0), 0.0, 0.001);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&result, 1, 1), 8.0, 0.001);
 
     free_matrix (&a);
     free_matrix (&b);
@@ -93,13 +182,467 @@ void test_matrix_multiplication (void) {
     free_matrix (&invalid_mul);
 }
 
+void test_matrix_multiplication_blocked (void) {
+    const int  m = 37, k = 301, n = 45;   // Размеры не кратны тайлам и блокам
+    GemmConfig saved, small;
+
+    Matrix a        = create_matrix (m, k);
+    Matrix b        = create_matrix (k, n);
+    Matrix result   = create_matrix (m, n);
+    Matrix expected = create_matrix (m, n);
+
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < k; j++) MATRIX_AT (&a, i, j) = (i * 7 + j * 3) % 11 - 5;
+    for (int i = 0; i < k; i++)
+        for (int j = 0; j < n; j++) MATRIX_AT (&b, i, j) = (i * 5 + j * 2) % 13 - 6;
+
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            double sum = 0;
+            for (int p = 0; p < k; p++)
+                sum += MATRIX_AT (&a, i, p) * MATRIX_AT (&b, p, j);
+            MATRIX_AT (&expected, i, j) = sum;
+        }
+    }
+
+    // Маленькие блоки, чтобы пройти все ветки обхода панелей
+    gemm_get_config (&saved);
+    small.mc        = 8;
+    small.kc        = 64;
+    small.nc        = 16;
+    small.threshold = 1;
+    CU_ASSERT_EQUAL (gemm_set_config (&small), 0);
+
+    CU_ASSERT_EQUAL (multiply_matrices (&a, &b, &result), 0);
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++)
+            CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&result, i, j),
+                                    MATRIX_AT (&expected, i, j), 1e-9);
+
+    // Тот же результат при разбиении тайлов между несколькими потоками
+    const int threads = thread_pool_threads ();
+    CU_ASSERT_EQUAL (thread_pool_set_threads (3), 0);
+    CU_ASSERT_EQUAL (thread_pool_threads (), 3);
+    for (int repeat = 0; repeat < 3; repeat++) {
+        CU_ASSERT_EQUAL (multiply_matrices (&a, &b, &result), 0);
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++)
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&result, i, j),
+                                        MATRIX_AT (&expected, i, j), 1e-9);
+    }
+    thread_pool_set_threads (threads);
+
+    gemm_set_config (&saved);
+
+    free_matrix (&a);
+    free_matrix (&b);
+    free_matrix (&result);
+    free_matrix (&expected);
+}
+
+/**
+ * @brief Подзадача проверки пула: отмечает задачу и номер потока
+ */
+static void mark_worker (void* ctx, int task, int worker) {
+    int* seen = ctx;
+
+    seen[task] = worker + 1;
+}
+
+void test_thread_pool_workers (void) {
+    const int threads  = thread_pool_threads ();
+    int       seen[64] = {0};
+    int       done = 1, bounded = 1;
+
+    // Пул больше числа буферов вызывающего: номера потоков в пределах буферов
+    CU_ASSERT_EQUAL (thread_pool_set_threads (4), 0);
+    for (int repeat = 0; repeat < 5; repeat++) {
+        CU_ASSERT_EQUAL (thread_pool_run_workers (64, 2, mark_worker, seen), 0);
+        for (int task = 0; task < 64; task++) {
+            done &= seen[task] > 0;
+            bounded &= seen[task] <= 2;
+            seen[task] = 0;
+        }
+    }
+    CU_ASSERT (done);
+    CU_ASSERT (bounded);
+    CU_ASSERT_EQUAL (thread_pool_run_workers (4, 0, mark_worker, seen), -1);
+    thread_pool_set_threads (threads);
+}
+
+void test_strassen_multiply (void) {
+    StrassenConfig saved, small;
+    strassen_get_config (&saved);
+
+    // Нечетные размеры на каждом уровне: отсечение строк, столбцов и k
+    Matrix A        = create_matrix (67, 45);
+    Matrix B        = create_matrix (45, 51);
+    Matrix expected = create_matrix (67, 51);
+    Matrix result   = create_matrix (67, 51);
+    for (int i = 0; i < A.rows; i++)
+        for (int j = 0; j < A.cols; j++) MATRIX_AT (&A, i, j) = sin (i * 0.3 + j);
+    for (int i = 0; i < B.rows; i++)
+        for (int j = 0; j < B.cols; j++) MATRIX_AT (&B, i, j) = cos (i - j * 0.7);
+    CU_ASSERT_EQUAL (multiply_matrices (&A, &B, &expected), 0);
+
+    small.threshold = 0;
+    small.crossover = 5;
+    CU_ASSERT_EQUAL (strassen_set_config (&small), 0);
+    CU_ASSERT_EQUAL (strassen_use (67, 51, 45), 0);
+    CU_ASSERT_EQUAL (strassen_multiply (&A, &B, &result), 0);
+    for (int i = 0; i < result.rows; i++)
+        for (int j = 0; j < result.cols; j++)
+            CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&result, i, j),
+                                    MATRIX_AT (&expected, i, j), 1e-12);
+
+    // Переключение multiply_matrices по порогу
+    small.threshold = 40;
+    CU_ASSERT_EQUAL (strassen_set_config (&small), 0);
+    CU_ASSERT_EQUAL (strassen_use (67, 51, 45), 1);
+    CU_ASSERT_EQUAL (strassen_use (67, 51, 39), 0);
+    CU_ASSERT_EQUAL (multiply_matrices (&A, &B, &result), 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&result, 66, 50),
+                            MATRIX_AT (&expected, 66, 50), 1e-12);
+
+    small.crossover = 0;
+    CU_ASSERT_EQUAL (strassen_set_config (&small), -1);
+    CU_ASSERT_EQUAL (strassen_multiply (&B, &A, &result), -1);
+    strassen_set_config (&saved);
+
+    free_matrix (&A);
+    free_matrix (&B);
+    free_matrix (&expected);
+    free_matrix (&result);
+}
+
+void test_fused_multiply (void) {
+    const int  m = 23, n = 31, k = 150;   // k больше kc - несколько проходов
+    GemmConfig saved, small;
+
+    Matrix a        = create_matrix (m, k);
+    Matrix b        = create_matrix (n, k);
+    Matrix c        = create_matrix (m, n);
+    Matrix d        = create_matrix (m, n);
+    Matrix at       = create_matrix (k, m);
+    Matrix result   = create_matrix (m, n);
+    Matrix expected = create_matrix (m, n);
+
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < k; j++) MATRIX_AT (&a, i, j) = (i * 5 + j) % 9 - 4;
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < k; j++) MATRIX_AT (&b, i, j) = (i + j * 3) % 7 - 3;
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            MATRIX_AT (&c, i, j) = i - j;
+            MATRIX_AT (&d, i, j) = i * j % 5;
+        }
+    }
+    CU_ASSERT_EQUAL (transpose_matrix_into (&a, &at), 0);
+
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            double sum = 0;
+            for (int p = 0; p < k; p++)
+                sum += MATRIX_AT (&a, i, p) * MATRIX_AT (&b, j, p);
+            MATRIX_AT (&expected, i, j) =
+                sum - MATRIX_AT (&c, i, j) + MATRIX_AT (&d, i, j);
+        }
+    }
+
+    // Простой цикл для малых размеров
+    CU_ASSERT_EQUAL (fused_multiply_bt_sub_add (&a, &b, &c, &d, &result), 0);
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++)
+            CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&result, i, j),
+                                    MATRIX_AT (&expected, i, j), 1e-9);
+
+    // Блочная схема с эпилогом и транспонированием при упаковке
+    gemm_get_config (&saved);
+    small.mc        = 8;
+    small.kc        = 64;
+    small.nc        = 16;
+    small.threshold = 1;
+    CU_ASSERT_EQUAL (gemm_set_config (&small), 0);
+
+    CU_ASSERT_EQUAL (fused_multiply_bt_sub_add (&a, &b, &c, &d, &result), 0);
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++)
+            CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&result, i, j),
+                                    MATRIX_AT (&expected, i, j), 1e-9);
+
+    // op(A) = A^T: то же произведение из транспонированной копии A
+    GemmEpilogue epilogue = {2, {{c.data, c.stride, -1}, {d.data, d.stride, 1}}};
+    CU_ASSERT_EQUAL (gemm_compute (1, 1, m, n, k, at.data, at.stride, b.data,
+                                   b.stride, result.data, result.stride, &epilogue),
+                     0);
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++)
+            CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&result, i, j),
+                                    MATRIX_AT (&expected, i, j), 1e-9);
+
+    gemm_set_config (&saved);
+
+    // Несовпадающие размеры и результат на месте слагаемого
+    CU_ASSERT_EQUAL (fused_multiply_bt_sub_add (&a, &c, &c, &d, &result), -1);
+    CU_ASSERT_EQUAL (fused_multiply_bt_sub_add (&a, &b, &c, &d, &c), -1);
+
+    free_matrix (&a);
+    free_matrix (&b);
+    free_matrix (&c);
+    free_matrix (&d);
+    free_matrix (&at);
+    free_matrix (&result);
+    free_matrix (&expected);
+}
+
+/// Проверяет, что матрицы совпадают поэлементно
+static void assert_matrices_equal (const Matrix* a, const Matrix* b) {
+    CU_ASSERT_EQUAL (a->rows, b->rows);
+    CU_ASSERT_EQUAL (a->cols, b->cols);
+    for (int i = 0; i < a->rows && i < b->rows; i++)
+        for (int j = 0; j < a->cols && j < b->cols; j++)
+            CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (a, i, j), MATRIX_AT (b, i, j), 1e-9);
+}
+
+void test_expression (void) {
+    const int m = 9, k = 13, n = 11;
+
+    Matrix a = create_matrix (m, k);
+    Matrix b = create_matrix (n, k);
+    Matrix c = create_matrix (m, n);
+    Matrix d = create_matrix (m, n);
+
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < k; j++) MATRIX_AT (&a, i, j) = (i * 3 + j) % 7 - 3;
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < k; j++) MATRIX_AT (&b, i, j) = (i + j * 2) % 5 - 2;
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            MATRIX_AT (&c, i, j) = i - j;
+            MATRIX_AT (&d, i, j) = (i * j) % 4;
+        }
+    }
+
+    // Ожидаемые значения - через немедленные операции
+    Matrix bt   = transpose_matrix (&b);
+    Matrix ab   = create_matrix (m, n);
+    Matrix ab_c = create_matrix (m, n);
+    Matrix abcd = create_matrix (m, n);
+    multiply_matrices (&a, &bt, &ab);
+    subtract_matrices (&ab, &c, &ab_c);
+    add_matrices (&ab_c, &d, &abcd);
+    Matrix abt = transpose_matrix (&abcd);
+
+    MatrixExpr* e  = expr_create ();
+    int         ea = expr_input (e, &a);
+    int         eb = expr_input (e, &b);
+    int         ec = expr_input (e, &c);
+    int         ed = expr_input (e, &d);
+
+    // A x B^T - C + D: транспонирование во флагах, сумма в эпилоге GEMM
+    int    fused  = expr_add (e, expr_sub (e, expr_multiply (e, ea,
+                                                             expr_transpose (e, eb)),
+                                           ec),
+                              ed);
+    Matrix result = create_matrix (m, n);
+    CU_ASSERT_EQUAL (expr_evaluate (e, fused, &result), 0);
+    assert_matrices_equal (&result, &abcd);
+
+    // (A x B^T - C + D)^T: транспонирование проходит на листья
+    int    rows, cols;
+    int    t      = expr_transpose (e, fused);
+    Matrix result_t;
+    CU_ASSERT_EQUAL (expr_shape (e, t, &rows, &cols), 0);
+    CU_ASSERT_EQUAL (rows, n);
+    CU_ASSERT_EQUAL (cols, m);
+    result_t = create_matrix (rows, cols);
+    CU_ASSERT_EQUAL (expr_evaluate (e, t, &result_t), 0);
+    assert_matrices_equal (&result_t, &abt);
+
+    // Общее подвыражение S = A x B^T - C + D используется дважды:
+    // 2 * S - (S^T)^T + D - D = S
+    int s2 = expr_scale (e, fused, 2);
+    int tt = expr_transpose (e, expr_transpose (e, fused));
+    int sh = expr_sub (e, expr_add (e, expr_sub (e, s2, tt), ed), ed);
+    CU_ASSERT_EQUAL (expr_evaluate (e, sh, &result), 0);
+    assert_matrices_equal (&result, &abcd);
+
+    // Корень - входная матрица
+    CU_ASSERT_EQUAL (expr_evaluate (e, ec, &result), 0);
+    assert_matrices_equal (&result, &c);
+
+    // Ошибки: несовместимые размеры, -1 как операнд, результат на месте входа
+    CU_ASSERT_EQUAL (expr_multiply (e, ea, ea), -1);
+    CU_ASSERT_EQUAL (expr_add (e, -1, ec), -1);
+    CU_ASSERT_EQUAL (expr_evaluate (e, fused, &c), -1);
+    CU_ASSERT_EQUAL (expr_evaluate (e, fused, &result_t), -1);
+
+    expr_free (e);
+    free_matrix (&a);
+    free_matrix (&b);
+    free_matrix (&c);
+    free_matrix (&d);
+    free_matrix (&bt);
+    free_matrix (&ab);
+    free_matrix (&ab_c);
+    free_matrix (&abcd);
+    free_matrix (&abt);
+    free_matrix (&result);
+    free_matrix (&result_t);
+}
+
+void test_simd_kernels (void) {
+    const int m = 29, n = 35, k = 67;   // Размеры не кратны ни одному тайлу
+
+    Matrix a        = create_matrix (m, k);
+    Matrix b        = create_matrix (k, n);
+    Matrix c        = create_matrix (m, k);
+    Matrix product  = create_matrix (m, n);
+    Matrix sum      = create_matrix (m, k);
+    Matrix diff     = create_matrix (m, k);
+    Matrix expected = create_matrix (m, n);
+
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < k; j++) {
+            MATRIX_AT (&a, i, j) = (i * 3 + j) % 17 - 8;
+            MATRIX_AT (&c, i, j) = (i + j * 5) % 7 - 3;
+        }
+    }
+    for (int i = 0; i < k; i++)
+        for (int j = 0; j < n; j++) MATRIX_AT (&b, i, j) = (i * 2 + j * 3) % 9 - 4;
+
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            double acc = 0;
+            for (int p = 0; p < k; p++)
+                acc += MATRIX_AT (&a, i, p) * MATRIX_AT (&b, p, j);
+            MATRIX_AT (&expected, i, j) = acc;
+        }
+    }
+
+    SimdLevel  initial = simd_kernels ()->level;
+    GemmConfig saved, small;
+    gemm_get_config (&saved);
+    small           = saved;
+    small.threshold = 1;
+    gemm_set_config (&small);
+
+    // Каждый поддерживаемый процессором уровень сверяется с эталоном
+    for (int level = SIMD_GENERIC; level < SIMD_LEVEL_COUNT; level++) {
+        if (simd_select ((SimdLevel) level) != 0) continue;
+
+        CU_ASSERT_EQUAL (multiply_matrices (&a, &b, &product), 0);
+        CU_ASSERT_EQUAL (add_matrices (&a, &c, &sum), 0);
+        CU_ASSERT_EQUAL (subtract_matrices (&a, &c, &diff), 0);
+        Matrix t = transpose_matrix (&a);
+
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++)
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&product, i, j),
+                                        MATRIX_AT (&expected, i, j), 1e-9);
+            for (int j = 0; j < k; j++) {
+                double x = MATRIX_AT (&a, i, j), y = MATRIX_AT (&c, i, j);
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&sum, i, j), x + y, 1e-12);
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&diff, i, j), x - y, 1e-12);
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&t, j, i), x, 1e-12);
+            }
+        }
+
+        // axpby: общий случай и beta = 0 (строка y не читается)
+        CU_ASSERT_EQUAL (axpby_matrices (2.0, &a, -0.5, &diff), 0);
+        CU_ASSERT_EQUAL (axpby_matrices (3.0, &c, 0.0, &sum), 0);
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < k; j++) {
+                double x = MATRIX_AT (&a, i, j), y = MATRIX_AT (&c, i, j);
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&diff, i, j),
+                                        2 * x - 0.5 * (x - y), 1e-12);
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&sum, i, j), 3 * y, 1e-12);
+            }
+        }
+        free_matrix (&t);
+    }
+
+    simd_select (initial);
+    gemm_set_config (&saved);
+
+    free_matrix (&a);
+    free_matrix (&b);
+    free_matrix (&c);
+    free_matrix (&product);
+    free_matrix (&sum);
+    free_matrix (&diff);
+    free_matrix (&expected);
+}
+
+void test_matrix_view (void) {
+    Matrix parent = create_matrix (6, 7);
+
+    for (int i = 0; i < 6; i++)
+        for (int j = 0; j < 7; j++) MATRIX_AT (&parent, i, j) = i * 10 + j;
+
+    // Окно 3 x 4 с началом (2, 1) и вложенное окно 2 x 2
+    Matrix view  = matrix_view (&parent, 2, 1, 3, 4);
+    Matrix inner = matrix_view (&view, 1, 2, 2, 2);
+    CU_ASSERT_EQUAL (view.storage, MATRIX_VIEW);
+    CU_ASSERT_EQUAL (view.stride, parent.stride);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&view, 0, 0), 21, 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&inner, 1, 1), 44, 0);
+
+    // Операции читают представление через stride
+    Matrix t   = transpose_matrix (&view);
+    Matrix sum = create_matrix (3, 4);
+    Matrix sq  = create_matrix (3, 3);
+    CU_ASSERT_EQUAL (add_matrices (&view, &view, &sum), 0);
+    CU_ASSERT_EQUAL (multiply_matrices (&view, &t, &sq), 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&t, 3, 2), 44, 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&sum, 2, 3), 88, 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&sq, 0, 0),
+                            21 * 21 + 22 * 22 + 23 * 23 + 24 * 24, 0);
+
+    // Сохранение окна и загрузка обратно
+    CU_ASSERT_EQUAL (save_matrix_to_file (&view, "test_view.txt"), 0);
+    CU_ASSERT_EQUAL (save_matrix_binary (&view, "test_view.mtx"), 0);
+    Matrix text   = load_matrix_from_file ("test_view.txt");
+    Matrix binary = load_matrix_binary ("test_view.mtx", 0);
+    CU_ASSERT_EQUAL (text.rows, 3);
+    CU_ASSERT_EQUAL (binary.cols, 4);
+    if (text.data && binary.data) {
+        CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&text, 2, 3), 44, 0);
+        CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&binary, 1, 0), 31, 0);
+    }
+
+    // Запись через представление меняет родителя
+    CU_ASSERT_EQUAL (axpby_matrices (0, &inner, -1, &inner), 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&parent, 4, 4), -44, 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&parent, 4, 5), 45, 0);
+    CU_ASSERT_EQUAL (transpose_matrix_inplace (&inner), 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&parent, 3, 4), -43, 0);
+    CU_ASSERT_EQUAL (transpose_matrix_inplace (&view), -1);
+
+    // Окно за границами; освобождение представления не трогает буфер
+    CU_ASSERT_PTR_NULL (matrix_view (&parent, 4, 0, 3, 1).data);
+    CU_ASSERT_PTR_NULL (matrix_view (&parent, 0, -1, 1, 1).data);
+    free_matrix (&view);
+    CU_ASSERT_PTR_NULL (view.data);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&parent, 5, 6), 56, 0);
+
+    free_matrix (&t);
+    free_matrix (&sum);
+    free_matrix (&sq);
+    free_matrix (&text);
+    free_matrix (&binary);
+    free_matrix (&parent);
+    remove ("test_view.txt");
+    remove ("test_view.mtx");
+}
+
 void test_matrix_transpose (void) {
     Matrix m = create_matrix (2, 3);
 
     // Заполняем матрицу тестовыми данными
     for (int i = 0; i < 2; i++) {
         for (int j = 0; j < 3; j++) {
-            m.data[i][j] = i * 3 + j;
+            MATRIX_AT (&m, i, j) = i * 3 + j;
         }
     }
 
@@ -107,27 +650,92 @@ void test_matrix_transpose (void) {
 
     CU_ASSERT_EQUAL (transposed.rows, 3);
     CU_ASSERT_EQUAL (transposed.cols, 2);
-    CU_ASSERT_DOUBLE_EQUAL (transposed.data[0][0], 0.0, 0.001);
-    CU_ASSERT_DOUBLE_EQUAL (transposed.data[1][1], 4.0, 0.001);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&transposed, 0, 0), 0.0, 0.001);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&transposed, 1, 1), 4.0, 0.001);
 
     free_matrix (&m);
     free_matrix (&transposed);
 }
 
+void test_matrix_transpose_inplace (void) {
+    // Квадратная (несколько уровней рекурсии) и прямоугольные матрицы
+    const int shapes[][2] = {{97, 97}, {3, 1}, {1, 5}, {70, 45}, {45, 70}};
+
+    for (size_t s = 0; s < sizeof (shapes) / sizeof (shapes[0]); s++) {
+        const int rows = shapes[s][0], cols = shapes[s][1];
+        Matrix    m    = create_matrix (rows, cols);
+        for (int i = 0; i < rows; i++)
+            for (int j = 0; j < cols; j++) MATRIX_AT (&m, i, j) = i * 1000 + j;
+
+        Matrix into = create_matrix (cols, rows);
+        CU_ASSERT_EQUAL (transpose_matrix_into (&m, &into), 0);
+        CU_ASSERT_EQUAL (transpose_matrix_inplace (&m), 0);
+        CU_ASSERT_EQUAL (m.rows, cols);
+        CU_ASSERT_EQUAL (m.cols, rows);
+        CU_ASSERT (m.stride >= m.cols);
+
+        for (int i = 0; i < cols; i++) {
+            for (int j = 0; j < rows; j++) {
+                const double expected = j * 1000 + i;
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&m, i, j), expected, 1e-12);
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&into, i, j), expected, 1e-12);
+            }
+        }
+
+        // Неверные размеры приемника
+        CU_ASSERT_NOT_EQUAL (transpose_matrix_into (&m, &m), 0);
+
+        free_matrix (&m);
+        free_matrix (&into);
+    }
+}
+
 void test_determinant (void) {
     Matrix m = create_matrix (2, 2);
 
     // Заполняем матрицу тестовыми данными
-    m.data[0][0] = 1.0;
-    m.data[0][1] = 2.0;
-    m.data[1][0] = 3.0;
-    m.data[1][1] = 4.0;
+    MATRIX_AT (&m, 0, 0) = 1.0;
+    MATRIX_AT (&m, 0, 1) = 2.0;
+    MATRIX_AT (&m, 1, 0) = 3.0;
+    MATRIX_AT (&m, 1, 1) = 4.0;
 
     double det = determinant (&m);
     CU_ASSERT_DOUBLE_EQUAL (det, -2.0, 0.001);
 
     free_matrix (&m);
 
+    // Матрица 4x4, требующая перестановки строк
+    const double values[4][4] = {
+        {0, 2, 1, 3}, {1, 0, 2, 1}, {2, 1, 0, 1}, {1, 1, 1, 0}};
+    Matrix big = create_matrix (4, 4);
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++) MATRIX_AT (&big, i, j) = values[i][j];
+    CU_ASSERT_DOUBLE_EQUAL (determinant (&big), -15.0, 1e-9);
+
+    double log_abs = 0;
+    int    sign    = 0;
+    CU_ASSERT_EQUAL (determinant_log (&big, &log_abs, &sign), 0);
+    CU_ASSERT_EQUAL (sign, -1);
+    CU_ASSERT_DOUBLE_EQUAL (log_abs, log (15.0), 1e-9);
+
+    // Вырожденная матрица: две одинаковые строки
+    for (int j = 0; j < 4; j++) MATRIX_AT (&big, 3, j) = values[0][j];
+    CU_ASSERT_DOUBLE_EQUAL (determinant (&big), 0.0, 1e-12);
+    CU_ASSERT_EQUAL (determinant_log (&big, &log_abs, &sign), 0);
+    CU_ASSERT_EQUAL (sign, 0);
+    free_matrix (&big);
+
+    // Большая диагональная матрица: det = 10^400 не помещается в double
+    const int n     = 200;
+    Matrix    large = create_matrix (n, n);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++) MATRIX_AT (&large, i, j) = i == j ? 100.0 : 0.0;
+    MATRIX_AT (&large, 0, 0) = -100.0;
+    CU_ASSERT_EQUAL (determinant_log (&large, &log_abs, &sign), 0);
+    CU_ASSERT_EQUAL (sign, -1);
+    CU_ASSERT_DOUBLE_EQUAL (log_abs, n * log (100.0), 1e-6);
+    free_matrix (&large);
+
     // Тест с неквадратной матрицей
     Matrix non_square  = create_matrix (2, 3);
     double invalid_det = determinant (&non_square);
@@ -170,8 +778,8 @@ void test_file_operations (void) {
     CU_ASSERT_PTR_NOT_NULL (loaded.data);
     CU_ASSERT_EQUAL (loaded.rows, 2);
     CU_ASSERT_EQUAL (loaded.cols, 2);
-    CU_ASSERT_DOUBLE_EQUAL (loaded.data[0][0], 1.0, 0.001);
-    CU_ASSERT_DOUBLE_EQUAL (loaded.data[1][1], 4.0, 0.001);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&loaded, 0, 0), 1.0, 0.001);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&loaded, 1, 1), 4.0, 0.001);
 
     // Тестируем сохранение
     int save_result = save_matrix_to_file (&loaded, "test_save.txt");
@@ -182,6 +790,919 @@ void test_file_operations (void) {
     remove ("test_save.txt");
 }
 
+void test_binary_file_operations (void) {
+    const char* filename = "test_matrix.mtx";
+    Matrix      m        = create_matrix (4, 9);
+
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 9; j++) MATRIX_AT (&m, i, j) = i * 10 + j;
+    CU_ASSERT_EQUAL (save_matrix_binary (&m, filename), 0);
+
+    // Только чтение: матрица указывает на отображение файла
+    Matrix mapped = load_matrix_binary (filename, 0);
+    CU_ASSERT_PTR_NOT_NULL (mapped.data);
+    CU_ASSERT_EQUAL (mapped.storage, MATRIX_MAPPED);
+    CU_ASSERT_EQUAL (mapped.rows, 4);
+    CU_ASSERT_EQUAL (mapped.cols, 9);
+    if (mapped.data)
+        CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&mapped, 3, 8), 38, 0);
+    free_matrix (&mapped);
+    CU_ASSERT_PTR_NULL (mapped.data);
+
+    // load_matrix_from_file распознает двоичный файл, запись разрешена
+    Matrix loaded = load_matrix_from_file (filename);
+    CU_ASSERT_PTR_NOT_NULL (loaded.data);
+    CU_ASSERT_EQUAL (loaded.storage, MATRIX_MAPPED);
+    if (loaded.data) {
+        MATRIX_AT (&loaded, 0, 0) = -1;
+        CU_ASSERT_EQUAL (transpose_matrix_inplace (&loaded), 0);
+        CU_ASSERT_EQUAL (loaded.rows, 9);
+        CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&loaded, 8, 3), 38, 0);
+        CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&loaded, 0, 0), -1, 0);
+    }
+    free_matrix (&loaded);
+
+    CU_ASSERT_PTR_NULL (load_matrix_binary ("nonexistent.mtx", 0).data);
+
+    free_matrix (&m);
+    remove (filename);
+}
+
+void test_out_of_core_multiply (void) {
+    const int m = 19, k = 37, n = 23;
+
+    Matrix a = create_matrix (m, k);
+    Matrix b = create_matrix (k, n);
+
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < k; j++) MATRIX_AT (&a, i, j) = (i * 7 + j * 3) % 11 - 5;
+    for (int i = 0; i < k; i++)
+        for (int j = 0; j < n; j++) MATRIX_AT (&b, i, j) = (i * 5 + j) % 13 * 0.5;
+    CU_ASSERT_EQUAL (save_matrix_binary (&a, "ooc_a.mtx"), 0);
+    CU_ASSERT_EQUAL (save_matrix_binary (&b, "ooc_b.mtx"), 0);
+
+    // Память на семь минимальных тайлов: размеры не кратны тайлу
+    const size_t memory = 7 * MATRIX_ALIGN_ELEMS * MATRIX_ALIGN_ELEMS *
+                          sizeof (MATRIX_TYPE);
+    CU_ASSERT_EQUAL (ooc_tile_size (memory), MATRIX_ALIGN_ELEMS);
+    CU_ASSERT_EQUAL (ooc_tile_size (memory - 1), 0);
+
+    CU_ASSERT_EQUAL (ooc_multiply_files ("ooc_a.mtx", "ooc_b.mtx", "ooc_c.mtx",
+                                         memory),
+                     0);
+    Matrix expected = create_matrix (m, n);
+    Matrix result   = load_matrix_binary ("ooc_c.mtx", 0);
+    CU_ASSERT_EQUAL (multiply_matrices (&a, &b, &expected), 0);
+    CU_ASSERT_PTR_NOT_NULL (result.data);
+    if (result.data) assert_matrices_equal (&result, &expected);
+    free_matrix (&result);
+
+    // Один тайл во всю ширину файла пишется строками целиком вместе с
+    // выравниванием, в файле оно должно остаться нулевым
+    Matrix wide_a = create_matrix (3, 5);
+    Matrix wide_b = create_matrix (5, n);
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 5; j++) MATRIX_AT (&wide_a, i, j) = i + j;
+    for (int i = 0; i < 5; i++)
+        for (int j = 0; j < n; j++) MATRIX_AT (&wide_b, i, j) = i - j;
+    CU_ASSERT_EQUAL (save_matrix_binary (&wide_a, "ooc_a.mtx"), 0);
+    CU_ASSERT_EQUAL (save_matrix_binary (&wide_b, "ooc_b.mtx"), 0);
+    CU_ASSERT_EQUAL (ooc_multiply_files ("ooc_a.mtx", "ooc_b.mtx", "ooc_c.mtx", 0),
+                     0);
+
+    int    rows = 0, cols = 0, stride = 0;
+    size_t offset = 0;
+    FILE*  file   = fdopen (output_open_matrix_binary ("ooc_c.mtx", &rows, &cols,
+                                                      &stride, &offset),
+                          "rb");
+    CU_ASSERT_PTR_NOT_NULL (file);
+    CU_ASSERT_EQUAL (stride, MATRIX_STRIDE (n));
+    if (file && stride == MATRIX_STRIDE (n)) {
+        double row[MATRIX_STRIDE (n)];
+        int    padding = 0;
+        for (int i = 0; i < rows; i++) {
+            fseek (file, (long) (offset + (size_t) i * stride * sizeof (double)),
+                   SEEK_SET);
+            CU_ASSERT_EQUAL (fread (row, sizeof (double), stride, file),
+                             (size_t) stride);
+            for (int j = n; j < stride; j++) padding += row[j] != 0;
+        }
+        CU_ASSERT_EQUAL (padding, 0);
+    }
+    if (file) fclose (file);
+    free_matrix (&wide_a);
+    free_matrix (&wide_b);
+    CU_ASSERT_EQUAL (save_matrix_binary (&a, "ooc_a.mtx"), 0);
+    CU_ASSERT_EQUAL (save_matrix_binary (&b, "ooc_b.mtx"), 0);
+
+    // Несовместимые размеры и запись поверх входного файла
+    CU_ASSERT_EQUAL (ooc_multiply_files ("ooc_a.mtx", "ooc_a.mtx", "ooc_c.mtx", 0),
+                     -1);
+    CU_ASSERT_EQUAL (ooc_multiply_files ("ooc_a.mtx", "ooc_b.mtx", "ooc_a.mtx", 0),
+                     -1);
+
+    free_matrix (&a);
+    free_matrix (&b);
+    free_matrix (&expected);
+    remove ("ooc_a.mtx");
+    remove ("ooc_b.mtx");
+    remove ("ooc_c.mtx");
+}
+
+void test_allocators (void) {
+    // Арена: все матрицы потока, включая временные внутри операций
+    MatrixArena* arena = matrix_arena_create (4096);
+    CU_ASSERT_PTR_NOT_NULL (arena);
+    if (!arena) return;
+
+    CU_ASSERT_PTR_NULL (matrix_set_allocator (matrix_arena_allocator (arena)));
+    for (int job = 0; job < 3; job++) {
+        Matrix a = create_matrix (5, 5);
+        Matrix t = {0};
+        CU_ASSERT_EQUAL (a.storage, MATRIX_ALLOCATED);
+        for (int i = 0; i < 5; i++)
+            for (int j = 0; j < 5; j++) MATRIX_AT (&a, i, j) = (i == j) + j * 0.1;
+
+        // Больше блока - отдельный блок арены
+        Matrix big = create_matrix (40, 40);
+        CU_ASSERT_PTR_NOT_NULL (big.data);
+        t = transpose_matrix (&a);
+        CU_ASSERT_EQUAL (t.storage, MATRIX_ALLOCATED);
+        CU_ASSERT_DOUBLE_EQUAL (determinant (&a), determinant (&t), 1e-12);
+        CU_ASSERT (matrix_arena_used (arena) >= 2 * 5 * 8 * sizeof (MATRIX_TYPE));
+
+        free_matrix (&t);
+        free_matrix (&big);
+        matrix_arena_reset (arena);
+        CU_ASSERT_EQUAL (matrix_arena_used (arena), 0);
+    }
+    // После сброса выделение начинается с начала первого блока
+    Matrix first  = create_matrix (3, 3);
+    matrix_arena_reset (arena);
+    Matrix second = create_matrix (3, 3);
+    CU_ASSERT_PTR_EQUAL (first.data, second.data);
+
+    // Освобождение матрицы до сброса не отдает память живой матрицы
+    MATRIX_AT (&second, 0, 0) = 7;
+    free_matrix (&first);
+    Matrix third = create_matrix (3, 3);
+    CU_ASSERT_PTR_NOT_NULL (third.data);
+    CU_ASSERT_PTR_NOT_EQUAL (third.data, second.data);
+    if (third.data) MATRIX_AT (&third, 0, 0) = 1;
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&second, 0, 0), 7, 0);
+    CU_ASSERT_PTR_EQUAL (matrix_set_allocator (NULL),
+                         matrix_arena_allocator (arena));
+    Matrix owned = create_matrix (2, 2);
+    CU_ASSERT_EQUAL (owned.storage, MATRIX_OWNED);
+    free_matrix (&owned);
+    matrix_arena_destroy (arena);
+
+    // Пул: буфер освобожденной матрицы достается матрице того же класса
+    MatrixPool*            pool      = matrix_pool_create ();
+    const MatrixAllocator* allocator = matrix_pool_allocator (pool);
+    Matrix                 a         = create_matrix_with (10, 10, allocator);
+    Matrix                 b         = create_matrix_with (10, 9, allocator);
+    MATRIX_TYPE*           data      = a.data;
+
+    CU_ASSERT_PTR_NOT_NULL (a.data);
+    CU_ASSERT_EQUAL (matrix_pool_cached (pool), 0);
+    free_matrix (&a);
+    CU_ASSERT_EQUAL (matrix_pool_cached (pool), 10 * 16 * sizeof (MATRIX_TYPE));
+    a = create_matrix_with (10, 12, allocator);
+    CU_ASSERT_PTR_EQUAL (a.data, data);
+    CU_ASSERT_EQUAL (matrix_pool_cached (pool), 0);
+    free_matrix (&a);
+    free_matrix (&b);
+    matrix_pool_trim (pool);
+    CU_ASSERT_EQUAL (matrix_pool_cached (pool), 0);
+    matrix_pool_destroy (pool);
+}
+
+void test_sparse_matrices (void) {
+    // Около 12% ненулевых: SpMV и разбор идут параллельно
+    Matrix   A = create_matrix (600, 500);
+    Matrix   B = create_matrix (500, 300);
+    unsigned seed = 7;
+
+    for (int i = 0; i < A.rows; i++)
+        for (int j = 0; j < A.cols; j++) {
+            seed = seed * 1103515245u + 12345u;
+            MATRIX_AT (&A, i, j) = (seed >> 16) % 8 == 0 ? (int) (seed % 19) - 9 : 0;
+        }
+    for (int i = 0; i < B.rows; i++)
+        for (int j = 0; j < B.cols; j++)
+            MATRIX_AT (&B, i, j) = (i * 7 + j) % 13 == 0;
+
+    SparseMatrix csr = sparse_from_dense (&A, SPARSE_CSR);
+    SparseMatrix csc = sparse_from_dense (&A, SPARSE_CSC);
+    SparseMatrix sb  = sparse_from_dense (&B, SPARSE_CSC);
+    CU_ASSERT_PTR_NOT_NULL (csr.offsets);
+    CU_ASSERT_EQUAL (csr.nnz, csc.nnz);
+    CU_ASSERT (csr.nnz > 32768 && csr.nnz < (size_t) A.rows * A.cols / 4);
+
+    // Плотная -> разреженная -> плотная без потерь
+    Matrix back = create_matrix (600, 500);
+    CU_ASSERT_EQUAL (sparse_to_dense (&csc, &back), 0);
+    assert_matrices_equal (&A, &back);
+
+    // SpMV в обоих форматах
+    MATRIX_TYPE x[500], y_csr[600], y_csc[600];
+    for (int j = 0; j < 500; j++) x[j] = j % 5 - 2;
+    CU_ASSERT_EQUAL (sparse_multiply_vector (&csr, x, y_csr), 0);
+    CU_ASSERT_EQUAL (sparse_multiply_vector (&csc, x, y_csc), 0);
+    for (int i = 0; i < 600; i += 37) {
+        MATRIX_TYPE sum = 0;
+        for (int j = 0; j < 500; j++) sum += MATRIX_AT (&A, i, j) * x[j];
+        CU_ASSERT_DOUBLE_EQUAL (y_csr[i], sum, 0);
+        CU_ASSERT_DOUBLE_EQUAL (y_csc[i], sum, 0);
+    }
+
+    // SpGEMM против плотного умножения (целые значения - точное равенство)
+    Matrix       product = create_matrix (600, 300);
+    Matrix       dense   = create_matrix (600, 300);
+    SparseMatrix C       = sparse_multiply (&csc, &sb);
+    CU_ASSERT_EQUAL (C.format, SPARSE_CSR);
+    CU_ASSERT_EQUAL (multiply_matrices (&A, &B, &product), 0);
+    CU_ASSERT_EQUAL (sparse_to_dense (&C, &dense), 0);
+    assert_matrices_equal (&product, &dense);
+    for (int i = 0; i < C.rows; i++)
+        for (size_t p = C.offsets[i] + 1; p < C.offsets[i + 1]; p++)
+            CU_ASSERT (C.indices[p - 1] < C.indices[p]);
+    CU_ASSERT_PTR_NULL (sparse_multiply (&sb, &csr).offsets);
+
+    // Сложение и вычитание с плотной, результат на месте B
+    Matrix sum = create_matrix (600, 500);
+    CU_ASSERT_EQUAL (sparse_add_dense (&csr, &back, &sum), 0);
+    CU_ASSERT_EQUAL (sparse_subtract_dense (&csc, &back, &back), 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&sum, 5, 7), 2 * MATRIX_AT (&A, 5, 7), 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&back, 5, 7), 0, 0);
+
+    // Триплеты: порядок любой, повторы складываются
+    const int         rows[] = {2, 0, 2, 1, 2};
+    const int         cols[] = {1, 3, 0, 1, 1};
+    const MATRIX_TYPE vals[] = {1.5, 4, -2, 3, 0.5};
+    SparseMatrix      t      = sparse_from_triplets (3, 4, 5, rows, cols, vals,
+                                                     SPARSE_CSR);
+    CU_ASSERT_EQUAL (t.nnz, 4);
+    CU_ASSERT_EQUAL (t.offsets[2], 2);
+    CU_ASSERT_EQUAL (t.indices[2], 0);
+    CU_ASSERT_DOUBLE_EQUAL (t.values[3], 2, 0);
+    CU_ASSERT_PTR_NULL (
+        sparse_from_triplets (3, 3, 5, rows, cols, vals, SPARSE_CSR).offsets);
+
+    // Загрузка из файлов: плотный текст, двоичный, Matrix Market
+    CU_ASSERT_EQUAL (save_matrix_to_file (&A, "test_sparse.txt"), 0);
+    CU_ASSERT_EQUAL (save_matrix_binary (&A, "test_sparse.mtx"), 0);
+    CU_ASSERT_EQUAL (sparse_save_to_file (&csc, "test_sparse_mm.txt"), 0);
+    SparseMatrix text   = sparse_load_from_file ("test_sparse.txt", SPARSE_CSR);
+    SparseMatrix binary = sparse_load_binary ("test_sparse.mtx", SPARSE_CSC);
+    SparseMatrix market = sparse_load_from_file ("test_sparse_mm.txt", SPARSE_CSR);
+    CU_ASSERT_EQUAL (text.nnz, csr.nnz);
+    CU_ASSERT_EQUAL (binary.nnz, csr.nnz);
+    CU_ASSERT_EQUAL (market.nnz, csr.nnz);
+    if (text.offsets && binary.offsets && market.offsets) {
+        CU_ASSERT_EQUAL (memcmp (text.indices, csr.indices, csr.nnz * sizeof (int)),
+                         0);
+        CU_ASSERT_EQUAL (memcmp (market.values, csr.values,
+                                 csr.nnz * sizeof (MATRIX_TYPE)),
+                         0);
+        CU_ASSERT_EQUAL (memcmp (binary.offsets, csc.offsets,
+                                 501 * sizeof (size_t)),
+                         0);
+    }
+
+    // Симметричный Matrix Market: внедиагональные элементы отражаются
+    FILE* f = fopen ("test_sparse_sym.txt", "w");
+    fprintf (f, "%%%%MatrixMarket matrix coordinate real symmetric\n"
+                "%% comment\n3 3 2\n1 1 5\n3 1 -1.25\n");
+    fclose (f);
+    SparseMatrix sym = sparse_load_from_file ("test_sparse_sym.txt", SPARSE_CSC);
+    CU_ASSERT_EQUAL (sym.nnz, 3);
+    if (sym.offsets) {
+        CU_ASSERT_EQUAL (sym.indices[1], 2);
+        CU_ASSERT_DOUBLE_EQUAL (sym.values[2], -1.25, 0);
+    }
+
+    free_matrix (&A);
+    free_matrix (&B);
+    free_matrix (&back);
+    free_matrix (&product);
+    free_matrix (&dense);
+    free_matrix (&sum);
+    sparse_free (&csr);
+    sparse_free (&csc);
+    sparse_free (&sb);
+    sparse_free (&C);
+    sparse_free (&t);
+    sparse_free (&text);
+    sparse_free (&binary);
+    sparse_free (&market);
+    sparse_free (&sym);
+    remove ("test_sparse.txt");
+    remove ("test_sparse.mtx");
+    remove ("test_sparse_mm.txt");
+    remove ("test_sparse_sym.txt");
+}
+
+void test_matrix_dtypes (void) {
+    // Строки каждого типа выровнены по MATRIX_ALIGNMENT байт
+    for (int t = 0; t < MATRIX_DTYPE_COUNT; t++) {
+        Matrix m = create_matrix_dtype (3, 5, (MatrixDtype) t);
+        CU_ASSERT_PTR_NOT_NULL (m.data);
+        CU_ASSERT_EQUAL ((int) m.dtype, t);
+        CU_ASSERT_EQUAL (m.stride * matrix_dtype_size (m.dtype) % MATRIX_ALIGNMENT,
+                         0);
+        free_matrix (&m);
+    }
+    CU_ASSERT_PTR_NULL (create_matrix_dtype (3, 5, MATRIX_DTYPE_COUNT).data);
+    CU_ASSERT_STRING_EQUAL (matrix_dtype_name (MATRIX_INT64), "int64");
+
+    // Произведение каждого типа против double: k и n пересекают границы
+    // блоков ядра, значения малы и суммы точны во всех типах
+    const int m = 7, k = 131, n = 263;
+    Matrix    a = create_matrix (m, k), b = create_matrix (k, n);
+    Matrix    expected = create_matrix (m, n), back = create_matrix (m, n);
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < k; j++) MATRIX_AT (&a, i, j) = (i * 3 + j) % 7 - 3;
+    for (int i = 0; i < k; i++)
+        for (int j = 0; j < n; j++) MATRIX_AT (&b, i, j) = (i + j * 5) % 5 - 2;
+    CU_ASSERT_EQUAL (multiply_matrices (&a, &b, &expected), 0);
+
+    for (int t = 1; t < MATRIX_DTYPE_COUNT; t++) {
+        Matrix ta = create_matrix_dtype (m, k, (MatrixDtype) t);
+        Matrix tb = create_matrix_dtype (k, n, (MatrixDtype) t);
+        Matrix tc = create_matrix_dtype (m, n, (MatrixDtype) t);
+        CU_ASSERT_EQUAL (convert_matrix (&a, &ta), 0);
+        CU_ASSERT_EQUAL (convert_matrix (&b, &tb), 0);
+        CU_ASSERT_EQUAL (multiply_matrices (&ta, &tb, &tc), 0);
+        CU_ASSERT_EQUAL (axpby_matrices (3, &tc, -1, &tc), 0);
+        CU_ASSERT_EQUAL (add_matrices_inplace (&tc, &tc), 0);
+        CU_ASSERT_EQUAL (convert_matrix (&tc, &back), 0);
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++)
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&back, i, j),
+                                        4 * MATRIX_AT (&expected, i, j), 0);
+
+        // Смешение типов не допускается
+        CU_ASSERT_EQUAL (multiply_matrices (&a, &tb, &tc), 1);
+        CU_ASSERT_EQUAL (add_matrices (&ta, &a, &ta), -1);
+        free_matrix (&ta);
+        free_matrix (&tb);
+        free_matrix (&tc);
+    }
+
+    // int32: арифметика по модулю 2^32, насыщение при преобразовании
+    Matrix i32 = create_matrix_dtype (2, 3, MATRIX_INT32);
+    Matrix one = create_matrix_dtype (2, 3, MATRIX_INT32);
+    for (int j = 0; j < 3; j++) {
+        MATRIX_TYPED_AT (int32_t, &i32, 0, j) = INT32_MAX;
+        MATRIX_TYPED_AT (int32_t, &i32, 1, j) = j - 1;
+        MATRIX_TYPED_AT (int32_t, &one, 0, j) = 1;
+        MATRIX_TYPED_AT (int32_t, &one, 1, j) = 10;
+    }
+    CU_ASSERT_EQUAL (add_matrices (&i32, &one, &i32), 0);
+    CU_ASSERT_EQUAL (MATRIX_TYPED_AT (int32_t, &i32, 0, 2), INT32_MIN);
+    CU_ASSERT_EQUAL (axpby_matrices (2, &one, -3, &i32), 0);
+    CU_ASSERT_EQUAL (MATRIX_TYPED_AT (int32_t, &i32, 1, 0), 20 - 27);
+    Matrix big = create_matrix (2, 3);
+    for (int j = 0; j < 3; j++) {
+        MATRIX_AT (&big, 0, j) = 1e12 * (j - 1);
+        MATRIX_AT (&big, 1, j) = -2.75;
+    }
+    CU_ASSERT_EQUAL (convert_matrix (&big, &i32), 0);
+    CU_ASSERT_EQUAL (MATRIX_TYPED_AT (int32_t, &i32, 0, 0), INT32_MIN);
+    CU_ASSERT_EQUAL (MATRIX_TYPED_AT (int32_t, &i32, 0, 1), 0);
+    CU_ASSERT_EQUAL (MATRIX_TYPED_AT (int32_t, &i32, 0, 2), INT32_MAX);
+    CU_ASSERT_EQUAL (MATRIX_TYPED_AT (int32_t, &i32, 1, 1), -2);
+
+    // Транспонирование представления
+    Matrix view = matrix_view (&i32, 0, 1, 2, 2);
+    CU_ASSERT_EQUAL (view.dtype, MATRIX_INT32);
+    Matrix t = transpose_matrix (&view);
+    CU_ASSERT_EQUAL (t.dtype, MATRIX_INT32);
+    CU_ASSERT_EQUAL (t.rows, 2);
+    if (t.data) {
+        CU_ASSERT_EQUAL (MATRIX_TYPED_AT (int32_t, &t, 1, 0), INT32_MAX);
+        CU_ASSERT_EQUAL (MATRIX_TYPED_AT (int32_t, &t, 0, 1), -2);
+    }
+    CU_ASSERT_EQUAL (transpose_matrix_inplace (&i32), -1);
+    CU_ASSERT_DOUBLE_EQUAL (determinant (&view), 0, 0);
+
+    // complex: (1 + 2i)(3 + 4i) + (0 + 1i)(0 + 1i) = -6 + 10i
+    Matrix  z1 = create_matrix_dtype (1, 2, MATRIX_COMPLEX128);
+    Matrix  z2 = create_matrix_dtype (2, 1, MATRIX_COMPLEX128);
+    Matrix  z3 = create_matrix_dtype (1, 1, MATRIX_COMPLEX128);
+    double* p1 = (double*) (void*) z1.data;
+    double* p2 = (double*) (void*) z2.data;
+    double* p3 = (double*) (void*) z3.data;
+    p1[0] = 1, p1[1] = 2, p1[2] = 0, p1[3] = 1;
+    p2[0] = 3, p2[1] = 4;
+    p2[2 * z2.stride] = 0, p2[2 * z2.stride + 1] = 1;
+    CU_ASSERT_EQUAL (multiply_matrices (&z1, &z2, &z3), 0);
+    CU_ASSERT_DOUBLE_EQUAL (p3[0], -6, 0);
+    CU_ASSERT_DOUBLE_EQUAL (p3[1], 10, 0);
+    Matrix re = create_matrix (1, 1);
+    CU_ASSERT_EQUAL (convert_matrix (&z3, &re), 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&re, 0, 0), -6, 0);
+
+    // Двоичный файл хранит тип элементов
+    CU_ASSERT_EQUAL (save_matrix_binary (&z1, "test_dtype.mtx"), 0);
+    Matrix zl = load_matrix_binary_native ("test_dtype.mtx", 0);
+    CU_ASSERT_EQUAL (zl.dtype, MATRIX_COMPLEX128);
+    CU_ASSERT_EQUAL (zl.storage, MATRIX_MAPPED);
+    if (zl.data) CU_ASSERT_DOUBLE_EQUAL (((double*) (void*) zl.data)[3], 1, 0);
+    CU_ASSERT_PTR_NULL (load_matrix_binary ("test_dtype.mtx", 0).data);
+    free_matrix (&zl);
+
+    Matrix i64 = create_matrix_dtype (2, 2, MATRIX_INT64);
+    MATRIX_TYPED_AT (int64_t, &i64, 0, 0) = INT64_MAX;
+    MATRIX_TYPED_AT (int64_t, &i64, 0, 1) = -5;
+    MATRIX_TYPED_AT (int64_t, &i64, 1, 0) = 1LL << 40;
+    MATRIX_TYPED_AT (int64_t, &i64, 1, 1) = 0;
+    CU_ASSERT_EQUAL (save_matrix_binary (&i64, "test_dtype.mtx"), 0);
+    Matrix il = load_matrix_binary_native ("test_dtype.mtx", 1);
+    CU_ASSERT_EQUAL (il.dtype, MATRIX_INT64);
+    if (il.data) CU_ASSERT (MATRIX_TYPED_AT (int64_t, &il, 0, 0) == INT64_MAX);
+    Matrix dl = load_matrix_binary ("test_dtype.mtx", 0);
+    CU_ASSERT_EQUAL (dl.dtype, MATRIX_FLOAT64);
+    if (dl.data) CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&dl, 1, 0), 1LL << 40, 0);
+    free_matrix (&il);
+    free_matrix (&dl);
+
+    // Текстовый файл: целые записываются как double
+    CU_ASSERT_EQUAL (save_matrix_to_file (&i64, "test_dtype.txt"), 0);
+    Matrix text = load_matrix_from_file ("test_dtype.txt");
+    if (text.data) CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&text, 0, 1), -5, 0);
+    CU_ASSERT_EQUAL (save_matrix_to_file (&z1, "test_dtype.txt"), -1);
+    free_matrix (&text);
+
+    free_matrix (&a);
+    free_matrix (&b);
+    free_matrix (&expected);
+    free_matrix (&back);
+    free_matrix (&i32);
+    free_matrix (&one);
+    free_matrix (&big);
+    free_matrix (&t);
+    free_matrix (&z1);
+    free_matrix (&z2);
+    free_matrix (&z3);
+    free_matrix (&re);
+    free_matrix (&i64);
+    remove ("test_dtype.mtx");
+    remove ("test_dtype.txt");
+}
+
+void test_small_kernels (void) {
+    // Размеры по обе стороны от ядер small.c; представления проверяют шаг
+    // строки, преобладающий элемент вне диагонали - перестановку строк
+    for (int n = 1; n <= 10; n++) {
+        Matrix parent = create_matrix (n + 1, n + 3);
+        Matrix a      = matrix_view (&parent, 1, 2, n, n);
+        Matrix b = create_matrix (n, n), c = create_matrix (n, n);
+        Matrix inv = create_matrix (n, n), t = create_matrix (n, n);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                MATRIX_AT (&a, i, j) =
+                    (i * 7 + j * 3) % 5 - 2 + (j == (i + 1) % n) * 3 * n;
+                MATRIX_AT (&b, i, j) = (i + 2 * j) % 3 - 1;
+            }
+        }
+
+        CU_ASSERT_EQUAL (multiply_matrices (&a, &b, &c), 0);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                MATRIX_TYPE sum = 0;
+                for (int k = 0; k < n; k++)
+                    sum += MATRIX_AT (&a, i, k) * MATRIX_AT (&b, k, j);
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&c, i, j), sum, 0);
+            }
+        }
+
+        MATRIX_TYPE log_abs = 0;
+        int         sign    = 0;
+        CU_ASSERT_EQUAL (determinant_log (&a, &log_abs, &sign), 0);
+        const MATRIX_TYPE det = sign * exp (log_abs);
+        CU_ASSERT_DOUBLE_EQUAL (determinant (&a), det, 1e-9 * fabs (det));
+
+        // A x A^-1 = E
+        CU_ASSERT_EQUAL (inverse_matrix (&a, &inv), 0);
+        CU_ASSERT_EQUAL (multiply_matrices (&a, &inv, &c), 0);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&c, i, j), i == j, 1e-12);
+
+        CU_ASSERT_EQUAL (transpose_matrix_into (&a, &t), 0);
+        CU_ASSERT_EQUAL (transpose_matrix_inplace (&a), 0);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&t, i, j), MATRIX_AT (&a, i, j),
+                                        0);
+
+        // Обращение на месте, вырожденная матрица оставляет result как был
+        CU_ASSERT_EQUAL (inverse_matrix (&inv, &inv), 0);
+        CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&inv, n - 1, 0), MATRIX_AT (&a, 0, n - 1),
+                                1e-9);
+        for (int j = 0; j < n; j++) MATRIX_AT (&b, n - 1, j) = 0;
+        CU_ASSERT_DOUBLE_EQUAL (determinant (&b), 0, 0);
+        CU_ASSERT_EQUAL (inverse_matrix (&b, &inv), -1);
+        CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&inv, n - 1, 0), MATRIX_AT (&a, 0, n - 1),
+                                1e-9);
+
+        free_matrix (&parent);
+        free_matrix (&b);
+        free_matrix (&c);
+        free_matrix (&inv);
+        free_matrix (&t);
+    }
+    CU_ASSERT_PTR_NULL (small_kernels (9));
+
+    Matrix rect = create_matrix (2, 3);
+    CU_ASSERT_EQUAL (inverse_matrix (&rect, &rect), -1);
+    free_matrix (&rect);
+}
+
+void test_batch_operations (void) {
+    // Число матриц не кратно куску ядра и шагу выравнивания
+    const int   count = 1003;
+    MatrixBatch A = batch_create (5, 4, count), B = batch_create (4, 6, count);
+    MatrixBatch C = batch_create (5, 6, count), T = batch_create (4, 5, count);
+    CU_ASSERT_PTR_NOT_NULL (A.data);
+    CU_ASSERT_EQUAL (A.stride % MATRIX_ALIGN_ELEMS, 0);
+    CU_ASSERT_EQUAL ((size_t) MATRIX_BATCH_PLANE (&A, 1, 2) % MATRIX_ALIGNMENT, 0);
+
+    Matrix a = create_matrix (5, 4), b = create_matrix (4, 6);
+    Matrix c = create_matrix (5, 6), got = create_matrix (5, 6);
+    Matrix at = create_matrix (4, 5);
+    for (int t = 0; t < count; t++) {
+        for (int i = 0; i < 5; i++)
+            for (int j = 0; j < 4; j++)
+                MATRIX_AT (&a, i, j) = (t + i * 3 + j) % 7 - 3;
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 6; j++)
+                MATRIX_AT (&b, i, j) = (t * 5 + i + j) % 5 - 2;
+        CU_ASSERT_EQUAL (batch_set (&A, t, &a), 0);
+        CU_ASSERT_EQUAL (batch_set (&B, t, &b), 0);
+    }
+    CU_ASSERT_EQUAL (batch_multiply (&A, &B, &C), 0);
+    CU_ASSERT_EQUAL (batch_transpose (&A, &T), 0);
+    for (int t = 0; t < count; t += 97) {
+        CU_ASSERT_EQUAL (batch_get (&A, t, &a), 0);
+        CU_ASSERT_EQUAL (batch_get (&B, t, &b), 0);
+        CU_ASSERT_EQUAL (multiply_matrices (&a, &b, &c), 0);
+        CU_ASSERT_EQUAL (batch_get (&C, t, &got), 0);
+        CU_ASSERT_EQUAL (batch_get (&T, t, &at), 0);
+        for (int i = 0; i < 5; i++) {
+            for (int j = 0; j < 6; j++)
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&got, i, j), MATRIX_AT (&c, i, j),
+                                        0);
+            for (int j = 0; j < 4; j++)
+                CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&at, j, i), MATRIX_AT (&a, i, j),
+                                        0);
+        }
+    }
+
+    // Сложение и вычитание, результат на месте операнда
+    CU_ASSERT_EQUAL (batch_add (&C, &C, &C), 0);
+    CU_ASSERT_EQUAL (batch_subtract (&C, &C, &C), 0);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_BATCH_AT (&C, count - 1, 4, 5), 0, 0);
+    CU_ASSERT_EQUAL (batch_add (&A, &B, &C), -1);
+    CU_ASSERT_EQUAL (batch_multiply (&A, &B, &T), -1);
+    CU_ASSERT_EQUAL (batch_set (&A, count, &a), -1);
+    CU_ASSERT_EQUAL (batch_get (&A, 0, &b), -1);
+
+    // Детерминанты против determinant () для явных формул и LU; в пакет
+    // входят вырожденные матрицы и матрицы, требующие перестановки строк
+    for (int n = 1; n <= 6; n++) {
+        MatrixBatch  S   = batch_create (n, n, 300);
+        Matrix       s   = create_matrix (n, n);
+        MATRIX_TYPE* det = malloc (300 * sizeof (MATRIX_TYPE));
+        for (int t = 0; t < 300; t++) {
+            for (int i = 0; i < n; i++)
+                for (int j = 0; j < n; j++)
+                    MATRIX_AT (&s, i, j) =
+                        t % 10 == 0 ? i + j : (t * 7 + i * 5 + j * j) % 11 - 5;
+            batch_set (&S, t, &s);
+        }
+        CU_ASSERT_EQUAL (batch_determinant (&S, det), 0);
+        for (int t = 0; t < 300; t++) {
+            batch_get (&S, t, &s);
+            const MATRIX_TYPE expected = determinant (&s);
+            CU_ASSERT_DOUBLE_EQUAL (det[t], expected, 1e-9 * (1 + fabs (expected)));
+        }
+
+        // Квадратные матрицы транспонируются на месте
+        const MATRIX_TYPE corner = MATRIX_BATCH_AT (&S, 7, n - 1, 0);
+        CU_ASSERT_EQUAL (batch_transpose (&S, &S), 0);
+        CU_ASSERT_DOUBLE_EQUAL (MATRIX_BATCH_AT (&S, 7, 0, n - 1), corner, 0);
+        batch_free (&S);
+        free_matrix (&s);
+        free (det);
+    }
+    CU_ASSERT_EQUAL (batch_determinant (&A, NULL), -1);
+    CU_ASSERT_EQUAL (batch_transpose (&A, &A), -1);
+
+    // Большой пакет делится между потоками пула
+    MatrixBatch L = batch_create (3, 3, 200000), LT = batch_create (3, 3, 200000);
+    MatrixBatch LC = batch_create (3, 3, 200000);
+    for (int p = 0; p < 9; p++)
+        for (int t = 0; t < L.count; t++)
+            L.data[(size_t) p * L.stride + t] = t % 13 + p;
+    CU_ASSERT_EQUAL (batch_transpose (&L, &LT), 0);
+    CU_ASSERT_EQUAL (batch_multiply (&L, &LT, &LC), 0);
+    const int    last = L.count - 1, v = last % 13;
+    const double sum  = (double) v * v + (v + 1) * (v + 1) + (v + 2) * (v + 2);
+    CU_ASSERT_DOUBLE_EQUAL (MATRIX_BATCH_AT (&LC, last, 0, 0), sum, 0);
+    batch_free (&L);
+    batch_free (&LT);
+    batch_free (&LC);
+
+    CU_ASSERT_PTR_NULL (batch_create (0, 3, 10).data);
+    batch_free (&A);
+    batch_free (&B);
+    batch_free (&C);
+    batch_free (&T);
+    CU_ASSERT_PTR_NULL (A.data);
+    free_matrix (&a);
+    free_matrix (&b);
+    free_matrix (&c);
+    free_matrix (&got);
+    free_matrix (&at);
+}
+
+void test_operation_stats (void) {
+    MatrixStatsEntry entry;
+    Matrix           A = create_matrix (4, 3), B = create_matrix (3, 5);
+    Matrix           C = create_matrix (4, 5);
+
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 3; j++) MATRIX_AT (&A, i, j) = i + j;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 5; j++) MATRIX_AT (&B, i, j) = i - j;
+
+    // Выключенная статистика ничего не копит
+    matrix_stats_enable (0);
+    matrix_stats_reset ();
+    multiply_matrices (&A, &B, &C);
+    matrix_stats_get (MATRIX_OP_MULTIPLY, &entry);
+    CU_ASSERT_EQUAL (entry.calls, 0);
+
+    matrix_stats_enable (1);
+    CU_ASSERT_EQUAL (matrix_stats_enabled (), 1);
+    CU_ASSERT_EQUAL (multiply_matrices (&A, &B, &C), 0);
+    CU_ASSERT_EQUAL (multiply_matrices (&A, &A, &C), 1);
+    CU_ASSERT_EQUAL (matrix_stats_get (MATRIX_OP_MULTIPLY, &entry), 0);
+    CU_ASSERT_STRING_EQUAL (entry.name, "multiply_matrices");
+    CU_ASSERT_EQUAL (entry.calls, 2);
+    CU_ASSERT_EQUAL (entry.flops, 2 * 4 * 5 * 3);
+    CU_ASSERT_EQUAL (entry.bytes_read, (4 * 3 + 3 * 5) * sizeof (MATRIX_TYPE));
+    CU_ASSERT_EQUAL (entry.bytes_written, 4 * 5 * sizeof (MATRIX_TYPE));
+    CU_ASSERT (entry.max_ns <= entry.total_ns);
+
+    // Вложенный вызов output.c учитывается в своей строке, но не в итоге
+    CU_ASSERT_EQUAL (save_matrix_to_file (&C, "test_stats.txt"), 0);
+    Matrix loaded = load_matrix_from_file ("test_stats.txt");
+    CU_ASSERT_PTR_NOT_NULL (loaded.data);
+    matrix_stats_get (MATRIX_OP_SAVE_TO_FILE, &entry);
+    CU_ASSERT_EQUAL (entry.calls, 1);
+    CU_ASSERT (entry.bytes_written > 0);
+    const uint64_t file_bytes = entry.bytes_written;
+    matrix_stats_get (MATRIX_OP_OUTPUT_SAVE_TEXT, &entry);
+    CU_ASSERT_EQUAL (entry.calls, 1);
+    CU_ASSERT_EQUAL (entry.bytes_written, file_bytes);
+    matrix_stats_get (MATRIX_OP_OUTPUT_LOAD_TEXT, &entry);
+    CU_ASSERT_EQUAL (entry.bytes_read, file_bytes);
+    matrix_stats_total (MATRIX_STATS_SAVE, &entry);
+    CU_ASSERT_EQUAL (entry.calls, 1);
+    CU_ASSERT_EQUAL (entry.bytes_written, file_bytes);
+    matrix_stats_total (MATRIX_STATS_LOAD, &entry);
+    CU_ASSERT_EQUAL (entry.calls, 1);
+    CU_ASSERT_EQUAL (entry.bytes_read, file_bytes);
+    matrix_stats_total (MATRIX_STATS_COMPUTE, &entry);
+    CU_ASSERT_EQUAL (entry.calls, 2);
+
+    // Таблица содержит только вызванные операции
+    FILE* dump = tmpfile ();
+    char  line[256];
+    int   rows = 0, found = 0;
+    matrix_stats_dump (dump);
+    rewind (dump);
+    while (fgets (line, sizeof line, dump)) {
+        rows++;
+        if (strncmp (line, "multiply_matrices ", 18) == 0) found = 1;
+        CU_ASSERT_PTR_NULL (strstr (line, "determinant"));
+    }
+    CU_ASSERT (found);
+    CU_ASSERT_EQUAL (rows, 1 + 5 + 1 + 3);
+    fclose (dump);
+
+    matrix_stats_reset ();
+    matrix_stats_get (MATRIX_OP_MULTIPLY, &entry);
+    CU_ASSERT_EQUAL (entry.calls, 0);
+    CU_ASSERT_EQUAL (matrix_stats_get (MATRIX_OP_COUNT, &entry), -1);
+    matrix_stats_enable (0);
+    CU_ASSERT_EQUAL (matrix_stats_enabled (), 0);
+
+    remove ("test_stats.txt");
+    free_matrix (&A);
+    free_matrix (&B);
+    free_matrix (&C);
+    free_matrix (&loaded);
+}
+
+void test_trace_timeline (void) {
+    GemmConfig saved, small = {16, 32, 16, 1};
+    Matrix     A = create_matrix (64, 48), B = create_matrix (48, 40);
+    Matrix     C       = create_matrix (64, 40);
+    const int  threads = thread_pool_threads ();
+
+    for (int i = 0; i < 64; i++)
+        for (int j = 0; j < 48; j++) MATRIX_AT (&A, i, j) = (i * 3 + j) % 7;
+    for (int i = 0; i < 48; i++)
+        for (int j = 0; j < 40; j++) MATRIX_AT (&B, i, j) = (i + j * 5) % 9;
+
+    gemm_get_config (&saved);
+    gemm_set_config (&small);
+    thread_pool_set_threads (3);
+
+    CU_ASSERT_EQUAL (trace_stop (), -1);
+    CU_ASSERT_EQUAL (trace_start ("test_trace.json"), 0);
+    CU_ASSERT_EQUAL (trace_enabled (), 1);
+    TRACE_BEGIN ("compute", "stage");
+    CU_ASSERT_EQUAL (multiply_matrices (&A, &B, &C), 0);
+    TRACE_END ("compute", "stage");
+    CU_ASSERT_EQUAL (trace_stop (), 0);
+    CU_ASSERT_EQUAL (trace_enabled (), 0);
+
+    // После остановки события не пишутся
+    multiply_matrices (&A, &B, &C);
+
+    // Тайлы, участие потоков и операции; начала и концы парные
+    FILE* f = fopen ("test_trace.json", "r");
+    char  line[512];
+    int   tiles = 0, workers = 0, begins = 0, ends = 0, stage = 0, closed = 0;
+    CU_ASSERT_PTR_NOT_NULL (f);
+    while (f && fgets (line, sizeof line, f)) {
+        if (strstr (line, "\"gemm_tile\"")) tiles++;
+        if (strstr (line, "\"worker ")) workers++;
+        if (strstr (line, "\"ph\": \"B\"")) begins++;
+        if (strstr (line, "\"ph\": \"E\"")) ends++;
+        if (strstr (line, "\"compute\", \"cat\": \"stage\"")) stage++;
+        if (strcmp (line, "]}\n") == 0) closed = 1;
+    }
+    if (f) fclose (f);
+    CU_ASSERT (tiles >= 4);
+    CU_ASSERT (workers >= 1);
+    CU_ASSERT_EQUAL (begins, ends);
+    CU_ASSERT (begins >= 3);
+    CU_ASSERT_EQUAL (stage, 2);
+    CU_ASSERT (closed);
+
+    CU_ASSERT_EQUAL (trace_start ("/nonexistent/dir/trace.json"), -1);
+    remove ("test_trace.json");
+    thread_pool_set_threads (threads);
+    gemm_set_config (&saved);
+    free_matrix (&A);
+    free_matrix (&B);
+    free_matrix (&C);
+}
+
+void test_perf_counters (void) {
+    MatrixStatsEntry entry;
+    Matrix           A = create_matrix (32, 32), B = create_matrix (32, 32);
+    Matrix           C = create_matrix (32, 32);
+
+    for (int i = 0; i < 32; i++)
+        for (int j = 0; j < 32; j++) {
+            MATRIX_AT (&A, i, j) = i + j;
+            MATRIX_AT (&B, i, j) = i - j;
+        }
+
+    CU_ASSERT_STRING_EQUAL (perf_event_name (MATRIX_PERF_CYCLES), "cycles");
+    CU_ASSERT_STRING_EQUAL (perf_event_name (MATRIX_PERF_EVENT_COUNT), "unknown");
+
+    // Без PMU (виртуальная машина) события не открываются
+    const int events = matrix_stats_enable_perf (1);
+    CU_ASSERT (events == -1 || (events > 0 && events == perf_opened ()));
+    if (events > 0) {
+        CU_ASSERT (matrix_stats_mode () & MATRIX_STATS_PERF);
+        matrix_stats_reset ();
+        CU_ASSERT_EQUAL (multiply_matrices (&A, &B, &C), 0);
+        matrix_stats_get (MATRIX_OP_MULTIPLY, &entry);
+        CU_ASSERT_EQUAL (entry.calls, 1);
+        if (events & (1 << MATRIX_PERF_INSTRUCTIONS))
+            CU_ASSERT (entry.perf[MATRIX_PERF_INSTRUCTIONS] > 0);
+        if (events & (1 << MATRIX_PERF_CYCLES))
+            CU_ASSERT (entry.perf[MATRIX_PERF_CYCLES] > 0);
+    } else {
+        CU_ASSERT_EQUAL (perf_opened (), 0);
+        CU_ASSERT_EQUAL (matrix_stats_mode () & MATRIX_STATS_PERF, 0);
+    }
+
+    CU_ASSERT_EQUAL (matrix_stats_enable_perf (0), 0);
+    CU_ASSERT_EQUAL (perf_opened (), 0);
+    CU_ASSERT_EQUAL (matrix_stats_mode () & MATRIX_STATS_PERF, 0);
+    matrix_stats_reset ();
+    matrix_stats_enable (0);
+
+    free_matrix (&A);
+    free_matrix (&B);
+    free_matrix (&C);
+}
+
+void test_autotune (void) {
+    GemmConfig     saved_gemm, gemm;
+    StrassenConfig saved_strassen, strassen;
+    TuneParams     params = {{48, 96, 1024, 40}, {2048, 512}}, loaded;
+    char           path[64], line[256];
+    int            records = 0, foreign = 0;
+
+    gemm_get_config (&saved_gemm);
+    strassen_get_config (&saved_strassen);
+
+    // Пустая переменная выключает файл по умолчанию
+    const char* env = getenv ("MATRIX_TUNE_FILE");
+    char        saved_env[256];
+    snprintf (saved_env, sizeof saved_env, "%s", env ? env : "");
+    setenv ("MATRIX_TUNE_FILE", "", 1);
+    CU_ASSERT_PTR_NULL (tune_default_file (path, sizeof path));
+    setenv ("MATRIX_TUNE_FILE", "test_tune.txt", 1);
+    CU_ASSERT_PTR_NOT_NULL (tune_default_file (path, sizeof path));
+    CU_ASSERT_STRING_EQUAL (path, "test_tune.txt");
+    if (env) setenv ("MATRIX_TUNE_FILE", saved_env, 1);
+    else unsetenv ("MATRIX_TUNE_FILE");
+
+    // Запись другого процессора сохраняется, своя заменяется
+    FILE* f = fopen ("test_tune.txt", "w");
+    CU_ASSERT_PTR_NOT_NULL (f);
+    if (f) {
+        fprintf (f, "cpu = Other CPU\nsimd = generic\ngemm = 8 8 8 8\n"
+                    "strassen = 0 64\n");
+        fclose (f);
+    }
+    CU_ASSERT_EQUAL (tune_save ("test_tune.txt", &params), 0);
+    params.gemm.mc = 64;
+    CU_ASSERT_EQUAL (tune_save ("test_tune.txt", &params), 0);
+    f = fopen ("test_tune.txt", "r");
+    while (f && fgets (line, sizeof line, f)) {
+        if (strncmp (line, "cpu = ", 6) == 0) records++;
+        if (strstr (line, "Other CPU")) foreign = 1;
+    }
+    if (f) fclose (f);
+    CU_ASSERT_EQUAL (records, 2);
+    CU_ASSERT (foreign);
+
+    CU_ASSERT_EQUAL (tune_load ("test_tune.txt", &loaded), 0);
+    gemm_get_config (&gemm);
+    strassen_get_config (&strassen);
+    CU_ASSERT_EQUAL (loaded.gemm.mc, 64);
+    CU_ASSERT_EQUAL (gemm.mc, 64);
+    CU_ASSERT_EQUAL (gemm.kc, 96);
+    CU_ASSERT_EQUAL (gemm.nc, 1024);
+    CU_ASSERT_EQUAL (gemm.threshold, 40);
+    CU_ASSERT_EQUAL (strassen.threshold, 2048);
+    CU_ASSERT_EQUAL (strassen.crossover, 512);
+
+    // Некорректная запись не меняет параметры
+    params.gemm.kc = 0;
+    CU_ASSERT_EQUAL (tune_save ("test_tune.txt", &params), 0);
+    CU_ASSERT_EQUAL (tune_load ("test_tune.txt", NULL), -1);
+    gemm_get_config (&gemm);
+    CU_ASSERT_EQUAL (gemm.kc, 96);
+    CU_ASSERT_EQUAL (tune_load ("test_tune_missing.txt", NULL), -1);
+
+    // Подобранные параметры установлены и дают верное произведение
+    CU_ASSERT_EQUAL (tune_run (TUNE_QUICK, &params), 0);
+    gemm_get_config (&gemm);
+    CU_ASSERT_EQUAL (gemm.mc, params.gemm.mc);
+    CU_ASSERT_EQUAL (gemm.kc, params.gemm.kc);
+    CU_ASSERT_EQUAL (gemm.threshold, params.gemm.threshold);
+    CU_ASSERT (gemm.threshold >= 16);
+
+    Matrix A = create_matrix (70, 50), B = create_matrix (50, 60);
+    Matrix C = create_matrix (70, 60);
+    for (int i = 0; i < 70; i++)
+        for (int j = 0; j < 50; j++) MATRIX_AT (&A, i, j) = (i + 2 * j) % 9;
+    for (int i = 0; i < 50; i++)
+        for (int j = 0; j < 60; j++) MATRIX_AT (&B, i, j) = (i * j) % 7;
+    CU_ASSERT_EQUAL (multiply_matrices (&A, &B, &C), 0);
+    for (int i = 0; i < 70; i += 23) {
+        for (int j = 0; j < 60; j += 17) {
+            double sum = 0;
+            for (int p = 0; p < 50; p++)
+                sum += MATRIX_AT (&A, i, p) * MATRIX_AT (&B, p, j);
+            CU_ASSERT_DOUBLE_EQUAL (MATRIX_AT (&C, i, j), sum, 1e-9);
+        }
+    }
+
+    remove ("test_tune.txt");
+    gemm_set_config (&saved_gemm);
+    strassen_set_config (&saved_strassen);
+    free_matrix (&A);
+    free_matrix (&B);
+    free_matrix (&C);
+}
+
 void test_file_errors (void) {
     // Тест с несуществующим файлом
     Matrix loaded = load_matrix_from_file ("nonexistent.txt");
@@ -201,9 +1722,30 @@ void register_matrix_tests (void) {
     CU_pSuite suite = CU_add_suite ("Matrix Tests", NULL, NULL);
     CU_add_test (suite, "Matrix Creation", test_matrix_creation);
     CU_add_test (suite, "Matrix Addition", test_matrix_addition);
+    CU_add_test (suite, "In-Place and Accumulate", test_inplace_accumulate);
     CU_add_test (suite, "Matrix Multiplication", test_matrix_multiplication);
+    CU_add_test (suite, "Matrix Multiplication Blocked",
+                 test_matrix_multiplication_blocked);
+    CU_add_test (suite, "Thread Pool Worker Bound", test_thread_pool_workers);
+    CU_add_test (suite, "Strassen-Winograd Multiplication", test_strassen_multiply);
+    CU_add_test (suite, "Fused A x B^T - C + D", test_fused_multiply);
+    CU_add_test (suite, "Lazy Expressions", test_expression);
+    CU_add_test (suite, "Submatrix Views", test_matrix_view);
     CU_add_test (suite, "Matrix Transpose", test_matrix_transpose);
+    CU_add_test (suite, "Matrix Transpose In Place", test_matrix_transpose_inplace);
+    CU_add_test (suite, "SIMD Kernels", test_simd_kernels);
     CU_add_test (suite, "Matrix Determinant", test_determinant);
     CU_add_test (suite, "NULL Safety", test_null_safety);
     CU_add_test (suite, "File Operations", test_file_operations);
+    CU_add_test (suite, "Binary File Operations", test_binary_file_operations);
+    CU_add_test (suite, "Out-of-Core Multiplication", test_out_of_core_multiply);
+    CU_add_test (suite, "Arena and Pool Allocators", test_allocators);
+    CU_add_test (suite, "Sparse CSR/CSC Matrices", test_sparse_matrices);
+    CU_add_test (suite, "Float, Integer and Complex Types", test_matrix_dtypes);
+    CU_add_test (suite, "Fixed-Size Small Kernels", test_small_kernels);
+    CU_add_test (suite, "Operation Counters and Timers", test_operation_stats);
+    CU_add_test (suite, "Trace Event Timeline", test_trace_timeline);
+    CU_add_test (suite, "Hardware Performance Counters", test_perf_counters);
+    CU_add_test (suite, "Autotuned Block Sizes and Thresholds", test_autotune);
+    CU_add_test (suite, "Batched Small Matrices", test_batch_operations);
 }
@@ -7,6 +7,7 @@
 #include "../src/output/output.h"
 
 #include <CUnit/CUnit.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,11 +25,11 @@ void test_output_print_matrix (void) {
     // Тест с нормальной матрицей
     double data1[4] = {1.0, 2.0, 3.0, 4.0};
     printf ("Ожидаемый вывод для матрицы 2x2:\n");
-    output_print_matrix (2, 2, data1);
+    output_print_matrix (2, 2, 2, data1);
 
     // Тест с NULL данными
     printf ("Ожидаемое сообщение об ошибке:\n");
-    output_print_matrix (2, 2, NULL);
+    output_print_matrix (2, 2, 2, NULL);
 }
 
 void test_output_save_matrix_to_file (void) {
@@ -36,7 +37,7 @@ void test_output_save_matrix_to_file (void) {
     double      data[4]  = {1.1, 2.2, 3.3, 4.4};
 
     // Успешное сохранение
-    CU_ASSERT_EQUAL (output_save_matrix_to_file (2, 2, data, filename), 0);
+    CU_ASSERT_EQUAL (output_save_matrix_to_file (2, 2, 2, data, filename), 0);
 
     // Проверка содержимого файла
     FILE* f = fopen (filename, "r");
@@ -56,22 +57,93 @@ void test_output_save_matrix_to_file (void) {
     }
 
     // Ошибка при NULL данных
-    CU_ASSERT_EQUAL (output_save_matrix_to_file (2, 2, NULL, filename), -1);
+    CU_ASSERT_EQUAL (output_save_matrix_to_file (2, 2, 2, NULL, filename), -1);
 
     // Ошибка при неверном имени файла
     CU_ASSERT_EQUAL (
-        output_save_matrix_to_file (2, 2, data, "/invalid/path/matrix.txt"), -1);
+        output_save_matrix_to_file (2, 2, 2, data, "/invalid/path/matrix.txt"), -1);
 
     remove (filename);
 }
 
+void test_output_save_formats (void) {
+    const char* filename = "test_formats.txt";
+    const int   rows = 300, cols = 500;
+    double*     data = malloc ((size_t) rows * cols * sizeof (double));
+    uint64_t    seed = 12345;
+
+    CU_ASSERT_PTR_NOT_NULL (data);
+    if (!data) return;
+
+    // Случайные биты плюс трудные для форматирования значения
+    for (int i = 0; i < rows * cols; i++) {
+        seed       = seed * 6364136223846793005ull + 1442695040888963407ull;
+        uint64_t b = (seed >> 12) | ((uint64_t) (900 + i % 250) << 52);
+        memcpy (&data[i], &b, sizeof (double));
+    }
+    const double special[] = {0.1,    0.3,
+                              -0.0,   1e21,
+                              1e23,   5e-324,
+                              -13.5,  2.2250738585072014e-308,
+                              1e-7,   1.7976931348623157e308};
+    memcpy (data, special, sizeof (special));
+
+    // Кратчайшая и шестнадцатеричная записи читаются обратно точно; большая
+    // матрица проходит через несколько подзадач и пакетов записи
+    const OutputFormat exact[] = {OUTPUT_FORMAT_SHORTEST, OUTPUT_FORMAT_HEX};
+    for (int f = 0; f < 2; f++) {
+        int     r, c, stride;
+        double* loaded = NULL;
+
+        CU_ASSERT_EQUAL (output_set_format (exact[f], 0), 0);
+        CU_ASSERT_EQUAL (
+            output_save_matrix_to_file (rows, cols, cols, data, filename), 0);
+        loaded = output_load_matrix_from_file (&r, &c, &stride, filename);
+        CU_ASSERT_PTR_NOT_NULL (loaded);
+        if (loaded) {
+            int mismatches = 0;
+            for (int i = 0; i < rows; i++)
+                mismatches += memcmp (&loaded[(size_t) i * stride],
+                                      &data[(size_t) i * cols],
+                                      (size_t) cols * sizeof (double)) != 0;
+            CU_ASSERT_EQUAL (mismatches, 0);
+            free (loaded);
+        }
+    }
+
+    // Фиксированная точность
+    const double small[] = {1.0, 0.125, -2.5, 1e-9};
+    char         text[64] = {0};
+    CU_ASSERT_EQUAL (output_set_format (OUTPUT_FORMAT_FIXED, 3), 0);
+    CU_ASSERT_EQUAL (output_save_matrix_to_file (2, 2, 2, small, filename), 0);
+    FILE* f = fopen (filename, "r");
+    if (f) {
+        fread (text, 1, sizeof (text) - 1, f);
+        fclose (f);
+    }
+    CU_ASSERT_STRING_EQUAL (text, "2 2\n1.000 0.125\n-2.500 0.000\n");
+
+    int          precision = 0;
+    OutputFormat format    = OUTPUT_FORMAT_SHORTEST;
+    output_get_format (&format, &precision);
+    CU_ASSERT_EQUAL (format, OUTPUT_FORMAT_FIXED);
+    CU_ASSERT_EQUAL (precision, 3);
+
+    CU_ASSERT_EQUAL (output_set_format (OUTPUT_FORMAT_FIXED, -1), -1);
+    CU_ASSERT_EQUAL (output_set_format ((OutputFormat) 42, 2), -1);
+    CU_ASSERT_EQUAL (output_set_format (OUTPUT_FORMAT_SHORTEST, 2), 0);
+
+    free (data);
+    remove (filename);
+}
+
 void test_output_load_matrix_from_file (void) {
     const char* filename     = "test_load.txt";
     const char* file_content = "2 2\n1.5 2.5\n3.5 4.5\n";
     create_test_file (filename, file_content);
 
-    int     rows, cols;
-    double* data = output_load_matrix_from_file (&rows, &cols, filename);
+    int     rows, cols, stride;
+    double* data = output_load_matrix_from_file (&rows, &cols, &stride, filename);
 
     // Проверка успешной загрузки
     CU_ASSERT_PTR_NOT_NULL (data);
@@ -79,57 +151,300 @@ void test_output_load_matrix_from_file (void) {
         CU_ASSERT_EQUAL (rows, 2);
         CU_ASSERT_EQUAL (cols, 2);
         CU_ASSERT_DOUBLE_EQUAL (data[0], 1.5, 0.001);
-        CU_ASSERT_DOUBLE_EQUAL (data[3], 4.5, 0.001);
+        CU_ASSERT_DOUBLE_EQUAL (data[stride + 1], 4.5, 0.001);
         free (data);
     }
 
     // Тест с несуществующим файлом
     double* invalid_data =
-        output_load_matrix_from_file (&rows, &cols, "nonexistent.txt");
+        output_load_matrix_from_file (&rows, &cols, &stride, "nonexistent.txt");
     CU_ASSERT_PTR_NULL (invalid_data);
 
     // Тест с поврежденным файлом (неправильные размеры)
     const char* bad_content1 = "2 a\n1 2\n3 4\n";
     create_test_file (filename, bad_content1);
-    double* bad_data1 = output_load_matrix_from_file (&rows, &cols, filename);
+    double* bad_data1 =
+        output_load_matrix_from_file (&rows, &cols, &stride, filename);
     CU_ASSERT_PTR_NULL (bad_data1);
 
     // Тест с поврежденным файлом (недостаточно данных)
     const char* bad_content2 = "2 2\n1 2\n3\n";
     create_test_file (filename, bad_content2);
-    double* bad_data2 = output_load_matrix_from_file (&rows, &cols, filename);
+    double* bad_data2 =
+        output_load_matrix_from_file (&rows, &cols, &stride, filename);
     CU_ASSERT_PTR_NULL (bad_data2);
 
     remove (filename);
 }
 
+void test_output_parse_text (void) {
+    const char* filename = "test_parse.txt";
+    int         rows, cols, stride;
+
+    // Разные формы чисел, CRLF, табуляция и строки, не совпадающие со строками
+    // матрицы
+    create_test_file (filename, "2 3\r\n1e3\t-.5 +2.\r\n 0.1 -0\n\n"
+                                "12345678901234567890123 trailing");
+    double* data = output_load_matrix_from_file (&rows, &cols, &stride, filename);
+    CU_ASSERT_PTR_NOT_NULL (data);
+    if (data) {
+        CU_ASSERT_EQUAL (rows, 2);
+        CU_ASSERT_EQUAL (cols, 3);
+        CU_ASSERT_DOUBLE_EQUAL (data[0], 1000, 0);
+        CU_ASSERT_DOUBLE_EQUAL (data[1], -0.5, 0);
+        CU_ASSERT_DOUBLE_EQUAL (data[2], 2, 0);
+        CU_ASSERT_EQUAL (data[stride], 0.1);
+        CU_ASSERT_DOUBLE_EQUAL (data[stride + 2], 1.2345678901234568e22, 1e7);
+        free (data);
+    }
+
+    // Некорректное число внутри данных
+    create_test_file (filename, "1 3\n1 2x 3\n");
+    CU_ASSERT_PTR_NULL (output_load_matrix_from_file (&rows, &cols, &stride,
+                                                      filename));
+
+    // Файл на несколько кусков разбора: значения с 17 значащими цифрами
+    // должны восстанавливаться точно
+    const int n = 300;
+    FILE*     f = fopen (filename, "w");
+    if (f) {
+        fprintf (f, "%d %d\n", n, n);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) fprintf (f, "%.17g ", (i - j) / 7.0);
+            fprintf (f, "\n");
+        }
+        fclose (f);
+    }
+    data = output_load_matrix_from_file (&rows, &cols, &stride, filename);
+    CU_ASSERT_PTR_NOT_NULL (data);
+    if (data) {
+        int mismatches = 0;
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                mismatches += data[(size_t) i * stride + j] != (i - j) / 7.0;
+        CU_ASSERT_EQUAL (mismatches, 0);
+        free (data);
+    }
+
+    remove (filename);
+}
+
+void test_output_sparse_text (void) {
+    const char* filename = "test_sparse_text.txt";
+    int         rows, cols;
+    size_t      count;
+    int*        row_index;
+    int*        col_index;
+    double*     values;
+
+    // Плотный текст: нули не сохраняются, порядок - по строкам
+    create_test_file (filename, "3 3\n0 2.5 0\n0 0 0\n-1 0 4\n");
+    CU_ASSERT_EQUAL (output_load_sparse_from_file (filename, &rows, &cols, &count,
+                                                   &row_index, &col_index, &values),
+                     0);
+    CU_ASSERT_EQUAL (count, 3);
+    if (values) {
+        CU_ASSERT_EQUAL (row_index[1], 2);
+        CU_ASSERT_EQUAL (col_index[2], 2);
+        CU_ASSERT_DOUBLE_EQUAL (values[0], 2.5, 0);
+    }
+    free (row_index);
+    free (col_index);
+    free (values);
+
+    // Matrix Market pattern: значения равны единице, регистр не важен
+    create_test_file (filename, "%%MatrixMarket MATRIX Coordinate pattern general\n"
+                                "2 5 2\n2 5\n1 3\n");
+    CU_ASSERT_EQUAL (output_load_sparse_from_file (filename, &rows, &cols, &count,
+                                                   &row_index, &col_index, &values),
+                     0);
+    CU_ASSERT_EQUAL (cols, 5);
+    if (values) {
+        CU_ASSERT_EQUAL (row_index[0], 1);
+        CU_ASSERT_EQUAL (col_index[0], 4);
+        CU_ASSERT_DOUBLE_EQUAL (values[1], 1, 0);
+    }
+    free (row_index);
+    free (col_index);
+    free (values);
+
+    // Индекс вне матрицы и неподдерживаемый формат array
+    create_test_file (filename, "%%MatrixMarket matrix coordinate real general\n"
+                                "2 2 1\n3 1 1.0\n");
+    CU_ASSERT_EQUAL (output_load_sparse_from_file (filename, &rows, &cols, &count,
+                                                   &row_index, &col_index, &values),
+                     -1);
+    CU_ASSERT_PTR_NULL (values);
+    create_test_file (filename, "%%MatrixMarket matrix array real general\n"
+                                "1 1\n1.0\n");
+    CU_ASSERT_EQUAL (output_load_sparse_from_file (filename, &rows, &cols, &count,
+                                                   &row_index, &col_index, &values),
+                     -1);
+
+    remove (filename);
+}
+
 void test_file_operations_integration (void) {
     const char* filename = "test_integration.txt";
     double      data[4]  = {1.0, 2.0, 3.0, 4.0};
 
     // Сохраняем матрицу
-    CU_ASSERT_EQUAL (output_save_matrix_to_file (2, 2, data, filename), 0);
+    CU_ASSERT_EQUAL (output_save_matrix_to_file (2, 2, 2, data, filename), 0);
 
     // Загружаем обратно
-    int     rows, cols;
-    double* loaded_data = output_load_matrix_from_file (&rows, &cols, filename);
+    int     rows, cols, stride;
+    double* loaded_data =
+        output_load_matrix_from_file (&rows, &cols, &stride, filename);
     CU_ASSERT_PTR_NOT_NULL (loaded_data);
     if (loaded_data) {
         CU_ASSERT_EQUAL (rows, 2);
         CU_ASSERT_EQUAL (cols, 2);
         CU_ASSERT_DOUBLE_EQUAL (loaded_data[0], 1.0, 0.001);
-        CU_ASSERT_DOUBLE_EQUAL (loaded_data[3], 4.0, 0.001);
+        CU_ASSERT_DOUBLE_EQUAL (loaded_data[stride + 1], 4.0, 0.001);
         free (loaded_data);
     }
 
     remove (filename);
 }
 
+// Записывает value в файл с порядком байт, обратным порядку этой машины
+static void write_swapped (FILE* f, const void* value, size_t size) {
+    const unsigned char* bytes = value;
+    for (size_t i = size; i > 0; i--) fputc (bytes[i - 1], f);
+}
+
+void test_output_binary_matrix (void) {
+    const char* filename = "test_binary.mtx";
+    double      data[15];   // 3 x 5 с шагом 5
+    int         rows, cols, stride;
+    size_t      mapped;
+
+    for (int i = 0; i < 15; i++) data[i] = i * 0.5 - 3;
+
+    CU_ASSERT_EQUAL (output_save_matrix_binary (3, 5, 5, data, filename), 0);
+    CU_ASSERT_EQUAL (output_is_binary_matrix (filename), 1);
+
+    // Только чтение: данные указывают в отображение файла
+    double* mapped_data = output_map_matrix_binary (&rows, &cols, &stride, &mapped,
+                                                    0, filename);
+    CU_ASSERT_PTR_NOT_NULL (mapped_data);
+    if (mapped_data) {
+        CU_ASSERT_EQUAL (rows, 3);
+        CU_ASSERT_EQUAL (cols, 5);
+        CU_ASSERT_EQUAL (stride, MATRIX_STRIDE (5));
+        CU_ASSERT (mapped > 0);
+        CU_ASSERT_EQUAL ((uintptr_t) mapped_data % MATRIX_ALIGNMENT, 0);
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 5; j++)
+                CU_ASSERT_DOUBLE_EQUAL (mapped_data[i * stride + j], data[i * 5 + j],
+                                        0);
+        output_unmap_matrix (mapped_data, mapped);
+    }
+
+    // Копирование при записи: файл не меняется
+    mapped_data = output_map_matrix_binary (&rows, &cols, &stride, &mapped, 1,
+                                            filename);
+    CU_ASSERT_PTR_NOT_NULL (mapped_data);
+    if (mapped_data) {
+        mapped_data[0] = 100;
+        output_unmap_matrix (mapped_data, mapped);
+        mapped_data = output_map_matrix_binary (&rows, &cols, &stride, &mapped, 0,
+                                                filename);
+        CU_ASSERT_PTR_NOT_NULL (mapped_data);
+        if (mapped_data) {
+            CU_ASSERT_DOUBLE_EQUAL (mapped_data[0], data[0], 0);
+            output_unmap_matrix (mapped_data, mapped);
+        }
+    }
+
+    // Обрезанный файл и текстовый файл не принимаются
+    FILE* f = fopen (filename, "r+b");
+    if (f) {
+        char header[OUTPUT_BINARY_HEADER_SIZE];
+        CU_ASSERT_EQUAL (fread (header, 1, sizeof (header), f), sizeof (header));
+        fclose (f);
+        f = fopen (filename, "wb");
+        fwrite (header, 1, sizeof (header), f);
+        fclose (f);
+    }
+    CU_ASSERT_PTR_NULL (output_map_matrix_binary (&rows, &cols, &stride, &mapped,
+                                                  0, filename));
+    create_test_file (filename, "2 2\n1 2\n3 4\n");
+    CU_ASSERT_EQUAL (output_is_binary_matrix (filename), 0);
+    CU_ASSERT_PTR_NULL (output_map_matrix_binary (&rows, &cols, &stride, &mapped,
+                                                  0, filename));
+
+    // Чужой порядок байт и float: чтение с преобразованием в свой буфер
+    const uint32_t fields[3] = {OUTPUT_BINARY_VERSION, 0x01020304u,
+                                OUTPUT_DTYPE_FLOAT32};
+    const uint64_t dims[3]   = {2, 3, 3};
+    const uint32_t layout[2] = {4, OUTPUT_BINARY_HEADER_SIZE};
+    const float    values[6] = {1.5f, -2, 3, 4, 5.25f, 6};
+    f                        = fopen (filename, "wb");
+    if (f) {
+        fwrite (OUTPUT_BINARY_MAGIC, 1, 4, f);
+        for (int i = 0; i < 3; i++) write_swapped (f, &fields[i], sizeof (uint32_t));
+        for (int i = 0; i < 3; i++) write_swapped (f, &dims[i], sizeof (uint64_t));
+        for (int i = 0; i < 2; i++) write_swapped (f, &layout[i], sizeof (uint32_t));
+        for (int i = 0; i < 16; i++) fputc (0, f);
+        for (int i = 0; i < 6; i++) write_swapped (f, &values[i], sizeof (float));
+        fclose (f);
+    }
+    mapped_data = output_map_matrix_binary (&rows, &cols, &stride, &mapped, 0,
+                                            filename);
+    CU_ASSERT_PTR_NOT_NULL (mapped_data);
+    if (mapped_data) {
+        CU_ASSERT_EQUAL (rows, 2);
+        CU_ASSERT_EQUAL (cols, 3);
+        CU_ASSERT_EQUAL (mapped, 0);
+        CU_ASSERT_DOUBLE_EQUAL (mapped_data[0], 1.5, 0);
+        CU_ASSERT_DOUBLE_EQUAL (mapped_data[stride + 1], 5.25, 0);
+        free (mapped_data);
+    }
+
+    // Чужой порядок байт и complex: тип сохраняется, половины
+    // переставляются по отдельности
+    const uint32_t ctype[3]  = {OUTPUT_BINARY_VERSION, 0x01020304u,
+                                OUTPUT_DTYPE_COMPLEX128};
+    const uint64_t cdims[3]  = {1, 2, 2};
+    const double   parts[4]  = {1.5, -2, 0.25, 8};
+    OutputDtype    dtype     = OUTPUT_DTYPE_FLOAT64;
+    f                        = fopen (filename, "wb");
+    if (f) {
+        fwrite (OUTPUT_BINARY_MAGIC, 1, 4, f);
+        for (int i = 0; i < 3; i++) write_swapped (f, &ctype[i], sizeof (uint32_t));
+        for (int i = 0; i < 3; i++) write_swapped (f, &cdims[i], sizeof (uint64_t));
+        for (int i = 0; i < 2; i++) write_swapped (f, &layout[i], sizeof (uint32_t));
+        for (int i = 0; i < 16; i++) fputc (0, f);
+        for (int i = 0; i < 4; i++) write_swapped (f, &parts[i], sizeof (double));
+        fclose (f);
+    }
+    double* complex_data = output_map_matrix_typed (&rows, &cols, &stride, &dtype,
+                                                    &mapped, 0, filename);
+    CU_ASSERT_PTR_NOT_NULL (complex_data);
+    if (complex_data) {
+        CU_ASSERT_EQUAL (dtype, OUTPUT_DTYPE_COMPLEX128);
+        CU_ASSERT_EQUAL (cols, 2);
+        CU_ASSERT_EQUAL (mapped, 0);
+        for (int i = 0; i < 4; i++)
+            CU_ASSERT_DOUBLE_EQUAL (complex_data[i], parts[i], 0);
+        free (complex_data);
+    }
+    CU_ASSERT_PTR_NULL (output_map_matrix_binary (&rows, &cols, &stride, &mapped,
+                                                  0, filename));
+
+    remove (filename);
+}
+
 void register_output_tests (void) {
     CU_pSuite suite = CU_add_suite ("Output Tests", NULL, NULL);
     CU_add_test (suite, "Print Matrix", test_output_print_matrix);
     CU_add_test (suite, "Save Matrix to File", test_output_save_matrix_to_file);
+    CU_add_test (suite, "Save Number Formats", test_output_save_formats);
     CU_add_test (suite, "Load Matrix from File", test_output_load_matrix_from_file);
+    CU_add_test (suite, "Binary Matrix Format", test_output_binary_matrix);
+    CU_add_test (suite, "Parallel Text Parser", test_output_parse_text);
+    CU_add_test (suite, "Sparse Text Loader", test_output_sparse_text);
     CU_add_test (suite, "File Operations Integration",
                  test_file_operations_integration);
 }